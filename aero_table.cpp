@@ -0,0 +1,91 @@
+//--------------------------------------------------------
+//
+// Aero table - precomputed lift and flap curves for the flight model
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "aero_table.h"
+#include "common_defs.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define AERO_PI			3.14159265358979
+#define AERO_RADtoDEG	57.2957795130823
+#define AERO_INCIDENCE	1.0				// deg, added to the flow angle as in the force pass
+
+AeroTable::AeroTable ()
+{
+	BuildDefault ();
+}
+
+// AOA of entry k, the inverse of u = sin(angle/2)
+static double EntryAOA ( int k )
+{
+	double u = (double) k / AERO_TABLE_SIZE;
+	return 2.0 * asin ( u ) * AERO_RADtoDEG + AERO_INCIDENCE;
+}
+
+void AeroTable::BuildDefault ()
+{
+	for (int k = 0; k <= AERO_TABLE_SIZE; k++) {
+		double aoa = EntryAOA ( k );
+		m_aoa[k] = (float) aoa;
+		m_cl[k] = (float) sin ( aoa * 0.2 );
+		m_flap[k] = (float) cos ( (double) k / AERO_TABLE_SIZE * (AERO_PI/2.0) );
+	}
+}
+
+void AeroTable::BuildLift ( const float* aoa, const float* cl, int n )
+{
+	int j = 0;
+	for (int k = 0; k <= AERO_TABLE_SIZE; k++) {
+		double a = EntryAOA ( k );
+		m_aoa[k] = (float) a;
+		// clamp outside the polar, else interpolate between samples
+		if ( n == 1 || a <= aoa[0] ) { m_cl[k] = cl[0]; continue; }
+		if ( a >= aoa[n-1] ) { m_cl[k] = cl[n-1]; continue; }
+		while ( j < n-2 && aoa[j+1] < a ) j++;
+		double t = (a - aoa[j]) / (aoa[j+1] - aoa[j]);
+		m_cl[k] = (float) ( cl[j] + (cl[j+1] - cl[j]) * t );
+	}
+}
+
+bool AeroTable::LoadPolar ( const char* fname )
+{
+	FILE* fp = fopen ( fname, "rt" );
+	if ( fp == 0x0 ) {
+		dbgprintf ( "ERROR: Unable to open polar %s\n", fname );
+		return false;
+	}
+	std::vector<float> aoa, cl;
+	char buf[1024];
+	int line = 0;
+	bool ok = true;
+	while ( fgets ( buf, 1024, fp ) ) {
+		line++;
+		char* c = strchr ( buf, '#' );		// strip comments
+		if ( c ) *c = '\0';
+		float a, l;
+		char extra;
+		int n = sscanf ( buf, "%f %f %c", &a, &l, &extra );
+		if ( n == EOF ) continue;			// blank
+		if ( n != 2 || (!aoa.empty() && a <= aoa.back()) ) {
+			dbgprintf ( "ERROR: %s:%d: expected \"aoa CL\" with ascending aoa\n", fname, line );
+			ok = false;
+			break;
+		}
+		aoa.push_back ( a );
+		cl.push_back ( l );
+	}
+	fclose ( fp );
+	if ( ok && aoa.empty() ) {
+		dbgprintf ( "ERROR: Polar %s is empty\n", fname );
+		ok = false;
+	}
+	if ( ok ) BuildLift ( aoa.data(), cl.data(), (int) aoa.size() );
+	return ok;
+}
@@ -0,0 +1,59 @@
+//--------------------------------------------------------
+//
+// Aero table - precomputed lift and flap curves for the flight model
+//
+// Replaces the acos / sin / cos of the force pass with table lookups and
+// linear interpolation. The lift table is indexed straight from the dot
+// product of body forward and the velocity axis through
+//   u = sqrt((1-dot)/2) = sin(angle/2)
+// which is close to linear in the angle near zero AOA, where acos(dot) is
+// ill-conditioned, so the table stays accurate where aircraft actually fly.
+// Each entry holds the AOA (deg, with the model's +1 deg incidence) and CL.
+// The flap table is indexed by speed / max speed.
+// BuildDefault reproduces the analytic model, LoadPolar reads an airfoil
+// polar. A table can be shared by any number of models.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_AERO_TABLE
+	#define DEF_AERO_TABLE
+
+	#include <math.h>
+
+	#define AERO_TABLE_SIZE		1024		// intervals per table, 4 KB each
+
+	class AeroTable {
+	public:
+		AeroTable ();
+
+		void		BuildDefault ();											// CL = sin(0.2 aoa), flap lift = cos(pi/2 speed/max)
+		void		BuildLift ( const float* aoa, const float* cl, int n );		// CL from polar samples (deg), ascending aoa
+		bool		LoadPolar ( const char* fname );							// text file of "aoa CL" lines, # comments
+
+		// AOA (deg) and CL for dot = fwd . vaxis, nan gives the zero-angle entry
+		inline void	Lookup ( float dot, float& aoa, float& cl ) const {
+			float u = sqrtf ( fminf ( fmaxf ( (1.0f - dot) * 0.5f, 0.0f ), 1.0f ) );
+			float f = u * AERO_TABLE_SIZE;
+			int i = (int) f;
+			if ( i > AERO_TABLE_SIZE-1 ) i = AERO_TABLE_SIZE-1;
+			float t = f - i;
+			aoa = m_aoa[i] + (m_aoa[i+1] - m_aoa[i]) * t;
+			cl = m_cl[i] + (m_cl[i+1] - m_cl[i]) * t;
+		}
+		// Flap lift factor for s = speed / max speed in [0,1]
+		inline float FlapLift ( float s ) const {
+			float f = fminf ( fmaxf ( s, 0.0f ), 1.0f ) * AERO_TABLE_SIZE;
+			int i = (int) f;
+			if ( i > AERO_TABLE_SIZE-1 ) i = AERO_TABLE_SIZE-1;
+			return m_flap[i] + (m_flap[i+1] - m_flap[i]) * (f - i);
+		}
+
+		float		m_aoa[AERO_TABLE_SIZE+1];		// by u
+		float		m_cl[AERO_TABLE_SIZE+1];		// by u
+		float		m_flap[AERO_TABLE_SIZE+1];		// by speed / max speed
+	};
+
+#endif
@@ -0,0 +1,68 @@
+//--------------------------------------------------------
+//
+// Aircraft traits - per-type constants for specialized flight model steps
+//
+// Each aircraft type is a traits struct of static inline accessors. The
+// force passes, scalar, AVX2 and NEON, and the integrate pass are templates
+// on the traits, so for the constant types every coefficient folds into the
+// instruction stream and branches like flaps drop out at compile time. AircraftDefault reads the
+// tunable FlightModel members instead, and is the type new models start as.
+// Wind is a separate template flag, chosen per step by hasWind().
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_AIRCRAFT_TRAITS
+	#define DEF_AIRCRAFT_TRAITS
+
+	class FlightModel;
+
+	// Aircraft types, FlightModel::setAircraftType
+	#define AIRCRAFT_DEFAULT	0		// runtime parameters (m_LiftFactor, m_DragFactor, m_mass, m_max_speed)
+	#define AIRCRAFT_TRAINER	1
+	#define AIRCRAFT_GLIDER		2
+	#define AIRCRAFT_JET		3
+	#define AIRCRAFT_TYPES		4
+
+	struct AircraftDefault {
+		static inline float	LiftFactor ( const FlightModel& m );
+		static inline float	DragFactor ( const FlightModel& m );
+		static inline float	Mass ( const FlightModel& m );
+		static inline float	MaxSpeed ( const FlightModel& m );
+		static inline float	AirDensity ( const FlightModel& )	{ return 1.225f; }		// kg/m^3
+		static const bool	has_flaps = true;
+	};
+
+	// The stock aircraft, as AircraftDefault with its initial values
+	struct AircraftTrainer {
+		static inline float	LiftFactor ( const FlightModel& )	{ return 0.0001f; }
+		static inline float	DragFactor ( const FlightModel& )	{ return 0.0001f; }
+		static inline float	Mass ( const FlightModel& )			{ return 0.1f; }
+		static inline float	MaxSpeed ( const FlightModel& )		{ return 500.0f; }
+		static inline float	AirDensity ( const FlightModel& )	{ return 1.225f; }
+		static const bool	has_flaps = true;
+	};
+
+	// High lift, low drag, no flaps, slow
+	struct AircraftGlider {
+		static inline float	LiftFactor ( const FlightModel& )	{ return 0.00015f; }
+		static inline float	DragFactor ( const FlightModel& )	{ return 0.00005f; }
+		static inline float	Mass ( const FlightModel& )			{ return 0.08f; }
+		static inline float	MaxSpeed ( const FlightModel& )		{ return 120.0f; }
+		static inline float	AirDensity ( const FlightModel& )	{ return 1.225f; }
+		static const bool	has_flaps = false;
+	};
+
+	// Heavier, less lift, fast
+	struct AircraftJet {
+		static inline float	LiftFactor ( const FlightModel& )	{ return 0.00008f; }
+		static inline float	DragFactor ( const FlightModel& )	{ return 0.00006f; }
+		static inline float	Mass ( const FlightModel& )			{ return 0.15f; }
+		static inline float	MaxSpeed ( const FlightModel& )		{ return 500.0f; }
+		static inline float	AirDensity ( const FlightModel& )	{ return 1.225f; }
+		static const bool	has_flaps = true;
+	};
+
+#endif
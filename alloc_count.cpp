@@ -0,0 +1,97 @@
+//--------------------------------------------------------
+//
+// Alloc count - counts heap allocations made through operator new
+//
+// Every replaceable form of operator new is replaced, since which of them
+// the library versions forward to differs between standard libraries.
+// Aligned forms use the platform's aligned allocator and matching free.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include "alloc_count.h"
+
+static std::atomic<uint64_t> g_alloc_total ( 0 );
+static thread_local uint64_t g_alloc_thread = 0;
+
+uint64_t AllocCountThread ()	{ return g_alloc_thread; }
+uint64_t AllocCountTotal ()		{ return g_alloc_total.load ( std::memory_order_relaxed ); }
+
+static inline void* CountedAlloc ( size_t sz )
+{
+	g_alloc_thread++;
+	g_alloc_total.fetch_add ( 1, std::memory_order_relaxed );
+	return malloc ( sz ? sz : 1 );
+}
+
+static inline void* CountedAllocAligned ( size_t sz, size_t align )
+{
+	g_alloc_thread++;
+	g_alloc_total.fetch_add ( 1, std::memory_order_relaxed );
+	if ( sz == 0 ) sz = 1;
+	#ifdef _WIN32
+		return _aligned_malloc ( sz, align );
+	#else
+		void* p = 0x0;
+		if ( posix_memalign ( &p, align < sizeof(void*) ? sizeof(void*) : align, sz ) != 0 ) return 0x0;
+		return p;
+	#endif
+}
+
+static inline void FreeAligned ( void* p )
+{
+	#ifdef _WIN32
+		_aligned_free ( p );
+	#else
+		free ( p );
+	#endif
+}
+
+void* operator new ( size_t sz )
+{
+	void* p = CountedAlloc ( sz );
+	if ( p == 0x0 ) throw std::bad_alloc ();
+	return p;
+}
+void* operator new[] ( size_t sz )
+{
+	void* p = CountedAlloc ( sz );
+	if ( p == 0x0 ) throw std::bad_alloc ();
+	return p;
+}
+void* operator new ( size_t sz, const std::nothrow_t& ) noexcept		{ return CountedAlloc ( sz ); }
+void* operator new[] ( size_t sz, const std::nothrow_t& ) noexcept		{ return CountedAlloc ( sz ); }
+
+void* operator new ( size_t sz, std::align_val_t al )
+{
+	void* p = CountedAllocAligned ( sz, (size_t) al );
+	if ( p == 0x0 ) throw std::bad_alloc ();
+	return p;
+}
+void* operator new[] ( size_t sz, std::align_val_t al )
+{
+	void* p = CountedAllocAligned ( sz, (size_t) al );
+	if ( p == 0x0 ) throw std::bad_alloc ();
+	return p;
+}
+void* operator new ( size_t sz, std::align_val_t al, const std::nothrow_t& ) noexcept	{ return CountedAllocAligned ( sz, (size_t) al ); }
+void* operator new[] ( size_t sz, std::align_val_t al, const std::nothrow_t& ) noexcept	{ return CountedAllocAligned ( sz, (size_t) al ); }
+
+void operator delete ( void* p ) noexcept								{ free ( p ); }
+void operator delete[] ( void* p ) noexcept								{ free ( p ); }
+void operator delete ( void* p, size_t ) noexcept						{ free ( p ); }
+void operator delete[] ( void* p, size_t ) noexcept						{ free ( p ); }
+void operator delete ( void* p, const std::nothrow_t& ) noexcept		{ free ( p ); }
+void operator delete[] ( void* p, const std::nothrow_t& ) noexcept		{ free ( p ); }
+
+void operator delete ( void* p, std::align_val_t ) noexcept				{ FreeAligned ( p ); }
+void operator delete[] ( void* p, std::align_val_t ) noexcept			{ FreeAligned ( p ); }
+void operator delete ( void* p, size_t, std::align_val_t ) noexcept		{ FreeAligned ( p ); }
+void operator delete[] ( void* p, size_t, std::align_val_t ) noexcept	{ FreeAligned ( p ); }
+void operator delete ( void* p, std::align_val_t, const std::nothrow_t& ) noexcept		{ FreeAligned ( p ); }
+void operator delete[] ( void* p, std::align_val_t, const std::nothrow_t& ) noexcept	{ FreeAligned ( p ); }
@@ -0,0 +1,25 @@
+//--------------------------------------------------------
+//
+// Alloc count - counts heap allocations made through operator new
+//
+// alloc_count.cpp replaces the global operator new and delete with ones
+// that forward to malloc and free and count every new, so the HUD can show
+// allocations per frame. The counts are totals since startup, taken before
+// and after a frame. Only C++ allocations are counted, not direct calls to
+// malloc or aligned_alloc (the flight model's AlignedAlloc) or those made
+// inside the GL driver.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_ALLOC_COUNT
+	#define DEF_ALLOC_COUNT
+
+	#include <stdint.h>
+
+	uint64_t	AllocCountThread ();			// made by the calling thread
+	uint64_t	AllocCountTotal ();				// made by all threads
+
+#endif
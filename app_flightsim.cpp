@@ -13,7 +13,7 @@
 //    Stalls - with zero power, aoa and drag increases, causing stalls.
 //    Landing/Take off - ground conditions. zero roll/pitch, ground friction
 //    Taxiing - on the ground left/right becomes rudder
-//    Wind - modify the m_wind variable to introduce wind
+//    Wind - modify the FlightModel m_wind variable to introduce wind, press 'g' for turbulence
 //    Flaps - press the 'f' key for flags. increases drag, useful when landing.
 //
 // Orientation is a unique challenge. A common way to implement this is to
@@ -29,6 +29,10 @@
 // for lift forces. However there is no torque, angular velocity or rotational inertia.
 // These assumptions can still cause stalls, but not flat spins or 3D flying.
 //
+// The model itself lives in flight_model.cpp and steps any number of aircraft.
+// This sample flies a single aircraft (m_player). The model is stepped on a
+// physics thread (physics_thread.cpp), and display mirrors the latest snapshot.
+//
 //--------------------------------------------------------------------------------
 // Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
 //
@@ -48,13 +52,38 @@
 //
 
 #include <time.h>
+#include <chrono>
 #include "main.h"			// window system 
 #include "quaternion.h"
+#include "flight_model.h"
+#include "render_grid.h"
+#include "render_terrain.h"
+#include "render_lines.h"
+#include "render_aircraft.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include "hud_text.h"
+#include "text_format.h"
+#include "flight_recorder.h"
+#include "physics_thread.h"
+#include "net_sync.h"
+#include "perf_timer.h"
+#include "frame_arena.h"
+#include "alloc_count.h"
+#include "asset_bundle.h"
 
 #include "gxlib.h"			// low-level render
 #include "g2lib.h"			// gui system
 using namespace glib;
 
+#define PERF_HUD_LINES	16
+#define FRAME_ARENA_SIZE	(1 << 20)		// per-frame scratch (bytes)
+#define NUM_TIME_SCALES	10
+#define NUM_TURBULENCE	4
+
+static const float g_time_scales[NUM_TIME_SCALES] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };		// - and = keys
+static const float g_turbulence[NUM_TURBULENCE] = { 0, 7.5, 15, 23 };		// W20 (m/s), none, light, moderate, severe. 'g' key
+
 class Sample : public Application {
 public:
 	virtual bool init();
@@ -67,30 +96,80 @@ public:
 	virtual void mousewheel(int delta);
 	virtual void shutdown();
 
-	void		Advance ();
-	void		CheckLanding ();
+	void		ShowSnapshot ( const FlightSnapshot& s );
+	void		SendControls ();
+	void		InitHUD ();
+	void		PlaybackStep ();
+	void		ShowRecord ( int i );
+	void		ToggleRecord ();
+	void		TogglePlayback ();
+	void		UpdateHUD ();
+	void		ReadContacts ();
+	void		UpdatePerfHUD ();
 	void		CameraToCockpit();
 	void		drawGrid( Vec4F clr );
 	
-	// state variables
+	AssetBundle	m_bundle;			// packed font and grid, mapped, when tools/asset_pack has made one
+	bool		m_started;			// first frame drawn, startup report printed
+	FlightModel	m_model;		// owned by m_phys once started, runways are read-only
+	PhysicsThread m_phys;
+	NetSync		m_net;				// multiplayer, when flightsim_net.txt exists
+	GridRenderer m_grid;		// tiled ground grid
+	float		m_world_extent;		// ground grid covers +/- extent (m)
+	Terrain		m_terrain;			// streamed heightfield, flat ground if there is none
+	TerrainRenderer m_terrain_draw;
+	WindField	m_wind_field;		// shear and turbulence around the aircraft
+	int			m_turbulence;		// index into g_turbulence
+	LineBatcher	m_lines;			// force vectors and other debug lines
+	AircraftRenderer m_aircraft;	// instanced from the snapshot's fleet arrays
+	const FlightSnapshot* m_snap;	// latest physics step, 0x0 during playback
+	HudText		m_hud;				// cached instrument text
+	int			m_hud_time, m_hud_speed, m_hud_power, m_hud_alt, m_hud_sink;		// HUD field ids
+	int			m_hud_aoa, m_hud_roll, m_hud_pitch, m_hud_heading, m_hud_flaps, m_hud_landing;
+	int			m_hud_perf[PERF_HUD_LINES];		// perf overlay, header then one line per phase
+	int			m_hud_alloc;		// perf overlay, heap allocations and arena use
+	bool		m_perf_hud;
+	int			m_perf_frame;
+	FrameArena	m_frame;			// transient render and text data, reset when a frame is drawn
+	uint64_t	m_frame_allocs, m_frame_allocs_all;		// heap allocations in the last frame, render thread and all threads
+	uint64_t	m_allocs_max;		// most in one frame since the overlay was last updated
+	int			m_player;			// aircraft flown by the user
+
+	// state variables (player aircraft, copied from the physics snapshot each frame)
 	Vec3F		m_pos, m_vel;
 	Quaternion	m_orient;	
-	float		m_roll, m_pitch, m_pitch_adv, m_power;
+	float		m_roll, m_pitch, m_power;		// player inputs, sent to m_phys on change
 
 	// extra variables (for rendering/debug)
-	Vec3F		m_lift, m_thrust, m_drag, m_force, m_accel;
-	float		m_speed, m_max_speed, m_aoa;
+	Vec3F		m_lift, m_thrust, m_drag, m_force;
+	float		m_speed, m_aoa, m_ground;
 	float		m_DT, m_flaps;
-	Vec3F		m_wind;
 
-	float		m_runway_length;
-	float		m_runway_width;
-	std::string m_landing_info;
-	bool		m_landing_status;
-	int			m_airborn;
+	LandingStatus m_landing;		// player's last touchdown, from the snapshot
+	int			m_landing_shown;	// touchdown count formatted into the HUD, -1 = none
+	int			m_hud_traffic;		// HUD field, the player's closest encounter
+	int			m_traffic;			// aircraft within the near-miss distance of the player, from contact events, -1 = none
+	bool		m_traffic_collided;
+	int			m_contacts;			// pairs of the fleet within the near-miss distance, from the snapshot
 
 	float		m_time;
 	bool		m_run, m_flightcam;
+
+	// real-time stepping
+	bool		m_realtime;				// physics paced to wall-clock, otherwise one step per frame
+	int			m_time_scale;			// index into g_time_scales, fast time above 0
+	Vec3F		m_draw_pos;				// interpolated between the last two steps for rendering
+	Quaternion	m_draw_orient;
+
+	// flight recorder, the physics thread appends each step while recording
+	bool		m_recording;
+	bool		m_autopilot;			// player flown by the physics thread's autopilot, from the snapshot
+	bool		m_telemetry;			// fleet telemetry streaming, from the snapshot
+	FlightPlayback m_play;
+	std::chrono::steady_clock::time_point m_clock;		// playback wall-clock
+	bool		m_playing;
+	double		m_play_time;			// playback position (sec after the first record)
+
 	Camera3D*	m_cam;
 	int			mouse_down;
 };
@@ -107,6 +186,30 @@ bool Sample::init ()
 	init2D ( "arial" );
 	setview2D ( w, h );	
 	setTextSz ( 16, 1 );		
+	PerfStartupMark ( "init2D" );
+
+	m_started = false;
+	m_bundle.Open ( ASSET_PATH BUNDLE_NAME );		// see tools/asset_pack.cpp
+	m_frame.Init ( FRAME_ARENA_SIZE );
+	m_frame_allocs = 0; m_frame_allocs_all = 0; m_allocs_max = 0;
+	m_grid.Init ();
+	m_lines.Init ();
+	m_aircraft.Init ();
+	m_snap = 0x0;
+	PerfStartupMark ( "renderers" );
+	InitHUD ();
+	PerfStartupMark ( "hud" );
+	m_playing = false;
+	m_play_time = 0;
+	m_world_extent = 27500;
+	if ( m_terrain.Open ( ASSET_PATH "terrain" ) ) {		// see tools/terrain_tiles.cpp
+		m_model.setTerrain ( &m_terrain );
+		m_terrain_draw.Init ( m_terrain.getSpacing() );
+	}
+	m_wind_field.Open ();
+	m_model.setWindField ( &m_wind_field );
+	m_turbulence = 0;
+	PerfStartupMark ( "terrain, wind" );
 	
 	m_cam = new Camera3D;
 	m_cam->setFov ( 120 );
@@ -115,209 +218,302 @@ bool Sample::init ()
 
 	m_pos.Set (0, 10, 0);
 	m_vel.Set (0, 0, 200);
-	m_airborn = 1;
 	m_roll = 0;
 	m_pitch = 0;
 	m_power = 3;				// "throttle up"
-	m_pitch_adv = 0;
-	m_accel.Set(0,0,0);
-	m_orient.fromDirectionAndRoll ( Vec3F(0,0,1), m_roll );
 	m_flaps = 0;
-	m_max_speed = 500.0;		// top speed, 500 m/s = 1800 kph = 1118 mph
+	if ( m_terrain.isOpen() ) {			// tiles under the spawn point, so the first steps see the real ground
+		m_terrain.UpdateFocus ( 1, &m_pos.x, &m_pos.z, PHYS_FOCUS_RADIUS );
+		m_terrain.Wait ();
+		PerfStartupMark ( "terrain tiles" );
+	}
+	m_player = m_model.AddAircraft ( m_pos, m_vel, m_power );		// oriented along velocity
+	const Runway& rw = m_model.getRunway ( 0 );
+	m_grid.Build ( rw.half_width, rw.half_length, m_world_extent, m_bundle.isOpen() ? &m_bundle : 0x0 );
+	PerfStartupMark ( "grid" );
+	m_orient = m_model.getOrient ( m_player );
+	m_speed = m_vel.Length();
+	m_aoa = 0;
+	m_ground = 0;
+	m_lift = 0; m_thrust = 0; m_drag = 0; m_force = 0;
+	m_landing.flags = 0;
+	m_landing.count = 0;
+	m_landing_shown = -1;
+	m_traffic = -1;
+	m_traffic_collided = false;
+	m_contacts = 0;
 
 	m_DT = 0.001;
-
-	m_runway_length = 2000;		// 2000 meters (6560 ft)
-	m_runway_width = 50;		// 50 meters (164 ft)
-
-	m_wind.Set (0, 0, 0);
+	m_time = 0;
+
+	m_realtime = true;
+	m_time_scale = 0;
+	m_recording = false;
+	m_autopilot = false;
+	m_telemetry = false;
+	m_clock = std::chrono::steady_clock::now();
+	m_draw_pos = m_pos;
+	m_draw_orient = m_orient;
+
+	if ( m_net.Load ( "flightsim_net.txt" ) ) {		// see net_sync.h for the format
+		m_net.AddLocal ( m_player );
+		m_phys.setNet ( &m_net );
+	}
+	m_phys.setWind ( &m_wind_field );
+	m_phys.Start ( &m_model, m_player, m_DT, m_terrain.isOpen() ? &m_terrain : 0x0, "flightsim.rec" );
+	SendControls ();
+	PerfStartupMark ( "physics" );
 
 	return true;
 }
 
 void Sample::drawGrid( Vec4F clr )
 {
-	Vec3F a;
-	float o = 0.02;
-
-	// runway
-	float x = m_runway_width;
-	float z = m_runway_length;
-	drawLine3D ( Vec3F(-x, o,-z), Vec3F(-x, o, z), Vec4F(0,0,1,1) );
-	drawLine3D ( Vec3F(-x, o, z), Vec3F( x, o, z), Vec4F(0,0,1,1) );
-	drawLine3D ( Vec3F( x, o, z), Vec3F( x, o,-z), Vec4F(0,0,1,1) );
-	drawLine3D ( Vec3F( x, o,-z), Vec3F(-x, o,-z), Vec4F(0,0,1,1) );	
-	for (int n=-z; n < z; n+= 60) {
-		drawLine3D ( Vec3F( 1, o, n), Vec3F( 1, o, n+20), Vec4F(1,1,1,1) );
-		drawLine3D ( Vec3F(-1, o, n), Vec3F(-1, o, n+20), Vec4F(1,1,1,1) );
+	// Terrain clipmap, when there is terrain
+	m_terrain_draw.Draw ( m_cam, m_terrain );
+
+	// Runway and grid are static, built once into a VBO (see grid_mesh.cpp)
+	// and rebuilt only if the runway changes
+	const Runway& rw = m_model.getRunway ( 0 );
+	m_grid.Draw ( m_cam, rw.half_width, rw.half_length, m_frame );
+}
+
+void Sample::InitHUD ()
+{
+	if ( !m_hud.Init ( ASSET_PATH "arial", 16, m_bundle.isOpen() ? &m_bundle : 0x0 ) ) return;
+
+	Vec4F white (1,1,1,1);
+	float col = 10 + m_hud.getTextWidth ( "Sink rate: " );		// value column
+	m_hud.AddLabel ( 10, 20, "INPUT:     LFT/RIGHT = Ailerons, UP/DOWN = Elevators, W/S keys = THROTTLE, F = FLAPS, T = REALTIME, - = = TIME SCALE, R = RECORD, P = PLAY, [ ] = SEEK, N = TRAFFIC", white );
+	m_hud.AddLabel ( 10, 40, "Time:", white );
+	m_hud.AddLabel ( 10, 60, "INSTRUMENTS:", white );
+	m_hud.AddLabel ( 10, 80, "Speed:", white );
+	m_hud.AddLabel ( 10, 100, "Power:", white );
+	m_hud.AddLabel ( 10, 120, "Altitude:", white );
+	m_hud.AddLabel ( 10, 140, "Sink rate:", white );
+	m_hud.AddLabel ( 10, 160, "AOA:", white );
+	m_hud.AddLabel ( 10, 180, "Roll:", white );
+	m_hud.AddLabel ( 10, 200, "Pitch:", white );
+	m_hud.AddLabel ( 10, 220, "Heading:", white );
+	m_hud.AddLabel ( 10, 240, "Flaps:", white );
+
+	m_hud_time =	m_hud.AddField ( col, 40, 40, white );
+	m_hud_speed =	m_hud.AddField ( col, 80, 48, white );
+	m_hud_power =	m_hud.AddField ( col, 100, 16, white );
+	m_hud_alt =		m_hud.AddField ( col, 120, 20, white );
+	m_hud_sink =	m_hud.AddField ( col, 140, 20, white );
+	m_hud_aoa =		m_hud.AddField ( col, 160, 16, white );
+	m_hud_roll =	m_hud.AddField ( col, 180, 16, white );
+	m_hud_pitch =	m_hud.AddField ( col, 200, 16, white );
+	m_hud_heading =	m_hud.AddField ( col, 220, 16, white );
+	m_hud_flaps =	m_hud.AddField ( col, 240, 8, white );
+	m_hud_landing =	m_hud.AddField ( 10, 280, 200, white );
+	m_hud_traffic =	m_hud.AddField ( 10, 300, 48, white );
+
+	for (int k=0; k < PERF_HUD_LINES; k++)
+		m_hud_perf[k] = m_hud.AddField ( 10, 360 + k*20, 64, Vec4F(1,1,0,1) );
+	m_hud_alloc = m_hud.AddField ( 10, 360 + PERF_HUD_LINES*20, 80, Vec4F(1,1,0,1) );
+	m_perf_hud = false;
+	m_perf_frame = 0;
+}
+
+void Sample::UpdateHUD ()
+{
+	// Fields are formatted each frame but only re-laid out when the text changes
+	Vec3F angs;
+	m_orient.toEuler ( angs );
+
+	TextBuf t;
+	t.Clear ();	t.Float ( m_time, 4, 2 ).Str ( m_playing ? " s (playback" : m_realtime ? " s (realtime" : " s (steps/frame" );
+	if ( m_time_scale > 0 ) t.Str ( " x" ).Int ( (int) g_time_scales[m_time_scale] );
+	if ( m_turbulence > 0 ) t.Str ( ", turb " ).Float ( g_turbulence[m_turbulence], 2, 1 );
+	m_hud.SetText ( m_hud_time, t.Str ( ")" ).Str ( m_recording ? ", REC" : "" ).Str ( m_autopilot ? ", AP" : "" ).Str ( m_telemetry ? ", TEL" : "" ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_speed,	t.Float ( m_speed, 4, 3 ).Str ( " m/s, " ).Float ( m_speed*3.6, 4, 1 ).Str ( " kph, " ).Float ( m_speed*2.237, 4, 1 ).Str ( " mph" ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_power,	t.Float ( m_power, 4, 1 ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_alt,		t.Float ( m_pos.y, 4, 2 ).Str ( " m" ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_sink,		t.Float ( m_vel.y, 4, 2 ).Str ( " m/s" ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_aoa,		t.Float ( m_aoa, 4, 4 ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_roll,		t.Float ( angs.x, 4, 1 ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_pitch,	t.Float ( angs.y, 4, 1 ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_heading,	t.Float ( angs.z, 4, 1 ).c_str() );
+	t.Clear ();	m_hud.SetText ( m_hud_flaps,	t.Float ( m_flaps, 1, 0 ).c_str() );
+
+	// Landing text is only formatted when a touchdown is scored or expires
+	int shown = (m_landing.flags & LAND_VALID) ? m_landing.count : -1;
+	char* msg = (shown != m_landing_shown) ? m_frame.Alloc<char> ( 512 ) : 0x0;
+	if ( msg ) {
+		FlightModel::FormatLanding ( m_landing, msg, 512 );
+		m_hud.SetText ( m_hud_landing, msg );
+		m_hud.SetColor ( m_hud_landing, (m_landing.flags & LAND_OK) ? Vec4F(0,1,0,1) : Vec4F(1,0,0,1) );
+		m_landing_shown = shown;
 	}
 
-	// center section
-	o = -0.02;			// offset
-	for (int n=-5000; n <= 5000; n += 50 ) {
-		drawLine3D ( Vec3F(n, o,-5000), Vec3F(n, o, 5000), Vec4F(.6,.6,.6, .5) );
-		drawLine3D ( Vec3F(-5000, o, n), Vec3F(5000, o, n), Vec4F(.6,.6,.6, .5) );
+	// Traffic, the player's encounter at its present distance, else the fleet's
+	t.Clear ();
+	const FlightSnapshot* s = m_snap;
+	if ( m_traffic >= 0 && s && m_traffic < s->num ) {
+		Vec3F d = Vec3F ( s->px[m_traffic], s->py[m_traffic], s->pz[m_traffic] ) - m_pos;
+		t.Str ( m_traffic_collided ? "COLLISION: aircraft " : "TRAFFIC: aircraft " ).Int ( m_traffic ).Str ( ", " ).Float ( d.Length(), 1, 0 ).Str ( " m" );
+		m_hud.SetColor ( m_hud_traffic, m_traffic_collided ? Vec4F(1,0,0,1) : Vec4F(1,1,0,1) );
+	} else if ( m_contacts > 0 ) {
+		t.Str ( "Traffic: " ).Int ( m_contacts ).Str ( m_contacts == 1 ? " pair close" : " pairs close" );
+		m_hud.SetColor ( m_hud_traffic, Vec4F(1,1,1,1) );
 	}
-	
-	// large sections
-	for (int j=-5; j <=5 ; j++) {
-		for (int k=-5; k <=5; k++) {
-			a = Vec3F(j, 0, k) * Vec3F(5000,0,5000);
-			if (j==0 && k==0) continue;
-			for (int n=0; n <= 5000; n+= 200) {
-				drawLine3D ( Vec3F(a.x,   o, a.z+n), Vec3F(a.x+5000, o, a.z+n), Vec4F(.3,.3,.3, .5) );
-				drawLine3D ( Vec3F(a.x+n,-o, a.z  ), Vec3F(a.x+n,    o, a.z+5000), Vec4F(.3,.3,.3, .5) );
-			}
+	m_hud.SetText ( m_hud_traffic, t.c_str() );
+}
+
+// Contact events from the physics thread's broadphase. Only the player's
+// are shown, the rest are counted in the snapshot.
+void Sample::ReadContacts ()
+{
+	ContactEvent e;
+	while ( m_phys.getContacts().Pop ( e ) ) {
+		if ( e.a != m_player && e.b != m_player ) continue;
+		int other = (e.a == m_player) ? e.b : e.a;
+		if ( e.type == CONTACT_CLEAR ) {
+			if ( other == m_traffic ) { m_traffic = -1; m_traffic_collided = false; }
+		} else {
+			if ( other != m_traffic ) m_traffic_collided = false;
+			m_traffic = other;
+			if ( e.type == CONTACT_COLLIDE ) m_traffic_collided = true;
 		}
 	}
-
 }
 
-void Sample::CheckLanding ()
+void Sample::UpdatePerfHUD ()
 {
-	if ( m_airborn > 2000 ) {
-
-		char msg[4096];
-		Vec3F angs;
-		m_orient.toEuler ( angs );			
-		
-		// Check for good landing:
-		// - Speed < 80 m/s
-		// - Sink rate < 2 m/s
-		// - Pitch < 5 deg
-		// - Roll < 5 deg	
-		// - On runway
-		
-		bool ok_speed = (m_speed < 80);
-		bool ok_sink = (fabs(m_vel.y) < 2);
-		bool ok_pitch = (fabs(angs.y) < 5);
-		bool ok_roll = (fabs(angs.x) < 5);
-		bool ok_runway = (m_pos.x > -m_runway_width) && (m_pos.x < m_runway_width) && (m_pos.z > -m_runway_length) && (m_pos.z < m_runway_length );
-		m_landing_status = ok_speed && ok_sink && ok_pitch && ok_roll && ok_runway;		
-
-		sprintf ( msg, "%s\n Speed (<80): %4.1f m/s     %s\n Sink rate (<2): %4.1f m/s      %s\n Pitch (<5): %4.1f deg     %s\n Roll (<5): %4.1f deg     %s\n On Runway: %s\n", 
-				            m_landing_status  ? "LANDED!" : "CRASH", 
-							m_speed,		ok_speed ? "OK" : "FAIL", 
-							m_vel.y,		ok_sink ? "OK" : "FAIL", 
-							fabs(angs.y),	ok_pitch ? "OK" : "FAIL",
-							fabs(angs.x),	ok_roll ? "OK" : "FAIL",
-				            ok_runway ? "Yes     OK" : "No     FAIL" );	
-
- 		m_landing_info = msg;			
-	}	
-	m_airborn = 0;
+	if ( !m_perf_hud ) {
+		for (int k=0; k < PERF_HUD_LINES; k++) m_hud.SetText ( m_hud_perf[k], "" );
+		m_hud.SetText ( m_hud_alloc, "" );
+		return;
+	}
+	if ( m_perf_frame++ % 15 != 0 ) return;		// a few times a second is readable
+
+	TextBuf t;
+	#ifdef PERF_TIMERS
+		m_hud.SetText ( m_hud_perf[0], "PERF (ms):  min / mean / p99,  J = write trace" );
+	#else
+		m_hud.SetText ( m_hud_perf[0], "PERF: timers compiled out (BUILD_PERF_TIMERS=OFF)" );
+	#endif
+	PerfStats st;
+	for (int k=1; k < PERF_HUD_LINES; k++) {
+		t.Clear ();
+		int id = k-1;
+		if ( id < PerfNumPhases() && PerfGetStats ( id, st ) ) {
+			t.Str ( PerfName(id) ).Str ( ":  " ).Float ( st.min, 1, 3 ).Str ( " / " ).Float ( st.mean, 1, 3 ).Str ( " / " ).Float ( st.p99, 1, 3 );
+		}
+		m_hud.SetText ( m_hud_perf[k], t.c_str() );
+	}
+	t.Clear ();
+	t.Str ( "Heap allocs/frame: " ).Int ( (int) m_frame_allocs ).Str ( " (max " ).Int ( (int) m_allocs_max ).Str ( "), all threads " ).Int ( (int) m_frame_allocs_all );
+	t.Str ( ".  Arena: " ).Int ( (int) (m_frame.getPeak() >> 10) ).Str ( " / " ).Int ( (int) (m_frame.getCapacity() >> 10) ).Str ( " KB" );
+	if ( m_frame.getFailed() > 0 ) t.Str ( ", " ).Int ( m_frame.getFailed() ).Str ( " FULL" );
+	m_hud.SetText ( m_hud_alloc, t.c_str() );
+	m_allocs_max = 0;
 }
 
 
-void Sample::Advance ()
+// Mirror the latest physics step for display
+void Sample::ShowSnapshot ( const FlightSnapshot& s )
 {
-	Vec3F force, torque;
-	
-	float m_LiftFactor = 0.0001;
-	float m_DragFactor = 0.0001;
+	m_time = s.time;
+	m_pos = s.pos;
+	m_vel = s.vel;
+	m_orient = s.orient;
+	m_speed = s.speed;
+	m_aoa = s.aoa;
+	m_ground = s.ground;
+	m_lift = s.lift;
+	m_drag = s.drag;
+	m_thrust = s.thrust;
+	m_force = m_lift + m_drag + m_thrust;
+
+	m_landing = s.land;
+	m_autopilot = s.autopilot;
+	m_telemetry = s.telemetry;
+	m_contacts = s.contacts;
+	if ( m_autopilot ) m_power = s.power;		// throttle picks up from the autopilot when it is turned off
+
+	// Interpolate render state between the last two steps, by wall-clock
+	// time since the last one was due. Unpaced steps are shown as is.
+	float t = 1;
+	if ( s.realtime && s.running ) {
+		t = float ( (PhysicsThread::Now() - s.wall) * 1e-9 * s.scale / m_DT );
+		if ( t < 0 ) t = 0;
+		if ( t > 1 ) t = 1;
+	}
+	m_draw_pos = s.prev_pos + (s.pos - s.prev_pos) * t;
+
+	Quaternion q0 = s.prev_orient, q1 = s.orient;		// nlerp, steps are small
+	if ( q0.X*q1.X + q0.Y*q1.Y + q0.Z*q1.Z + q0.W*q1.W < 0 ) { q1.X = -q1.X; q1.Y = -q1.Y; q1.Z = -q1.Z; q1.W = -q1.W; }
+	m_draw_orient.X = q0.X + (q1.X - q0.X) * t;
+	m_draw_orient.Y = q0.Y + (q1.Y - q0.Y) * t;
+	m_draw_orient.Z = q0.Z + (q1.Z - q0.Z) * t;
+	m_draw_orient.W = q0.W + (q1.W - q0.W) * t;
+	m_draw_orient.normalize();
+}
 
-	float mass = 0.1;	// body mass (kg)
-	
-	// Body frame of reference
-	Vec3F fwd = Vec3F(1,0,0) * m_orient;		// X-axis is body forward
-	Vec3F up  = Vec3F(0,1,0) * m_orient;		// Y-axis is body up
-	Vec3F right = Vec3F(0,0,1) * m_orient;		// Z-axis is body right
+void Sample::SendControls ()
+{
+	m_phys.Send ( PHYS_CONTROLS, m_roll, m_pitch, m_power, m_flaps );
+}
 
-	// Velocity limit
-	m_speed = m_vel.Length();
-	Vec3F vaxis = m_vel / m_speed;	
-	if ( m_speed < 0 ) m_speed =  0;		// planes dont go in reverse
-	if ( m_speed > m_max_speed ) m_speed = m_max_speed;
-	if ( m_speed==0) vaxis = fwd;
-
-	// Pitch inputs - modify direction of target velocity 
-	Quaternion ctrl_pitch;
-	if ( m_pos.y <= 0 ) m_pitch_adv = 1.1;
-	m_pitch_adv = m_pitch_adv * 0.9995 + m_pitch * 0.005;
-	ctrl_pitch.fromAngleAxis ( m_pitch_adv*0.0001, Vec3F(0,0,1) * m_orient );
-	vaxis *= ctrl_pitch;	vaxis.Normalize();	
-
-	m_vel = vaxis * m_speed;
-
-
-	m_force = 0;
-	torque = 0;
-
-	// Flaps
-	float flap_lift = m_flaps * cos(m_speed/m_max_speed * (PI/2.0) );	// flap lift decreases with speed
-	float wing_area = 1 + m_flaps;										// flap increases wing area (drag)
-
-	// Dynamic pressure		
-	float airflow = m_speed + m_wind.Dot ( vaxis*-1.0f );		// airflow = aircraft speed + wind over wing
-	float p = 1.225;											// air density, kg/m^3
-	float dynamic_pressure = 0.5f * p * airflow * airflow;
-
-	// Lift force
-	m_aoa = acos( fwd.Dot( vaxis ) )*RADtoDEG + 1;				// angle-of-attack = angle between velocity and body forward		
-	if (isnan(m_aoa)) m_aoa = 1;
-	float CL = sin( m_aoa * 0.2) + flap_lift;					// CL = coeff of lift, approximate CL curve with sin
-	float L = CL * dynamic_pressure * m_LiftFactor * 0.5;		// lift equation. L = CL (1/2 p v^2) A
-	m_lift = up * L;
-	m_force += m_lift;	
-
-	// Drag force	
-	m_drag = vaxis * dynamic_pressure * m_DragFactor * -1.0f * wing_area;	// drag equation. D = Cd (1/2 p v^2) A
-	m_force += m_drag; 
-
-	// Thrust force
-	m_thrust = fwd * m_power;
-	m_force += m_thrust;
-
-	// Update Orientation
-	// Directional stability: airplane will typically reorient toward the velocity vector
-	//  see: https://en.wikipedia.org/wiki/Directional_stability
-	// this is an assumption yet much simpler/faster than integrating body orientation
-	// this way we dont need torque, angular vel, or rotational inertia.
-	// stalls are possible but not flat spins or 3D flying
-	Quaternion angvel;
-	angvel.fromRotationFromTo ( fwd, vaxis, 0.001 );
-	if ( !isnan(angvel.X) ) {
-		m_orient *= angvel;
-		m_orient.normalize();
-	}	
-
-	// Roll inputs - modify body orientation along X-axis
-	Quaternion ctrl_roll;
-	ctrl_roll.fromAngleAxis ( m_roll*0.001, Vec3F(1,0,0) * m_orient );
-	m_orient *= ctrl_roll; m_orient.normalize();		// roll inputs
-
-	// Integrate position		
-	m_accel = m_force / mass;			// body forces
-	
-	m_accel += Vec3F(0,-9.8,0);		// gravity
+void Sample::ToggleRecord ()
+{
+	if ( m_playing ) return;
+	m_recording = !m_recording;
+	m_phys.Send ( PHYS_RECORD, m_recording ? 1 : 0 );
+}
 
-	m_accel += m_wind * p * 0.1f;		// wind force. Fw = w^2 p * A, where w=wind speed, p=air density, A=frontal area
-	
-	m_pos += m_vel * m_DT;
+void Sample::TogglePlayback ()
+{
+	if ( m_playing ) {
+		m_play.Close ();
+		m_playing = false;
+		m_phys.Send ( PHYS_RUN, m_run ? 1 : 0 );		// resume from where the model was
+		return;
+	}
+	m_phys.Send ( PHYS_RUN, 0 );
+	m_phys.Send ( PHYS_RECORD, 0 );		// flush, so the log can be played at once
+	m_phys.Sync ();
+	m_recording = false;
+	if ( !m_play.Open ( "flightsim.rec" ) ) {
+		m_phys.Send ( PHYS_RUN, m_run ? 1 : 0 );
+		return;
+	}
+	m_playing = true;
+	m_play_time = 0;
+	m_clock = std::chrono::steady_clock::now();
+	ShowRecord ( 0 );
+}
 
-	// Ground condition
-	if (m_pos.y <= 0.00001 ) { 
+// Replay at wall-clock rate, reading records directly from the mapped log
+void Sample::PlaybackStep ()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double elapsed = std::chrono::duration<double>( now - m_clock ).count();
+	m_clock = now;
+	if ( elapsed > 0.25 ) elapsed = 0.25;
 
-		// Record landing status
-		CheckLanding ();		
-		
-		// Ground forces
-		m_pos.y = 0; m_vel.y = 0; 
-		m_accel += Vec3F(0,9.8,0);	// ground force (upward)
-		m_vel *= 0.9999;				// ground friction
-		m_orient.fromDirectionAndRoll ( Vec3F(fwd.x, 0, fwd.z), 0 );	// zero pitch & roll
-		ctrl_roll.fromAngleAxis ( -m_roll*0.001, Vec3F(0,1,0) );		// on ground, left/right is rudder
-		m_orient *= ctrl_roll; m_orient.normalize();
-		m_vel *= ctrl_roll;			
+	m_play_time += elapsed * g_time_scales[m_time_scale];
+	ShowRecord ( m_play.FindTime ( m_play_time ) );
+}
 
-	} else {
-		m_airborn++;
-		if (m_airborn > 3200) m_landing_info = "";
-	}
-	
-	// integrate velocity
-	m_vel += m_accel * m_DT;
-	
+void Sample::ShowRecord ( int i )
+{
+	const FlightRecord& r = m_play.getRecord ( i );
+	m_time = r.time;
+	m_pos.Set ( r.pos[0], r.pos[1], r.pos[2] );
+	m_vel.Set ( r.vel[0], r.vel[1], r.vel[2] );
+	m_orient.X = r.orient[0];	m_orient.Y = r.orient[1];	m_orient.Z = r.orient[2];	m_orient.W = r.orient[3];
+	m_roll = r.roll;	m_pitch = r.pitch;	m_power = r.power;	m_flaps = r.flaps;
+	m_speed = m_vel.Length();
+	m_lift.Set (0,0,0);				// forces are not recorded
+	m_drag.Set (0,0,0);
+	m_thrust.Set (0,0,0);
+	m_force.Set (0,0,0);
+	m_draw_pos = m_pos;
+	m_draw_orient = m_orient;
 }
 
 
@@ -327,10 +523,10 @@ void Sample::CameraToCockpit()
 	// View direction	
 	Vec3F fwd = m_vel; fwd.Normalize();
 	Vec3F angs;
-	m_orient.toEuler ( angs );
+	m_draw_orient.toEuler ( angs );
 
 	// Set eye level above centerline
-	Vec3F p = m_pos + Vec3F(0,2,0);	  
+	Vec3F p = m_draw_pos + Vec3F(0,2,0);	  
 	
 	m_cam->setDirection ( p, p + fwd, -angs.x );
 }
@@ -343,85 +539,113 @@ void Sample::display ()
 	int w = getWidth();
 	int h = getHeight();
 
-	if (m_run) { 		
-		Advance ();
+	PERF_SCOPE ( "Frame" );
+	uint64_t allocs = AllocCountThread (), allocs_all = AllocCountTotal ();
+
+	if ( m_terrain.isOpen() ) {			// physics pages terrain in around the camera and aircraft
+		Vec3F cp = m_cam->getPos();
+		m_phys.Send ( PHYS_FOCUS, cp.x, cp.z );
 	}
 
+	if (m_playing) {
+		PERF_SCOPE ( "Playback" );
+		if (m_run) PlaybackStep ();
+		m_snap = 0x0;
+	} else {
+		PERF_SCOPE ( "Snapshot" );
+		if ( m_run && !m_realtime ) m_phys.Send ( PHYS_STEP );		// one step per frame, or the time scale in steps
+		m_snap = &m_phys.Read();
+		ShowSnapshot ( *m_snap );
+	}
+	ReadContacts ();
+
 	if (m_flightcam) {
+		PERF_SCOPE ( "CameraToCockpit" );
 		CameraToCockpit();
 	} else {
-		m_cam->SetOrbit ( m_cam->getAng(), m_pos, m_cam->getOrbitDist(), m_cam->getDolly() );
+		m_cam->SetOrbit ( m_cam->getAng(), m_draw_pos, m_cam->getOrbitDist(), m_cam->getDolly() );
 	}
 	
-	char msg[2048];
-
 	clearGL();
-	
-	start2D( getWidth(), getHeight() );		
-
-		Vec3F angs;
-		m_orient.toEuler ( angs );
 
-		// Instrument display
-		sprintf ( msg, "INPUT:     LFT/RIGHT = Ailerons, UP/DOWN = Elevators, W/S keys = THROTTLE, F = FLAPS"); drawText( Vec2F(10, 20), msg, Vec4F(1,1,1,1) );
-
-		sprintf ( msg, "INSTRUMENTS:");										drawText( Vec2F(10, 60), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Speed:     %4.3f m/s, %4.1f kph, %4.1f mph", m_speed, m_speed*3.6, m_speed*2.237 ); drawText( Vec2F(10, 80), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Power:     %4.1f", m_power );			drawText( Vec2F(10, 100), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Altitude:  %4.2f m", m_pos.y );		drawText( Vec2F(10, 120), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Sink rate: %4.2f m/s", m_vel.y );	drawText( Vec2F(10, 140), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "AOA:       %4.4f", m_aoa );			  drawText( Vec2F(10, 160), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Roll:      %4.1f", angs.x );		  drawText( Vec2F(10, 180), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Pitch:     %4.1f", angs.y );		  drawText( Vec2F(10, 200), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Heading:   %4.1f", angs.z );		  drawText( Vec2F(10, 220), msg, Vec4F(1,1,1,1) );
-		sprintf ( msg, "Flaps:     %1.0f", m_flaps );		  drawText( Vec2F(10, 240), msg, Vec4F(1,1,1,1) );
-
-		Vec3F lclr;
-		lclr = (m_landing_status) ? Vec3F(0,1,0) : Vec3F(1,0,0);
-		sprintf ( msg, "%s", m_landing_info.c_str() );		drawText( Vec2F(10, 280), msg, Vec4F(lclr.x,lclr.y,lclr.z,1) );
-
-		/*sprintf ( msg, "Up/Down    Elevators", m_flaps );	drawText(10, 220, msg, 1,1,1,1);
-		sprintf ( msg, "Left/Right Ailerons", m_flaps );	drawText(10, 240, msg, 1,1,1,1);
-		sprintf ( msg, "Q/A        Power", m_flaps );		drawText(10, 260, msg, 1,1,1,1);
-		sprintf ( msg, "F          Flaps", m_flaps );		drawText(10, 280, msg, 1,1,1,1);
-		sprintf ( msg, "C          Camera", m_flaps );		drawText(10, 300, msg, 1,1,1,1);*/
-
-	end2D();
+	{
+		PERF_SCOPE ( "HUD" );
+		UpdateHUD ();
+		UpdatePerfHUD ();
+	}
 
 
 	start3D(m_cam);
 
 		// Draw ground
-		drawGrid( (m_flightcam) ? Vec4F(1,1,1,1) : Vec4F(1,1,1,.5) );
+		{
+			PERF_SCOPE ( "drawGrid" );
+			drawGrid( (m_flightcam) ? Vec4F(1,1,1,1) : Vec4F(1,1,1,.5) );
+		}
 
-		// Draw plane forces (orbit cam only)
+		// Draw aircraft. Traffic as stepped, the player at its interpolated
+		// state in its own draw, and not at all from the cockpit.
+		{
+			PERF_SCOPE ( "drawAircraft" );
+			const FlightSnapshot* s = m_snap;
+			if ( s && s->num > 1 )
+				m_aircraft.Draw ( m_cam, s->num, s->px.data(), s->py.data(), s->pz.data(), s->qx.data(), s->qy.data(), s->qz.data(), s->qw.data(), m_player );
+			if ( !m_flightcam ) {
+				Vec3F p = m_draw_pos;
+				Quaternion q = m_draw_orient;
+				m_aircraft.Draw ( m_cam, 1, &p.x, &p.y, &p.z, &q.X, &q.Y, &q.Z, &q.W );
+			}
+		}
+
+		// Draw plane forces (orbit cam only), batched into one line and one arrow draw
 		if ( !m_flightcam ) {
-			Vec3F grav (0,-9.8 * (m_pos.y>0),0);
-			Vec3F a,b,c;
-			a = Vec3F(1,0,0)*m_orient;
-			b = Vec3F(0,1,0)*m_orient;
-			c = Vec3F(0,0,1)*m_orient;			
-			drawLine3D ( m_pos-c, m_pos+c, Vec4F(1,1,1,0.3) );			
-			drawLine3D ( m_pos, m_pos+m_lift, Vec4F(0,1,0,1) );
-			drawLine3D ( m_pos, m_pos+m_thrust, Vec4F(1,0,0,1) );
-			drawLine3D ( m_pos, m_pos+m_drag, Vec4F(1,0,1,1) );			
-			drawLine3D ( m_pos, m_pos+m_force, Vec4F(0,1,1,.2) );
-			drawLine3D ( m_pos, m_pos + grav*0.1f, Vec4F(0.5,0.5,0.8,1) );
-			drawLine3D ( m_pos+Vec3F(0,-.1,0), m_pos + m_vel*0.05f +Vec3F(0,-.1,0), Vec4F(1,1,0,.5) );
-			drawLine3D ( m_pos, Vec3F(m_pos.x, 0, m_pos.z), Vec4F(0.5,0.5,0.8,.3) );
-			
-			drawLine3D ( Vec3F(0,0,0), c, Vec4F(1,1,1,1) );
-			drawLine3D ( Vec3F(0,0,0), m_lift, Vec4F(0,1,0,1) );
-			drawLine3D ( Vec3F(0,0,0), m_thrust, Vec4F(1,0,0,1) );
-			drawLine3D ( Vec3F(0,0,0), m_drag, Vec4F(1,0,1,1) );			
-			drawLine3D ( Vec3F(0,0,0), m_force, Vec4F(0,1,1,.2) );
-			
-			
+			PERF_SCOPE ( "Forces" );
+			m_lines.Begin ();
+			Vec3F p = m_draw_pos;
+			float ground = m_ground;
+			Vec3F grav (0,-9.8 * (p.y>ground),0);
+			Vec3F c = Vec3F(0,0,1)*m_draw_orient;
+			Vec3F o (0,0,0);
+			m_lines.Line ( p-c, p+c, Vec4F(1,1,1,0.3) );
+			m_lines.Arrow ( p, m_lift, Vec4F(0,1,0,1) );
+			m_lines.Arrow ( p, m_thrust, Vec4F(1,0,0,1) );
+			m_lines.Arrow ( p, m_drag, Vec4F(1,0,1,1) );
+			m_lines.Arrow ( p, m_force, Vec4F(0,1,1,.2) );
+			m_lines.Arrow ( p, grav*0.1f, Vec4F(0.5,0.5,0.8,1) );
+			m_lines.Arrow ( p+Vec3F(0,-.1,0), m_vel*0.05f, Vec4F(1,1,0,.5) );
+			m_lines.Line ( p, Vec3F(p.x, ground, p.z), Vec4F(0.5,0.5,0.8,.3) );
+
+			m_lines.Line ( o, c, Vec4F(1,1,1,1) );
+			m_lines.Arrow ( o, m_lift, Vec4F(0,1,0,1) );
+			m_lines.Arrow ( o, m_thrust, Vec4F(1,0,0,1) );
+			m_lines.Arrow ( o, m_drag, Vec4F(1,0,1,1) );
+			m_lines.Arrow ( o, m_force, Vec4F(0,1,1,.2) );
+			m_lines.Flush ( m_cam );
 		}
 
 	end3D();
 
-	drawAll ();
+	{
+		PERF_SCOPE ( "drawAll" );
+		drawAll ();
+	}
+	{
+		PERF_SCOPE ( "HUD draw" );
+		m_hud.Draw ( getWidth(), getHeight() );
+	}
+	m_frame.Reset ();
+
+	if ( !m_started ) {				// lazy uploads are done by the end of the first frame
+		PerfStartupMark ( "first frame" );
+		char buf[512];
+		PerfStartupReport ( buf, sizeof(buf) );
+		dbgprintf ( "%s%s\n", buf, m_bundle.isOpen() ? "" : " (no " BUNDLE_NAME ")" );
+		m_started = true;
+	}
+
+	m_frame_allocs = AllocCountThread () - allocs;
+	m_frame_allocs_all = AllocCountTotal () - allocs_all;
+	if ( m_frame_allocs > m_allocs_max ) m_allocs_max = m_frame_allocs;
 	
 	appPostRedisplay();								// Post redisplay since simulation is continuous
 }
@@ -487,18 +711,32 @@ void Sample::keyboard(int keycode, AppEnum action, int mods, int x, int y)
 {
 	if (action == AppEnum::BUTTON_RELEASE) {
 		switch ( keycode ) {
-		case KEY_LEFT: case KEY_RIGHT:  m_roll = 0; break;
-		case KEY_UP: case KEY_DOWN:		m_pitch = 0; break;
+		case KEY_LEFT: case KEY_RIGHT:  m_roll = 0; SendControls (); break;
+		case KEY_UP: case KEY_DOWN:		m_pitch = 0; SendControls (); break;
 		};
 		return;
 	}
 
 	switch ( keycode ) {
-	case ' ':	m_run = !m_run;	break;
+	case ' ':	
+		m_run = !m_run;	
+		m_clock = std::chrono::steady_clock::now();		// dont count paused time
+		if ( !m_playing ) m_phys.Send ( PHYS_RUN, m_run ? 1 : 0 );
+		break;
+	case 't':
+		m_realtime = !m_realtime;
+		m_phys.Send ( PHYS_REALTIME, m_realtime ? 1 : 0 );
+		break;
+	case '-': case '=':
+		m_time_scale += (keycode == '-') ? -1 : 1;
+		if ( m_time_scale < 0 ) m_time_scale = 0;
+		if ( m_time_scale >= NUM_TIME_SCALES ) m_time_scale = NUM_TIME_SCALES-1;
+		m_phys.Send ( PHYS_SCALE, g_time_scales[m_time_scale] );
+		break;
 	case 'c':	
 		m_flightcam = !m_flightcam; 		
 		if (!m_flightcam)
-			m_cam->SetOrbit ( Vec3F(-30,30,0), m_pos, m_cam->getOrbitDist(), m_cam->getDolly() );
+			m_cam->SetOrbit ( Vec3F(-30,30,0), m_draw_pos, m_cam->getOrbitDist(), m_cam->getDolly() );
 		break;
 	case 'w': case 'q':
 		m_power += 0.1;
@@ -511,11 +749,35 @@ void Sample::keyboard(int keycode, AppEnum action, int mods, int x, int y)
 	case 'f':
 		m_flaps = (m_flaps==0) ? 1 : 0;
 		break;
+	case 'g':
+		m_turbulence = (m_turbulence + 1) % NUM_TURBULENCE;
+		m_phys.Send ( PHYS_TURBULENCE, g_turbulence[m_turbulence] );
+		break;
+	case 'b':	if ( !m_playing ) m_phys.Send ( PHYS_REWIND, 10 );	break;
+	case 'r':	ToggleRecord ();	break;
+	case 'n':	m_phys.Send ( PHYS_TRAFFIC, 100 );	break;
+	case 'e':	m_phys.Send ( PHYS_TELEMETRY, m_telemetry ? 0 : 1 );	break;
+	case 'o':	if ( !m_playing ) m_phys.Send ( PHYS_AUTOPILOT, m_autopilot ? 0 : 1 );	break;
+	case 'h':	m_perf_hud = !m_perf_hud;	m_perf_frame = 0;	break;
+	case 'j':	PerfWriteTrace ( "flightsim_trace.json" );	break;
+	case 'p':	TogglePlayback ();	break;
+	case '[': case ']':
+		if ( m_playing ) {
+			m_play_time += (keycode == '[') ? -10 : 10;
+			ShowRecord ( m_play.FindTime ( m_play_time ) );
+		}
+		break;
 	case KEY_LEFT:	m_roll = -1.0; break;
 	case KEY_RIGHT:	m_roll = +1.0; break;
 	case KEY_UP:	m_pitch = -1.0; break;
 	case KEY_DOWN:	m_pitch = +1.0; break;
 	};
+	switch ( keycode ) {
+	case 'w': case 'q': case 's': case 'a': case 'f':
+	case KEY_LEFT: case KEY_RIGHT: case KEY_UP: case KEY_DOWN:
+		SendControls ();
+		break;
+	};
 }
 
 void Sample::reshape (int w, int h)
@@ -537,6 +799,15 @@ void Sample::startup ()
 
 void Sample::shutdown()
 {
+	m_phys.Stop ();					// closes the recorder
+	m_grid.Clear ();
+	m_lines.Clear ();
+	m_aircraft.Clear ();
+	m_terrain_draw.Clear ();
+	m_terrain.Close ();
+	m_wind_field.Close ();
+	m_hud.Clear ();
+	m_play.Close ();
 }
 
 
@@ -0,0 +1,213 @@
+//--------------------------------------------------------
+//
+// Arrow IPC - minimal writer for the Apache Arrow IPC stream format
+//
+// The flatbuffers are written by hand for the few tables used, from
+// format/Schema.fbs and format/Message.fbs:
+//   Message      { version: short, header_type: ubyte, header: offset, bodyLength: long }
+//   Schema       { endianness: short, fields: [Field] }
+//   Field        { name: string, nullable: bool, type_type: ubyte, type: offset, (dictionary), children: [Field] }
+//   Int          { bitWidth: int, is_signed: bool }
+//   FloatingPoint { precision: short }
+//   RecordBatch  { length: long, nodes: [FieldNode], buffers: [Buffer] }
+// FieldNode { length, null_count } and Buffer { offset, length } are structs
+// of two longs.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "arrow_ipc.h"
+#include <string.h>
+
+#define FB_METADATA_V5		4			// MetadataVersion
+#define FB_HEADER_SCHEMA	1			// MessageHeader
+#define FB_HEADER_BATCH		3
+#define FB_TYPE_INT			2			// Type
+#define FB_TYPE_FLOAT		3
+#define FB_FLOAT_SINGLE		1			// Precision
+#define FB_FLOAT_DOUBLE		2
+
+#define ARROW_CONTINUE		0xFFFFFFFF
+
+// A table field, by id in the schema. Offsets are size 4 and patched with
+// Link once their target is written; 'at' is set by Table.
+struct FlatField {
+	int			id;
+	int			size;
+	uint64_t	value;
+	int			at;
+};
+
+// Flatbuffer written front to back. A uoffset points forward from where it
+// is stored, so a table comes before the strings, vectors and tables it
+// refers to, and each is linked from its reference as it is placed.
+class FlatWriter {
+public:
+	FlatWriter ( std::vector<uint8_t>& b ) : m_b(b)		{ m_b.clear (); }
+
+	int			Pos ()						{ return (int) m_b.size(); }
+	void		Pad ( int align, int phase = 0 )	{ while ( (m_b.size() + phase) % align ) m_b.push_back ( 0 ); }
+	template<class T> int Put ( T v )		{ int at = Pos(); m_b.resize ( at + sizeof(T) ); memcpy ( &m_b[at], &v, sizeof(T) ); return at; }
+	void		Link ( int ref )			{ if ( ref >= 0 ) { uint32_t off = Pos() - ref; memcpy ( &m_b[ref], &off, 4 ); } }
+	uint8_t*	At ( int pos )				{ return &m_b[pos]; }
+
+	int			Table ( int ref, int n, FlatField* f );
+	void		String ( int ref, const char* s );
+	int			Vector ( int ref, int n, int elem_size, int align );	// position of the first element
+
+private:
+	std::vector<uint8_t>& m_b;
+};
+
+int FlatWriter::Table ( int ref, int n, FlatField* f )
+{
+	// vtable, then the table: soffset to the vtable and fields from the
+	// largest, with the table at 4 mod 8 so every field is aligned
+	int slots = 0, size = 4;
+	for (int k = 0; k < n; k++) {
+		if ( f[k].id + 1 > slots ) slots = f[k].id + 1;
+		size += f[k].size;
+	}
+	Pad ( 2 );
+	int vt = Pos ();
+	Put<uint16_t> ( 4 + 2*slots );
+	Put<uint16_t> ( size );
+	for (int s = 0; s < slots; s++) Put<uint16_t> ( 0 );
+
+	Pad ( 8, 4 );
+	Link ( ref );
+	int table = Pos ();
+	Put<int32_t> ( table - vt );
+	for (int bytes = 8; bytes >= 1; bytes /= 2) {
+		for (int k = 0; k < n; k++) {
+			if ( f[k].size != bytes ) continue;
+			f[k].at = Pos ();
+			m_b.resize ( f[k].at + bytes );
+			memcpy ( &m_b[f[k].at], &f[k].value, bytes );		// low bytes, little-endian
+			uint16_t off = f[k].at - table;
+			memcpy ( &m_b[vt + 4 + 2*f[k].id], &off, 2 );
+		}
+	}
+	return table;
+}
+
+void FlatWriter::String ( int ref, const char* s )
+{
+	uint32_t len = (uint32_t) strlen ( s );
+	Pad ( 4 );
+	Link ( ref );
+	Put<uint32_t> ( len );
+	m_b.insert ( m_b.end(), s, s + len + 1 );		// with the terminator
+}
+
+int FlatWriter::Vector ( int ref, int n, int elem_size, int align )
+{
+	Pad ( align < 4 ? 4 : align, 4 );				// elements aligned after the length
+	Link ( ref );
+	Put<uint32_t> ( n );
+	int first = Pos ();
+	m_b.resize ( first + n * elem_size, 0 );
+	return first;
+}
+
+static inline int64_t AlignUp ( int64_t v, int64_t a )	{ return (v + a - 1) / a * a; }
+
+ArrowStreamWriter::ArrowStreamWriter ()
+{
+	m_fp = 0x0;
+	m_bytes = 0;
+}
+
+bool ArrowStreamWriter::WriteMessage ( const std::vector<uint8_t>& meta, int64_t body_len )
+{
+	static const uint8_t zero[8] = { 0 };
+	uint32_t hdr[2] = { ARROW_CONTINUE, (uint32_t) AlignUp ( meta.size(), 8 ) };	// body starts 8-aligned
+	bool ok = fwrite ( hdr, sizeof(hdr), 1, m_fp ) == 1;
+	ok &= fwrite ( meta.data(), 1, meta.size(), m_fp ) == meta.size();
+	ok &= fwrite ( zero, 1, hdr[1] - meta.size(), m_fp ) == hdr[1] - meta.size();
+	m_bytes += sizeof(hdr) + hdr[1] + body_len;
+	return ok;
+}
+
+bool ArrowStreamWriter::Begin ( FILE* fp, int num_cols, const ArrowColumn* cols )
+{
+	m_fp = fp;
+	m_cols.assign ( cols, cols + num_cols );
+	m_bytes = 0;
+
+	FlatWriter w ( m_meta );
+	int root = w.Put<uint32_t> ( 0 );
+	FlatField msg[4] = { {0, 2, FB_METADATA_V5, 0}, {1, 1, FB_HEADER_SCHEMA, 0}, {2, 4, 0, 0}, {3, 8, 0, 0} };
+	w.Table ( root, 4, msg );
+	FlatField schema[2] = { {0, 2, 0, 0}, {1, 4, 0, 0} };				// little-endian, fields
+	w.Table ( msg[2].at, 2, schema );
+	int fields = w.Vector ( schema[1].at, num_cols, 4, 4 );
+
+	for (int c = 0; c < num_cols; c++) {
+		bool is_int = ( cols[c].type == ARROW_I32 );
+		FlatField f[5] = { {0, 4, 0, 0}, {1, 1, 0, 0}, {2, 1, (uint64_t) (is_int ? FB_TYPE_INT : FB_TYPE_FLOAT), 0}, {3, 4, 0, 0}, {5, 4, 0, 0} };
+		w.Table ( fields + 4*c, 5, f );
+		w.String ( f[0].at, cols[c].name );
+		if ( is_int ) {
+			FlatField t[2] = { {0, 4, 32, 0}, {1, 1, 1, 0} };				// 32 bit, signed
+			w.Table ( f[3].at, 2, t );
+		} else {
+			FlatField t[1] = { {0, 2, (uint64_t) (cols[c].type == ARROW_F64 ? FB_FLOAT_DOUBLE : FB_FLOAT_SINGLE), 0} };
+			w.Table ( f[3].at, 1, t );
+		}
+		w.Vector ( f[4].at, 0, 4, 4 );								// no children
+	}
+	return WriteMessage ( m_meta, 0 );
+}
+
+bool ArrowStreamWriter::WriteBatch ( int rows, const void* const* data )
+{
+	if ( m_fp == 0x0 || rows <= 0 ) return false;
+	int num_cols = (int) m_cols.size();
+
+	FlatWriter w ( m_meta );
+	int64_t body = 0;
+	for (int c = 0; c < num_cols; c++) body += AlignUp ( (int64_t) rows * TypeSize ( m_cols[c].type ), ARROW_ALIGN );
+
+	int root = w.Put<uint32_t> ( 0 );
+	FlatField msg[4] = { {0, 2, FB_METADATA_V5, 0}, {1, 1, FB_HEADER_BATCH, 0}, {2, 4, 0, 0}, {3, 8, (uint64_t) body, 0} };
+	w.Table ( root, 4, msg );
+	FlatField batch[3] = { {0, 8, (uint64_t) rows, 0}, {1, 4, 0, 0}, {2, 4, 0, 0} };
+	w.Table ( msg[2].at, 3, batch );
+
+	int nodes = w.Vector ( batch[1].at, num_cols, 16, 8 );
+	for (int c = 0; c < num_cols; c++) {
+		int64_t node[2] = { rows, 0 };								// length, null count
+		memcpy ( w.At ( nodes + 16*c ), node, 16 );
+	}
+	int bufs = w.Vector ( batch[2].at, 2*num_cols, 16, 8 );
+	int64_t offset = 0;
+	for (int c = 0; c < num_cols; c++) {
+		int64_t len = (int64_t) rows * TypeSize ( m_cols[c].type );
+		int64_t buf[4] = { offset, 0, offset, len };				// no validity bitmap, then the values
+		memcpy ( w.At ( bufs + 32*c ), buf, 32 );
+		offset += AlignUp ( len, ARROW_ALIGN );
+	}
+
+	static const uint8_t zero[ARROW_ALIGN] = { 0 };
+	bool ok = WriteMessage ( m_meta, body );
+	for (int c = 0; c < num_cols; c++) {
+		size_t len = (size_t) rows * TypeSize ( m_cols[c].type );
+		ok &= fwrite ( data[c], 1, len, m_fp ) == len;
+		size_t pad = AlignUp ( len, ARROW_ALIGN ) - len;
+		ok &= fwrite ( zero, 1, pad, m_fp ) == pad;
+	}
+	return ok;
+}
+
+bool ArrowStreamWriter::End ()
+{
+	if ( m_fp == 0x0 ) return false;
+	uint32_t eos[2] = { ARROW_CONTINUE, 0 };
+	bool ok = fwrite ( eos, sizeof(eos), 1, m_fp ) == 1;
+	m_bytes += sizeof(eos);
+	m_fp = 0x0;
+	return ok;
+}
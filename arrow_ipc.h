@@ -0,0 +1,60 @@
+//--------------------------------------------------------
+//
+// Arrow IPC - minimal writer for the Apache Arrow IPC stream format
+//
+// Writes a schema of flat, non-nullable primitive columns and then record
+// batches of them, readable by pyarrow (pyarrow.ipc.open_stream), polars,
+// DuckDB and the other Arrow libraries, with no dependency on them here.
+//
+// A stream is a sequence of encapsulated messages: 0xFFFFFFFF, the length of
+// the metadata, a flatbuffer Message (Schema.fbs, Message.fbs, metadata V5),
+// padding to 8 bytes, then the message body. A record batch body is each
+// column's data buffer in schema order, 64-byte aligned, after an empty
+// validity buffer. The stream ends with 0xFFFFFFFF 0x00000000. Little-endian
+// hosts only, as the flight recorder.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_ARROW_IPC
+	#define DEF_ARROW_IPC
+
+	#include <stdio.h>
+	#include <stdint.h>
+	#include <vector>
+
+	#define ARROW_I32		0
+	#define ARROW_F32		1
+	#define ARROW_F64		2
+
+	#define ARROW_ALIGN		64			// body buffer alignment (bytes)
+
+	struct ArrowColumn {
+		const char*	name;
+		int			type;				// ARROW_
+	};
+
+	class ArrowStreamWriter {
+	public:
+		ArrowStreamWriter ();
+
+		// Writes the schema. fp stays open, the caller closes it after End.
+		bool		Begin ( FILE* fp, int num_cols, const ArrowColumn* cols );
+		bool		WriteBatch ( int rows, const void* const* data );	// one array of rows per column
+		bool		End ();												// end of stream marker
+
+		uint64_t	getBytes ()			{ return m_bytes; }
+		static int	TypeSize ( int type )	{ return (type == ARROW_F64) ? 8 : 4; }
+
+	private:
+		bool		WriteMessage ( const std::vector<uint8_t>& meta, int64_t body_len );
+
+		FILE*		m_fp;
+		std::vector<ArrowColumn> m_cols;
+		std::vector<uint8_t> m_meta;		// reused per batch
+		uint64_t	m_bytes;
+	};
+
+#endif
@@ -0,0 +1,100 @@
+//--------------------------------------------------------
+//
+// Asset bundle - packed, memory-mapped startup assets
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "asset_bundle.h"
+#include "common_defs.h"
+#include <stdio.h>
+#include <string.h>
+
+static inline uint64_t AlignUp ( uint64_t v, uint64_t a )	{ return (v + a - 1) / a * a; }
+
+bool AssetBundle::Open ( const char* fname )
+{
+	Close ();
+	if ( !m_file.Open ( fname ) ) return false;
+
+	const uint8_t* base = m_file.getData ();
+	size_t size = m_file.getSize ();
+	const BundleHeader* hdr = (const BundleHeader*) base;
+	if ( size < sizeof(BundleHeader) || memcmp ( hdr->magic, BUNDLE_MAGIC, 4 ) != 0 || hdr->version != BUNDLE_VERSION
+		|| size < sizeof(BundleHeader) + (uint64_t) hdr->count * sizeof(BundleEntry) ) {
+		dbgprintf ( "ERROR: %s is not a version %d asset bundle\n", fname, BUNDLE_VERSION );
+		m_file.Close ();
+		return false;
+	}
+	const BundleEntry* e = (const BundleEntry*) (base + sizeof(BundleHeader));
+	for (uint32_t n=0; n < hdr->count; n++) {
+		if ( e[n].offset + e[n].size > size ) {
+			dbgprintf ( "ERROR: Asset bundle %s is truncated\n", fname );
+			m_file.Close ();
+			return false;
+		}
+	}
+	m_base = base;
+	m_entries = e;
+	m_count = (int) hdr->count;
+	return true;
+}
+
+const BundleEntry* AssetBundle::Find ( const char* name, int type ) const
+{
+	for (int n=0; n < m_count; n++) {
+		if ( m_entries[n].type == (uint32_t) type && strncmp ( m_entries[n].name, name, sizeof(m_entries[n].name) ) == 0 )
+			return &m_entries[n];
+	}
+	return 0x0;
+}
+
+void AssetBundleWriter::Add ( const char* name, int type, const uint32_t param[3], const void* data, size_t size )
+{
+	BundleEntry e;
+	memset ( &e, 0, sizeof(e) );
+	strncpy ( e.name, name, sizeof(e.name)-1 );
+	e.type = type;
+	if ( param ) memcpy ( e.param, param, sizeof(e.param) );
+	e.size = size;
+	m_entries.push_back ( e );
+	m_data.push_back ( std::vector<uint8_t> ( (const uint8_t*) data, (const uint8_t*) data + size ) );
+}
+
+size_t AssetBundleWriter::getSize ()
+{
+	uint64_t pos = AlignUp ( sizeof(BundleHeader) + m_entries.size() * sizeof(BundleEntry), BUNDLE_ALIGN );
+	for (size_t n=0; n < m_entries.size(); n++)
+		pos = AlignUp ( pos + m_entries[n].size, BUNDLE_ALIGN );
+	return (size_t) pos;
+}
+
+bool AssetBundleWriter::Write ( const char* fname )
+{
+	// place the data, each entry aligned
+	uint64_t pos = AlignUp ( sizeof(BundleHeader) + m_entries.size() * sizeof(BundleEntry), BUNDLE_ALIGN );
+	for (size_t n=0; n < m_entries.size(); n++) {
+		m_entries[n].offset = pos;
+		pos = AlignUp ( pos + m_entries[n].size, BUNDLE_ALIGN );
+	}
+	std::vector<uint8_t> out ( pos, 0 );
+	BundleHeader hdr;
+	memcpy ( hdr.magic, BUNDLE_MAGIC, 4 );
+	hdr.version = BUNDLE_VERSION;
+	hdr.count = (uint32_t) m_entries.size();
+	hdr.reserved = 0;
+	memcpy ( &out[0], &hdr, sizeof(hdr) );
+	if ( !m_entries.empty() )
+		memcpy ( &out[sizeof(hdr)], m_entries.data(), m_entries.size() * sizeof(BundleEntry) );
+	for (size_t n=0; n < m_entries.size(); n++) {
+		if ( m_entries[n].size ) memcpy ( &out[ m_entries[n].offset ], m_data[n].data(), m_entries[n].size );
+	}
+
+	FILE* fp = fopen ( fname, "wb" );
+	if ( fp == 0x0 ) return false;
+	bool ok = fwrite ( out.data(), 1, out.size(), fp ) == out.size();
+	ok &= fclose ( fp ) == 0;
+	return ok;
+}
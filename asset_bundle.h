@@ -0,0 +1,90 @@
+//--------------------------------------------------------
+//
+// Asset bundle - packed, memory-mapped startup assets
+//
+// One file of named entries, written by tools/asset_pack and mapped whole
+// at startup, so assets are read in place with no parsing, and pages are
+// loaded by the OS only when an asset is first used. Entry data is
+// BUNDLE_ALIGN aligned and laid out ready for upload:
+//   BUNDLE_FONT   BakedFont metrics, FontBundleHeader then 256 BakedGlyph
+//   BUNDLE_BC4    texture, BC4 (RGTC1) blocks of every mip level, largest
+//                 first, param = width, height, levels
+//   BUNDLE_GRID   GridMesh as SaveGridMesh, param = the BuildGridMesh
+//                 runway width, length and extent (float bits)
+// Layout: a BundleHeader, count BundleEntry, then the data. Little-endian,
+// as the flight recorder. GL free, for tools and headless builds.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_ASSET_BUNDLE
+	#define DEF_ASSET_BUNDLE
+
+	#include <stdint.h>
+	#include <string.h>
+	#include <vector>
+	#include "mapped_file.h"
+
+	#define BUNDLE_MAGIC		"FBDL"
+	#define BUNDLE_VERSION		1
+	#define BUNDLE_NAME			"flightsim.bundle"		// in the asset path
+	#define BUNDLE_ALIGN		64
+
+	#define BUNDLE_FONT			1
+	#define BUNDLE_BC4			2
+	#define BUNDLE_GRID			3
+
+	struct BundleHeader {
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	count;					// entries
+		uint32_t	reserved;
+	};
+
+	struct BundleEntry {
+		char		name[32];
+		uint32_t	type;					// BUNDLE_
+		uint32_t	param[3];
+		uint64_t	offset, size;			// data, from the start of the file
+	};
+
+	// Size of mip level l, and bytes of one BC4 level, 8 per 4x4 block
+	inline int	MipSize ( int size, int l )			{ size >>= l; return size > 0 ? size : 1; }
+	inline int	BC4LevelBytes ( int w, int h )		{ return ((w + 3) / 4) * ((h + 3) / 4) * 8; }
+
+	// Float entry params, as their bits
+	inline uint32_t	BundleFloatBits ( float f )		{ uint32_t u; memcpy ( &u, &f, 4 ); return u; }
+
+	class AssetBundle {
+	public:
+		bool		Open ( const char* fname );			// false if missing or not a bundle
+		void		Close ()				{ m_file.Close(); m_base = 0x0; m_entries = 0x0; m_count = 0; }
+		bool		isOpen ()				{ return m_file.isOpen(); }
+
+		const BundleEntry* Find ( const char* name, int type ) const;		// 0x0 if absent
+		const uint8_t* getData ( const BundleEntry* e ) const		{ return m_base + e->offset; }
+
+		AssetBundle ()		{ m_base = 0x0; m_entries = 0x0; m_count = 0; }
+
+	private:
+		MappedFile	m_file;
+		const uint8_t* m_base;
+		const BundleEntry* m_entries;
+		int			m_count;
+	};
+
+	// Builds a bundle in memory, for tools/asset_pack
+	class AssetBundleWriter {
+	public:
+		void		Add ( const char* name, int type, const uint32_t param[3], const void* data, size_t size );
+		bool		Write ( const char* fname );
+		size_t		getSize ();
+
+	private:
+		std::vector<BundleEntry> m_entries;
+		std::vector<std::vector<uint8_t> > m_data;
+	};
+
+#endif
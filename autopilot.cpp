@@ -0,0 +1,190 @@
+//--------------------------------------------------------
+//
+// Autopilot - altitude, heading and speed hold and waypoint following for a fleet
+//
+// Sign conventions of the flight model: positive pitch input raises the
+// nose, positive roll input banks the aircraft so its right wing (body +z)
+// goes up and it turns toward lower headings. Bank is taken as the
+// sine, -right.y, from one batched basis conversion per block.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <math.h>
+#include "autopilot.h"
+#include "flight_kernels.h"
+#include "quat_batch.h"
+
+static inline float Clampf ( float v, float lo, float hi )	{ return (v < lo) ? lo : (v > hi) ? hi : v; }
+
+Autopilot::Autopilot ()
+{
+	m_num = 0;
+	m_period = AP_PERIOD;
+	m_step = 0;
+}
+
+void Autopilot::Clear ()
+{
+	m_num = 0;
+	m_step = 0;
+	m_mode.clear ();
+	m_alt.clear ();		m_spd.clear ();
+	m_hx.clear ();		m_hz.clear ();
+	m_vs_int.clear ();	m_spd_int.clear ();
+	m_route.clear ();	m_leg.clear ();
+	m_wp.clear ();
+	m_routes.clear ();
+}
+
+void Autopilot::Resize ( int num )
+{
+	if ( num == m_num ) return;
+	m_mode.resize ( num, 0 );
+	m_alt.resize ( num, 0 );	m_spd.resize ( num, 0 );
+	m_hx.resize ( num, 0 );		m_hz.resize ( num, 1 );
+	m_vs_int.resize ( num, 0 );	m_spd_int.resize ( num, 0 );
+	m_route.resize ( num, -1 );	m_leg.resize ( num, 0 );
+	m_num = num;
+}
+
+void Autopilot::SetHeading ( int i, float heading )
+{
+	m_hx[i] = sinf ( heading * DEGtoRAD );
+	m_hz[i] = cosf ( heading * DEGtoRAD );
+}
+
+void Autopilot::Engage ( FlightModel& m, int i, int mode, float alt, float heading, float speed )
+{
+	if ( i < 0 || i >= m.getNumAircraft() ) return;
+	if ( m_num < m.getNumAircraft() ) Resize ( m.getNumAircraft() );
+	m_mode[i] = mode;
+	m_alt[i] = alt;
+	m_spd[i] = speed;
+	SetHeading ( i, heading );
+	m_vs_int[i] = Clampf ( m.m_pitch_adv[i], -AP_PITCH_ADV, AP_PITCH_ADV );		// integrators start at the present controls
+	m_spd_int[i] = Clampf ( m.m_power[i], 0, AP_MAX_POWER );
+	if ( !(mode & AP_NAV) ) { m_route[i] = -1; m_leg[i] = 0; }
+}
+
+void Autopilot::HoldCurrent ( FlightModel& m, int i )
+{
+	Vec3F v = m.getVel ( i );
+	Engage ( m, i, AP_HOLD, m.m_py[i], atan2f ( v.x, v.z ) * RADtoDEG, v.Length() );
+}
+
+void Autopilot::Disengage ( int i )
+{
+	if ( i < m_num ) m_mode[i] = 0;
+}
+
+int Autopilot::AddRoute ( const Waypoint* wp, int n, bool loop )
+{
+	Route r;
+	r.first = (int) m_wp.size();
+	r.count = n;
+	r.loop = loop;
+	m_wp.insert ( m_wp.end(), wp, wp + n );
+	m_routes.push_back ( r );
+	return (int) m_routes.size() - 1;
+}
+
+void Autopilot::setRoute ( FlightModel& m, int i, int route )
+{
+	if ( route < 0 || route >= (int) m_routes.size() || m_routes[route].count == 0 ) return;
+	const Waypoint& w = m_wp[ m_routes[route].first ];
+	Vec3F v = m.getVel ( i );
+	Engage ( m, i, AP_HOLD | AP_NAV, w.y, atan2f ( v.x, v.z ) * RADtoDEG, (w.speed > 0) ? w.speed : v.Length() );
+	m_route[i] = route;
+	m_leg[i] = 0;
+}
+
+void Autopilot::Prepare ( int num )
+{
+	Resize ( num );
+	m_step++;
+}
+
+// Targets from the waypoint being flown to, moving on to the next once in reach
+void Autopilot::Navigate ( FlightModel& m, int first, int n )
+{
+	for (int i = first; i < first + n; i++) {
+		if ( !(m_mode[i] & AP_NAV) ) continue;
+		const Route& r = m_routes[ m_route[i] ];
+		const Waypoint* w = &m_wp[ r.first + m_leg[i] ];
+		float dx = w->x - m.m_px[i], dz = w->z - m.m_pz[i];
+		if ( dx*dx + dz*dz < AP_CAPTURE*AP_CAPTURE ) {
+			if ( m_leg[i] + 1 < r.count )	m_leg[i]++;
+			else if ( r.loop )				m_leg[i] = 0;
+			else {
+				m_mode[i] &= ~AP_NAV;		// hold what the last leg set
+				continue;
+			}
+			w = &m_wp[ r.first + m_leg[i] ];
+			dx = w->x - m.m_px[i]; dz = w->z - m.m_pz[i];
+		}
+		float d = sqrtf ( dx*dx + dz*dz );
+		if ( d > 0 ) { m_hx[i] = dx / d; m_hz[i] = dz / d; }
+		m_alt[i] = w->y;
+		if ( w->speed > 0 ) m_spd[i] = w->speed;
+	}
+}
+
+void Autopilot::UpdateBlock ( FlightModel& m, int first, int n, float dt )
+{
+	if ( ( first / STEP_BLOCK + m_step ) % m_period != 0 ) return;		// this block's turn
+	if ( first + n > m_num ) n = m_num - first;
+	if ( n <= 0 ) return;
+	int engaged = 0;
+	for (int i = first; i < first + n; i++) engaged |= m_mode[i];
+	if ( engaged == 0 ) return;
+
+	float h = dt * m_period;										// time since the last update
+
+	float rx[STEP_BLOCK], ry[STEP_BLOCK], rz[STEP_BLOCK];
+	QuatSoA orient = { &m.m_qx[first], &m.m_qy[first], &m.m_qz[first], &m.m_qw[first] };
+	Vec3SoA right = { rx, ry, rz }, none = { 0x0, 0x0, 0x0 };
+	QuatBasisN ( n, orient, none, none, right );
+
+	if ( engaged & AP_NAV ) Navigate ( m, first, n );
+
+	for (int j = 0; j < n; j++) {
+		int i = first + j;
+		int mode = m_mode[i];
+
+		// Altitude: climb rate from the altitude error, vertical acceleration
+		// from the climb rate error, and the filtered pitch that gives it. The
+		// integrator holds what level flight needs. Pitch input then leads the
+		// filter toward that.
+		if ( mode & AP_ALT ) {
+			float vs = Clampf ( AP_ALT_GAIN * (m_alt[i] - m.m_py[i]), -AP_MAX_VS, AP_MAX_VS );
+			float e = vs - m.m_vy[i];
+			float v = (m.m_speed[i] > AP_MIN_SPEED) ? m.m_speed[i] : AP_MIN_SPEED;
+			m_vs_int[i] = Clampf ( m_vs_int[i] + AP_VS_I * e * h, -AP_PITCH_ADV, AP_PITCH_ADV );
+			float adv = Clampf ( AP_VS_GAIN * e / (AP_PITCH_RATE * v) + m_vs_int[i], -AP_PITCH_ADV, AP_PITCH_ADV );
+			m.m_pitch[i] = Clampf ( adv / AP_PITCH_ADV + AP_PITCH_P * (adv - m.m_pitch_adv[i]), -1, 1 );
+		}
+
+		// Heading: the sine of the heading error, or a full turn past 90 deg,
+		// sets the bank. Turning toward higher headings takes a negative bank.
+		if ( mode & AP_HDG ) {
+			float vx = m.m_vx[i], vz = m.m_vz[i];
+			float len = sqrtf ( vx*vx + vz*vz );
+			if ( len > 0.001f ) { vx /= len; vz /= len; } else { vx = 0; vz = 1; }
+			float s = vz * m_hx[i] - vx * m_hz[i];
+			float c = vx * m_hx[i] + vz * m_hz[i];
+			float e = (c >= 0) ? s : (s >= 0) ? 1 : -1;
+			float bank = -Clampf ( AP_HDG_GAIN * e, -AP_MAX_BANK, AP_MAX_BANK );
+			m.m_roll[i] = Clampf ( AP_BANK_P * (bank + ry[j]), -1, 1 );		// bank now is -right.y
+		}
+
+		// Speed: power
+		if ( mode & AP_SPD ) {
+			float e = m_spd[i] - m.m_speed[i];
+			m_spd_int[i] = Clampf ( m_spd_int[i] + AP_SPD_I * e * h, 0, AP_MAX_POWER );
+			m.m_power[i] = Clampf ( AP_SPD_P * e + m_spd_int[i], 0, AP_MAX_POWER );
+		}
+	}
+}
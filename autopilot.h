@@ -0,0 +1,117 @@
+//--------------------------------------------------------
+//
+// Autopilot - altitude, heading and speed hold and waypoint following for a fleet
+//
+// Controllers write the model's control arrays (m_roll, m_pitch, m_power)
+// directly. Their state is kept as structure-of-arrays like the model's, and
+// they run inside FlightModel::Advance, over each block of STEP_BLOCK
+// aircraft just before that block is stepped, so the scheduler that steps
+// the fleet runs them too and there is no call per aircraft.
+//
+// Each aircraft has a mode of AP_ bits, 0 = controls are left as set:
+//   AP_ALT  altitude error sets a climb rate, the climb rate error sets pitch (PI)
+//   AP_HDG  heading error sets a bank angle, the bank error sets roll (P)
+//   AP_SPD  speed error sets power (PI)
+//   AP_NAV  the aircraft's route sets the three targets, waypoint by waypoint
+// A waypoint is reached within AP_CAPTURE (m) horizontally. After the last
+// one a route starts over if it loops, otherwise the aircraft holds the last
+// altitude, speed and heading.
+//
+// An aircraft is updated every AP_PERIOD steps, in turn by block, so a step
+// costs the same for any fleet: 1/AP_PERIOD of the aircraft are updated.
+// Controls are held between updates, as by a flight computer running at
+// 1/(AP_PERIOD dt). Blocks follow the same chunks as Advance, so results do
+// not depend on the number of threads.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_AUTOPILOT
+	#define DEF_AUTOPILOT
+
+	#include <vector>
+	#include "flight_model.h"
+
+	#define AP_ALT			1			// hold altitude
+	#define AP_HDG			2			// hold heading
+	#define AP_SPD			4			// hold speed with power
+	#define AP_NAV			8			// follow the route
+	#define AP_HOLD			(AP_ALT | AP_HDG | AP_SPD)
+
+	#define AP_PERIOD		10			// steps between updates of an aircraft (default)
+	#define AP_CAPTURE		400.0f		// waypoint reached within (m)
+
+	// Gains, per second. The pitch input is filtered by the model into
+	// m_pitch_adv, which settles at AP_PITCH_ADV times the input in about 2 s
+	// and turns the velocity by AP_PITCH_RATE rad/s per unit.
+	#define AP_PITCH_ADV	10.0f
+	#define AP_PITCH_RATE	0.1f
+	#define AP_ALT_GAIN		0.15f		// climb rate per m of altitude error (1/s)
+	#define AP_MAX_VS		15.0f		// climb and sink rate limit (m/s)
+	#define AP_VS_GAIN		1.0f		// vertical acceleration per m/s of climb rate error (1/s)
+	#define AP_VS_I			0.02f		// filtered pitch per m of integrated climb rate error
+	#define AP_PITCH_P		0.5f		// pitch input per unit of filtered pitch error
+	#define AP_MIN_SPEED	20.0f		// below this the pitch gain is held (m/s)
+	#define AP_HDG_GAIN		2.0f		// sine of bank per radian of heading error
+	#define AP_MAX_BANK		0.5f		// sine of the bank limit (30 deg)
+	#define AP_BANK_P		2.0f		// roll per unit of bank sine error
+	#define AP_SPD_P		0.1f		// power per m/s of speed error
+	#define AP_SPD_I		0.02f		// power per m of integrated speed error
+	#define AP_MAX_POWER	10.0f
+
+	struct Waypoint {
+		float		x, y, z;				// y is the altitude to fly at
+		float		speed;					// m/s, 0 = keep the speed target
+	};
+
+	class Autopilot {
+	public:
+		Autopilot ();
+
+		void		Clear ();
+		void		setPeriod ( int steps )		{ m_period = (steps < 1) ? 1 : steps; }
+		int			getPeriod ()				{ return m_period; }
+
+		// Between steps. Engaging starts from the aircraft's present controls,
+		// so it takes over without a jump. heading is deg clockwise from +z.
+		void		Engage ( FlightModel& m, int i, int mode, float alt, float heading, float speed );
+		void		HoldCurrent ( FlightModel& m, int i );				// AP_HOLD at the present altitude, heading and speed
+		void		Disengage ( int i );
+		int			getMode ( int i )		{ return i < (int) m_mode.size() ? m_mode[i] : 0; }
+
+		// Routes are shared, any number of aircraft may fly one
+		int			AddRoute ( const Waypoint* wp, int n, bool loop );	// returns route index
+		void		setRoute ( FlightModel& m, int i, int route );		// AP_NAV | AP_HOLD from the first waypoint
+		int			getLeg ( int i )		{ return i < (int) m_leg.size() ? m_leg[i] : 0; }	// waypoint being flown to
+
+		// Called by FlightModel::Advance. Prepare once per step before the blocks,
+		// UpdateBlock for each block, from any thread.
+		void		Prepare ( int num );						// num = aircraft in the model, entries past it are dropped
+		void		UpdateBlock ( FlightModel& m, int first, int n, float dt );
+
+	private:
+		struct Route {
+			int		first, count;			// in m_wp
+			bool	loop;
+		};
+		void		Resize ( int num );
+		void		SetHeading ( int i, float heading );
+		void		Navigate ( FlightModel& m, int first, int n );
+
+		int			m_num;
+		int			m_period;
+		uint32_t	m_step;						// steps prepared
+
+		ByteArray	m_mode;						// AP_ bits
+		FloatArray	m_alt, m_spd;				// targets
+		FloatArray	m_hx, m_hz;					// target heading as a unit vector in x, z
+		FloatArray	m_vs_int, m_spd_int;		// integrators, as filtered pitch and power
+		IntArray	m_route, m_leg;				// route and waypoint, -1 = none
+
+		std::vector<Waypoint> m_wp;
+		std::vector<Route> m_routes;
+	};
+
+#endif
@@ -0,0 +1,116 @@
+//--------------------------------------------------------
+//
+// Baked font - glyph metrics and atlas for the HUD
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "baked_font.h"
+#include "asset_bundle.h"
+#include "common_defs.h"
+#include <stdio.h>
+#include <string>
+#include <string.h>
+
+// .bin layout, all 4-byte little-endian
+struct FontBinHeader {
+	int32_t		tex_width, tex_height;
+	int32_t		ascent, descent, linegap;
+	float		norm_ascent, norm_descent, norm_linegap;
+};
+struct FontBinGlyph {
+	int32_t		u, v, width, height, advance, offx, offy;
+	float		norm[7];
+};
+
+bool LoadBakedFont ( const char* name, BakedFont& font )
+{
+	font.bc4 = 0x0;
+	font.bc4_levels = 0;
+	std::string fname = std::string(name) + ".bin";
+	FILE* fp = fopen ( fname.c_str(), "rb" );
+	if ( fp == 0x0 ) {
+		dbgprintf ( "ERROR: Unable to open font %s\n", fname.c_str() );
+		return false;
+	}
+	FontBinHeader hdr;
+	FontBinGlyph g[256];
+	bool ok = fread ( &hdr, sizeof(hdr), 1, fp ) == 1 && fread ( g, sizeof(g), 1, fp ) == 1;
+	fclose ( fp );
+	if ( !ok ) {
+		dbgprintf ( "ERROR: Font %s is truncated\n", fname.c_str() );
+		return false;
+	}
+	font.tex_width = hdr.tex_width;
+	font.tex_height = hdr.tex_height;
+	font.ascent = hdr.ascent;
+	font.descent = hdr.descent;
+	font.linegap = hdr.linegap;
+	for (int n=0; n < 256; n++) {
+		BakedGlyph& b = font.glyphs[n];
+		b.u = g[n].u;			b.v = g[n].v;
+		b.width = g[n].width;	b.height = g[n].height;
+		b.advance = g[n].advance;
+		b.offx = g[n].offx;		b.offy = g[n].offy;
+	}
+
+	// atlas, uncompressed 24/32-bit TGA, red channel as coverage
+	fname = std::string(name) + ".tga";
+	fp = fopen ( fname.c_str(), "rb" );
+	if ( fp == 0x0 ) {
+		dbgprintf ( "ERROR: Unable to open font atlas %s\n", fname.c_str() );
+		return false;
+	}
+	uint8_t th[18];
+	ok = fread ( th, 18, 1, fp ) == 1;
+	int w = th[12] | (th[13] << 8);
+	int h = th[14] | (th[15] << 8);
+	int bpp = th[16] / 8;
+	bool top_down = (th[17] & 0x20) != 0;
+	if ( !ok || th[2] != 2 || (bpp != 3 && bpp != 4) || w != font.tex_width || h != font.tex_height ) {
+		dbgprintf ( "ERROR: Font atlas %s must be an uncompressed %dx%d RGB TGA\n", fname.c_str(), font.tex_width, font.tex_height );
+		fclose ( fp );
+		return false;
+	}
+	fseek ( fp, th[0], SEEK_CUR );		// image id
+	std::vector<uint8_t> row ( w * bpp );
+	font.pixels.resize ( w * h );
+	for (int y=0; y < h && ok; y++) {
+		ok = fread ( row.data(), row.size(), 1, fp ) == 1;
+		uint8_t* dst = &font.pixels[ (top_down ? h-1-y : y) * w ];
+		for (int x=0; x < w; x++) dst[x] = row[ x*bpp + 2 ];		// BGR
+	}
+	fclose ( fp );
+	if ( !ok ) dbgprintf ( "ERROR: Font atlas %s is truncated\n", fname.c_str() );
+	return ok;
+}
+
+bool LoadBakedFont ( const AssetBundle& bundle, const char* name, BakedFont& font )
+{
+	const BundleEntry* metrics = bundle.Find ( name, BUNDLE_FONT );
+	const BundleEntry* atlas = bundle.Find ( name, BUNDLE_BC4 );
+	if ( metrics == 0x0 || atlas == 0x0 || metrics->size != sizeof(FontBundleHeader) + sizeof(font.glyphs) ) return false;
+
+	FontBundleHeader hdr;
+	const uint8_t* src = bundle.getData ( metrics );
+	memcpy ( &hdr, src, sizeof(hdr) );
+	int w = atlas->param[0], h = atlas->param[1], levels = atlas->param[2];
+	size_t bytes = 0;
+	for (int l=0; l < levels; l++) bytes += BC4LevelBytes ( MipSize ( w, l ), MipSize ( h, l ) );
+	if ( w != hdr.tex_width || h != hdr.tex_height || levels < 1 || atlas->size != bytes ) {
+		dbgprintf ( "ERROR: Font %s in the asset bundle does not match its atlas\n", name );
+		return false;
+	}
+	font.tex_width = hdr.tex_width;
+	font.tex_height = hdr.tex_height;
+	font.ascent = hdr.ascent;
+	font.descent = hdr.descent;
+	font.linegap = hdr.linegap;
+	memcpy ( font.glyphs, src + sizeof(hdr), sizeof(font.glyphs) );
+	font.pixels.clear ();
+	font.bc4 = bundle.getData ( atlas );
+	font.bc4_levels = levels;
+	return true;
+}
@@ -0,0 +1,54 @@
+//--------------------------------------------------------
+//
+// Baked font - glyph metrics and atlas for the HUD
+//
+// Reads the .bin/.tga pair used by the 2D layer (arial.bin, arial.tga):
+// glyph placement in pixels for 256 codes, plus a grayscale coverage atlas.
+// Or reads them from an asset bundle, packed by tools/asset_pack, where the
+// atlas is BC4 with its mip chain, used in place from the mapped file.
+// GL free, so tools can read and repack it.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_BAKED_FONT
+	#define DEF_BAKED_FONT
+
+	#include <vector>
+	#include <stdint.h>
+
+	class AssetBundle;
+
+	struct BakedGlyph {					// pixels, y down from the baseline
+		int		u, v;					// atlas pixel of the glyph's left, bottom edge
+		int		width, height;
+		int		advance;
+		int		offx, offy;				// top-left relative to pen, offy < 0 above baseline
+	};
+
+	struct BakedFont {
+		int			tex_width, tex_height;
+		int			ascent, descent, linegap;
+		BakedGlyph	glyphs[256];
+		std::vector<uint8_t> pixels;	// tex_width * tex_height coverage, row 0 at bottom (GL order)
+		const uint8_t* bc4;				// or BC4 atlas, all levels, in the bundle mapping, 0x0 if none
+		int			bc4_levels;
+	};
+
+	// Load <name>.bin and <name>.tga. Returns false and prints on failure.
+	bool	LoadBakedFont ( const char* name, BakedFont& font );
+
+	// Load font <name> from a bundle, no pixels are copied. The bundle must
+	// stay open while font.bc4 is used. Returns false if it is not there.
+	bool	LoadBakedFont ( const AssetBundle& bundle, const char* name, BakedFont& font );
+
+	// Bundle entry of the metrics, written by tools/asset_pack
+	struct FontBundleHeader {
+		int32_t		tex_width, tex_height;
+		int32_t		ascent, descent, linegap;
+		int32_t		reserved[3];
+	};
+
+#endif
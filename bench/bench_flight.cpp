@@ -0,0 +1,830 @@
+//--------------------------------------------------------
+//
+// Flightsim bench - micro-benchmarks for the flight core
+//
+// Times the per-step flight model in several regimes, the quaternion
+// operations it relies on, scalar and batched, the autopilot over a large
+// fleet, fleet telemetry as CSV and as Arrow columns, the ground grid build
+// and culling, the spatial index updates and queries, and the contact
+// broadphase at 10k aircraft against its 1 ms step, then writes the
+// results as JSON so runs can be compared across libmin versions,
+// compilers and flags.
+//
+// Usage:  bench_flight [-o results.json] [-t min_sec] [-f filter]
+//   -o   write JSON to a file instead of stdout
+//   -t   minimum time per measurement (default 0.2 sec)
+//   -f   only run benchmarks whose name contains filter
+//
+// Each benchmark is timed over 5 runs of at least min_sec, and the median
+// is reported. Model runs restore their start state every 1024 steps, so
+// long runs stay in the regime being measured.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "flight_model.h"
+#include "grid_mesh.h"
+#include "aero_table.h"
+#include "spatial_grid.h"
+#include "quat_batch.h"
+#include "flight_kernels.h"
+#include "autopilot.h"
+#include "telemetry.h"
+#include "broadphase.h"
+
+#define BENCH_RUNS		5
+
+struct BenchResult {
+	std::string	name;
+	double		ns_per_op;			// median over runs
+	double		ns_min;
+	long long	ops;				// ops per run
+	int			items;				// aircraft or elements per op
+};
+
+typedef void (*BenchFunc) ( void* ctx, long long n );		// run n ops
+
+static double g_min_time = 0.2;
+static const char* g_filter = 0x0;
+static std::vector<BenchResult> g_results;
+static volatile float g_sink;								// keeps results alive
+
+static double Seconds ( std::chrono::steady_clock::time_point t0 )
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+}
+
+// Grow the op count until one run takes min_time, then time BENCH_RUNS runs
+static void Bench ( const char* name, int items, BenchFunc fn, void* ctx, void (*reset)(void*) = 0x0 )
+{
+	if ( g_filter && strstr ( name, g_filter ) == 0x0 ) return;
+
+	long long n = 1;
+	for (;;) {
+		if ( reset ) reset ( ctx );
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		fn ( ctx, n );
+		double t = Seconds ( t0 );
+		if ( t >= g_min_time || n >= (1LL << 40) ) break;
+		n = (t > 1e-6) ? std::max ( n * 2, (long long) (n * g_min_time * 1.2 / t) ) : n * 10;
+	}
+	double ns[BENCH_RUNS];
+	for (int r = 0; r < BENCH_RUNS; r++) {
+		if ( reset ) reset ( ctx );
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		fn ( ctx, n );
+		ns[r] = Seconds ( t0 ) * 1e9 / n;
+	}
+	std::sort ( ns, ns + BENCH_RUNS );
+
+	BenchResult res;
+	res.name = name;
+	res.ns_per_op = ns[BENCH_RUNS/2];
+	res.ns_min = ns[0];
+	res.ops = n;
+	res.items = items;
+	g_results.push_back ( res );
+	fprintf ( stderr, "%-36s %12.1f ns/op  %14.0f items/s\n", name, res.ns_per_op, items * 1e9 / res.ns_per_op );
+}
+
+//----------------------------------------------------------- flight model
+
+#define REGIME_AIRBORNE		0		// cruise at 200 m/s, 1000 m
+#define REGIME_GROUND		1		// ground roll at 30 m/s
+#define REGIME_STALL		2		// 20 m/s at 2000 m, nose up, no power
+#define REGIME_TOUCHDOWN	3		// on the ground each step with a landing scored
+
+#define RESTORE_STEPS		1024	// steps before restoring the initial state, so the regime holds
+
+struct ModelCtx {
+	FlightModel	model;
+	FlightModel	start;				// initial state
+	int			type;				// AIRCRAFT_ id
+	const AeroTable* aero;			// 0 = analytic lift
+	int			regime;
+	int			num;
+	int			kernel;
+};
+
+static void ModelReset ( void* p )
+{
+	ModelCtx* c = (ModelCtx*) p;
+	FlightModel& m = c->model;
+	m.Clear ();
+	m.setKernel ( c->kernel );
+	m.setAircraftType ( c->type );
+	m.setAeroTable ( c->aero );
+	for (int i = 0; i < c->num; i++) {
+		float h = (i % 16) * 1.0f;			// small spread, so aircraft are not identical
+		switch ( c->regime ) {
+		case REGIME_AIRBORNE:	m.AddAircraft ( Vec3F(i*10.0f, 1000+h, 0), Vec3F(0, 0, 200), 3 );	break;
+		case REGIME_GROUND:		m.AddAircraft ( Vec3F(i*10.0f, 0, 0), Vec3F(0, 0, 30+h), 1 );		break;
+		case REGIME_STALL:		m.AddAircraft ( Vec3F(i*10.0f, 2000+h, 0), Vec3F(0, 0, 20), 0 );	break;
+		case REGIME_TOUCHDOWN:	m.AddAircraft ( Vec3F(i*10.0f, 0, 0), Vec3F(0, -1, 60+h), 1 );		break;
+		}
+		if ( c->regime == REGIME_STALL ) m.setControls ( i, 0, -1, 0, 0 );
+	}
+	c->start = m;
+}
+
+static void ModelRun ( void* p, long long n )
+{
+	ModelCtx* c = (ModelCtx*) p;
+	FlightModel& m = c->model;
+	for (long long s = 0; s < n; s++) {
+		if ( s % RESTORE_STEPS == RESTORE_STEPS-1 ) m = c->start;		// same sizes, copies without allocating
+		if ( c->regime == REGIME_TOUCHDOWN ) {
+			for (int i = 0; i < c->num; i++) {		// score a touchdown every step
+				m.m_airborn[i] = 2001;
+				m.m_py[i] = 0;
+				m.m_vy[i] = -1;
+			}
+		}
+		m.Advance ( 0.001f );
+	}
+	g_sink = m.m_py[0];
+}
+
+static void BenchModel ()
+{
+	static const char* regimes[4] = { "airborne", "ground_roll", "stall", "touchdown" };
+	int kernels[2] = { KERNEL_SCALAR, KERNEL_AUTO };
+	int counts[2] = { 1, 4096 };
+	ModelCtx* c = new ModelCtx;
+	char name[128];
+	c->type = AIRCRAFT_DEFAULT;
+	c->aero = 0x0;
+
+	for (int k = 0; k < 2; k++) {
+		c->model.setKernel ( kernels[k] );
+		int kern = c->model.getKernel ();
+		if ( k == 1 && kern == KERNEL_SCALAR ) break;		// no SIMD kernel on this CPU
+		for (int r = 0; r < 4; r++) {
+			for (int n = 0; n < 2; n++) {
+				c->regime = r;
+				c->num = counts[n];
+				c->kernel = kern;
+				sprintf ( name, "advance/%s/%s/%d", regimes[r], FlightModel::getKernelName(kern), counts[n] );
+				Bench ( name, counts[n], ModelRun, c, ModelReset );
+			}
+		}
+	}
+
+	// lift & flap tables instead of acos/sin/cos
+	AeroTable* aero = new AeroTable;
+	for (int k = 0; k < 2; k++) {
+		c->model.setKernel ( kernels[k] );
+		int kern = c->model.getKernel ();
+		if ( k == 1 && kern == KERNEL_SCALAR ) break;
+		c->regime = REGIME_AIRBORNE;
+		c->num = 4096;
+		c->kernel = kern;
+		c->aero = aero;
+		sprintf ( name, "advance/airborne/%s+table/4096", FlightModel::getKernelName(kern) );
+		Bench ( name, c->num, ModelRun, c, ModelReset );
+	}
+	c->aero = 0x0;
+	delete aero;
+
+	// specialized steps per aircraft type, airborne
+	for (int k = 0; k < 2; k++) {
+		c->model.setKernel ( kernels[k] );
+		int kern = c->model.getKernel ();
+		if ( k == 1 && kern == KERNEL_SCALAR ) break;
+		for (int t = 0; t < AIRCRAFT_TYPES; t++) {
+			c->type = t;
+			c->regime = REGIME_AIRBORNE;
+			c->num = 4096;
+			c->kernel = kern;
+			sprintf ( name, "advance/type/%s/%s/4096", FlightModel::getAircraftTypeName(t), FlightModel::getKernelName(kern) );
+			Bench ( name, c->num, ModelRun, c, ModelReset );
+		}
+	}
+	c->type = AIRCRAFT_DEFAULT;
+	delete c;
+}
+
+//----------------------------------------------------------- quaternion ops
+
+#define QN		1024
+
+struct QuatCtx {
+	Quaternion	q[QN];
+	Vec3F		a[QN], b[QN];
+	float		ang[QN];
+};
+
+static void QuatInit ( QuatCtx* c )
+{
+	unsigned int seed = 1;
+	for (int i = 0; i < QN; i++) {
+		float v[7];
+		for (int k = 0; k < 7; k++) {
+			seed = seed * 1664525u + 1013904223u;
+			v[k] = (seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+		}
+		c->a[i] = Vec3F(v[0], v[1], v[2] + 2.0f);	c->a[i].Normalize();
+		c->b[i] = Vec3F(v[3], v[4] + 2.0f, v[5]);	c->b[i].Normalize();
+		c->ang[i] = v[6];
+		c->q[i].fromAngleAxis ( c->ang[i], c->a[i] );
+	}
+}
+
+static void QuatAngleAxis ( void* p, long long n )
+{
+	QuatCtx* c = (QuatCtx*) p;
+	Quaternion q;
+	float s = 0;
+	for (long long k = 0; k < n; k++) {
+		int i = k & (QN-1);
+		q.fromAngleAxis ( c->ang[i], c->a[i] );
+		s += q.W;
+	}
+	g_sink = s;
+}
+
+static void QuatFromTo ( void* p, long long n )
+{
+	QuatCtx* c = (QuatCtx*) p;
+	Quaternion q;
+	float s = 0;
+	for (long long k = 0; k < n; k++) {
+		int i = k & (QN-1);
+		q.fromRotationFromTo ( c->a[i], c->b[i], 0.001f );
+		s += q.W;
+	}
+	g_sink = s;
+}
+
+static void QuatNormalize ( void* p, long long n )
+{
+	QuatCtx* c = (QuatCtx*) p;
+	for (long long k = 0; k < n; k++) {
+		Quaternion& q = c->q[ k & (QN-1) ];
+		q.W *= 1.0001f;
+		q.normalize ();
+	}
+	g_sink = c->q[0].W;
+}
+
+static void QuatCompose ( void* p, long long n )
+{
+	QuatCtx* c = (QuatCtx*) p;
+	Quaternion q = c->q[0];
+	for (long long k = 0; k < n; k++) {
+		q *= c->q[ k & (QN-1) ];
+		if ( (k & 255) == 255 ) q.normalize ();
+	}
+	g_sink = q.W;
+}
+
+static void QuatRotate ( void* p, long long n )
+{
+	QuatCtx* c = (QuatCtx*) p;
+	Vec3F s (0,0,0);
+	for (long long k = 0; k < n; k++) {
+		int i = k & (QN-1);
+		s += c->a[i] * c->q[i];
+	}
+	g_sink = s.x + s.y + s.z;
+}
+
+static void QuatToEuler ( void* p, long long n )
+{
+	QuatCtx* c = (QuatCtx*) p;
+	Vec3F angs, s (0,0,0);
+	for (long long k = 0; k < n; k++) {
+		c->q[ k & (QN-1) ].toEuler ( angs );
+		s += angs;
+	}
+	g_sink = s.x + s.y + s.z;
+}
+
+static void BenchQuat ()
+{
+	QuatCtx* c = new QuatCtx;
+	QuatInit ( c );
+	Bench ( "quat/fromAngleAxis", 1, QuatAngleAxis, c );
+	Bench ( "quat/fromRotationFromTo", 1, QuatFromTo, c );
+	Bench ( "quat/normalize", 1, QuatNormalize, c );
+	Bench ( "quat/compose", 1, QuatCompose, c );
+	Bench ( "quat/rotate_vec3", 1, QuatRotate, c );
+	Bench ( "quat/toEuler", 1, QuatToEuler, c );
+	delete c;
+}
+
+// Batched ops over QN quaternions per op, from the same inputs as above
+struct QuatBatchCtx {
+	float		qx[QN], qy[QN], qz[QN], qw[QN];
+	float		rx[QN], ry[QN], rz[QN], rw[QN];
+	float		ax[QN], ay[QN], az[QN], bx[QN], by[QN], bz[QN];
+	float		vx[QN], vy[QN], vz[QN], ux[QN], uy[QN], uz[QN], wx[QN], wy[QN], wz[QN];
+	float		ang[QN];
+	QuatSoA		q, r;
+	Vec3SoA		a, b, v, u, w;
+};
+
+static void QuatBatchInit ( QuatBatchCtx* c )
+{
+	QuatCtx* s = new QuatCtx;
+	QuatInit ( s );
+	for (int i = 0; i < QN; i++) {
+		c->qx[i] = s->q[i].X;	c->qy[i] = s->q[i].Y;	c->qz[i] = s->q[i].Z;	c->qw[i] = s->q[i].W;
+		c->rx[i] = s->q[i].X;	c->ry[i] = s->q[i].Y;	c->rz[i] = s->q[i].Z;	c->rw[i] = s->q[i].W;
+		c->ax[i] = s->a[i].x;	c->ay[i] = s->a[i].y;	c->az[i] = s->a[i].z;
+		c->bx[i] = s->b[i].x;	c->by[i] = s->b[i].y;	c->bz[i] = s->b[i].z;
+		c->vx[i] = s->a[i].x;	c->vy[i] = s->a[i].y;	c->vz[i] = s->a[i].z;
+		c->ang[i] = s->ang[i];
+	}
+	delete s;
+	c->q = { c->qx, c->qy, c->qz, c->qw };		c->r = { c->rx, c->ry, c->rz, c->rw };
+	c->a = { c->ax, c->ay, c->az };				c->b = { c->bx, c->by, c->bz };
+	c->v = { c->vx, c->vy, c->vz };				c->u = { c->ux, c->uy, c->uz };		c->w = { c->wx, c->wy, c->wz };
+}
+
+static void QuatBatchAngleAxis ( void* p, long long n )
+{
+	QuatBatchCtx* c = (QuatBatchCtx*) p;
+	for (long long k = 0; k < n; k++) QuatFromAngleAxisN ( QN, c->ang, c->a, c->r );
+	g_sink = c->rw[0];
+}
+
+static void QuatBatchFromTo ( void* p, long long n )
+{
+	QuatBatchCtx* c = (QuatBatchCtx*) p;
+	for (long long k = 0; k < n; k++) QuatFromToN ( QN, c->a, c->b, 0.001f, c->r );
+	g_sink = c->rw[0];
+}
+
+static void QuatBatchNormalize ( void* p, long long n )
+{
+	QuatBatchCtx* c = (QuatBatchCtx*) p;
+	for (long long k = 0; k < n; k++) { c->qw[k & (QN-1)] *= 1.0001f; QuatNormalizeN ( QN, c->q ); }
+	g_sink = c->qw[0];
+}
+
+static void QuatBatchCompose ( void* p, long long n )
+{
+	QuatBatchCtx* c = (QuatBatchCtx*) p;
+	for (long long k = 0; k < n; k++) {
+		QuatComposeN ( QN, c->q, c->r );
+		if ( (k & 255) == 255 ) QuatNormalizeN ( QN, c->q );
+	}
+	g_sink = c->qw[0];
+}
+
+static void QuatBatchRotate ( void* p, long long n )
+{
+	QuatBatchCtx* c = (QuatBatchCtx*) p;
+	for (long long k = 0; k < n; k++) QuatRotateN ( QN, c->q, c->v );
+	g_sink = c->vx[0];
+}
+
+static void QuatBatchBasis ( void* p, long long n )
+{
+	QuatBatchCtx* c = (QuatBatchCtx*) p;
+	for (long long k = 0; k < n; k++) QuatBasisN ( QN, c->q, c->u, c->v, c->w );
+	g_sink = c->ux[0] + c->vy[0] + c->wz[0];
+}
+
+static void BenchQuatBatch ()
+{
+	QuatBatchCtx* c = new QuatBatchCtx;
+	QuatBatchInit ( c );
+	Bench ( "quat_batch/fromAngleAxis/1024", QN, QuatBatchAngleAxis, c );
+	Bench ( "quat_batch/fromTo/1024", QN, QuatBatchFromTo, c );
+	Bench ( "quat_batch/normalize/1024", QN, QuatBatchNormalize, c );
+	Bench ( "quat_batch/compose/1024", QN, QuatBatchCompose, c );
+	Bench ( "quat_batch/rotate_vec3/1024", QN, QuatBatchRotate, c );
+	Bench ( "quat_batch/basis/1024", QN, QuatBatchBasis, c );
+	delete c;
+}
+
+//----------------------------------------------------------- autopilot
+
+#define AP_NUM		10240
+
+struct AutopilotCtx {
+	FlightModel	model, start;
+	Autopilot	ap, ap_start;
+};
+
+// Every aircraft holding altitude, heading and speed, a quarter on a route
+static void AutopilotInit ( AutopilotCtx* c, int kernel )
+{
+	FlightModel& m = c->model;
+	m.Clear ();
+	c->ap.Clear ();
+	m.setKernel ( kernel );
+	m.setAutopilot ( &c->ap );
+	Waypoint wp[4] = { { 5000, 1200, 0, 180 }, { 5000, 1000, 5000, 200 }, { 0, 800, 5000, 160 }, { 0, 1000, 0, 200 } };
+	int route = c->ap.AddRoute ( wp, 4, true );
+	for (int i = 0; i < AP_NUM; i++) {
+		m.AddAircraft ( Vec3F((i % 128) * 50.0f, 1000 + (i % 16), (i / 128) * 50.0f), Vec3F(0, 0, 200), 3 );
+		if ( i % 4 == 3 )	c->ap.setRoute ( m, i, route );
+		else				c->ap.Engage ( m, i, AP_HOLD, 1100, (float) (i % 360), 180 );
+	}
+	c->start = m;
+	c->ap_start = c->ap;
+}
+
+// All blocks of the fleet, as Advance would over AP_PERIOD steps
+static void AutopilotUpdate ( void* p, long long n )
+{
+	AutopilotCtx* c = (AutopilotCtx*) p;
+	c->ap.setPeriod ( 1 );
+	for (long long k = 0; k < n; k++) {
+		c->ap.Prepare ( AP_NUM );
+		for (int b = 0; b < AP_NUM; b += STEP_BLOCK) c->ap.UpdateBlock ( c->model, b, STEP_BLOCK, 0.001f );
+	}
+	c->ap.setPeriod ( AP_PERIOD );
+	g_sink = c->model.m_pitch[0];
+}
+
+static void AutopilotAdvance ( void* p, long long n )
+{
+	AutopilotCtx* c = (AutopilotCtx*) p;
+	for (long long s = 0; s < n; s++) {
+		if ( s % RESTORE_STEPS == RESTORE_STEPS-1 ) { c->model = c->start; c->ap = c->ap_start; }
+		c->model.Advance ( 0.001f );
+	}
+	g_sink = c->model.m_py[0];
+}
+
+static void BenchAutopilot ()
+{
+	AutopilotCtx* c = new AutopilotCtx;
+	char name[128];
+	int kernels[2] = { KERNEL_SCALAR, KERNEL_AUTO };
+	for (int k = 0; k < 2; k++) {
+		AutopilotInit ( c, kernels[k] );
+		int kern = c->model.getKernel ();
+		if ( k == 1 && kern == KERNEL_SCALAR ) break;
+		if ( k == 0 ) Bench ( "autopilot/update/10240", AP_NUM, AutopilotUpdate, c );
+		sprintf ( name, "autopilot/advance/%s/10240", FlightModel::getKernelName(kern) );
+		Bench ( name, AP_NUM, AutopilotAdvance, c );
+	}
+	delete c;
+}
+
+//----------------------------------------------------------- telemetry
+
+#define TEL_NUM		20480
+
+#ifdef _WIN32
+	#define NULL_FILE	"NUL"
+#else
+	#define NULL_FILE	"/dev/null"
+#endif
+
+struct TelemetryCtx {
+	FlightModel	model;
+	FILE*		csv;
+	TelemetrySink sink;
+};
+
+// One sample of the fleet, as flightsim_batch writes its CSV
+static void TelemetryCSV ( void* p, long long n )
+{
+	TelemetryCtx* c = (TelemetryCtx*) p;
+	FlightModel& m = c->model;
+	Vec3F angs;
+	for (long long k = 0; k < n; k++) {
+		for (int i = 0; i < TEL_NUM; i++) {
+			m.getOrient(i).toEuler ( angs );
+			fprintf ( c->csv, "%.4f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.4f,%.2f,%.2f,%.2f,%.1f,%.0f,%d,%d,%d\n", k * 0.01f, i,
+				m.m_px[i], m.m_py[i], m.m_pz[i], m.m_vx[i], m.m_vy[i], m.m_vz[i],
+				m.m_speed[i], m.m_aoa[i], angs.x, angs.y, angs.z, m.m_power[i], m.m_flaps[i],
+				m.m_land_count[i], (int) m.m_land_flags[i], m.m_land_runway[i] );
+		}
+	}
+}
+
+// One sample of every channel, waiting on the writer when it is behind, so
+// this is the sustained rate of the stepping and writer threads together
+static void TelemetryArrow ( void* p, long long n )
+{
+	TelemetryCtx* c = (TelemetryCtx*) p;
+	for (long long k = 0; k < n; k++) c->sink.Capture ( c->model );
+}
+
+static void BenchTelemetry ()
+{
+	TelemetryCtx* c = new TelemetryCtx;
+	for (int i = 0; i < TEL_NUM; i++)
+		c->model.AddAircraft ( Vec3F((i % 128) * 50.0f, 1000, (i / 128) * 50.0f), Vec3F(0, 0, 200), 3 );
+	c->model.Advance ( 0.001f );
+	c->csv = fopen ( NULL_FILE, "wt" );
+	if ( c->csv ) {
+		Bench ( "telemetry/csv/20480", TEL_NUM, TelemetryCSV, c );
+		fclose ( c->csv );
+	}
+	if ( c->sink.Open ( NULL_FILE, 1, 1, TEL_ALL, true ) ) {
+		Bench ( "telemetry/arrow/20480", TEL_NUM, TelemetryArrow, c );
+		c->sink.Close ();
+	}
+	delete c;
+}
+
+//----------------------------------------------------------- ground grid
+
+struct GridCtx {
+	GridMesh	mesh;
+	GridView	view;
+	std::vector<float> inst;			// GridInstFloats, sized after the build
+	int			count[GRID_LEVELS];
+	float		extent;
+};
+
+// Column-major look-at and perspective, as Camera3D builds them
+static void LookAt ( float* M, Vec3F eye, Vec3F at )
+{
+	Vec3F f = at - eye;			f.Normalize();
+	Vec3F s = f.Cross ( Vec3F(0,1,0) );	s.Normalize();
+	Vec3F u = s.Cross ( f );
+	float m[16] = { s.x, u.x, -f.x, 0,  s.y, u.y, -f.y, 0,  s.z, u.z, -f.z, 0,
+					-s.Dot(eye), -u.Dot(eye), f.Dot(eye), 1 };
+	memcpy ( M, m, sizeof(m) );
+}
+
+static void Perspective ( float* M, float fov_deg, float aspect, float n, float f )
+{
+	float t = 1.0f / tanf ( fov_deg * 0.5f * 3.141592f / 180.0f );
+	float m[16] = { t/aspect, 0, 0, 0,  0, t, 0, 0,  0, 0, (f+n)/(n-f), -1,  0, 0, 2*f*n/(n-f), 0 };
+	memcpy ( M, m, sizeof(m) );
+}
+
+static void GridBuild ( void* p, long long n )
+{
+	GridCtx* c = (GridCtx*) p;
+	for (long long k = 0; k < n; k++) BuildGridMesh ( c->mesh, 50, 2000, c->extent );
+	g_sink = (float) c->mesh.tile.size();
+}
+
+static void GridCull ( void* p, long long n )
+{
+	GridCtx* c = (GridCtx*) p;
+	int vis = 0;
+	for (long long k = 0; k < n; k++) vis += CullGridTiles ( c->mesh, c->view, c->inst.data(), c->count );
+	g_sink = (float) vis;
+}
+
+static void BenchGrid ()
+{
+	GridCtx* c = new GridCtx;
+	float V[16], P[16];
+	LookAt ( V, Vec3F(0, 300, -1000), Vec3F(0, 0, 2000) );		// approach view, as the app's flight camera
+	Perspective ( P, 120, 16.0f/9.0f, 1, 100000 );
+	GridViewFromMatrices ( c->view, V, P );
+
+	float extents[2] = { 27500, 300000 };
+	char name[128];
+	for (int e = 0; e < 2; e++) {
+		c->extent = extents[e];
+		BuildGridMesh ( c->mesh, 50, 2000, c->extent );
+		c->inst.resize ( GridInstFloats ( c->mesh ) );
+		sprintf ( name, "grid/build/%gkm", extents[e] / 1000 );
+		Bench ( name, 1, GridBuild, c );
+		sprintf ( name, "grid/cull/%gkm", extents[e] / 1000 );
+		Bench ( name, c->mesh.tiles * c->mesh.tiles, GridCull, c );
+	}
+	delete c;
+}
+
+//----------------------------------------------------------- spatial index
+
+#define SPATIAL_NUM		65536
+
+struct SpatialCtx {
+	SpatialGrid	grid;
+	RunwayIndex	runways;
+	std::vector<float> x, z, vx, vz;
+	std::vector<int> out;
+	unsigned int seed;
+};
+
+static float Rand ( unsigned int& seed )	{ seed = seed * 1664525u + 1013904223u; return (seed >> 8) * (1.0f / 16777216.0f); }
+
+static void SpatialUpdate ( void* p, long long n )
+{
+	SpatialCtx* c = (SpatialCtx*) p;
+	for (long long k = 0; k < n; k++) {
+		for (int i = 0; i < SPATIAL_NUM; i++) { c->x[i] += c->vx[i]; c->z[i] += c->vz[i]; }
+		c->grid.Update ( SPATIAL_NUM, c->x.data(), c->z.data() );
+	}
+	g_sink = (float) c->grid.getMoves();
+}
+
+static void SpatialNeighbors ( void* p, long long n )
+{
+	SpatialCtx* c = (SpatialCtx*) p;
+	size_t found = 0;
+	for (long long k = 0; k < n; k++) {
+		int i = k % SPATIAL_NUM;
+		c->out.clear ();
+		c->grid.NeighborsWithin ( c->x[i], c->z[i], 1000, c->out );
+		found += c->out.size();
+	}
+	g_sink = (float) found;
+}
+
+static void SpatialRunwayAt ( void* p, long long n )
+{
+	SpatialCtx* c = (SpatialCtx*) p;
+	int on = 0;
+	for (long long k = 0; k < n; k++) {
+		int i = k % SPATIAL_NUM;
+		on += ( c->runways.RunwayAt ( c->x[i], c->z[i] ) >= 0 );
+	}
+	g_sink = (float) on;
+}
+
+static void BenchSpatial ()
+{
+	// 64k aircraft over 200 x 200 km at 100-300 m/s and 1 ms steps
+	SpatialCtx* c = new SpatialCtx;
+	c->seed = 1;
+	c->x.resize ( SPATIAL_NUM ); c->z.resize ( SPATIAL_NUM );
+	c->vx.resize ( SPATIAL_NUM ); c->vz.resize ( SPATIAL_NUM );
+	for (int i = 0; i < SPATIAL_NUM; i++) {
+		c->x[i] = (Rand(c->seed) - 0.5f) * 200000;
+		c->z[i] = (Rand(c->seed) - 0.5f) * 200000;
+		float a = Rand(c->seed) * 6.283185f, v = (100 + Rand(c->seed) * 200) * 0.001f;
+		c->vx[i] = v * cosf(a);
+		c->vz[i] = v * sinf(a);
+	}
+	c->grid.Update ( SPATIAL_NUM, c->x.data(), c->z.data() );
+
+	// 64 airports of one 4 km runway each
+	std::vector<Runway> rw;
+	for (int k = 0; k < 64; k++) {
+		Runway r;
+		r.x = (Rand(c->seed) - 0.5f) * 200000;
+		r.z = (Rand(c->seed) - 0.5f) * 200000;
+		r.heading = Rand(c->seed) * 360;
+		r.half_width = 50;
+		r.half_length = 2000;
+		rw.push_back ( r );
+	}
+	c->runways.Build ( rw );
+
+	Bench ( "spatial/update/65536", SPATIAL_NUM, SpatialUpdate, c );
+	Bench ( "spatial/neighbors/1km", 1, SpatialNeighbors, c );
+	Bench ( "spatial/runway_at/64", 1, SpatialRunwayAt, c );
+	delete c;
+}
+
+//----------------------------------------------------------- contacts
+
+#define CONTACT_NUM		10240
+#define CONTACT_BUDGET	1e6			// ns, the 1 ms step
+
+struct ContactCtx {
+	FlightModel	model;
+	Broadphase	bp;
+	std::vector<float> vx, vz;
+};
+
+// Positions moved directly at 1 ms steps, so only the broadphase is timed
+static void ContactMove ( ContactCtx* c )
+{
+	FlightModel& m = c->model;
+	for (int i = 0; i < CONTACT_NUM; i++) { m.m_px[i] += c->vx[i]; m.m_pz[i] += c->vz[i]; }
+}
+
+static void ContactSweep ( void* p, long long n )
+{
+	ContactCtx* c = (ContactCtx*) p;
+	for (long long k = 0; k < n; k++) {
+		ContactMove ( c );
+		c->bp.Update ( c->model );
+	}
+	g_sink = (float) c->bp.getActivePairs();
+}
+
+static void ContactBrute ( void* p, long long n )
+{
+	ContactCtx* c = (ContactCtx*) p;
+	const float* x = c->model.m_px.data();
+	const float* y = c->model.m_py.data();
+	const float* z = c->model.m_pz.data();
+	float r2 = CONTACT_NEAR_DIST * CONTACT_NEAR_DIST;
+	int pairs = 0;
+	for (long long k = 0; k < n; k++) {
+		ContactMove ( c );
+		for (int i = 0; i < CONTACT_NUM; i++)
+			for (int j = i+1; j < CONTACT_NUM; j++) {
+				float dx = x[j]-x[i], dy = y[j]-y[i], dz = z[j]-z[i];
+				pairs += ( dx*dx + dy*dy + dz*dz <= r2 );
+			}
+	}
+	g_sink = (float) pairs;
+}
+
+static void BenchContacts ()
+{
+	// 10k aircraft at 100-300 m/s, 500-1500 m up, over 20 and 100 km
+	ContactCtx* c = new ContactCtx;
+	char name[128];
+	float extents[2] = { 20000, 100000 };
+	for (int e = 0; e < 2; e++) {
+		unsigned int seed = 1;
+		c->model.Clear ();
+		c->bp.Clear ();
+		c->vx.resize ( CONTACT_NUM ); c->vz.resize ( CONTACT_NUM );
+		for (int i = 0; i < CONTACT_NUM; i++) {
+			Vec3F pos ( (Rand(seed) - 0.5f) * extents[e], 500 + Rand(seed) * 1000, (Rand(seed) - 0.5f) * extents[e] );
+			float a = Rand(seed) * 6.283185f, v = 100 + Rand(seed) * 200;
+			c->vx[i] = v * cosf(a) * 0.001f;
+			c->vz[i] = v * sinf(a) * 0.001f;
+			c->model.AddAircraft ( pos, Vec3F(c->vx[i], 0, c->vz[i]) * 1000.0f, 3 );
+		}
+		c->bp.Update ( c->model );
+		sprintf ( name, "contacts/sweep/%gkm/10240", extents[e] / 1000 );
+		size_t r = g_results.size();
+		Bench ( name, CONTACT_NUM, ContactSweep, c );
+		if ( g_results.size() > r )
+			fprintf ( stderr, "  %d boxes overlapping, %d within %g m, %.0f%% of the %g ms step\n", c->bp.getTests(), c->bp.getActivePairs(),
+				CONTACT_NEAR_DIST, 100 * g_results[r].ns_per_op / CONTACT_BUDGET, CONTACT_BUDGET / 1e6 );
+		if ( e == 0 ) Bench ( "contacts/brute/10240", CONTACT_NUM, ContactBrute, c );
+	}
+	delete c;
+}
+
+//----------------------------------------------------------- output
+
+static void WriteJSON ( FILE* fp )
+{
+	FlightModel m;
+	m.setKernel ( KERNEL_AUTO );
+	fprintf ( fp, "{\n  \"benchmark\": \"flightsim\",\n" );
+	#if defined(__clang__)
+		fprintf ( fp, "  \"compiler\": \"clang %d.%d\",\n", __clang_major__, __clang_minor__ );
+	#elif defined(__GNUC__)
+		fprintf ( fp, "  \"compiler\": \"gcc %d.%d\",\n", __GNUC__, __GNUC_MINOR__ );
+	#elif defined(_MSC_VER)
+		fprintf ( fp, "  \"compiler\": \"msvc %d\",\n", _MSC_VER );
+	#else
+		fprintf ( fp, "  \"compiler\": \"unknown\",\n" );
+	#endif
+	#ifdef NDEBUG
+		fprintf ( fp, "  \"build\": \"release\",\n" );
+	#else
+		fprintf ( fp, "  \"build\": \"debug\",\n" );
+	#endif
+	fprintf ( fp, "  \"best_kernel\": \"%s\",\n", FlightModel::getKernelName ( m.getKernel() ) );
+	fprintf ( fp, "  \"min_time_sec\": %g,\n", g_min_time );
+	fprintf ( fp, "  \"results\": [\n" );
+	for (size_t k = 0; k < g_results.size(); k++) {
+		BenchResult& r = g_results[k];
+		fprintf ( fp, "    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"ns_min\": %.3f, \"ops_per_sec\": %.1f, \"items\": %d, \"items_per_sec\": %.1f, \"ops\": %lld }%s\n",
+			r.name.c_str(), r.ns_per_op, r.ns_min, 1e9 / r.ns_per_op, r.items, r.items * 1e9 / r.ns_per_op, r.ops,
+			(k + 1 < g_results.size()) ? "," : "" );
+	}
+	fprintf ( fp, "  ]\n}\n" );
+}
+
+int main ( int argc, char** argv )
+{
+	const char* outname = 0x0;
+	for (int a = 1; a < argc; a++) {
+		if      ( strcmp ( argv[a], "-o" ) == 0 && a+1 < argc )	outname = argv[++a];
+		else if ( strcmp ( argv[a], "-t" ) == 0 && a+1 < argc )	g_min_time = atof ( argv[++a] );
+		else if ( strcmp ( argv[a], "-f" ) == 0 && a+1 < argc )	g_filter = argv[++a];
+		else {
+			fprintf ( stderr, "Usage: bench_flight [-o results.json] [-t min_sec] [-f filter]\n" );
+			return 1;
+		}
+	}
+
+	BenchModel ();
+	BenchQuat ();
+	BenchQuatBatch ();
+	BenchAutopilot ();
+	BenchTelemetry ();
+	BenchGrid ();
+	BenchSpatial ();
+	BenchContacts ();
+
+	FILE* fp = stdout;
+	if ( outname ) {
+		fp = fopen ( outname, "wt" );
+		if ( fp == 0x0 ) {
+			fprintf ( stderr, "ERROR: Unable to write %s\n", outname );
+			return 1;
+		}
+	}
+	WriteJSON ( fp );
+	if ( fp != stdout ) fclose ( fp );
+	return 0;
+}
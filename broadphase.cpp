@@ -0,0 +1,272 @@
+//--------------------------------------------------------
+//
+// Broadphase - aircraft proximity and collision events by sweep and prune
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "broadphase.h"
+#include "flight_model.h"
+#include <math.h>
+#include <algorithm>
+
+#define PAIR_CLOSE		1			// within the near-miss distance
+#define PAIR_SILENT		2			// started inside, no events but a collision
+#define PAIR_COLLIDED	4			// collision reported
+
+Broadphase::Broadphase ()
+{
+	m_near = CONTACT_NEAR_DIST;
+	m_collide = CONTACT_COLLIDE_DIST;
+	m_num_queues = 0;
+	for (int q = 0; q < CONTACT_MAX_QUEUES; q++) m_queues[q] = 0x0;
+	Clear ();
+}
+
+void Broadphase::setDistances ( float near_miss, float collide )
+{
+	m_near = std::max ( near_miss, 0.0f );
+	m_collide = std::min ( std::max ( collide, 0.0f ), m_near );
+	Clear ();
+}
+
+void Broadphase::AddQueue ( ContactQueue* q )
+{
+	if ( m_num_queues < CONTACT_MAX_QUEUES ) m_queues[m_num_queues++] = q;
+}
+
+void Broadphase::RemoveQueue ( ContactQueue* q )
+{
+	for (int k = 0; k < m_num_queues; k++) {
+		if ( m_queues[k] != q ) continue;
+		m_queues[k] = m_queues[--m_num_queues];
+		m_queues[m_num_queues] = 0x0;
+		return;
+	}
+}
+
+void Broadphase::Clear ()
+{
+	for (int a = 0; a < 3; a++) {
+		m_ends[a].clear ();
+		m_pos[a] = 0x0;
+	}
+	m_pairs.clear ();
+	m_index.clear ();
+	m_num_close = 0;
+	m_known = 0;
+	m_time = 0;
+	m_swaps = 0;
+	m_near_misses = 0;
+	m_collisions = 0;
+	m_dropped = 0;
+}
+
+void Broadphase::Update ( FlightModel& m )
+{
+	int n = m.getNumAircraft ();
+	if ( n < m_known ) Clear ();			// model cleared, start over
+	m_time = m.getTime ();
+
+	Bounds ( m );
+	m_swaps = 0;
+	if ( n > m_known ) {
+		Rebuild ( m );
+	} else {
+		for (int a = 0; a < 3; a++) Sort ( a );
+	}
+	Track ( m );
+	m_known = n;
+}
+
+// Ends of this step's boxes, refreshed in their last order
+void Broadphase::Bounds ( FlightModel& m )
+{
+	m_pos[0] = m.m_px.data();
+	m_pos[1] = m.m_py.data();
+	m_pos[2] = m.m_pz.data();
+	float h[2] = { -0.5f * m_near, 0.5f * m_near };
+	for (int a = 0; a < 3; a++) {
+		const float* p = m_pos[a];
+		End* e = m_ends[a].data();
+		int ne = (int) m_ends[a].size();
+		for (int k = 0; k < ne; k++)
+			e[k].v = p[ e[k].id >> 1 ] + h[ e[k].id & 1 ];
+	}
+}
+
+// Ends in order of value, a low end before a high end of the same value so
+// touching boxes overlap, as in Overlap
+bool Broadphase::Before ( const End& p, const End& q )
+{
+	return p.v < q.v || ( p.v == q.v && (p.id & 1) < (q.id & 1) );
+}
+
+// Insertion sort of one axis. Each swap of a low and a high end of two
+// boxes is where they start or stop overlapping on this axis.
+void Broadphase::Sort ( int axis )
+{
+	End* e = m_ends[axis].data();
+	int ne = (int) m_ends[axis].size();
+	for (int k = 1; k < ne; k++) {
+		End v = e[k];
+		if ( !Before ( v, e[k-1] ) ) continue;
+		int j = k;
+		do {
+			const End& p = e[j-1];
+			if ( (v.id ^ p.id) & 1 ) {
+				int a = v.id >> 1, b = p.id >> 1;
+				if ( v.id & 1 )					RemovePair ( a, b );	// high end moved below a low end
+				else if ( Overlap ( a, b ) )	AddPair ( a, b );
+			}
+			e[j] = p;
+			j--;
+		} while ( j > 0 && Before ( v, e[j-1] ) );
+		e[j] = v;
+		m_swaps += k - j;
+	}
+}
+
+// With aircraft added, ends sorted in whole and the set found by a sweep of
+// the low ends along x. Pairs already in the set keep their state.
+void Broadphase::Rebuild ( FlightModel& m )
+{
+	int n = m.getNumAircraft ();
+	float h[2] = { -0.5f * m_near, 0.5f * m_near };
+	for (int a = 0; a < 3; a++) {
+		std::vector<End>& ends = m_ends[a];
+		for (int id = m_known << 1; id < n << 1; id++) {
+			End e = { m_pos[a][id >> 1] + h[id & 1], id };
+			ends.push_back ( e );
+		}
+		std::sort ( ends.begin(), ends.end(), Before );
+	}
+	m_swaps = n;
+
+	std::vector<Pair> last;
+	last.swap ( m_pairs );
+	m_index.clear ();
+	const std::vector<End>& ends = m_ends[0];
+	int ne = (int) ends.size();
+	for (int k = 0; k < ne; k++) {
+		if ( ends[k].id & 1 ) continue;
+		int a = ends[k].id >> 1;
+		float hi = m_pos[0][a] + 0.5f * m_near;
+		for (int s = k+1; s < ne && ends[s].v <= hi; s++) {
+			int b = ends[s].id >> 1;
+			if ( (ends[s].id & 1) == 0 && Overlap ( a, b ) ) AddPair ( a, b );
+		}
+	}
+	for (size_t k = 0; k < last.size(); k++) {
+		const Pair& p = last[k];
+		std::unordered_map<uint64_t, int>::iterator it = m_index.find ( p.key );
+		if ( it != m_index.end() ) {
+			m_pairs[ it->second ] = p;
+		} else if ( p.flags & PAIR_CLOSE ) {					// apart this step
+			if ( !(p.flags & PAIR_SILENT) ) Emit ( CONTACT_CLEAR, p.key, p.closest, p.x, p.y, p.z );
+			m_num_close--;
+		}
+	}
+}
+
+// Boxes overlap on all axes, from the same values as their ends
+bool Broadphase::Overlap ( int a, int b )
+{
+	float h = 0.5f * m_near;
+	for (int k = 0; k < 3; k++)
+		if ( m_pos[k][a] - h > m_pos[k][b] + h || m_pos[k][b] - h > m_pos[k][a] + h ) return false;
+	return true;
+}
+
+void Broadphase::AddPair ( int a, int b )
+{
+	Pair p;
+	p.key = (uint64_t(uint32_t(std::min(a, b))) << 32) | uint32_t(std::max(a, b));
+	p.closest = 0;
+	p.x = p.y = p.z = 0;
+	p.flags = 0;
+	if ( m_index.insert ( std::make_pair ( p.key, (int) m_pairs.size() ) ).second ) m_pairs.push_back ( p );
+}
+
+void Broadphase::RemovePair ( int a, int b )
+{
+	uint64_t key = (uint64_t(uint32_t(std::min(a, b))) << 32) | uint32_t(std::max(a, b));
+	std::unordered_map<uint64_t, int>::iterator it = m_index.find ( key );
+	if ( it == m_index.end() ) return;
+	int k = it->second;
+	m_index.erase ( it );
+	const Pair& p = m_pairs[k];
+	if ( p.flags & PAIR_CLOSE ) {								// left within the distance, at a box edge
+		if ( !(p.flags & PAIR_SILENT) ) Emit ( CONTACT_CLEAR, p.key, p.closest, p.x, p.y, p.z );
+		m_num_close--;
+	}
+	if ( k != (int) m_pairs.size() - 1 ) {
+		m_pairs[k] = m_pairs.back ();
+		m_index[ m_pairs[k].key ] = k;
+	}
+	m_pairs.pop_back ();
+}
+
+// Distance of each pair in the set, with the events as they come within
+// the near-miss distance, collide and clear
+void Broadphase::Track ( FlightModel& m )
+{
+	const float* px = m.m_px.data();
+	const float* py = m.m_py.data();
+	const float* pz = m.m_pz.data();
+	const int* airborn = m.m_airborn.data();
+	float r2 = m_near * m_near, c2 = m_collide * m_collide;
+
+	for (size_t k = 0; k < m_pairs.size(); k++) {
+		Pair& p = m_pairs[k];
+		int i = (int) (p.key >> 32), j = (int) (p.key & 0xFFFFFFFF);
+		float dx = px[j] - px[i], dy = py[j] - py[i], dz = pz[j] - pz[i];
+		float d2 = dx*dx + dy*dy + dz*dz;
+		bool close = d2 <= r2 && ( airborn[i] != 0 || airborn[j] != 0 || d2 <= c2 );	// not taxiing, parked
+		if ( !close ) {
+			if ( p.flags & PAIR_CLOSE ) {						// separated
+				if ( !(p.flags & PAIR_SILENT) ) Emit ( CONTACT_CLEAR, p.key, p.closest, p.x, p.y, p.z );
+				p.flags = 0;
+				m_num_close--;
+			}
+			continue;
+		}
+		float dist = sqrtf ( d2 );
+		float x = px[i] + 0.5f*dx, y = py[i] + 0.5f*dy, z = pz[i] + 0.5f*dz;
+		if ( !(p.flags & PAIR_CLOSE) ) {						// new
+			p.flags = PAIR_CLOSE;
+			p.closest = dist;
+			p.x = x; p.y = y; p.z = z;
+			m_num_close++;
+			if ( i >= m_known || j >= m_known ) {
+				p.flags |= PAIR_SILENT;
+			} else {
+				Emit ( CONTACT_NEAR, p.key, dist, x, y, z );
+				m_near_misses++;
+			}
+		} else if ( dist < p.closest ) {						// still close
+			p.closest = dist;
+			p.x = x; p.y = y; p.z = z;
+		}
+		if ( dist <= m_collide && !(p.flags & PAIR_COLLIDED) ) {
+			Emit ( CONTACT_COLLIDE, p.key, dist, x, y, z );
+			m_collisions++;
+			p.flags |= PAIR_COLLIDED;
+		}
+	}
+}
+
+void Broadphase::Emit ( int type, uint64_t key, float dist, float x, float y, float z )
+{
+	ContactEvent e;
+	e.time = m_time;
+	e.type = type;
+	e.a = (int) (key >> 32);
+	e.b = (int) (key & 0xFFFFFFFF);
+	e.dist = dist;
+	e.x = x; e.y = y; e.z = z;
+	for (int q = 0; q < m_num_queues; q++)
+		if ( !m_queues[q]->Push ( e ) ) m_dropped++;
+}
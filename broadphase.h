@@ -0,0 +1,124 @@
+//--------------------------------------------------------
+//
+// Broadphase - aircraft proximity and collision events by sweep and prune
+//
+// Runs in FlightModel::Advance after the fleet is stepped. Each aircraft is
+// a box the size of the near-miss distance, and the ends of the boxes are
+// kept sorted along x, y and z from step to step. The order is repaired with
+// an insertion sort, which costs about one compare per end since at flight
+// speeds and a 1 ms step few boxes pass each other. When the low end of one
+// box passes the high end of another the pair may start to overlap, and is
+// added if the boxes overlap on the other axes. When a high end passes a low
+// end it is removed. So the set of overlapping boxes is kept by the swaps
+// alone, and a pair that does not change costs nothing. Only the pairs in
+// it are tested by distance. Added aircraft are sorted in whole and the set
+// is found again by a sweep along x. There is no pair loop over the fleet.
+//
+// Pairs in the set keep their state from step to step, so each encounter
+// gives one event as it comes within the near-miss distance and one as it
+// ends:
+//   CONTACT_NEAR     came within the near-miss distance (default the 500 ft
+//                    of a near mid-air collision)
+//   CONTACT_COLLIDE  came within the collision distance, dist is that step's
+//   CONTACT_CLEAR    beyond the near-miss distance again, dist is the closest
+//                    and x, y, z the midpoint there
+// Pairs that start inside the distance because an aircraft was added there
+// are tracked silently until they separate, so formations added as traffic
+// give no events. Near misses between two aircraft on the ground are not
+// reported, collisions are.
+//
+// Events are pushed to each ContactQueue added, lock-free SPSC queues to the
+// HUD and telemetry. A full queue drops the event and counts it.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_BROADPHASE
+	#define DEF_BROADPHASE
+
+	#include <stdint.h>
+	#include <vector>
+	#include <unordered_map>
+	#include "spsc_queue.h"
+
+	class FlightModel;
+
+	#define CONTACT_NEAR			1
+	#define CONTACT_COLLIDE			2
+	#define CONTACT_CLEAR			3
+
+	#define CONTACT_NEAR_DIST		152.4f		// near-miss distance, 500 ft (m)
+	#define CONTACT_COLLIDE_DIST	12.0f		// collision distance, about a wingspan (m)
+	#define CONTACT_QUEUE			4096		// events in flight per queue
+	#define CONTACT_MAX_QUEUES		4
+
+	struct ContactEvent {
+		double		time;					// sim sec, after the step
+		int			type;					// CONTACT_
+		int			a, b;					// aircraft, a < b
+		float		dist;					// m
+		float		x, y, z;				// midpoint of the pair
+	};
+
+	typedef SpscQueue<ContactEvent, CONTACT_QUEUE> ContactQueue;
+
+	class Broadphase {
+	public:
+		Broadphase ();
+
+		void		setDistances ( float near_miss, float collide );	// clears the tracked pairs
+		float		getNearDist ()			{ return m_near; }
+		float		getCollideDist ()		{ return m_collide; }
+
+		// Consumers, each pops on its own thread. Stepping thread, between steps.
+		void		AddQueue ( ContactQueue* q );
+		void		RemoveQueue ( ContactQueue* q );
+
+		void		Update ( FlightModel& m );		// from Advance, after the step
+		void		Clear ();
+
+		int			getActivePairs ()		{ return m_num_close; }		// within the near-miss distance
+		int			getSwaps ()				{ return m_swaps; }			// order repairs in the last Update
+		int			getTests ()				{ return (int) m_pairs.size(); }	// boxes overlapping, tested by distance
+		uint64_t	getNearMisses ()		{ return m_near_misses; }	// since Clear
+		uint64_t	getCollisions ()		{ return m_collisions; }
+		uint64_t	getDropped ()			{ return m_dropped; }		// events lost to full queues
+
+	private:
+		struct End {
+			float		v;					// low or high end of a box on one axis
+			int			id;					// aircraft << 1, | 1 for the high end
+		};
+		struct Pair {
+			uint64_t	key;				// a << 32 | b
+			float		closest;			// m
+			float		x, y, z;			// midpoint at the closest
+			int			flags;				// PAIR_
+		};
+		static bool	Before ( const End& p, const End& q );
+		void		Bounds ( FlightModel& m );
+		void		Sort ( int axis );
+		void		Rebuild ( FlightModel& m );
+		bool		Overlap ( int a, int b );
+		void		AddPair ( int a, int b );
+		void		RemovePair ( int a, int b );
+		void		Track ( FlightModel& m );
+		void		Emit ( int type, uint64_t key, float dist, float x, float y, float z );
+
+		float		m_near, m_collide;
+		const float* m_pos[3];				// model positions, in this Update
+		std::vector<End> m_ends[3];			// sorted along x, y and z
+		std::vector<Pair> m_pairs;			// boxes overlapping
+		std::unordered_map<uint64_t, int> m_index;	// key to m_pairs
+		int			m_num_close;
+		int			m_known;				// aircraft as of the last Update, later ones are new
+		double		m_time;
+		ContactQueue* m_queues[CONTACT_MAX_QUEUES];
+		int			m_num_queues;
+		int			m_swaps;
+		uint64_t	m_near_misses, m_collisions, m_dropped;
+	};
+
+#endif
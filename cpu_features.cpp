@@ -0,0 +1,46 @@
+//--------------------------------------------------------
+//
+// CPU feature detection, for selecting SIMD kernels at runtime
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "cpu_features.h"
+
+#if defined(CPU_X86) && defined(_MSC_VER)
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+bool cpuHasAVX2 ()
+{
+#if defined(CPU_X86) && defined(_MSC_VER)
+	int r[4];
+	__cpuid ( r, 0 );
+	if ( r[0] < 7 ) return false;
+	__cpuid ( r, 1 );
+	bool fma = (r[2] & (1 << 12)) != 0;
+	bool osxsave = (r[2] & (1 << 27)) != 0;
+	bool avx = (r[2] & (1 << 28)) != 0;
+	if ( !fma || !osxsave || !avx ) return false;
+	if ( (_xgetbv(0) & 6) != 6 ) return false;		// OS saves XMM and YMM state
+	__cpuidex ( r, 7, 0 );
+	return (r[1] & (1 << 5)) != 0;
+#elif defined(CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init ();
+	return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+#else
+	return false;
+#endif
+}
+
+bool cpuHasNEON ()
+{
+#if defined(CPU_ARM64)
+	return true;			// NEON (ASIMD) is mandatory on AArch64
+#else
+	return false;
+#endif
+}
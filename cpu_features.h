@@ -0,0 +1,23 @@
+//--------------------------------------------------------
+//
+// CPU feature detection, for selecting SIMD kernels at runtime
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_CPU_FEATURES
+	#define DEF_CPU_FEATURES
+
+	#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+		#define CPU_X86
+	#endif
+	#if defined(__aarch64__) || defined(_M_ARM64)
+		#define CPU_ARM64
+	#endif
+
+	bool	cpuHasAVX2 ();		// AVX2 + FMA, with OS support for YMM state
+	bool	cpuHasNEON ();
+
+#endif
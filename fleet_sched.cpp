@@ -0,0 +1,146 @@
+//--------------------------------------------------------
+//
+// Fleet scheduler - work-stealing thread pool for stepping large fleets
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "fleet_sched.h"
+
+#define SCHED_SPIN		4000				// polls before a worker sleeps on the condition
+
+static inline uint64_t PackRange ( uint32_t b, uint32_t e )		{ return uint64_t(b) | (uint64_t(e) << 32); }
+
+FleetScheduler::FleetScheduler ( int threads )
+{
+	if ( threads <= 0 ) threads = std::thread::hardware_concurrency();
+	if ( threads <= 0 ) threads = 1;
+	m_num_threads = threads;
+
+	m_queues = new WorkQueue[ m_num_threads ];
+	for (int n = 0; n < m_num_threads; n++)
+		m_queues[n].range.store ( 0 );
+
+	m_fn = 0x0;
+	m_ctx = 0x0;
+	m_generation.store ( 0 );
+	m_busy.store ( 0 );
+	m_quit.store ( false );
+
+	// Worker 0 is the calling thread
+	for (int n = 1; n < m_num_threads; n++)
+		m_threads.push_back ( std::thread ( &FleetScheduler::WorkerLoop, this, n ) );
+}
+
+FleetScheduler::~FleetScheduler ()
+{
+	{
+		std::lock_guard<std::mutex> lock ( m_mutex );
+		m_quit.store ( true );
+		m_generation++;
+	}
+	m_wake.notify_all ();
+	for (size_t n = 0; n < m_threads.size(); n++)
+		m_threads[n].join ();
+	delete [] m_queues;
+}
+
+void FleetScheduler::ParallelFor ( int num_chunks, ChunkFunc fn, void* ctx )
+{
+	if ( num_chunks <= 0 ) return;
+
+	if ( m_num_threads == 1 || num_chunks == 1 ) {
+		for (int c = 0; c < num_chunks; c++) fn ( ctx, c );
+		return;
+	}
+
+	// Contiguous initial range per worker
+	m_fn = fn;
+	m_ctx = ctx;
+	for (int n = 0; n < m_num_threads; n++) {
+		uint32_t b = uint32_t( int64_t(num_chunks) * n / m_num_threads );
+		uint32_t e = uint32_t( int64_t(num_chunks) * (n+1) / m_num_threads );
+		m_queues[n].range.store ( PackRange ( b, e ), std::memory_order_relaxed );
+	}
+	m_busy.store ( m_num_threads - 1 );
+	{
+		std::lock_guard<std::mutex> lock ( m_mutex );
+		m_generation++;							// publishes the job
+	}
+	m_wake.notify_all ();
+
+	RunChunks ( 0 );
+
+	// Wait for workers to finish their last chunk
+	while ( m_busy.load ( std::memory_order_acquire ) > 0 )
+		std::this_thread::yield ();
+}
+
+void FleetScheduler::WorkerLoop ( int id )
+{
+	int seen = 0;
+
+	for (;;) {
+		// Wait for the next job, polling first since steps come back to back
+		int spin = 0;
+		while ( m_generation.load ( std::memory_order_acquire ) == seen && spin < SCHED_SPIN ) {
+			spin++;
+			if ( (spin & 63) == 0 ) std::this_thread::yield ();
+		}
+		if ( m_generation.load ( std::memory_order_acquire ) == seen ) {
+			std::unique_lock<std::mutex> lock ( m_mutex );
+			while ( m_generation.load() == seen ) m_wake.wait ( lock );
+		}
+		seen = m_generation.load ( std::memory_order_acquire );
+
+		if ( m_quit.load() ) return;
+
+		RunChunks ( id );
+		m_busy.fetch_sub ( 1, std::memory_order_release );
+	}
+}
+
+void FleetScheduler::RunChunks ( int id )
+{
+	int c;
+	for (;;) {
+		c = PopChunk ( id );
+		if ( c < 0 ) c = StealChunk ( id );
+		if ( c < 0 ) return;				// all queues empty
+		m_fn ( m_ctx, c );
+	}
+}
+
+int FleetScheduler::PopChunk ( int id )
+{
+	std::atomic<uint64_t>& q = m_queues[id].range;
+	uint64_t r = q.load ( std::memory_order_acquire );
+	for (;;) {
+		uint32_t b = uint32_t(r), e = uint32_t(r >> 32);
+		if ( b >= e ) return -1;
+		if ( q.compare_exchange_weak ( r, PackRange ( b+1, e ), std::memory_order_acq_rel ) ) return int(b);
+	}
+}
+
+int FleetScheduler::StealChunk ( int id )
+{
+	// Visit other workers starting after ourselves
+	for (int k = 1; k < m_num_threads; k++) {
+		int v = (id + k) % m_num_threads;
+		std::atomic<uint64_t>& q = m_queues[v].range;
+		uint64_t r = q.load ( std::memory_order_acquire );
+		for (;;) {
+			uint32_t b = uint32_t(r), e = uint32_t(r >> 32);
+			if ( b >= e ) break;
+			uint32_t cnt = (e - b + 1) / 2;			// back half
+			uint32_t mid = e - cnt;
+			if ( q.compare_exchange_weak ( r, PackRange ( b, mid ), std::memory_order_acq_rel ) ) {
+				if ( cnt > 1 ) m_queues[id].range.store ( PackRange ( mid+1, e ), std::memory_order_release );
+				return int(mid);
+			}
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,67 @@
+//--------------------------------------------------------
+//
+// Fleet scheduler - work-stealing thread pool for stepping large fleets
+//
+// ParallelFor splits a job into chunks. Each worker starts with a contiguous
+// range of chunk indices and takes chunks from the front of its own range;
+// once out of work it steals the back half of another worker's range. The
+// ranges are packed [begin,end) in one 64-bit atomic per worker, so both the
+// owner pop and the steal are a single CAS. Stealing absorbs the uneven cost
+// of aircraft on the ground, whose step rebuilds the orientation.
+//
+// Chunk boundaries depend only on the chunk size, never on the thread count,
+// so every aircraft is stepped by the same code path whatever the number of
+// threads and results are deterministic.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_FLEET_SCHED
+	#define DEF_FLEET_SCHED
+
+	#include <stdint.h>
+	#include <atomic>
+	#include <thread>
+	#include <mutex>
+	#include <condition_variable>
+	#include <vector>
+
+	typedef void (*ChunkFunc) ( void* ctx, int chunk );
+
+	class FleetScheduler {
+	public:
+		FleetScheduler ( int threads = 0 );			// 0 = one per hardware thread
+		~FleetScheduler ();
+
+		int			getNumThreads ()		{ return m_num_threads; }
+
+		// Run fn(ctx, c) for every chunk c in [0, num_chunks). The calling thread
+		// takes part and the call returns once all chunks are done.
+		void		ParallelFor ( int num_chunks, ChunkFunc fn, void* ctx );
+
+	private:
+		struct alignas(64) WorkQueue {
+			std::atomic<uint64_t>	range;			// begin in low 32 bits, end in high 32 bits
+		};
+		void		WorkerLoop ( int id );
+		void		RunChunks ( int id );
+		int			PopChunk ( int id );
+		int			StealChunk ( int id );
+
+		int			m_num_threads;
+		std::vector<std::thread> m_threads;
+		WorkQueue*	m_queues;
+
+		ChunkFunc	m_fn;
+		void*		m_ctx;
+
+		std::mutex	m_mutex;
+		std::condition_variable m_wake;
+		std::atomic<int> m_generation;				// incremented for each job
+		std::atomic<int> m_busy;					// workers still running the current job
+		std::atomic<bool> m_quit;
+	};
+
+#endif
@@ -0,0 +1,69 @@
+//--------------------------------------------------------
+//
+// Flight model step kernels
+//
+// A step runs in blocks of STEP_BLOCK aircraft. The force pass evaluates the
+// body frame, pitch inputs, lift, drag and thrust for the block and leaves the
+// intermediate vectors in StepScratch. The integrate pass then updates
+// orientation, position, velocity and ground contact from the scratch.
+// The scalar force pass is the reference; the SIMD passes must match it
+// within the error bounds stated in flight_simd.cpp. With a SIMD kernel the
+// integrate pass also turns the block's orientations at once with the batched
+// quaternion ops (quat_batch.h), before the per-aircraft update. Blocks under
+// SIMD_MIN_BLOCK aircraft step with the scalar passes whatever the kernel.
+// Ground contact stays per aircraft in either case.
+//
+// The model's rate constants were tuned as per-step factors at a 1 ms step.
+// StepRates turns them into the factors for the step actually taken, so the
+// pitch filter, directional stability, roll rate, ground friction and the
+// landing timers all run at the same rate per second whatever dt is. At the
+// base step they are the original constants exactly.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_FLIGHT_KERNELS
+	#define DEF_FLIGHT_KERNELS
+
+	#include "flight_model.h"
+
+	#define STEP_BLOCK		256
+	#define SIMD_MIN_BLOCK	8			// smaller blocks step scalar, as SIMD would be all remainder
+	#define STEP_BASE_DT	0.001		// step the per-step constants are given for (sec)
+
+	struct StepRates {
+		double	ratio;						// dt / STEP_BASE_DT
+		double	pitch_keep, pitch_gain;		// pitch input filter, adv = adv*keep + pitch*gain
+		double	pitch_angle;				// velocity rotation per unit of filtered pitch (rad)
+		double	stability;					// fraction of the way the body turns toward the velocity
+		double	roll_angle;					// body roll per unit of roll input (rad)
+		double	friction;					// ground roll velocity factor
+		int		land_after;					// steps airborne before a touchdown is scored
+		int		land_shown;					// steps airborne a scored touchdown stays valid
+	};
+	void	MakeStepRates ( StepRates& r, float dt );
+
+	struct StepScratch {
+		StepRates rates;											// for this step's dt
+		float	fx[STEP_BLOCK], fy[STEP_BLOCK], fz[STEP_BLOCK];		// body forward, before orientation update
+		float	ax[STEP_BLOCK], ay[STEP_BLOCK], az[STEP_BLOCK];		// velocity axis, after pitch inputs
+		float	Fx[STEP_BLOCK], Fy[STEP_BLOCK], Fz[STEP_BLOCK];		// total body force (lift + drag + thrust)
+		float	wx[STEP_BLOCK], wy[STEP_BLOCK], wz[STEP_BLOCK];		// wind at the aircraft, zero without wind
+
+		// batched orientation update
+		float	ux[STEP_BLOCK], uy[STEP_BLOCK], uz[STEP_BLOCK];		// body up before it, for RK4
+		float	rx[STEP_BLOCK], ry[STEP_BLOCK], rz[STEP_BLOCK];		// roll axis, body forward after stability
+		float	qx[STEP_BLOCK], qy[STEP_BLOCK], qz[STEP_BLOCK], qw[STEP_BLOCK];		// stability, then roll rotation
+		float	angle[STEP_BLOCK];									// roll angle
+	};
+
+	// Force pass over aircraft [first, first+n), n <= STEP_BLOCK, scratch entry j is aircraft first+j.
+	// Writes m_speed, m_aoa, m_pitch_adv, lift/drag/thrust and the scratch.
+	// The scalar pass may start at entry 'start' to finish a SIMD remainder.
+	void	ComputeForcesScalar ( FlightModel& m, int first, int n, StepScratch& s, int start = 0 );
+	template<class T> void	ComputeForcesAVX2 ( FlightModel& m, int first, int n, StepScratch& s );	// instantiated for each aircraft type
+	template<class T> void	ComputeForcesNEON ( FlightModel& m, int first, int n, StepScratch& s );
+
+#endif
@@ -0,0 +1,762 @@
+//--------------------------------------------------------
+//
+// Flight model - single-body force model (SBFM) for N aircraft
+//
+// See app_flightsim.cpp for a description of the model.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "flight_model.h"
+#include "flight_kernels.h"
+#include "cpu_features.h"
+#include "fleet_sched.h"
+#include "aero_table.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include "quat_batch.h"
+#include "autopilot.h"
+#include "broadphase.h"
+#include <string.h>
+#include <stdio.h>
+
+FlightModel::FlightModel ()
+{
+	m_num = 0;
+
+	m_LiftFactor = 0.0001;
+	m_DragFactor = 0.0001;
+	m_mass = 0.1;				// body mass (kg)
+	m_max_speed = 500.0;		// top speed, 500 m/s = 1800 kph = 1118 mph
+
+	m_wind.Set (0, 0, 0);
+
+	AddRunway ( 0, 0, 0, 100, 4000 );		// 4000 x 100 meters (13120 x 328 ft)
+	m_traffic_on = true;
+
+	m_type = AIRCRAFT_DEFAULT;
+	m_aero = 0x0;
+	m_terrain = 0x0;
+	m_autopilot = 0x0;
+	m_broadphase = 0x0;
+	m_wind_field = 0x0;
+	m_time = 0;
+	m_wind_next = 0;
+	m_wind_due = true;
+	m_integrator = INTEGRATOR_EULER;
+	m_adaptive_tol = 0;
+	setKernel ( KERNEL_AUTO );
+}
+
+void FlightModel::Clear ()
+{
+	m_num = 0;
+	m_px.clear(); m_py.clear(); m_pz.clear();
+	m_vx.clear(); m_vy.clear(); m_vz.clear();
+	m_qw.clear(); m_qx.clear(); m_qy.clear(); m_qz.clear();
+	m_pitch_adv.clear();
+	m_roll.clear(); m_pitch.clear(); m_power.clear(); m_flaps.clear();
+	m_speed.clear(); m_aoa.clear();
+	m_lx.clear(); m_ly.clear(); m_lz.clear();
+	m_dx.clear(); m_dy.clear(); m_dz.clear();
+	m_tx.clear(); m_ty.clear(); m_tz.clear();
+	m_airborn.clear();
+	m_land_flags.clear();
+	m_land_speed.clear(); m_land_sink.clear(); m_land_pitch.clear(); m_land_roll.clear();
+	m_land_count.clear();
+	m_land_runway.clear();
+	m_ground.clear(); m_terrain_slot.clear(); m_wind_slot.clear();
+	m_gx.clear(); m_gy.clear(); m_gz.clear();
+	m_traffic.Clear();
+}
+
+int FlightModel::AddAircraft ( Vec3F pos, Vec3F vel, float power )
+{
+	// Initial orientation along velocity, zero roll
+	Vec3F dir = vel;
+	if ( dir.Length() == 0 ) dir.Set(0, 0, 1);
+	dir.Normalize();
+	Quaternion q;
+	q.fromDirectionAndRoll ( dir, 0 );
+
+	m_px.push_back ( pos.x );	m_py.push_back ( pos.y );	m_pz.push_back ( pos.z );
+	m_vx.push_back ( vel.x );	m_vy.push_back ( vel.y );	m_vz.push_back ( vel.z );
+	m_qw.push_back ( q.W );		m_qx.push_back ( q.X );		m_qy.push_back ( q.Y );		m_qz.push_back ( q.Z );
+	m_pitch_adv.push_back ( 0 );
+
+	m_roll.push_back ( 0 );
+	m_pitch.push_back ( 0 );
+	m_power.push_back ( power );
+	m_flaps.push_back ( 0 );
+
+	m_speed.push_back ( vel.Length() );
+	m_aoa.push_back ( 0 );
+	m_lx.push_back ( 0 );	m_ly.push_back ( 0 );	m_lz.push_back ( 0 );
+	m_dx.push_back ( 0 );	m_dy.push_back ( 0 );	m_dz.push_back ( 0 );
+	m_tx.push_back ( 0 );	m_ty.push_back ( 0 );	m_tz.push_back ( 0 );
+
+	m_airborn.push_back ( 1 );
+	m_land_flags.push_back ( 0 );
+	m_land_speed.push_back ( 0 );	m_land_sink.push_back ( 0 );
+	m_land_pitch.push_back ( 0 );	m_land_roll.push_back ( 0 );
+	m_land_count.push_back ( 0 );
+	m_land_runway.push_back ( -1 );
+	m_terrain_slot.push_back ( -1 );
+	m_ground.push_back ( m_terrain ? m_terrain->Height ( pos.x, pos.z, m_terrain_slot.back() ) : 0 );
+	m_wind_slot.push_back ( -1 );
+	m_gx.push_back ( 0 );	m_gy.push_back ( 0 );	m_gz.push_back ( 0 );
+	m_wind_next = m_time;		// sample the newcomer at the next step
+
+	return m_num++;
+}
+
+void FlightModel::getLanding ( int i, LandingStatus& l )
+{
+	l.flags = m_land_flags[i];
+	l.count = m_land_count[i];
+	l.runway = m_land_runway[i];
+	l.speed = m_land_speed[i];		l.sink = m_land_sink[i];
+	l.pitch = m_land_pitch[i];		l.roll = m_land_roll[i];
+}
+
+int FlightModel::FormatLanding ( const LandingStatus& l, char* buf, int size )
+{
+	uint8_t f = l.flags;
+	if ( !(f & LAND_VALID) ) {
+		if ( size > 0 ) buf[0] = '\0';
+		return 0;
+	}
+	return snprintf ( buf, size, "%s\n Speed (<80): %4.1f m/s     %s\n Sink rate (<2): %4.1f m/s      %s\n Pitch (<5): %4.1f deg     %s\n Roll (<5): %4.1f deg     %s\n On Runway: %s\n",
+						(f & LAND_OK) ? "LANDED!" : "CRASH",
+						l.speed,	(f & LAND_SPEED) ? "OK" : "FAIL",
+						l.sink,		(f & LAND_SINK) ? "OK" : "FAIL",
+						l.pitch,	(f & LAND_PITCH) ? "OK" : "FAIL",
+						l.roll,		(f & LAND_ROLL) ? "OK" : "FAIL",
+						(f & LAND_RUNWAY) ? "Yes     OK" : "No     FAIL" );
+}
+
+void FlightModel::SaveState ( int i, FlightState& s )
+{
+	s.time = m_time;
+	s.pos[0] = m_px[i];		s.pos[1] = m_py[i];		s.pos[2] = m_pz[i];
+	s.vel[0] = m_vx[i];		s.vel[1] = m_vy[i];		s.vel[2] = m_vz[i];
+	s.orient[0] = m_qx[i];	s.orient[1] = m_qy[i];	s.orient[2] = m_qz[i];	s.orient[3] = m_qw[i];
+	s.pitch_adv = m_pitch_adv[i];
+	s.roll = m_roll[i];		s.pitch = m_pitch[i];	s.power = m_power[i];	s.flaps = m_flaps[i];
+	s.speed = m_speed[i];	s.aoa = m_aoa[i];
+	s.lift[0] = m_lx[i];	s.lift[1] = m_ly[i];	s.lift[2] = m_lz[i];
+	s.drag[0] = m_dx[i];	s.drag[1] = m_dy[i];	s.drag[2] = m_dz[i];
+	s.thrust[0] = m_tx[i];	s.thrust[1] = m_ty[i];	s.thrust[2] = m_tz[i];
+	s.ground = m_ground[i];
+	s.gust[0] = m_gx[i];	s.gust[1] = m_gy[i];	s.gust[2] = m_gz[i];
+	s.airborn = m_airborn[i];
+	getLanding ( i, s.land );
+}
+
+void FlightModel::RestoreState ( int i, const FlightState& s )
+{
+	m_px[i] = s.pos[0];		m_py[i] = s.pos[1];		m_pz[i] = s.pos[2];
+	m_vx[i] = s.vel[0];		m_vy[i] = s.vel[1];		m_vz[i] = s.vel[2];
+	m_qx[i] = s.orient[0];	m_qy[i] = s.orient[1];	m_qz[i] = s.orient[2];	m_qw[i] = s.orient[3];
+	m_pitch_adv[i] = s.pitch_adv;
+	m_roll[i] = s.roll;		m_pitch[i] = s.pitch;	m_power[i] = s.power;	m_flaps[i] = s.flaps;
+	m_speed[i] = s.speed;	m_aoa[i] = s.aoa;
+	m_lx[i] = s.lift[0];	m_ly[i] = s.lift[1];	m_lz[i] = s.lift[2];
+	m_dx[i] = s.drag[0];	m_dy[i] = s.drag[1];	m_dz[i] = s.drag[2];
+	m_tx[i] = s.thrust[0];	m_ty[i] = s.thrust[1];	m_tz[i] = s.thrust[2];
+	m_ground[i] = s.ground;
+	m_gx[i] = s.gust[0];	m_gy[i] = s.gust[1];	m_gz[i] = s.gust[2];
+	m_airborn[i] = s.airborn;
+	m_land_flags[i] = s.land.flags;
+	m_land_count[i] = s.land.count;
+	m_land_runway[i] = s.land.runway;
+	m_land_speed[i] = s.land.speed;		m_land_sink[i] = s.land.sink;
+	m_land_pitch[i] = s.land.pitch;		m_land_roll[i] = s.land.roll;
+	m_terrain_slot[i] = -1;				// hints are for the old position
+	m_wind_slot[i] = -1;
+}
+
+int FlightModel::ForkState ( const FlightState& s, int k )
+{
+	int first = m_num;
+	for (int j = 0; j < k; j++) {
+		int i = AddAircraft ( Vec3F(s.pos[0], s.pos[1], s.pos[2]), Vec3F(s.vel[0], s.vel[1], s.vel[2]), s.power );
+		RestoreState ( i, s );
+	}
+	return first;
+}
+
+void FlightModel::CheckLanding ( int i, Quaternion& orient, float speed, int land_after )
+{
+	if ( m_airborn[i] > land_after ) {
+
+		Vec3F angs;
+		orient.toEuler ( angs );
+
+		// Check for good landing:
+		// - Speed < 80 m/s
+		// - Sink rate < 2 m/s
+		// - Pitch < 5 deg
+		// - Roll < 5 deg
+		// - On runway
+		float x = m_px[i], z = m_pz[i];
+		uint8_t f = LAND_VALID;
+		if ( speed < 80 )				f |= LAND_SPEED;
+		if ( fabs(m_vy[i]) < 2 )		f |= LAND_SINK;
+		if ( fabs(angs.y) < 5 )			f |= LAND_PITCH;
+		if ( fabs(angs.x) < 5 )			f |= LAND_ROLL;
+		int r = m_runway_index.RunwayAt ( x, z );
+		if ( r >= 0 ) f |= LAND_RUNWAY;
+		if ( (f & (LAND_SPEED|LAND_SINK|LAND_PITCH|LAND_ROLL|LAND_RUNWAY)) == (LAND_SPEED|LAND_SINK|LAND_PITCH|LAND_ROLL|LAND_RUNWAY) ) f |= LAND_OK;
+
+		m_land_flags[i] = f;
+		m_land_speed[i] = speed;
+		m_land_sink[i] = m_vy[i];
+		m_land_pitch[i] = fabs(angs.y);
+		m_land_roll[i] = fabs(angs.x);
+		m_land_count[i]++;
+		m_land_runway[i] = r;
+	}
+	m_airborn[i] = 0;
+}
+
+struct AdvanceJob {
+	FlightModel*	model;
+	float			dt;
+};
+
+static void AdvanceChunk ( void* ctx, int c )
+{
+	AdvanceJob* job = (AdvanceJob*) ctx;
+	int first = c * STEP_BLOCK;
+	int last = first + STEP_BLOCK;
+	if ( last > job->model->m_num ) last = job->model->m_num;
+	job->model->AdvanceRange ( first, last, job->dt, true );
+}
+
+void FlightModel::Advance ( float dt, FleetScheduler* sched )
+{
+	// Wind field samples are due every WIND_RESAMPLE
+	m_wind_due = ( m_time >= m_wind_next );
+	if ( m_wind_due ) m_wind_next = m_time + WIND_RESAMPLE;
+	if ( m_autopilot ) m_autopilot->Prepare ( m_num );
+
+	// Chunks are whole blocks, so a parallel step gives the same results as a serial one
+	int chunks = (m_num + STEP_BLOCK-1) / STEP_BLOCK;
+	if ( sched == 0x0 || chunks < 2 ) {
+		AdvanceRange ( 0, m_num, dt, true );
+	} else {
+		AdvanceJob job;
+		job.model = this;
+		job.dt = dt;
+		sched->ParallelFor ( chunks, AdvanceChunk, &job );
+	}
+	if ( m_traffic_on ) m_traffic.Update ( m_num, m_px.data(), m_pz.data() );
+	m_time += dt;
+	if ( m_broadphase ) m_broadphase->Update ( *this );
+}
+
+int FlightModel::AddRunway ( float x, float z, float heading, float width, float length )
+{
+	Runway r;
+	r.x = x;
+	r.z = z;
+	r.heading = heading;
+	r.half_width = width * 0.5f;
+	r.half_length = length * 0.5f;
+	m_runways.push_back ( r );
+	m_runway_index.Build ( m_runways );		// few and static, rebuilt whole
+	return (int) m_runways.size() - 1;
+}
+
+void FlightModel::ClearRunways ()
+{
+	m_runways.clear ();
+	m_runway_index.Build ( m_runways );
+}
+
+void FlightModel::setTerrain ( const Terrain* t )
+{
+	m_terrain = t;
+	for (int i = 0; i < m_num; i++) {
+		m_terrain_slot[i] = -1;
+		m_ground[i] = 0;
+	}
+}
+
+void FlightModel::setWindField ( const WindField* w )
+{
+	m_wind_field = w;
+	for (int i = 0; i < m_num; i++) m_wind_slot[i] = -1;
+	m_wind_next = m_time;
+}
+
+bool FlightModel::hasWind ()
+{
+	if ( m_wind_field && m_wind_field->getTurbulence() > 0 ) return true;
+	return ( m_wind.x != 0 || m_wind.y != 0 || m_wind.z != 0 );
+}
+
+// Wind at each aircraft of a block, sheared and turbulent from the field, else m_wind.
+// Field samples are held between the steps they are due.
+void FlightModel::SampleWind ( int first, int n, StepScratch& s )
+{
+	if ( m_wind_field ) {
+		if ( m_wind_due ) {
+			for (int i = first; i < first + n; i++) {
+				Vec3F w = m_wind_field->Sample ( m_wind, m_px[i], m_py[i] - m_ground[i], m_pz[i], m_time, m_wind_slot[i] );
+				m_gx[i] = w.x;	m_gy[i] = w.y;	m_gz[i] = w.z;
+			}
+		}
+		memcpy ( s.wx, &m_gx[first], n * sizeof(float) );
+		memcpy ( s.wy, &m_gy[first], n * sizeof(float) );
+		memcpy ( s.wz, &m_gz[first], n * sizeof(float) );
+	} else {
+		for (int j = 0; j < n; j++) { s.wx[j] = m_wind.x;	s.wy[j] = m_wind.y;	s.wz[j] = m_wind.z; }
+	}
+}
+
+void FlightModel::setTrafficIndex ( bool on )
+{
+	m_traffic_on = on;
+	if ( on )	m_traffic.Update ( m_num, m_px.data(), m_pz.data() );
+	else		m_traffic.Clear ();
+}
+
+void FlightModel::NeighborsWithin ( int i, float r, std::vector<int>& out )
+{
+	// Grid gives horizontal candidates, height and self are tested here
+	size_t first = out.size();
+	m_traffic.NeighborsWithin ( m_px[i], m_pz[i], r, out );
+	size_t n = first;
+	for (size_t k = first; k < out.size(); k++) {
+		int j = out[k];
+		float dx = m_px[j] - m_px[i], dy = m_py[j] - m_py[i], dz = m_pz[j] - m_pz[i];
+		if ( j != i && dx*dx + dy*dy + dz*dz <= r*r ) out[n++] = j;
+	}
+	out.resize ( n );
+}
+
+void FlightModel::setKernel ( int k )
+{
+	if ( k == KERNEL_AUTO ) {
+		k = KERNEL_SCALAR;
+		if ( cpuHasAVX2() ) k = KERNEL_AVX2;
+		if ( cpuHasNEON() ) k = KERNEL_NEON;
+	}
+	if ( k == KERNEL_AVX2 && !cpuHasAVX2() ) k = KERNEL_SCALAR;
+	if ( k == KERNEL_NEON && !cpuHasNEON() ) k = KERNEL_SCALAR;
+	m_kernel = k;
+}
+
+const char* FlightModel::getKernelName ( int k )
+{
+	switch ( k ) {
+	case KERNEL_AVX2:	return "avx2";
+	case KERNEL_NEON:	return "neon";
+	default:			return "scalar";
+	};
+}
+
+// Constant types copy their values into the runtime parameters, which the
+// SIMD kernels and callers read, so every path sees the same aircraft.
+template<class T> static void SetParams ( FlightModel& m )
+{
+	m.m_LiftFactor = T::LiftFactor ( m );
+	m.m_DragFactor = T::DragFactor ( m );
+	m.m_mass = T::Mass ( m );
+	m.m_max_speed = T::MaxSpeed ( m );
+}
+
+void FlightModel::setAircraftType ( int t )
+{
+	switch ( t ) {
+	case AIRCRAFT_TRAINER:	SetParams<AircraftTrainer> ( *this );	break;
+	case AIRCRAFT_GLIDER:	SetParams<AircraftGlider> ( *this );	break;
+	case AIRCRAFT_JET:		SetParams<AircraftJet> ( *this );		break;
+	default:				t = AIRCRAFT_DEFAULT;					break;
+	};
+	m_type = t;
+	if ( !hasFlaps() )
+		for (int i = 0; i < m_num; i++) m_flaps[i] = 0;
+}
+
+void FlightModel::setIntegrator ( int k )
+{
+	m_integrator = ( k >= INTEGRATOR_EULER && k <= INTEGRATOR_RK4 ) ? k : INTEGRATOR_EULER;
+}
+
+const char* FlightModel::getIntegratorName ( int k )
+{
+	switch ( k ) {
+	case INTEGRATOR_SEMI_IMPLICIT:	return "semi";
+	case INTEGRATOR_RK4:			return "rk4";
+	default:						return "euler";
+	};
+}
+
+const char* FlightModel::getAircraftTypeName ( int t )
+{
+	switch ( t ) {
+	case AIRCRAFT_TRAINER:	return "trainer";
+	case AIRCRAFT_GLIDER:	return "glider";
+	case AIRCRAFT_JET:		return "jet";
+	default:				return "default";
+	};
+}
+
+bool FlightModel::hasFlaps ()
+{
+	switch ( m_type ) {
+	case AIRCRAFT_TRAINER:	return AircraftTrainer::has_flaps;
+	case AIRCRAFT_GLIDER:	return AircraftGlider::has_flaps;
+	case AIRCRAFT_JET:		return AircraftJet::has_flaps;
+	default:				return AircraftDefault::has_flaps;
+	};
+}
+
+
+// Per-step factors for dt. Each is written as the base constant times a
+// ratio that is exactly 1 at the base step, so default runs are unchanged.
+void MakeStepRates ( StepRates& r, float dt )
+{
+	double ratio = dt / STEP_BASE_DT;
+	if ( fabs(ratio - 1) < 1e-6 ) ratio = 1;		// dt is a float, 0.001f is not exactly 0.001
+	r.ratio = ratio;
+	r.pitch_keep = pow ( 0.9995, ratio );
+	r.pitch_gain = 0.005 * (1 - r.pitch_keep) / (1 - 0.9995);
+	r.pitch_angle = 0.0001 * ratio;
+	r.stability = 0.001 * (1 - pow ( 0.999, ratio )) / (1 - 0.999);
+	r.roll_angle = 0.001 * ratio;
+	r.friction = pow ( 0.9999, ratio );
+	r.land_after = (int) (2000 / ratio + 0.5);		// 2 sec
+	r.land_shown = (int) (3200 / ratio + 0.5);		// 3.2 sec
+}
+
+// Lift, drag and thrust for one aircraft flying along vaxis at speed
+template<class T, bool WIND> static inline Vec3F BodyForce ( const FlightModel& m, int i, Vec3F fwd, Vec3F up, Vec3F vaxis, float speed, Vec3F wind,
+															Vec3F& lift, Vec3F& drag, Vec3F& thrust, float& aoa )
+{
+	const float p = T::AirDensity ( m );		// air density, kg/m^3
+	const float max_speed = T::MaxSpeed ( m );
+	const AeroTable* aero = m.m_aero;
+	Vec3F force;
+	force = 0;
+
+	// Flaps
+	float flap_lift = 0, wing_area = 1;
+	if ( T::has_flaps ) {
+		if ( aero )	flap_lift = m.m_flaps[i] * aero->FlapLift ( speed/max_speed );
+		else		flap_lift = m.m_flaps[i] * cos(speed/max_speed * (PI/2.0) );	// flap lift decreases with speed
+		wing_area = 1 + m.m_flaps[i];											// flap increases wing area (drag)
+	}
+
+	// Dynamic pressure
+	float airflow = speed;
+	if ( WIND ) airflow += wind.Dot ( vaxis*-1.0f );			// airflow = aircraft speed + wind over wing
+	float dynamic_pressure = 0.5f * p * airflow * airflow;
+
+	// Lift force
+	float CL;
+	if ( aero ) {
+		aero->Lookup ( fwd.Dot( vaxis ), aoa, CL );
+		CL += flap_lift;
+	} else {
+		aoa = acos( fwd.Dot( vaxis ) )*RADtoDEG + 1;			// angle-of-attack = angle between velocity and body forward
+		if (isnan(aoa)) aoa = 1;
+		CL = sin( aoa * 0.2) + flap_lift;						// CL = coeff of lift, approximate CL curve with sin
+	}
+	float L = CL * dynamic_pressure * T::LiftFactor ( m ) * 0.5;		// lift equation. L = CL (1/2 p v^2) A
+	lift = up * L;
+	force += lift;
+
+	// Drag force
+	drag = vaxis * dynamic_pressure * T::DragFactor ( m ) * -1.0f * wing_area;	// drag equation. D = Cd (1/2 p v^2) A
+	force += drag;
+
+	// Thrust force
+	thrust = fwd * m.m_power[i];
+	force += thrust;
+
+	return force;
+}
+
+// Scalar reference for the force pass
+template<class T, bool WIND> static void ComputeForcesT ( FlightModel& m, int first, int n, StepScratch& s, int start )
+{
+	Vec3F fwd, up, right, vaxis, vel, force;
+	Vec3F lift, drag, thrust;
+	Quaternion orient, ctrl_pitch;
+	float speed, aoa;
+
+	const float max_speed = T::MaxSpeed ( m );
+	const StepRates& r = s.rates;
+
+	for (int j = start; j < n; j++) {
+		int i = first + j;
+
+		vel.Set ( m.m_vx[i], m.m_vy[i], m.m_vz[i] );
+		orient = m.getOrient ( i );
+
+		// Body frame of reference
+		fwd = Vec3F(1,0,0) * orient;		// X-axis is body forward
+		up  = Vec3F(0,1,0) * orient;		// Y-axis is body up
+		right = Vec3F(0,0,1) * orient;		// Z-axis is body right
+
+		// Velocity limit
+		speed = vel.Length();
+		vaxis = vel / speed;
+		if ( speed < 0 ) speed = 0;		// planes dont go in reverse
+		if ( speed > max_speed ) speed = max_speed;
+		if ( speed == 0 ) vaxis = fwd;
+
+		// Pitch inputs - modify direction of target velocity
+		if ( m.m_py[i] <= m.m_ground[i] + GROUND_EPS ) m.m_pitch_adv[i] = 1.1;		// on the ground, takeoff pitch
+		m.m_pitch_adv[i] = m.m_pitch_adv[i] * r.pitch_keep + m.m_pitch[i] * r.pitch_gain;
+		ctrl_pitch.fromAngleAxis ( m.m_pitch_adv[i]*r.pitch_angle, right );
+		vaxis *= ctrl_pitch;	vaxis.Normalize();
+
+		Vec3F wind ( s.wx[j], s.wy[j], s.wz[j] );
+		force = BodyForce<T,WIND> ( m, i, fwd, up, vaxis, speed, wind, lift, drag, thrust, aoa );
+
+		// Outputs
+		m.m_speed[i] = speed;
+		m.m_aoa[i] = aoa;
+		m.m_lx[i] = lift.x;		m.m_ly[i] = lift.y;		m.m_lz[i] = lift.z;
+		m.m_dx[i] = drag.x;		m.m_dy[i] = drag.y;		m.m_dz[i] = drag.z;
+		m.m_tx[i] = thrust.x;	m.m_ty[i] = thrust.y;	m.m_tz[i] = thrust.z;
+		s.fx[j] = fwd.x;		s.fy[j] = fwd.y;		s.fz[j] = fwd.z;
+		s.ax[j] = vaxis.x;		s.ay[j] = vaxis.y;		s.az[j] = vaxis.z;
+		s.Fx[j] = force.x;		s.Fy[j] = force.y;		s.Fz[j] = force.z;
+	}
+}
+
+// Acceleration at velocity v with the orientation held, for the RK4 stages.
+// Pitch inputs are not applied again, they turn the velocity once per step.
+template<class T, bool WIND> static inline Vec3F AccelAt ( const FlightModel& m, int i, Vec3F fwd, Vec3F up, Vec3F wind, Vec3F v )
+{
+	float speed = v.Length();
+	Vec3F vaxis = (speed > 0) ? v / speed : fwd;
+	if ( speed > T::MaxSpeed ( m ) ) speed = T::MaxSpeed ( m );
+	Vec3F lift, drag, thrust;
+	float aoa;
+	Vec3F accel = BodyForce<T,WIND> ( m, i, fwd, up, vaxis, speed, wind, lift, drag, thrust, aoa ) / T::Mass ( m );
+	accel += Vec3F(0,-9.8,0);
+	if ( WIND ) accel += wind * T::AirDensity ( m ) * 0.1f;
+	return accel;
+}
+
+// One classic RK4 step of h for position and velocity, a1 = acceleration at v
+template<class T, bool WIND> static inline void StepRK4 ( const FlightModel& m, int i, Vec3F fwd, Vec3F up, Vec3F wind, Vec3F& pos, Vec3F& vel, Vec3F a1, float h )
+{
+	Vec3F v2 = vel + a1 * (h*0.5f);		Vec3F a2 = AccelAt<T,WIND> ( m, i, fwd, up, wind, v2 );
+	Vec3F v3 = vel + a2 * (h*0.5f);		Vec3F a3 = AccelAt<T,WIND> ( m, i, fwd, up, wind, v3 );
+	Vec3F v4 = vel + a3 * h;			Vec3F a4 = AccelAt<T,WIND> ( m, i, fwd, up, wind, v4 );
+	pos += (vel + v2*2.0f + v3*2.0f + v4) * (h/6.0f);
+	vel += (a1 + a2*2.0f + a3*2.0f + a4) * (h/6.0f);
+}
+
+// RK4 with step doubling. The difference between one step of h and two of h/2
+// estimates the local error (m, velocity error weighted by h); over tol the
+// interval is split again, up to RK4_MAX_DEPTH times. Accepted steps take the
+// Richardson-extrapolated result.
+template<class T, bool WIND> static void StepRK4Adaptive ( const FlightModel& m, int i, Vec3F fwd, Vec3F up, Vec3F wind, Vec3F& pos, Vec3F& vel, Vec3F a1,
+															float h, float tol, int depth )
+{
+	Vec3F p1 = pos, v1 = vel;
+	StepRK4<T,WIND> ( m, i, fwd, up, wind, p1, v1, a1, h );
+	Vec3F p2 = pos, v2 = vel;
+	StepRK4<T,WIND> ( m, i, fwd, up, wind, p2, v2, a1, h*0.5f );
+	StepRK4<T,WIND> ( m, i, fwd, up, wind, p2, v2, AccelAt<T,WIND> ( m, i, fwd, up, wind, v2 ), h*0.5f );
+
+	float err = (p2 - p1).Length() + (v2 - v1).Length() * h;
+	if ( err > tol && depth < RK4_MAX_DEPTH ) {
+		StepRK4Adaptive<T,WIND> ( m, i, fwd, up, wind, pos, vel, a1, h*0.5f, tol, depth+1 );
+		StepRK4Adaptive<T,WIND> ( m, i, fwd, up, wind, pos, vel, AccelAt<T,WIND> ( m, i, fwd, up, wind, vel ), h*0.5f, tol, depth+1 );
+		return;
+	}
+	pos = p2 + (p2 - p1) * (1.0f/15.0f);
+	vel = v2 + (v2 - v1) * (1.0f/15.0f);
+}
+
+// Scalar force pass for the model's type, also used for SIMD remainders
+void ComputeForcesScalar ( FlightModel& m, int first, int n, StepScratch& s, int start )
+{
+	bool wind = m.hasWind ();
+	#define FORCES(T,W)		ComputeForcesT<T,W> ( m, first, n, s, start )
+	switch ( m.getAircraftType() ) {
+	case AIRCRAFT_TRAINER:	if ( wind ) FORCES(AircraftTrainer,true);	else FORCES(AircraftTrainer,false);	break;
+	case AIRCRAFT_GLIDER:	if ( wind ) FORCES(AircraftGlider,true);	else FORCES(AircraftGlider,false);	break;
+	case AIRCRAFT_JET:		if ( wind ) FORCES(AircraftJet,true);		else FORCES(AircraftJet,false);		break;
+	default:				if ( wind ) FORCES(AircraftDefault,true);	else FORCES(AircraftDefault,false);	break;
+	};
+	#undef FORCES
+}
+
+// Orientation update of a block with the batched quaternion ops, as the
+// scalar integrate pass does per aircraft: directional stability, then roll
+// about the new body forward. Writes the model's orientations, and the body
+// up they replace to the scratch when RK4 needs it.
+static void OrientBlock ( FlightModel& m, int first, int n, StepScratch& s, bool keep_up )
+{
+	QuatSoA orient = { &m.m_qx[first], &m.m_qy[first], &m.m_qz[first], &m.m_qw[first] };
+	QuatSoA rot = { s.qx, s.qy, s.qz, s.qw };
+	Vec3SoA fwd = { s.fx, s.fy, s.fz }, vaxis = { s.ax, s.ay, s.az };
+	Vec3SoA up = { s.ux, s.uy, s.uz }, axis = { s.rx, s.ry, s.rz }, none = { 0x0, 0x0, 0x0 };
+	if ( keep_up ) QuatBasisN ( n, orient, none, up, none );
+
+	// Directional stability, toward the velocity axis
+	QuatFromToN ( n, fwd, vaxis, (float) s.rates.stability, rot );
+	QuatComposeN ( n, orient, rot );
+	QuatNormalizeN ( n, orient );
+
+	// Roll inputs about body X
+	QuatBasisN ( n, orient, axis, none, none );
+	for (int j = 0; j < n; j++) s.angle[j] = m.m_roll[first+j] * s.rates.roll_angle;
+	QuatFromAngleAxisN ( n, s.angle, axis, rot );
+	QuatComposeN ( n, orient, rot );
+	QuatNormalizeN ( n, orient );
+}
+
+template<class T, bool WIND, bool BATCH> void FlightModel::Integrate ( int first, int n, StepScratch& s, float dt )
+{
+	Vec3F fwd, up, vaxis, pos, vel, accel, dvel, wind;
+	Quaternion orient, orient0, ctrl_roll, angvel;
+	float speed;
+
+	const float p = T::AirDensity ( *this );		// air density, kg/m^3
+	const float mass = T::Mass ( *this );
+	const StepRates& r = s.rates;
+
+	if ( BATCH ) OrientBlock ( *this, first, n, s, m_integrator == INTEGRATOR_RK4 );
+
+	for (int j = 0; j < n; j++) {
+		int i = first + j;
+
+		pos.Set ( m_px[i], m_py[i], m_pz[i] );
+		orient = getOrient ( i );
+		orient0 = orient;
+		fwd.Set ( s.fx[j], s.fy[j], s.fz[j] );
+		vaxis.Set ( s.ax[j], s.ay[j], s.az[j] );
+		speed = m_speed[i];
+		vel = vaxis * speed;
+		wind.Set ( s.wx[j], s.wy[j], s.wz[j] );
+
+		// Update Orientation, already done for the block when batched
+		if ( !BATCH ) {
+			// Directional stability: airplane will typically reorient toward the velocity vector
+			angvel.fromRotationFromTo ( fwd, vaxis, r.stability );
+			if ( !isnan(angvel.X) ) {
+				orient *= angvel;
+				orient.normalize();
+			}
+
+			// Roll inputs - modify body orientation along X-axis
+			ctrl_roll.fromAngleAxis ( m_roll[i]*r.roll_angle, Vec3F(1,0,0) * orient );
+			orient *= ctrl_roll; orient.normalize();		// roll inputs
+		}
+
+		// Integrate position
+		accel = Vec3F(s.Fx[j], s.Fy[j], s.Fz[j]) / mass;			// body forces
+		accel += Vec3F(0,-9.8,0);		// gravity
+		if ( WIND ) accel += wind * p * 0.1f;		// wind force. Fw = w^2 p * A, where w=wind speed, p=air density, A=frontal area
+
+		// Airborne update, forces held at the body orientation the force pass used
+		switch ( m_integrator ) {
+		case INTEGRATOR_SEMI_IMPLICIT:
+			dvel = accel * dt;
+			pos += (vel + dvel) * dt;
+			break;
+		case INTEGRATOR_RK4: {
+			Vec3F v = vel;
+			up = BATCH ? Vec3F(s.ux[j], s.uy[j], s.uz[j]) : Vec3F(0,1,0) * orient0;
+			if ( m_adaptive_tol > 0 )	StepRK4Adaptive<T,WIND> ( *this, i, fwd, up, wind, pos, v, accel, dt, m_adaptive_tol, 0 );
+			else						StepRK4<T,WIND> ( *this, i, fwd, up, wind, pos, v, accel, dt );
+			dvel = v - vel;
+			} break;
+		default:
+			dvel = accel * dt;
+			pos += vel * dt;
+			break;
+		};
+		m_px[i] = pos.x; m_py[i] = pos.y; m_pz[i] = pos.z;
+		m_vy[i] = vel.y;
+
+		// Ground condition
+		float ground = 0;
+		if ( m_terrain ) { ground = m_terrain->Height ( pos.x, pos.z, m_terrain_slot[i] ); m_ground[i] = ground; }
+		if ( pos.y <= ground + GROUND_EPS ) {
+
+			// Record landing status
+			CheckLanding ( i, orient, speed, r.land_after );
+
+			// Ground forces, a constrained roll, always a plain Euler step
+			pos.y = ground; vel.y = 0;
+			accel += Vec3F(0,9.8,0);		// ground force (upward)
+			vel *= r.friction;				// ground friction
+			orient.fromDirectionAndRoll ( Vec3F(fwd.x, 0, fwd.z), 0 );	// zero pitch & roll
+			ctrl_roll.fromAngleAxis ( -m_roll[i]*r.roll_angle, Vec3F(0,1,0) );	// on ground, left/right is rudder
+			orient *= ctrl_roll; orient.normalize();
+			vel *= ctrl_roll;
+			dvel = accel * dt;
+
+		} else {
+			m_airborn[i]++;
+			if ( m_airborn[i] > r.land_shown ) m_land_flags[i] &= ~LAND_VALID;
+		}
+
+		// integrate velocity
+		vel += dvel;
+
+		// Store state
+		m_px[i] = pos.x; m_py[i] = pos.y; m_pz[i] = pos.z;
+		m_vx[i] = vel.x; m_vy[i] = vel.y; m_vz[i] = vel.z;
+		setOrient ( i, orient );
+	}
+}
+
+template<class T, bool WIND> void FlightModel::AdvanceBlocks ( int first, int last, float dt, bool control )
+{
+	StepScratch s;
+	MakeStepRates ( s.rates, dt );
+
+	for (int b = first; b < last; b += STEP_BLOCK) {
+		int n = (last - b < STEP_BLOCK) ? last - b : STEP_BLOCK;
+		int kernel = (n < SIMD_MIN_BLOCK) ? KERNEL_SCALAR : m_kernel;		// same result, the SIMD passes fall back per aircraft
+
+		// Controls, from the state the block is about to be stepped from
+		if ( control && m_autopilot ) m_autopilot->UpdateBlock ( *this, b, n, dt );
+
+		// Wind at each aircraft, the SIMD passes read it even when there is none
+		if ( WIND )							SampleWind ( b, n, s );
+		else if ( kernel != KERNEL_SCALAR ) {
+			memset ( s.wx, 0, n * sizeof(float) );	memset ( s.wy, 0, n * sizeof(float) );	memset ( s.wz, 0, n * sizeof(float) );
+		}
+
+		// Lift, drag & thrust
+		switch ( kernel ) {
+		case KERNEL_AVX2:	ComputeForcesAVX2<T> ( *this, b, n, s );	break;
+		case KERNEL_NEON:	ComputeForcesNEON<T> ( *this, b, n, s );	break;
+		default:			ComputeForcesT<T,WIND> ( *this, b, n, s, 0 );	break;
+		};
+
+		// Orientation, position & ground. Batched orientations pay off from a SIMD width up.
+		if ( kernel == KERNEL_SCALAR )	Integrate<T,WIND,false> ( b, n, s, dt );
+		else							Integrate<T,WIND,true> ( b, n, s, dt );
+	}
+}
+
+void FlightModel::AdvanceRange ( int first, int last, float dt, bool control )
+{
+	bool wind = hasWind ();
+	#define ADVANCE_BLOCKS(T,W)		AdvanceBlocks<T,W> ( first, last, dt, control )
+	switch ( m_type ) {
+	case AIRCRAFT_TRAINER:	if ( wind ) ADVANCE_BLOCKS(AircraftTrainer,true);	else ADVANCE_BLOCKS(AircraftTrainer,false);	break;
+	case AIRCRAFT_GLIDER:	if ( wind ) ADVANCE_BLOCKS(AircraftGlider,true);	else ADVANCE_BLOCKS(AircraftGlider,false);	break;
+	case AIRCRAFT_JET:		if ( wind ) ADVANCE_BLOCKS(AircraftJet,true);		else ADVANCE_BLOCKS(AircraftJet,false);		break;
+	default:				if ( wind ) ADVANCE_BLOCKS(AircraftDefault,true);	else ADVANCE_BLOCKS(AircraftDefault,false);	break;
+	};
+	#undef ADVANCE_BLOCKS
+}
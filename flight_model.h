@@ -0,0 +1,264 @@
+//--------------------------------------------------------
+//
+// Flight model - single-body force model (SBFM) for N aircraft
+//
+// The lift, drag, thrust and gravity model from app_flightsim, factored out of
+// the application so that many aircraft can be stepped together. State is kept
+// as structure-of-arrays (separate contiguous x/y/z, quaternion w/x/y/z and
+// control arrays) so a step streams through memory and can be vectorized.
+// Aircraft i is the i-th entry of every array.
+// All aircraft in a model are one type (aircraft_traits.h). Mixed fleets use
+// one model per type, each stepping with a loop specialized for its type.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_FLIGHT_MODEL
+	#define DEF_FLIGHT_MODEL
+
+	#include <stdint.h>
+	#include <stdlib.h>
+	#include <new>
+	#include <type_traits>
+	#include <vector>
+	#include "vec.h"
+	#include "quaternion.h"
+	#include "aircraft_traits.h"
+	#include "spatial_grid.h"
+
+	// Landing check results, bits of m_land_flags
+	#define LAND_VALID		1		// a touchdown has been scored (cleared after a while airborn)
+	#define LAND_OK			2		// all criteria passed
+	#define LAND_SPEED		4		// speed < 80 m/s
+	#define LAND_SINK		8		// sink rate < 2 m/s
+	#define LAND_PITCH		16		// pitch < 5 deg
+	#define LAND_ROLL		32		// roll < 5 deg
+	#define LAND_RUNWAY		64		// on runway
+
+	// Last touchdown of an aircraft, as a status code and the values it was
+	// scored on. Text is only made when shown, by FormatLanding.
+	struct LandingStatus {
+		uint8_t		flags;						// LAND_ bits
+		int			count;						// touchdowns scored
+		int			runway;						// -1 = off runway
+		float		speed, sink, pitch, roll;
+	};
+
+	// Everything that steps one aircraft, as plain data. Saving or restoring
+	// is a fixed size copy, so snapshots can be kept in rings or forked into
+	// many aircraft without allocating. Tile hints are not kept.
+	struct FlightState {
+		double		time;						// model time when saved
+		float		pos[3], vel[3], orient[4];	// orient x, y, z, w
+		float		pitch_adv;
+		float		roll, pitch, power, flaps;	// controls
+		float		speed, aoa;
+		float		lift[3], drag[3], thrust[3];
+		float		ground;
+		float		gust[3];					// held wind field sample
+		int			airborn;
+		LandingStatus land;
+	};
+	static_assert ( std::is_trivially_copyable<FlightState>::value, "FlightState must be memcpy-able" );
+
+	// Force kernels
+	#define KERNEL_AUTO		-1		// best available on this CPU, blocks under SIMD_MIN_BLOCK aircraft step scalar
+	#define KERNEL_SCALAR	0		// reference
+	#define KERNEL_AVX2		1		// 8-wide, x86 AVX2 + FMA
+	#define KERNEL_NEON		2		// 4-wide, AArch64
+
+	// Integrators for the airborne update. Ground contact is always Euler.
+	#define INTEGRATOR_EULER			0		// explicit Euler, the reference at 1 ms steps
+	#define INTEGRATOR_SEMI_IMPLICIT	1		// symplectic Euler, position from the new velocity
+	#define INTEGRATOR_RK4				2		// classic RK4 with orientation held over the step
+	#define RK4_MAX_DEPTH				4		// adaptive RK4 splits a step at most 2^4 ways
+
+	#define GROUND_EPS		0.00001f	// m, on the ground at or below the ground height plus this
+	#define WIND_RESAMPLE	0.016	// sec a wind field sample is held, gusts vary over tens of m
+
+	struct StepScratch;
+	class FleetScheduler;
+	class AeroTable;
+	class Terrain;
+	class WindField;
+	class Autopilot;
+	class Broadphase;
+
+	// Cache-line aligned allocator, so SoA arrays start on a 64-byte boundary
+	template<class T> struct AlignedAlloc {
+		typedef T value_type;
+		AlignedAlloc () {}
+		template<class U> AlignedAlloc ( const AlignedAlloc<U>& ) {}
+		T* allocate ( size_t n ) {
+			size_t bytes = ((n * sizeof(T) + 63) / 64) * 64;
+			#ifdef _WIN32
+				void* p = _aligned_malloc ( bytes, 64 );
+			#else
+				void* p = aligned_alloc ( 64, bytes );
+			#endif
+			if ( p == 0x0 ) throw std::bad_alloc();
+			return (T*) p;
+		}
+		void deallocate ( T* p, size_t ) {
+			#ifdef _WIN32
+				_aligned_free ( p );
+			#else
+				free ( p );
+			#endif
+		}
+		template<class U> bool operator== ( const AlignedAlloc<U>& ) const { return true; }
+		template<class U> bool operator!= ( const AlignedAlloc<U>& ) const { return false; }
+	};
+	typedef std::vector<float, AlignedAlloc<float> >		FloatArray;
+	typedef std::vector<int, AlignedAlloc<int> >			IntArray;
+	typedef std::vector<uint8_t, AlignedAlloc<uint8_t> >	ByteArray;
+
+	class FlightModel {
+	public:
+		FlightModel ();
+
+		int			AddAircraft ( Vec3F pos, Vec3F vel, float power );		// returns aircraft index
+		void		Clear ();
+		int			getNumAircraft ()		{ return m_num; }
+
+		void		Advance ( float dt, FleetScheduler* sched = 0x0 );		// step all aircraft, in parallel if given a scheduler
+		void		AdvanceRange ( int first, int last, float dt, bool control = false );	// step aircraft [first, last), control runs the autopilot
+
+		void		setKernel ( int k );									// KERNEL_ id, falls back to scalar if unsupported
+		int			getKernel ()			{ return m_kernel; }
+		static const char* getKernelName ( int k );
+
+		// Larger steps (10-20 ms) stay stable with semi-implicit or RK4. Control
+		// and stability rates are scaled to dt for every integrator.
+		void		setIntegrator ( int k );								// INTEGRATOR_ id
+		int			getIntegrator ()		{ return m_integrator; }
+		static const char* getIntegratorName ( int k );
+		void		setAdaptive ( float tol )	{ m_adaptive_tol = tol; }	// RK4 step error bound (m), 0 = fixed steps
+		float		getAdaptive ()			{ return m_adaptive_tol; }
+
+		void		setAircraftType ( int t );								// AIRCRAFT_ id, sets the parameters below to the type's
+		int			getAircraftType ()		{ return m_type; }
+		static const char* getAircraftTypeName ( int t );
+		bool		hasFlaps ();
+
+		void		setAeroTable ( const AeroTable* t )	{ m_aero = t; }		// lift & flap tables instead of acos/sin/cos, 0 = analytic
+		const AeroTable* getAeroTable ()	{ return m_aero; }
+
+		// Runways. A new model has one, at the origin along z.
+		int			AddRunway ( float x, float z, float heading, float width, float length );	// full size (m), returns runway index
+		void		ClearRunways ();
+		int			getNumRunways ()		{ return (int) m_runways.size(); }
+		const Runway& getRunway ( int k )	{ return m_runways[k]; }
+		int			RunwayAt ( float x, float z )	{ return m_runway_index.RunwayAt ( x, z ); }	// -1 if off runway
+
+		// Ground height from a streamed heightfield instead of the y=0 plane, 0x0 = flat
+		void		setTerrain ( const Terrain* t );
+		const Terrain* getTerrain ()		{ return m_terrain; }
+
+		// Wind. m_wind is the mean wind; a field adds shear and turbulence around
+		// it at each aircraft, 0x0 = m_wind everywhere.
+		void		setWindField ( const WindField* w );
+		const WindField* getWindField ()	{ return m_wind_field; }
+		bool		hasWind ();
+		double		getTime ()				{ return m_time; }		// sec stepped by Advance
+
+		// Controllers writing the control arrays, run by Advance over each block before it is stepped, 0x0 = none
+		void		setAutopilot ( Autopilot* ap )	{ m_autopilot = ap; }
+		Autopilot*	getAutopilot ()			{ return m_autopilot; }
+
+		// Proximity and collision events, run by Advance after the step, 0x0 = none
+		void		setBroadphase ( Broadphase* bp )	{ m_broadphase = bp; }
+		Broadphase*	getBroadphase ()		{ return m_broadphase; }
+
+		// Proximity, from positions as of the last Advance
+		void		setTrafficIndex ( bool on );							// keep the aircraft grid updated each step (default on)
+		void		NeighborsWithin ( int i, float r, std::vector<int>& out );	// other aircraft within r (m), appended to out
+
+		// Per-aircraft access
+		Vec3F		getPos ( int i )		{ return Vec3F(m_px[i], m_py[i], m_pz[i]); }
+		Vec3F		getVel ( int i )		{ return Vec3F(m_vx[i], m_vy[i], m_vz[i]); }
+		Quaternion	getOrient ( int i )		{ Quaternion q; q.X = m_qx[i]; q.Y = m_qy[i]; q.Z = m_qz[i]; q.W = m_qw[i]; return q; }
+		Vec3F		getLift ( int i )		{ return Vec3F(m_lx[i], m_ly[i], m_lz[i]); }
+		Vec3F		getDrag ( int i )		{ return Vec3F(m_dx[i], m_dy[i], m_dz[i]); }
+		Vec3F		getThrust ( int i )		{ return Vec3F(m_tx[i], m_ty[i], m_tz[i]); }
+		void		setPos ( int i, Vec3F p )			{ m_px[i] = p.x; m_py[i] = p.y; m_pz[i] = p.z; }
+		void		setVel ( int i, Vec3F v )			{ m_vx[i] = v.x; m_vy[i] = v.y; m_vz[i] = v.z; }
+		void		setOrient ( int i, Quaternion q )	{ m_qx[i] = q.X; m_qy[i] = q.Y; m_qz[i] = q.Z; m_qw[i] = q.W; }
+		void		setControls ( int i, float roll, float pitch, float power, float flaps )	{ m_roll[i] = roll; m_pitch[i] = pitch; m_power[i] = power; m_flaps[i] = hasFlaps() ? flaps : 0; }
+		void		getLanding ( int i, LandingStatus& l );
+		static int	FormatLanding ( const LandingStatus& l, char* buf, int size );	// "" unless LAND_VALID, returns length
+
+		// Snapshots, into a model of the same aircraft type. Restoring does not
+		// change the model time, so a rewound aircraft flies on from now.
+		void		SaveState ( int i, FlightState& s );
+		void		RestoreState ( int i, const FlightState& s );
+		int			ForkState ( const FlightState& s, int k );			// adds k copies, returns the first index
+
+	private:
+		template<class T, bool WIND> void AdvanceBlocks ( int first, int last, float dt, bool control );
+		template<class T, bool WIND, bool BATCH> void Integrate ( int first, int n, StepScratch& s, float dt );
+		void		SampleWind ( int first, int n, StepScratch& s );
+		void		CheckLanding ( int i, Quaternion& orient, float speed, int land_after );
+
+	public:
+		int			m_num;
+		int			m_kernel;
+		int			m_integrator;
+		float		m_adaptive_tol;
+		int			m_type;							// AIRCRAFT_ id, the same for all aircraft in a model
+		const AeroTable* m_aero;					// not owned
+		const Terrain* m_terrain;					// not owned
+		const WindField* m_wind_field;				// not owned
+		Autopilot*	m_autopilot;					// not owned
+		Broadphase*	m_broadphase;					// not owned
+		double		m_time;
+		double		m_wind_next;					// m_time wind field samples are next due
+		bool		m_wind_due;						// this step
+
+		// state variables
+		FloatArray	m_px, m_py, m_pz;				// position
+		FloatArray	m_vx, m_vy, m_vz;				// velocity
+		FloatArray	m_qw, m_qx, m_qy, m_qz;			// orientation
+		FloatArray	m_pitch_adv;
+
+		// control inputs
+		FloatArray	m_roll, m_pitch, m_power, m_flaps;
+
+		// derived (for rendering/debug)
+		FloatArray	m_speed, m_aoa;
+		FloatArray	m_lx, m_ly, m_lz;				// lift
+		FloatArray	m_dx, m_dy, m_dz;				// drag
+		FloatArray	m_tx, m_ty, m_tz;				// thrust
+
+		// ground & landing
+		IntArray	m_airborn;						// steps since last ground contact
+		ByteArray	m_land_flags;					// LAND_ bits of last touchdown
+		FloatArray	m_land_speed, m_land_sink, m_land_pitch, m_land_roll;
+		IntArray	m_land_count;					// number of touchdowns scored
+		IntArray	m_land_runway;					// runway of last touchdown, -1 = off runway
+		FloatArray	m_ground;						// ground height below, as of the last step
+		IntArray	m_terrain_slot;					// cached terrain tile, -1 = none
+		IntArray	m_wind_slot;					// cached wind tile, -1 = none
+		FloatArray	m_gx, m_gy, m_gz;				// wind field sample at each aircraft
+
+		// shared parameters
+		float		m_LiftFactor, m_DragFactor;
+		float		m_mass;							// body mass (kg)
+		float		m_max_speed;					// top speed (m/s)
+		Vec3F		m_wind;
+
+		// spatial indices
+		std::vector<Runway> m_runways;
+		RunwayIndex	m_runway_index;
+		SpatialGrid	m_traffic;
+		bool		m_traffic_on;
+	};
+
+	inline float AircraftDefault::LiftFactor ( const FlightModel& m )	{ return m.m_LiftFactor; }
+	inline float AircraftDefault::DragFactor ( const FlightModel& m )	{ return m.m_DragFactor; }
+	inline float AircraftDefault::Mass ( const FlightModel& m )			{ return m.m_mass; }
+	inline float AircraftDefault::MaxSpeed ( const FlightModel& m )		{ return m.m_max_speed; }
+
+#endif
@@ -0,0 +1,110 @@
+//--------------------------------------------------------
+//
+// Flight recorder - fixed-record binary log of flight state per step
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "flight_recorder.h"
+#include "common_defs.h"
+#include <string.h>
+#include <math.h>
+
+static_assert ( sizeof(FlightRecHeader) == 64, "FlightRecHeader must be 64 bytes" );
+static_assert ( sizeof(FlightRecord) == 64, "FlightRecord must be 64 bytes" );
+
+FlightRecorder::FlightRecorder ()
+{
+	m_fp = 0x0;
+	m_written = 0;
+}
+
+bool FlightRecorder::Open ( const char* fname, float dt )
+{
+	Close ();
+	m_fp = fopen ( fname, "wb" );
+	if ( m_fp == 0x0 ) {
+		dbgprintf ( "ERROR: Unable to write flight log %s\n", fname );
+		return false;
+	}
+	FlightRecHeader hdr;
+	memset ( &hdr, 0, sizeof(hdr) );
+	memcpy ( hdr.magic, FLIGHTREC_MAGIC, 4 );
+	hdr.version = FLIGHTREC_VERSION;
+	hdr.header_size = sizeof(FlightRecHeader);
+	hdr.record_size = sizeof(FlightRecord);
+	hdr.dt = dt;
+	fwrite ( &hdr, sizeof(hdr), 1, m_fp );
+
+	m_buf.reserve ( FLIGHTREC_BUFFER );
+	m_written = 0;
+	return true;
+}
+
+void FlightRecorder::Flush ()
+{
+	if ( m_fp == 0x0 || m_buf.empty() ) return;
+	if ( fwrite ( m_buf.data(), sizeof(FlightRecord), m_buf.size(), m_fp ) != m_buf.size() )
+		dbgprintf ( "ERROR: Flight log write failed.\n" );
+	m_written += (uint32_t) m_buf.size();
+	m_buf.clear ();
+}
+
+void FlightRecorder::Close ()
+{
+	if ( m_fp == 0x0 ) return;
+	Flush ();
+	fclose ( m_fp );
+	m_fp = 0x0;
+}
+
+FlightPlayback::FlightPlayback ()
+{
+	m_hdr = 0x0;
+	m_recs = 0x0;
+	m_num = 0;
+}
+
+bool FlightPlayback::Open ( const char* fname )
+{
+	Close ();
+	if ( !m_file.Open ( fname ) ) {
+		dbgprintf ( "ERROR: Unable to open flight log %s\n", fname );
+		return false;
+	}
+	const FlightRecHeader* hdr = (const FlightRecHeader*) m_file.getData();
+	if ( m_file.getSize() < sizeof(FlightRecHeader) || memcmp ( hdr->magic, FLIGHTREC_MAGIC, 4 ) != 0 ||
+		 hdr->version != FLIGHTREC_VERSION || hdr->header_size != sizeof(FlightRecHeader) || hdr->record_size != sizeof(FlightRecord) ) {
+		dbgprintf ( "ERROR: %s is not a version %d flight log\n", fname, FLIGHTREC_VERSION );
+		m_file.Close ();
+		return false;
+	}
+	m_num = (int) ( (m_file.getSize() - sizeof(FlightRecHeader)) / sizeof(FlightRecord) );		// whole records only
+	if ( m_num == 0 ) {
+		dbgprintf ( "ERROR: Flight log %s is empty\n", fname );
+		m_file.Close ();
+		return false;
+	}
+	m_hdr = hdr;
+	m_recs = (const FlightRecord*) (m_file.getData() + sizeof(FlightRecHeader));
+	return true;
+}
+
+void FlightPlayback::Close ()
+{
+	m_file.Close ();
+	m_hdr = 0x0;
+	m_recs = 0x0;
+	m_num = 0;
+}
+
+int FlightPlayback::FindTime ( double t )
+{
+	// Records are one step apart, so the step index is t/dt. The stored float
+	// times are too coarse to search on in a long log.
+	double k = floor ( t / m_hdr->dt + 1e-3 );		// a thousandth of a step for rounding in t
+	if ( !(k > 0) ) return 0;
+	return (k < m_num - 1) ? (int) k : m_num - 1;
+}
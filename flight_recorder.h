@@ -0,0 +1,84 @@
+//--------------------------------------------------------
+//
+// Flight recorder - fixed-record binary log of flight state per step
+//
+// File layout: a 64-byte FlightRecHeader, then one 64-byte FlightRecord per
+// Advance step, in step order, native little-endian floats. Records are
+// fixed stride, so playback maps the file and indexes it directly, and a
+// file cut short by a crash is still readable up to the last whole record.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_FLIGHT_RECORDER
+	#define DEF_FLIGHT_RECORDER
+
+	#include <stdio.h>
+	#include <stdint.h>
+	#include <vector>
+	#include "mapped_file.h"
+
+	#define FLIGHTREC_MAGIC		"FREC"
+	#define FLIGHTREC_VERSION	1
+	#define FLIGHTREC_BUFFER	4096		// records buffered before a write (256 KB)
+
+	struct FlightRecHeader {
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	header_size;
+		uint32_t	record_size;
+		float		dt;						// step size (sec)
+		uint32_t	reserved[11];
+	};
+
+	struct FlightRecord {
+		uint32_t	step;					// record index, playback seeks on it
+		float		time;					// sim time after the step (sec), for display (0.5 ms apart at 2 hours)
+		float		pos[3], vel[3];
+		float		orient[4];				// quaternion x,y,z,w
+		float		roll, pitch, power, flaps;		// controls used for the step
+	};
+
+	// Appends records through a buffer
+	class FlightRecorder {
+	public:
+		FlightRecorder ();
+		~FlightRecorder ()		{ Close(); }
+
+		bool		Open ( const char* fname, float dt );
+		void		Append ( const FlightRecord& r )	{ m_buf.push_back ( r ); if ( m_buf.size() >= FLIGHTREC_BUFFER ) Flush(); }
+		void		Flush ();
+		void		Close ();
+		bool		isOpen ()			{ return m_fp != 0x0; }
+		uint32_t	getNumRecords ()	{ return m_written + (uint32_t) m_buf.size(); }
+
+	private:
+		FILE*		m_fp;
+		std::vector<FlightRecord> m_buf;
+		uint32_t	m_written;
+	};
+
+	// Reads records in place from a mapped log
+	class FlightPlayback {
+	public:
+		FlightPlayback ();
+
+		bool		Open ( const char* fname );
+		void		Close ();
+		bool		isOpen ()			{ return m_recs != 0x0; }
+
+		int				getNumRecords ()	{ return m_num; }
+		float			getDT ()			{ return m_hdr->dt; }
+		const FlightRecord& getRecord ( int i )		{ return m_recs[i]; }
+		int				FindTime ( double t );		// last record at or before t sec after the first, clamped
+
+	private:
+		MappedFile	m_file;
+		const FlightRecHeader* m_hdr;
+		const FlightRecord* m_recs;
+		int			m_num;
+	};
+
+#endif
@@ -0,0 +1,333 @@
+//--------------------------------------------------------
+//
+// Flight model - SIMD force kernels
+//
+// Vectorized versions of ComputeForcesScalar, 8 aircraft per AVX2 register
+// or 4 per NEON register. Each lane performs exactly the scalar sequence:
+// body frame from the quaternion, speed limit, pitch input rotation of the
+// velocity axis, flap lift, dynamic pressure, AOA, lift, drag and thrust.
+// Remainder aircraft (n not a multiple of the width) use the scalar path.
+// Both are templates on the aircraft traits like the scalar pass, so the
+// type's constants fold in and flapless types skip the flap terms.
+//
+// Transcendentals are replaced with the polynomials of simd_math.h, within
+// 4e-7 rad (2e-5 deg of AOA).
+// With an AeroTable set, AVX2 reads the tables with gathers instead, and NEON,
+// which has no gather, runs the scalar table path.
+// The body frame is read from the rotation matrix columns of the quaternion,
+// which equals libmin's Vec3F * Quaternion up to rounding. Near zero AOA the
+// acos of the dot product is ill-conditioned, so float rounding of the inputs
+// alone gives up to ~0.02 deg difference from the scalar path there.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "flight_kernels.h"
+#include "cpu_features.h"
+#include "aero_table.h"
+#include "simd_math.h"
+
+//---------------------------------------------------------------- AVX2
+#if defined(CPU_X86)
+
+// Table index and fraction for x in [0,1], nan as 0
+SIMD_AVX2 static inline void avx_table_index ( __m256 x, __m256i& i, __m256& t )
+{
+	x = _mm256_min_ps ( _mm256_max_ps ( x, _mm256_setzero_ps() ), _mm256_set1_ps(1.0f) );
+	__m256 f = _mm256_mul_ps ( x, _mm256_set1_ps ( (float) AERO_TABLE_SIZE ) );
+	i = _mm256_min_epi32 ( _mm256_cvttps_epi32 ( f ), _mm256_set1_epi32 ( AERO_TABLE_SIZE-1 ) );
+	t = _mm256_sub_ps ( f, _mm256_cvtepi32_ps ( i ) );
+}
+
+SIMD_AVX2 static inline __m256 avx_table_lerp ( const float* tab, __m256i i, __m256 t )
+{
+	__m256 a = _mm256_i32gather_ps ( tab, i, 4 );
+	__m256 b = _mm256_i32gather_ps ( tab + 1, i, 4 );
+	return _mm256_fmadd_ps ( _mm256_sub_ps ( b, a ), t, a );
+}
+
+template<class T> SIMD_AVX2 static void ForcesAVX2 ( FlightModel& m, int first, int n, StepScratch& s )
+{
+	int n8 = n & ~7;
+
+	const __m256 one = _mm256_set1_ps ( 1.0f );
+	const __m256 two = _mm256_set1_ps ( 2.0f );
+	const __m256 zero = _mm256_setzero_ps ();
+	const __m256 ground_eps = _mm256_set1_ps ( GROUND_EPS );
+	const __m256 max_speed = _mm256_set1_ps ( T::MaxSpeed ( m ) );
+	const __m256 inv_max_speed = _mm256_set1_ps ( 1.0f / T::MaxSpeed ( m ) );
+	const __m256 half_p = _mm256_set1_ps ( 0.5f * T::AirDensity ( m ) );		// 1/2 air density
+	const __m256 lift_k = _mm256_set1_ps ( T::LiftFactor ( m ) * 0.5f );
+	const __m256 drag_k = _mm256_set1_ps ( -T::DragFactor ( m ) );
+	const __m256 keep = _mm256_set1_ps ( (float) s.rates.pitch_keep );		// pitch input rates for dt
+	const __m256 gain = _mm256_set1_ps ( (float) s.rates.pitch_gain );
+	const __m256 angle = _mm256_set1_ps ( (float) (s.rates.pitch_angle * 0.5) );
+	const AeroTable* aero = m.m_aero;
+	__m256i ti;
+	__m256 tt;
+
+	for (int j = 0; j < n8; j += 8) {
+		int i = first + j;
+
+		__m256 qw = _mm256_loadu_ps ( &m.m_qw[i] ), qx = _mm256_loadu_ps ( &m.m_qx[i] );
+		__m256 qy = _mm256_loadu_ps ( &m.m_qy[i] ), qz = _mm256_loadu_ps ( &m.m_qz[i] );
+		__m256 vx = _mm256_loadu_ps ( &m.m_vx[i] ), vy = _mm256_loadu_ps ( &m.m_vy[i] ), vz = _mm256_loadu_ps ( &m.m_vz[i] );
+
+		// Body frame of reference, columns of the rotation matrix
+		__m256 xx = _mm256_mul_ps ( qx, qx ), yy = _mm256_mul_ps ( qy, qy ), zz = _mm256_mul_ps ( qz, qz );
+		__m256 xy = _mm256_mul_ps ( qx, qy ), xz = _mm256_mul_ps ( qx, qz ), yz = _mm256_mul_ps ( qy, qz );
+		__m256 wx_ = _mm256_mul_ps ( qw, qx ), wy_ = _mm256_mul_ps ( qw, qy ), wz_ = _mm256_mul_ps ( qw, qz );
+		__m256 fx = _mm256_fnmadd_ps ( two, _mm256_add_ps ( yy, zz ), one );		// X-axis is body forward
+		__m256 fy = _mm256_mul_ps ( two, _mm256_add_ps ( xy, wz_ ) );
+		__m256 fz = _mm256_mul_ps ( two, _mm256_sub_ps ( xz, wy_ ) );
+		__m256 ux = _mm256_mul_ps ( two, _mm256_sub_ps ( xy, wz_ ) );				// Y-axis is body up
+		__m256 uy = _mm256_fnmadd_ps ( two, _mm256_add_ps ( xx, zz ), one );
+		__m256 uz = _mm256_mul_ps ( two, _mm256_add_ps ( yz, wx_ ) );
+		__m256 rx = _mm256_mul_ps ( two, _mm256_add_ps ( xz, wy_ ) );				// Z-axis is body right
+		__m256 ry = _mm256_mul_ps ( two, _mm256_sub_ps ( yz, wx_ ) );
+		__m256 rz = _mm256_fnmadd_ps ( two, _mm256_add_ps ( xx, yy ), one );
+
+		// Velocity limit
+		__m256 speed = _mm256_sqrt_ps ( _mm256_fmadd_ps ( vx, vx, _mm256_fmadd_ps ( vy, vy, _mm256_mul_ps ( vz, vz ) ) ) );
+		__m256 ax = _mm256_div_ps ( vx, speed ), ay = _mm256_div_ps ( vy, speed ), az = _mm256_div_ps ( vz, speed );
+		speed = _mm256_min_ps ( speed, max_speed );
+		__m256 still = _mm256_cmp_ps ( speed, zero, _CMP_EQ_OQ );
+		ax = _mm256_blendv_ps ( ax, fx, still );
+		ay = _mm256_blendv_ps ( ay, fy, still );
+		az = _mm256_blendv_ps ( az, fz, still );
+
+		// Pitch inputs - rotate velocity axis about body right
+		__m256 padv = _mm256_loadu_ps ( &m.m_pitch_adv[i] );
+		__m256 ground = _mm256_cmp_ps ( _mm256_loadu_ps ( &m.m_py[i] ), _mm256_add_ps ( _mm256_loadu_ps ( &m.m_ground[i] ), ground_eps ), _CMP_LE_OQ );
+		padv = _mm256_blendv_ps ( padv, _mm256_set1_ps(1.1f), ground );
+		padv = _mm256_fmadd_ps ( padv, keep, _mm256_mul_ps ( _mm256_loadu_ps ( &m.m_pitch[i] ), gain ) );
+		_mm256_storeu_ps ( &m.m_pitch_adv[i], padv );
+
+		__m256 half = _mm256_mul_ps ( padv, angle );
+		__m256 sh = avx_sin ( half ), cw = avx_cos ( half );
+		__m256 px = _mm256_mul_ps ( rx, sh ), py = _mm256_mul_ps ( ry, sh ), pz = _mm256_mul_ps ( rz, sh );
+		__m256 tx = _mm256_mul_ps ( two, _mm256_fmsub_ps ( py, az, _mm256_mul_ps ( pz, ay ) ) );		// t = 2 (q x v)
+		__m256 ty = _mm256_mul_ps ( two, _mm256_fmsub_ps ( pz, ax, _mm256_mul_ps ( px, az ) ) );
+		__m256 tz = _mm256_mul_ps ( two, _mm256_fmsub_ps ( px, ay, _mm256_mul_ps ( py, ax ) ) );
+		ax = _mm256_add_ps ( _mm256_fmadd_ps ( cw, tx, ax ), _mm256_fmsub_ps ( py, tz, _mm256_mul_ps ( pz, ty ) ) );	// v + w t + q x t
+		ay = _mm256_add_ps ( _mm256_fmadd_ps ( cw, ty, ay ), _mm256_fmsub_ps ( pz, tx, _mm256_mul_ps ( px, tz ) ) );
+		az = _mm256_add_ps ( _mm256_fmadd_ps ( cw, tz, az ), _mm256_fmsub_ps ( px, ty, _mm256_mul_ps ( py, tx ) ) );
+		__m256 len = _mm256_sqrt_ps ( _mm256_fmadd_ps ( ax, ax, _mm256_fmadd_ps ( ay, ay, _mm256_mul_ps ( az, az ) ) ) );
+		ax = _mm256_div_ps ( ax, len ); ay = _mm256_div_ps ( ay, len ); az = _mm256_div_ps ( az, len );
+
+		// Flaps, none for a flapless type
+		__m256 flap_lift = zero, wing_area = one;
+		if ( T::has_flaps ) {
+			__m256 flaps = _mm256_loadu_ps ( &m.m_flaps[i] );
+			if ( aero ) {
+				avx_table_index ( _mm256_mul_ps ( speed, inv_max_speed ), ti, tt );
+				flap_lift = _mm256_mul_ps ( flaps, avx_table_lerp ( aero->m_flap, ti, tt ) );
+			} else {
+				flap_lift = _mm256_mul_ps ( flaps, avx_cos ( _mm256_mul_ps ( _mm256_mul_ps ( speed, inv_max_speed ), _mm256_set1_ps(SIMD_HALF_PI) ) ) );
+			}
+			wing_area = _mm256_add_ps ( one, flaps );
+		}
+
+		// Dynamic pressure
+		__m256 wx = _mm256_loadu_ps ( &s.wx[j] ), wy = _mm256_loadu_ps ( &s.wy[j] ), wz = _mm256_loadu_ps ( &s.wz[j] );
+		__m256 airflow = _mm256_sub_ps ( speed, _mm256_fmadd_ps ( wx, ax, _mm256_fmadd_ps ( wy, ay, _mm256_mul_ps ( wz, az ) ) ) );
+		__m256 dp = _mm256_mul_ps ( half_p, _mm256_mul_ps ( airflow, airflow ) );
+
+		// Lift force
+		__m256 dot = _mm256_fmadd_ps ( fx, ax, _mm256_fmadd_ps ( fy, ay, _mm256_mul_ps ( fz, az ) ) );
+		__m256 aoa, CL;
+		if ( aero ) {
+			__m256 u = _mm256_max_ps ( _mm256_mul_ps ( _mm256_sub_ps ( one, dot ), _mm256_set1_ps(0.5f) ), zero );	// nan as 0
+			avx_table_index ( _mm256_sqrt_ps ( u ), ti, tt );
+			aoa = avx_table_lerp ( aero->m_aoa, ti, tt );
+			CL = avx_table_lerp ( aero->m_cl, ti, tt );
+		} else {
+			aoa = _mm256_fmadd_ps ( avx_acos ( dot ), _mm256_set1_ps(RADtoDEG), one );
+			aoa = _mm256_blendv_ps ( aoa, one, _mm256_cmp_ps ( dot, dot, _CMP_UNORD_Q ) );		// nan axis, aoa = 1
+			CL = avx_sin ( _mm256_mul_ps ( aoa, _mm256_set1_ps(0.2f) ) );
+		}
+		if ( T::has_flaps ) CL = _mm256_add_ps ( CL, flap_lift );
+		__m256 L = _mm256_mul_ps ( _mm256_mul_ps ( CL, dp ), lift_k );
+		__m256 lx = _mm256_mul_ps ( ux, L ), ly = _mm256_mul_ps ( uy, L ), lz = _mm256_mul_ps ( uz, L );
+
+		// Drag force
+		__m256 D = _mm256_mul_ps ( dp, drag_k );
+		if ( T::has_flaps ) D = _mm256_mul_ps ( D, wing_area );
+		__m256 dx = _mm256_mul_ps ( ax, D ), dy = _mm256_mul_ps ( ay, D ), dz = _mm256_mul_ps ( az, D );
+
+		// Thrust force
+		__m256 power = _mm256_loadu_ps ( &m.m_power[i] );
+		__m256 thx = _mm256_mul_ps ( fx, power ), thy = _mm256_mul_ps ( fy, power ), thz = _mm256_mul_ps ( fz, power );
+
+		// Outputs
+		_mm256_storeu_ps ( &m.m_speed[i], speed );
+		_mm256_storeu_ps ( &m.m_aoa[i], aoa );
+		_mm256_storeu_ps ( &m.m_lx[i], lx );	_mm256_storeu_ps ( &m.m_ly[i], ly );	_mm256_storeu_ps ( &m.m_lz[i], lz );
+		_mm256_storeu_ps ( &m.m_dx[i], dx );	_mm256_storeu_ps ( &m.m_dy[i], dy );	_mm256_storeu_ps ( &m.m_dz[i], dz );
+		_mm256_storeu_ps ( &m.m_tx[i], thx );	_mm256_storeu_ps ( &m.m_ty[i], thy );	_mm256_storeu_ps ( &m.m_tz[i], thz );
+		_mm256_storeu_ps ( &s.fx[j], fx );		_mm256_storeu_ps ( &s.fy[j], fy );		_mm256_storeu_ps ( &s.fz[j], fz );
+		_mm256_storeu_ps ( &s.ax[j], ax );		_mm256_storeu_ps ( &s.ay[j], ay );		_mm256_storeu_ps ( &s.az[j], az );
+		_mm256_storeu_ps ( &s.Fx[j], _mm256_add_ps ( _mm256_add_ps ( lx, dx ), thx ) );
+		_mm256_storeu_ps ( &s.Fy[j], _mm256_add_ps ( _mm256_add_ps ( ly, dy ), thy ) );
+		_mm256_storeu_ps ( &s.Fz[j], _mm256_add_ps ( _mm256_add_ps ( lz, dz ), thz ) );
+	}
+
+	// Remainder
+	ComputeForcesScalar ( m, first, n, s, n8 );
+}
+
+template<class T> void ComputeForcesAVX2 ( FlightModel& m, int first, int n, StepScratch& s )
+{
+	ForcesAVX2<T> ( m, first, n, s );
+}
+
+#else
+
+template<class T> void ComputeForcesAVX2 ( FlightModel& m, int first, int n, StepScratch& s )
+{
+	ComputeForcesScalar ( m, first, n, s );
+}
+
+#endif
+
+template void ComputeForcesAVX2<AircraftDefault> ( FlightModel& m, int first, int n, StepScratch& s );
+template void ComputeForcesAVX2<AircraftTrainer> ( FlightModel& m, int first, int n, StepScratch& s );
+template void ComputeForcesAVX2<AircraftGlider> ( FlightModel& m, int first, int n, StepScratch& s );
+template void ComputeForcesAVX2<AircraftJet> ( FlightModel& m, int first, int n, StepScratch& s );
+
+//---------------------------------------------------------------- NEON
+#if defined(CPU_ARM64)
+
+template<class T> void ComputeForcesNEON ( FlightModel& m, int first, int n, StepScratch& s )
+{
+	if ( m.m_aero ) {						// no gather, tables are read by the scalar path
+		ComputeForcesScalar ( m, first, n, s );
+		return;
+	}
+	int n4 = n & ~3;
+
+	const float32x4_t one = vdupq_n_f32 ( 1.0f );
+	const float32x4_t two = vdupq_n_f32 ( 2.0f );
+	const float32x4_t zero = vdupq_n_f32 ( 0.0f );
+	const float32x4_t ground_eps = vdupq_n_f32 ( GROUND_EPS );
+	const float32x4_t max_speed = vdupq_n_f32 ( T::MaxSpeed ( m ) );
+	const float inv_max_speed = 1.0f / T::MaxSpeed ( m );
+	const float half_p = 0.5f * T::AirDensity ( m );		// 1/2 air density
+	const float lift_k = T::LiftFactor ( m ) * 0.5f;
+	const float drag_k = -T::DragFactor ( m );
+	const float keep = (float) s.rates.pitch_keep;		// pitch input rates for dt
+	const float gain = (float) s.rates.pitch_gain;
+	const float angle = (float) (s.rates.pitch_angle * 0.5);
+
+	for (int j = 0; j < n4; j += 4) {
+		int i = first + j;
+
+		float32x4_t qw = vld1q_f32 ( &m.m_qw[i] ), qx = vld1q_f32 ( &m.m_qx[i] );
+		float32x4_t qy = vld1q_f32 ( &m.m_qy[i] ), qz = vld1q_f32 ( &m.m_qz[i] );
+		float32x4_t vx = vld1q_f32 ( &m.m_vx[i] ), vy = vld1q_f32 ( &m.m_vy[i] ), vz = vld1q_f32 ( &m.m_vz[i] );
+
+		// Body frame of reference, columns of the rotation matrix
+		float32x4_t xx = vmulq_f32 ( qx, qx ), yy = vmulq_f32 ( qy, qy ), zz = vmulq_f32 ( qz, qz );
+		float32x4_t xy = vmulq_f32 ( qx, qy ), xz = vmulq_f32 ( qx, qz ), yz = vmulq_f32 ( qy, qz );
+		float32x4_t wx_ = vmulq_f32 ( qw, qx ), wy_ = vmulq_f32 ( qw, qy ), wz_ = vmulq_f32 ( qw, qz );
+		float32x4_t fx = vfmsq_f32 ( one, two, vaddq_f32 ( yy, zz ) );		// X-axis is body forward
+		float32x4_t fy = vmulq_f32 ( two, vaddq_f32 ( xy, wz_ ) );
+		float32x4_t fz = vmulq_f32 ( two, vsubq_f32 ( xz, wy_ ) );
+		float32x4_t ux = vmulq_f32 ( two, vsubq_f32 ( xy, wz_ ) );			// Y-axis is body up
+		float32x4_t uy = vfmsq_f32 ( one, two, vaddq_f32 ( xx, zz ) );
+		float32x4_t uz = vmulq_f32 ( two, vaddq_f32 ( yz, wx_ ) );
+		float32x4_t rx = vmulq_f32 ( two, vaddq_f32 ( xz, wy_ ) );			// Z-axis is body right
+		float32x4_t ry = vmulq_f32 ( two, vsubq_f32 ( yz, wx_ ) );
+		float32x4_t rz = vfmsq_f32 ( one, two, vaddq_f32 ( xx, yy ) );
+
+		// Velocity limit
+		float32x4_t speed = vsqrtq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( vz, vz ), vy, vy ), vx, vx ) );
+		float32x4_t ax = vdivq_f32 ( vx, speed ), ay = vdivq_f32 ( vy, speed ), az = vdivq_f32 ( vz, speed );
+		speed = vminq_f32 ( speed, max_speed );
+		uint32x4_t still = vceqq_f32 ( speed, zero );
+		ax = vbslq_f32 ( still, fx, ax );
+		ay = vbslq_f32 ( still, fy, ay );
+		az = vbslq_f32 ( still, fz, az );
+
+		// Pitch inputs - rotate velocity axis about body right
+		float32x4_t padv = vld1q_f32 ( &m.m_pitch_adv[i] );
+		uint32x4_t ground = vcleq_f32 ( vld1q_f32 ( &m.m_py[i] ), vaddq_f32 ( vld1q_f32 ( &m.m_ground[i] ), ground_eps ) );
+		padv = vbslq_f32 ( ground, vdupq_n_f32(1.1f), padv );
+		padv = vfmaq_n_f32 ( vmulq_n_f32 ( vld1q_f32 ( &m.m_pitch[i] ), gain ), padv, keep );
+		vst1q_f32 ( &m.m_pitch_adv[i], padv );
+
+		float32x4_t half = vmulq_n_f32 ( padv, angle );
+		float32x4_t sh = neon_sin ( half ), cw = neon_cos ( half );
+		float32x4_t px = vmulq_f32 ( rx, sh ), py = vmulq_f32 ( ry, sh ), pz = vmulq_f32 ( rz, sh );
+		float32x4_t tx = vmulq_f32 ( two, vfmsq_f32 ( vmulq_f32 ( py, az ), pz, ay ) );		// t = 2 (q x v)
+		float32x4_t ty = vmulq_f32 ( two, vfmsq_f32 ( vmulq_f32 ( pz, ax ), px, az ) );
+		float32x4_t tz = vmulq_f32 ( two, vfmsq_f32 ( vmulq_f32 ( px, ay ), py, ax ) );
+		ax = vaddq_f32 ( vfmaq_f32 ( ax, cw, tx ), vfmsq_f32 ( vmulq_f32 ( py, tz ), pz, ty ) );	// v + w t + q x t
+		ay = vaddq_f32 ( vfmaq_f32 ( ay, cw, ty ), vfmsq_f32 ( vmulq_f32 ( pz, tx ), px, tz ) );
+		az = vaddq_f32 ( vfmaq_f32 ( az, cw, tz ), vfmsq_f32 ( vmulq_f32 ( px, ty ), py, tx ) );
+		float32x4_t len = vsqrtq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( az, az ), ay, ay ), ax, ax ) );
+		ax = vdivq_f32 ( ax, len ); ay = vdivq_f32 ( ay, len ); az = vdivq_f32 ( az, len );
+
+		// Flaps, none for a flapless type
+		float32x4_t flap_lift = zero, wing_area = one;
+		if ( T::has_flaps ) {
+			float32x4_t flaps = vld1q_f32 ( &m.m_flaps[i] );
+			flap_lift = vmulq_f32 ( flaps, neon_cos ( vmulq_n_f32 ( speed, inv_max_speed * SIMD_HALF_PI ) ) );
+			wing_area = vaddq_f32 ( one, flaps );
+		}
+
+		// Dynamic pressure
+		float32x4_t wx = vld1q_f32 ( &s.wx[j] ), wy = vld1q_f32 ( &s.wy[j] ), wz = vld1q_f32 ( &s.wz[j] );
+		float32x4_t airflow = vsubq_f32 ( speed, vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( wz, az ), wy, ay ), wx, ax ) );
+		float32x4_t dp = vmulq_n_f32 ( vmulq_f32 ( airflow, airflow ), half_p );
+
+		// Lift force
+		float32x4_t dot = vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( fz, az ), fy, ay ), fx, ax );
+		float32x4_t aoa = vfmaq_n_f32 ( one, neon_acos ( dot ), RADtoDEG );
+		aoa = vbslq_f32 ( vceqq_f32 ( dot, dot ), aoa, one );		// nan axis, aoa = 1
+		float32x4_t CL = neon_sin ( vmulq_n_f32 ( aoa, 0.2f ) );
+		if ( T::has_flaps ) CL = vaddq_f32 ( CL, flap_lift );
+		float32x4_t L = vmulq_n_f32 ( vmulq_f32 ( CL, dp ), lift_k );
+		float32x4_t lx = vmulq_f32 ( ux, L ), ly = vmulq_f32 ( uy, L ), lz = vmulq_f32 ( uz, L );
+
+		// Drag force
+		float32x4_t D = vmulq_n_f32 ( dp, drag_k );
+		if ( T::has_flaps ) D = vmulq_f32 ( D, wing_area );
+		float32x4_t dx = vmulq_f32 ( ax, D ), dy = vmulq_f32 ( ay, D ), dz = vmulq_f32 ( az, D );
+
+		// Thrust force
+		float32x4_t power = vld1q_f32 ( &m.m_power[i] );
+		float32x4_t thx = vmulq_f32 ( fx, power ), thy = vmulq_f32 ( fy, power ), thz = vmulq_f32 ( fz, power );
+
+		// Outputs
+		vst1q_f32 ( &m.m_speed[i], speed );
+		vst1q_f32 ( &m.m_aoa[i], aoa );
+		vst1q_f32 ( &m.m_lx[i], lx );	vst1q_f32 ( &m.m_ly[i], ly );	vst1q_f32 ( &m.m_lz[i], lz );
+		vst1q_f32 ( &m.m_dx[i], dx );	vst1q_f32 ( &m.m_dy[i], dy );	vst1q_f32 ( &m.m_dz[i], dz );
+		vst1q_f32 ( &m.m_tx[i], thx );	vst1q_f32 ( &m.m_ty[i], thy );	vst1q_f32 ( &m.m_tz[i], thz );
+		vst1q_f32 ( &s.fx[j], fx );		vst1q_f32 ( &s.fy[j], fy );		vst1q_f32 ( &s.fz[j], fz );
+		vst1q_f32 ( &s.ax[j], ax );		vst1q_f32 ( &s.ay[j], ay );		vst1q_f32 ( &s.az[j], az );
+		vst1q_f32 ( &s.Fx[j], vaddq_f32 ( vaddq_f32 ( lx, dx ), thx ) );
+		vst1q_f32 ( &s.Fy[j], vaddq_f32 ( vaddq_f32 ( ly, dy ), thy ) );
+		vst1q_f32 ( &s.Fz[j], vaddq_f32 ( vaddq_f32 ( lz, dz ), thz ) );
+	}
+
+	// Remainder
+	ComputeForcesScalar ( m, first, n, s, n4 );
+}
+
+#else
+
+template<class T> void ComputeForcesNEON ( FlightModel& m, int first, int n, StepScratch& s )
+{
+	ComputeForcesScalar ( m, first, n, s );
+}
+
+#endif
+
+template void ComputeForcesNEON<AircraftDefault> ( FlightModel& m, int first, int n, StepScratch& s );
+template void ComputeForcesNEON<AircraftTrainer> ( FlightModel& m, int first, int n, StepScratch& s );
+template void ComputeForcesNEON<AircraftGlider> ( FlightModel& m, int first, int n, StepScratch& s );
+template void ComputeForcesNEON<AircraftJet> ( FlightModel& m, int first, int n, StepScratch& s );
@@ -0,0 +1,52 @@
+//--------------------------------------------------------
+//
+// Frame arena - linear scratch memory for data that lives one frame
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdint.h>
+#include "frame_arena.h"
+
+FrameArena::FrameArena ()
+{
+	m_base = 0x0;
+	m_size = 0; m_used = 0; m_peak = 0;
+	m_failed = 0;
+}
+
+void FrameArena::Init ( size_t bytes )
+{
+	Clear ();
+	m_base = new char[ bytes ];
+	m_size = bytes;
+}
+
+void FrameArena::Clear ()
+{
+	delete [] m_base;
+	m_base = 0x0;
+	m_size = 0; m_used = 0; m_peak = 0;
+	m_failed = 0;
+}
+
+void FrameArena::Reset ()
+{
+	if ( m_used > m_peak ) m_peak = m_used;
+	m_used = 0;
+}
+
+// align must be a power of two
+void* FrameArena::Alloc ( size_t bytes, size_t align )
+{
+	uintptr_t base = (uintptr_t) m_base;
+	uintptr_t p = ( base + m_used + align-1 ) & ~(uintptr_t) (align-1);
+	if ( m_base == 0x0 || p + bytes > base + m_size ) {
+		m_failed++;
+		return 0x0;
+	}
+	m_used = p + bytes - base;
+	return (void*) p;
+}
@@ -0,0 +1,48 @@
+//--------------------------------------------------------
+//
+// Frame arena - linear scratch memory for data that lives one frame
+//
+// One block is allocated at Init. Alloc hands out aligned pieces of it by
+// bumping an offset and Reset, once the frame is drawn, takes them all back,
+// so per-frame culling lists and text cost no heap allocations however much
+// they vary from frame to frame. When the block is full Alloc returns 0x0
+// and counts the failure, callers skip what they could not get, and the
+// peak shows how large the block needs to be.
+// One thread only, normally the render thread.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_FRAME_ARENA
+	#define DEF_FRAME_ARENA
+
+	#include <stddef.h>
+
+	#define FRAME_ARENA_ALIGN	16
+
+	class FrameArena {
+	public:
+		FrameArena ();
+		~FrameArena ()		{ Clear(); }
+
+		void		Init ( size_t bytes );
+		void		Clear ();
+		void		Reset ();									// end of frame, frees everything
+
+		void*		Alloc ( size_t bytes, size_t align = FRAME_ARENA_ALIGN );	// 0x0 when full
+		template<class T> T* Alloc ( int n )	{ return (T*) Alloc ( n * sizeof(T), alignof(T) > FRAME_ARENA_ALIGN ? alignof(T) : FRAME_ARENA_ALIGN ); }
+
+		size_t		getUsed ()			{ return m_used; }
+		size_t		getPeak ()			{ return m_peak; }		// most used in any frame since Init
+		size_t		getCapacity ()		{ return m_size; }
+		int			getFailed ()		{ return m_failed; }	// allocations refused since Init
+
+	private:
+		char*		m_base;
+		size_t		m_size, m_used, m_peak;
+		int			m_failed;
+	};
+
+#endif
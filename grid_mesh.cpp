@@ -0,0 +1,202 @@
+//--------------------------------------------------------
+//
+// Ground grid mesh - runway, centerline and tiled grid lines
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "grid_mesh.h"
+#include <math.h>
+#include <string.h>
+
+// Saved mesh, then the world and tile vertices
+struct GridMeshHeader {
+	int32_t		world_count, tile_count;
+	int32_t		level_first[GRID_LEVELS];
+	int32_t		level_count[GRID_LEVELS];
+	GridLevel	levels[GRID_LEVELS];
+	float		tile_size, extent;
+	int32_t		tiles, reserved;
+};
+
+static inline void AddLine ( std::vector<LineVert>& v, float x0, float y0, float z0, float x1, float y1, float z1, float r, float g, float b, float a )
+{
+	LineVert p;
+	p.r = r; p.g = g; p.b = b; p.a = a;
+	p.x = x0; p.y = y0; p.z = z0;	v.push_back ( p );
+	p.x = x1; p.y = y1; p.z = z1;	v.push_back ( p );
+}
+
+static void SetLevel ( GridLevel& l, float spacing, float fade_near, float fade_far, float clr )
+{
+	l.spacing = spacing;
+	l.fade_near = fade_near;
+	l.fade_far = fade_far;
+	l.r = clr; l.g = clr; l.b = clr; l.a = 0.5;
+}
+
+void BuildGridMesh ( GridMesh& m, float runway_width, float runway_length, float extent )
+{
+	m.world.clear ();
+	m.tile.clear ();
+
+	// LOD levels, fine to coarse. Fading over 40x-80x the spacing keeps lines
+	// a few pixels apart at any distance.
+	SetLevel ( m.levels[0],   50,  2000,  4000, .6 );
+	SetLevel ( m.levels[1],  200,  8000, 16000, .45 );
+	SetLevel ( m.levels[2], 1000, 40000, 80000, .35 );
+	SetLevel ( m.levels[3], 5000,     0,     0, .3 );		// coarsest, always drawn
+
+	m.tile_size = m.levels[GRID_LEVELS-1].spacing;
+	m.tiles = (int) ceil ( 2*extent / m.tile_size );
+	m.extent = m.tiles * m.tile_size * 0.5f;
+
+	// runway
+	float o = 0.02;
+	float x = runway_width;
+	float z = runway_length;
+	AddLine ( m.world, -x, o,-z,  -x, o, z,  0,0,1,1 );
+	AddLine ( m.world, -x, o, z,   x, o, z,  0,0,1,1 );
+	AddLine ( m.world,  x, o, z,   x, o,-z,  0,0,1,1 );
+	AddLine ( m.world,  x, o,-z,  -x, o,-z,  0,0,1,1 );
+	for (int n=-z; n < z; n+= 60) {
+		AddLine ( m.world,  1, o, n,   1, o, n+20,  1,1,1,1 );
+		AddLine ( m.world, -1, o, n,  -1, o, n+20,  1,1,1,1 );
+	}
+
+	// far border, tiles only draw their near edges
+	o = -0.02;
+	GridLevel& c = m.levels[GRID_LEVELS-1];
+	float e = m.extent;
+	AddLine ( m.world, -e, o, e,  e, o, e,  c.r, c.g, c.b, c.a );
+	AddLine ( m.world,  e, o,-e,  e, o, e,  c.r, c.g, c.b, c.a );
+
+	// tile lines by level
+	float T = m.tile_size;
+	for (int L=0; L < GRID_LEVELS; L++) {
+		GridLevel& l = m.levels[L];
+		float coarser = (L < GRID_LEVELS-1) ? m.levels[L+1].spacing : 0;
+		m.level_first[L] = (int) m.tile.size();
+
+		for (float n=0; n < T; n += l.spacing) {
+			if ( coarser > 0 && fmod ( n, coarser ) == 0 ) continue;	// drawn by a coarser level
+			AddLine ( m.tile, 0, o, n,  T, o, n,  l.r, l.g, l.b, l.a );
+			AddLine ( m.tile, n, o, 0,  n, o, T,  l.r, l.g, l.b, l.a );
+		}
+		m.level_count[L] = (int) m.tile.size() - m.level_first[L];
+	}
+}
+
+void SaveGridMesh ( const GridMesh& m, std::vector<uint8_t>& out )
+{
+	GridMeshHeader hdr;
+	memset ( &hdr, 0, sizeof(hdr) );
+	hdr.world_count = (int32_t) m.world.size();
+	hdr.tile_count = (int32_t) m.tile.size();
+	for (int L=0; L < GRID_LEVELS; L++) {
+		hdr.level_first[L] = m.level_first[L];
+		hdr.level_count[L] = m.level_count[L];
+		hdr.levels[L] = m.levels[L];
+	}
+	hdr.tile_size = m.tile_size;
+	hdr.extent = m.extent;
+	hdr.tiles = m.tiles;
+
+	size_t bytes_world = m.world.size() * sizeof(LineVert);
+	size_t bytes_tile = m.tile.size() * sizeof(LineVert);
+	out.resize ( sizeof(hdr) + bytes_world + bytes_tile );
+	memcpy ( &out[0], &hdr, sizeof(hdr) );
+	if ( bytes_world ) memcpy ( &out[sizeof(hdr)], m.world.data(), bytes_world );
+	if ( bytes_tile ) memcpy ( &out[sizeof(hdr) + bytes_world], m.tile.data(), bytes_tile );
+}
+
+bool LoadGridMesh ( const uint8_t* data, size_t size, GridMesh& m )
+{
+	GridMeshHeader hdr;
+	if ( size < sizeof(hdr) ) return false;
+	memcpy ( &hdr, data, sizeof(hdr) );
+	if ( hdr.world_count < 0 || hdr.tile_count < 0 || hdr.tiles <= 0
+		|| size != sizeof(hdr) + ((size_t) hdr.world_count + hdr.tile_count) * sizeof(LineVert) ) return false;
+
+	const LineVert* v = (const LineVert*) (data + sizeof(hdr));
+	m.world.assign ( v, v + hdr.world_count );
+	m.tile.assign ( v + hdr.world_count, v + hdr.world_count + hdr.tile_count );
+	for (int L=0; L < GRID_LEVELS; L++) {
+		m.level_first[L] = hdr.level_first[L];
+		m.level_count[L] = hdr.level_count[L];
+		m.levels[L] = hdr.levels[L];
+	}
+	m.tile_size = hdr.tile_size;
+	m.extent = hdr.extent;
+	m.tiles = hdr.tiles;
+	return true;
+}
+
+// Frustum planes from clip = proj * view (Gribb-Hartmann), matrices column-major
+void GridViewFromMatrices ( GridView& gv, const float* V, const float* P )
+{
+	float M[16];
+	for (int c=0; c < 4; c++)
+		for (int r=0; r < 4; r++)
+			M[c*4+r] = P[0*4+r]*V[c*4+0] + P[1*4+r]*V[c*4+1] + P[2*4+r]*V[c*4+2] + P[3*4+r]*V[c*4+3];
+
+	for (int k=0; k < 4; k++) {
+		float w = M[k*4+3];
+		gv.planes[0][k] = w + M[k*4+0];	gv.planes[1][k] = w - M[k*4+0];	// left, right
+		gv.planes[2][k] = w + M[k*4+1];	gv.planes[3][k] = w - M[k*4+1];	// bottom, top
+		gv.planes[4][k] = w + M[k*4+2];	gv.planes[5][k] = w - M[k*4+2];	// near, far
+	}
+
+	// eye position from the rigid view matrix, -R^T t
+	gv.eye[0] = -(V[0]*V[12] + V[1]*V[13] + V[2]*V[14]);
+	gv.eye[1] = -(V[4]*V[12] + V[5]*V[13] + V[6]*V[14]);
+	gv.eye[2] = -(V[8]*V[12] + V[9]*V[13] + V[10]*V[14]);
+}
+
+// A tile is kept if its box is at least partly inside all six planes
+int CullGridTiles ( const GridMesh& m, const GridView& gv, float* inst, int count[GRID_LEVELS] )
+{
+	int stride = m.tiles * m.tiles * 2;
+	for (int L=0; L < GRID_LEVELS; L++) count[L] = 0;
+	int visible = 0;
+
+	float T = m.tile_size;
+	float ymin = -0.1, ymax = 0.1;
+	const float* eye = gv.eye;
+	for (int j=0; j < m.tiles; j++) {
+		for (int i=0; i < m.tiles; i++) {
+			float x0 = -m.extent + i*T, x1 = x0 + T;
+			float z0 = -m.extent + j*T, z1 = z0 + T;
+
+			bool inside = true;
+			for (int p=0; p < 6 && inside; p++) {
+				// corner farthest along the plane normal
+				const float* pl = gv.planes[p];
+				float x = (pl[0] >= 0) ? x1 : x0;
+				float y = (pl[1] >= 0) ? ymax : ymin;
+				float z = (pl[2] >= 0) ? z1 : z0;
+				inside = ( pl[0]*x + pl[1]*y + pl[2]*z + pl[3] >= 0 );
+			}
+			if ( !inside ) continue;
+			visible++;
+
+			// nearest point of the tile to the eye
+			float dx = fmaxf ( fmaxf ( x0 - eye[0], eye[0] - x1 ), 0 );
+			float dy = fmaxf ( fmaxf ( ymin - eye[1], eye[1] - ymax ), 0 );
+			float dz = fmaxf ( fmaxf ( z0 - eye[2], eye[2] - z1 ), 0 );
+			float dist = sqrtf ( dx*dx + dy*dy + dz*dz );
+
+			for (int L=0; L < GRID_LEVELS; L++) {
+				float far = m.levels[L].fade_far;
+				if ( far > 0 && dist >= far ) continue;
+				float* o = inst + L*stride + count[L]*2;
+				o[0] = x0;
+				o[1] = z0;
+				count[L]++;
+			}
+		}
+	}
+	return visible;
+}
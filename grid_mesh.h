@@ -0,0 +1,73 @@
+//--------------------------------------------------------
+//
+// Ground grid mesh - runway, centerline and tiled grid lines
+//
+// The ground grid is a square of tiles. Every tile has the same pattern, so
+// only one tile is stored, in local coordinates [0, tile_size], and it is
+// drawn instanced at each visible tile offset. Tile lines are grouped by LOD
+// level from fine to coarse; a line is stored only in the coarsest level that
+// contains it. Fine levels fade out with distance.
+// The mesh can be saved into an asset bundle by tools/asset_pack and loaded
+// back from it, rather than built, at startup.
+// Geometry and culling only, no GL, so it can be used by headless tools.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_GRID_MESH
+	#define DEF_GRID_MESH
+
+	#include <vector>
+	#include <stddef.h>
+	#include <stdint.h>
+
+	#define GRID_LEVELS		4
+
+	struct LineVert {
+		float	x, y, z;
+		float	r, g, b, a;
+	};
+
+	struct GridLevel {
+		float	spacing;				// line spacing (m)
+		float	fade_near, fade_far;	// fully visible until near, gone at far (m), 0 = never fades
+		float	r, g, b, a;
+	};
+
+	struct GridMesh {
+		std::vector<LineVert> world;		// runway, centerline and border, world coordinates
+		std::vector<LineVert> tile;			// one tile, local coordinates, grouped by level
+		int			level_first[GRID_LEVELS];
+		int			level_count[GRID_LEVELS];
+		GridLevel	levels[GRID_LEVELS];
+		float		tile_size;
+		float		extent;					// grid covers [-extent, extent] in x and z
+		int			tiles;					// tiles per side
+	};
+
+	struct GridView {
+		float		eye[3];
+		float		planes[6][4];			// frustum, inside where ax+by+cz+d >= 0
+	};
+
+	// Line lists (pairs of vertices) for the runway and ground grid
+	void	BuildGridMesh ( GridMesh& mesh, float runway_width, float runway_length, float extent );
+
+	// Flat copy of a mesh for an asset bundle entry (BUNDLE_GRID), and back.
+	// Load returns false if the data is not a saved mesh.
+	void	SaveGridMesh ( const GridMesh& mesh, std::vector<uint8_t>& out );
+	bool	LoadGridMesh ( const uint8_t* data, size_t size, GridMesh& mesh );
+
+	// Frustum and eye from column-major view and projection matrices
+	void	GridViewFromMatrices ( GridView& gv, const float* view, const float* proj );
+
+	// Visible tile origins (x,z pairs) per level, for tiles in the frustum and
+	// within the level's fade distance. inst holds GridInstFloats floats, level
+	// L's origins start at L * tiles*tiles*2 and count[L] is its number of
+	// tiles. Returns the number of visible tiles.
+	inline int	GridInstFloats ( const GridMesh& mesh )		{ return GRID_LEVELS * mesh.tiles * mesh.tiles * 2; }
+	int		CullGridTiles ( const GridMesh& mesh, const GridView& gv, float* inst, int count[GRID_LEVELS] );
+
+#endif
@@ -0,0 +1,238 @@
+//--------------------------------------------------------
+//
+// HUD text - cached glyph quads for labels and instrument fields
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "hud_text.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char* g_hud_vs =
+	"#version 330 core\n"
+	"layout(location=0) in vec4 inPosTex;\n"
+	"layout(location=1) in vec4 inClr;\n"
+	"uniform vec2 scrSize;\n"
+	"out vec2 vTex;\n"
+	"out vec4 vClr;\n"
+	"void main() {\n"
+	"  vTex = inPosTex.zw;\n"
+	"  vClr = inClr;\n"
+	"  gl_Position = vec4 ( inPosTex.x * 2.0 / scrSize.x - 1.0, 1.0 - inPosTex.y * 2.0 / scrSize.y, 0, 1 );\n"
+	"}\n";
+
+static const char* g_hud_fs =
+	"#version 330 core\n"
+	"in vec2 vTex;\n"
+	"in vec4 vClr;\n"
+	"uniform sampler2D fontTex;\n"
+	"out vec4 outClr;\n"
+	"void main() {\n"
+	"  outClr = vec4 ( vClr.rgb, vClr.a * texture ( fontTex, vTex ).r );\n"
+	"}\n";
+
+HudText::HudText ()
+{
+	m_scale = 1;
+	m_realloc = true;
+	m_prog = 0; m_vao = 0; m_vbo = 0; m_tex = 0;
+	m_uploads = 0;
+}
+
+bool HudText::Init ( const char* font_name, float text_size, const AssetBundle* bundle )
+{
+	const char* base = strrchr ( font_name, '/' );
+	if ( bundle == 0x0 || !LoadBakedFont ( *bundle, base ? base+1 : font_name, m_font ) ) {
+		if ( !LoadBakedFont ( font_name, m_font ) ) return false;
+	}
+	m_scale = text_size / (m_font.ascent - m_font.descent);
+
+	m_prog = glCompileProgram ( "hud", g_hud_vs, g_hud_fs );
+	if ( m_prog == 0 ) return false;
+	m_loc_scr = glGetUniformLocation ( m_prog, "scrSize" );
+	m_loc_tex = glGetUniformLocation ( m_prog, "fontTex" );
+
+	glGenVertexArrays ( 1, &m_vao );
+	glGenBuffers ( 1, &m_vbo );
+	glBindVertexArray ( m_vao );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_vbo );
+	glEnableVertexAttribArray ( 0 );
+	glVertexAttribPointer ( 0, 4, GL_FLOAT, GL_FALSE, sizeof(HudVert), (void*) offsetof(HudVert, x) );
+	glEnableVertexAttribArray ( 1 );
+	glVertexAttribPointer ( 1, 4, GL_FLOAT, GL_FALSE, sizeof(HudVert), (void*) offsetof(HudVert, r) );
+	glBindVertexArray ( 0 );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+	return true;
+}
+
+// Atlas texture, on the first Draw. A bundle atlas has its mip chain in
+// BC4 (RGTC1), one channel as the R8 atlas, sent as is from the mapping.
+void HudText::UploadFont ()
+{
+	glGenTextures ( 1, &m_tex );
+	glBindTexture ( GL_TEXTURE_2D, m_tex );
+	if ( m_font.bc4 ) {
+		const uint8_t* src = m_font.bc4;
+		for (int l=0; l < m_font.bc4_levels; l++) {
+			int w = MipSize ( m_font.tex_width, l ), h = MipSize ( m_font.tex_height, l );
+			int bytes = BC4LevelBytes ( w, h );
+			glCompressedTexImage2D ( GL_TEXTURE_2D, l, GL_COMPRESSED_RED_RGTC1, w, h, 0, bytes, src );
+			src += bytes;
+		}
+		glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_font.bc4_levels - 1 );
+		glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+	} else {
+		glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+		glTexImage2D ( GL_TEXTURE_2D, 0, GL_R8, m_font.tex_width, m_font.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, m_font.pixels.data() );
+		glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	}
+	glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glBindTexture ( GL_TEXTURE_2D, 0 );
+}
+
+int HudText::AddItem ( float x, float y, int capacity, Vec4F clr )
+{
+	HudItem item;
+	item.x = x;
+	item.y = y;
+	item.clr = clr;
+	item.first = m_items.empty() ? 0 : m_items.back().first + m_items.back().capacity;
+	item.capacity = capacity;
+	item.dirty = true;
+	m_items.push_back ( item );
+	m_items.back().text.reserve ( HUD_TEXT_ROOM(capacity) );
+	m_realloc = true;
+	return (int) m_items.size() - 1;
+}
+
+int HudText::AddLabel ( float x, float y, const char* text, Vec4F clr )
+{
+	int id = AddItem ( x, y, (int) strlen(text), clr );
+	m_items[id].text = text;
+	return id;
+}
+
+int HudText::AddField ( float x, float y, int max_chars, Vec4F clr )
+{
+	return AddItem ( x, y, max_chars, clr );
+}
+
+void HudText::SetText ( int id, const char* text )
+{
+	HudItem& item = m_items[id];
+	size_t len = strlen ( text );
+	if ( len > item.text.capacity() ) len = item.text.capacity();		// never reallocates
+	if ( item.text.compare ( 0, std::string::npos, text, len ) == 0 ) return;
+	item.text.assign ( text, len );
+	item.dirty = true;
+}
+
+void HudText::SetColor ( int id, Vec4F clr )
+{
+	HudItem& item = m_items[id];
+	if ( item.clr.x == clr.x && item.clr.y == clr.y && item.clr.z == clr.z && item.clr.w == clr.w ) return;
+	item.clr = clr;
+	item.dirty = true;
+}
+
+float HudText::getTextWidth ( const char* text )
+{
+	int w = 0;
+	for (const char* c = text; *c; c++) w += m_font.glyphs[ (uint8_t) *c ].advance;
+	return w * m_scale;
+}
+
+// Glyph quads for an item into its slots, unused slots collapse to a point
+void HudText::Layout ( HudItem& item )
+{
+	HudVert* v = &m_verts[ item.first * 6 ];
+	memset ( v, 0, item.capacity * 6 * sizeof(HudVert) );
+
+	float su = 1.0f / m_font.tex_width, sv = 1.0f / m_font.tex_height;
+	float px = item.x;
+	float py = item.y + m_font.ascent * m_scale;		// baseline
+	int n = 0;
+	for (const char* c = item.text.c_str(); *c && n < item.capacity; c++) {
+		if ( *c == '\n' ) {
+			px = item.x;
+			py += getLineHeight ();
+			continue;
+		}
+		BakedGlyph& g = m_font.glyphs[ (uint8_t) *c ];
+		if ( g.width > 0 && g.height > 0 ) {
+			float x0 = px + g.offx * m_scale, x1 = x0 + g.width * m_scale;
+			float y0 = py + g.offy * m_scale, y1 = y0 + g.height * m_scale;
+			float u0 = g.u * su, u1 = (g.u + g.width) * su;
+			float v0 = (g.v + g.height) * sv, v1 = g.v * sv;		// atlas is bottom-up
+			HudVert q[4] = {
+				{ x0, y0, u0, v0, item.clr.x, item.clr.y, item.clr.z, item.clr.w },
+				{ x1, y0, u1, v0, item.clr.x, item.clr.y, item.clr.z, item.clr.w },
+				{ x1, y1, u1, v1, item.clr.x, item.clr.y, item.clr.z, item.clr.w },
+				{ x0, y1, u0, v1, item.clr.x, item.clr.y, item.clr.z, item.clr.w } };
+			v[0] = q[0]; v[1] = q[1]; v[2] = q[2];
+			v[3] = q[0]; v[4] = q[2]; v[5] = q[3];
+			v += 6;
+			n++;
+		}
+		px += g.advance * m_scale;
+	}
+	item.dirty = false;
+}
+
+void HudText::Draw ( int w, int h )
+{
+	if ( m_prog == 0 || m_items.empty() ) return;
+	if ( m_tex == 0 ) UploadFont ();
+
+	// relayout changed items, sending only their slots
+	m_uploads = 0;
+	glBindBuffer ( GL_ARRAY_BUFFER, m_vbo );
+	if ( m_realloc ) {
+		m_verts.resize ( (m_items.back().first + m_items.back().capacity) * 6 );
+		for (size_t k=0; k < m_items.size(); k++) Layout ( m_items[k] );
+		glBufferData ( GL_ARRAY_BUFFER, m_verts.size() * sizeof(HudVert), m_verts.data(), GL_DYNAMIC_DRAW );
+		m_uploads = (int) m_verts.size() / 6;
+		m_realloc = false;
+	} else {
+		for (size_t k=0; k < m_items.size(); k++) {
+			HudItem& item = m_items[k];
+			if ( !item.dirty ) continue;
+			Layout ( item );
+			glBufferSubData ( GL_ARRAY_BUFFER, item.first * 6 * sizeof(HudVert), item.capacity * 6 * sizeof(HudVert), &m_verts[ item.first * 6 ] );
+			m_uploads += item.capacity;
+		}
+	}
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+
+	glDisable ( GL_DEPTH_TEST );
+	glEnable ( GL_BLEND );
+	glBlendFunc ( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+	glUseProgram ( m_prog );
+	glUniform2f ( m_loc_scr, (float) w, (float) h );
+	glUniform1i ( m_loc_tex, 0 );
+	glActiveTexture ( GL_TEXTURE0 );
+	glBindTexture ( GL_TEXTURE_2D, m_tex );
+	glBindVertexArray ( m_vao );
+	glDrawArrays ( GL_TRIANGLES, 0, (GLsizei) m_verts.size() );
+	glBindVertexArray ( 0 );
+	glBindTexture ( GL_TEXTURE_2D, 0 );
+	glUseProgram ( 0 );
+}
+
+void HudText::Clear ()
+{
+	if ( m_vbo ) glDeleteBuffers ( 1, &m_vbo );
+	if ( m_vao ) glDeleteVertexArrays ( 1, &m_vao );
+	if ( m_tex ) glDeleteTextures ( 1, &m_tex );
+	if ( m_prog ) glDeleteProgram ( m_prog );
+	m_prog = 0; m_vao = 0; m_vbo = 0; m_tex = 0;
+	m_items.clear ();
+	m_verts.clear ();
+	m_realloc = true;
+}
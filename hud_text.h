@@ -0,0 +1,77 @@
+//--------------------------------------------------------
+//
+// HUD text - cached glyph quads for labels and instrument fields
+//
+// Labels are laid out once into a vertex buffer. Fields reserve room for a
+// fixed number of glyphs and are laid out again only when SetText is given
+// a string that differs from the last one, so a steady HUD costs one draw
+// call and no uploads. Fields are normally filled with TextBuf.
+// Each item's text is reserved when it is added, with room for spaces and
+// line breaks beyond its glyphs, and SetText truncates to that, so setting
+// text never allocates.
+// The font comes from the asset bundle when there is one, with a BC4 atlas
+// read in place, and the atlas is sent to GL on the first Draw.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_HUD_TEXT
+	#define DEF_HUD_TEXT
+
+	#include <string>
+	#include <vector>
+	#include "vec.h"
+	#include "render_gl.h"
+	#include "baked_font.h"
+	#include "asset_bundle.h"
+
+	#define HUD_TEXT_ROOM(glyphs)	((glyphs) * 2 + 16)		// chars reserved per item
+
+	struct HudItem {
+		float		x, y;					// top-left, pixels
+		Vec4F		clr;
+		int			first, capacity;		// glyph slots in the vertex buffer
+		std::string	text;					// HUD_TEXT_ROOM(capacity) reserved
+		bool		dirty;
+	};
+
+	struct HudVert {
+		float		x, y, u, v;
+		float		r, g, b, a;
+	};
+
+	class HudText {
+	public:
+		HudText ();
+
+		bool		Init ( const char* font_name, float text_size, const AssetBundle* bundle = 0x0 );	// call with a GL context
+		int			AddLabel ( float x, float y, const char* text, Vec4F clr );		// static text
+		int			AddField ( float x, float y, int max_chars, Vec4F clr );		// changing text
+		void		SetText ( int id, const char* text );					// relayout only if changed
+		void		SetColor ( int id, Vec4F clr );
+		void		Draw ( int w, int h );
+		void		Clear ();
+
+		float		getTextWidth ( const char* text );
+		float		getLineHeight ()		{ return (m_font.ascent - m_font.descent + m_font.linegap) * m_scale; }
+		int			getUploads ()			{ return m_uploads; }			// glyphs re-sent by the last Draw
+
+	private:
+		int			AddItem ( float x, float y, int capacity, Vec4F clr );
+		void		Layout ( HudItem& item );
+		void		UploadFont ();
+
+		BakedFont	m_font;
+		float		m_scale;
+		std::vector<HudItem> m_items;
+		std::vector<HudVert> m_verts;		// 6 per glyph slot
+		bool		m_realloc;
+
+		GLuint		m_prog, m_vao, m_vbo, m_tex;
+		GLint		m_loc_scr, m_loc_tex;
+		int			m_uploads;
+	};
+
+#endif
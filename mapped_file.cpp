@@ -0,0 +1,92 @@
+//--------------------------------------------------------
+//
+// Mapped file - read-only memory-mapped file
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile ()
+{
+	m_data = 0x0;
+	m_size = 0;
+	#ifdef _WIN32
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = 0x0;
+	#else
+		m_fd = -1;
+	#endif
+}
+
+MappedFile::~MappedFile ()
+{
+	Close ();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open ( const char* fname )
+{
+	Close ();
+	m_file = CreateFileA ( fname, GENERIC_READ, FILE_SHARE_READ, 0x0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0x0 );
+	if ( m_file == INVALID_HANDLE_VALUE ) return false;
+	LARGE_INTEGER sz;
+	if ( !GetFileSizeEx ( m_file, &sz ) || sz.QuadPart == 0 ) { Close(); return false; }
+	m_mapping = CreateFileMappingA ( m_file, 0x0, PAGE_READONLY, 0, 0, 0x0 );
+	if ( m_mapping == 0x0 ) { Close(); return false; }
+	m_data = (const uint8_t*) MapViewOfFile ( m_mapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( m_data == 0x0 ) { Close(); return false; }
+	m_size = (size_t) sz.QuadPart;
+	return true;
+}
+
+void MappedFile::Close ()
+{
+	if ( m_data ) UnmapViewOfFile ( m_data );
+	if ( m_mapping ) CloseHandle ( m_mapping );
+	if ( m_file != INVALID_HANDLE_VALUE ) CloseHandle ( m_file );
+	m_data = 0x0;
+	m_size = 0;
+	m_mapping = 0x0;
+	m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open ( const char* fname )
+{
+	Close ();
+	m_fd = open ( fname, O_RDONLY );
+	if ( m_fd < 0 ) return false;
+	struct stat st;
+	if ( fstat ( m_fd, &st ) != 0 || st.st_size == 0 ) { Close(); return false; }
+	void* p = mmap ( 0x0, (size_t) st.st_size, PROT_READ, MAP_SHARED, m_fd, 0 );
+	if ( p == MAP_FAILED ) { Close(); return false; }
+	m_data = (const uint8_t*) p;
+	m_size = (size_t) st.st_size;
+	return true;
+}
+
+void MappedFile::Close ()
+{
+	if ( m_data ) munmap ( (void*) m_data, m_size );
+	if ( m_fd >= 0 ) close ( m_fd );
+	m_data = 0x0;
+	m_size = 0;
+	m_fd = -1;
+}
+
+#endif
@@ -0,0 +1,46 @@
+//--------------------------------------------------------
+//
+// Mapped file - read-only memory-mapped file
+//
+// Maps a whole file into the address space so fixed-record data can be read
+// in place, with pages loaded by the OS on first touch.
+// POSIX mmap or Win32 file mapping.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_MAPPED_FILE
+	#define DEF_MAPPED_FILE
+
+	#include <stddef.h>
+	#include <stdint.h>
+
+	class MappedFile {
+	public:
+		MappedFile ();
+		~MappedFile ();
+
+		bool		Open ( const char* fname );			// false if missing or empty
+		void		Close ();
+		bool		isOpen ()			{ return m_data != 0x0; }
+
+		const uint8_t* getData ()		{ return m_data; }
+		size_t		getSize ()			{ return m_size; }
+
+	private:
+		MappedFile ( const MappedFile& );				// not copyable
+		MappedFile& operator= ( const MappedFile& );
+
+		const uint8_t* m_data;
+		size_t		m_size;
+		#ifdef _WIN32
+			void*	m_file;
+			void*	m_mapping;
+		#else
+			int		m_fd;
+		#endif
+	};
+
+#endif
@@ -0,0 +1,196 @@
+//--------------------------------------------------------
+//
+// Net codec - quantized aircraft state and delta bit packing
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "net_codec.h"
+#include <math.h>
+
+static const int g_field_bits[NET_FIELDS] = {
+	16, 16,						// tile x, z
+	19, 21, 19,					// x, y, z
+	16, 16, 16,					// vx, vy, vz
+	2, NET_QUAT_BITS, NET_QUAT_BITS, NET_QUAT_BITS,
+	8, 8, 7, 4					// roll, pitch, power, flaps
+};
+
+static const float SQRT1_2 = 0.70710678f;
+static const int g_class_bits[3] = { 4, 8, 12 };		// delta size classes, the 4th is the full field
+
+int NetFieldBits ( int field )
+{
+	return g_field_bits[field];
+}
+
+static inline uint32_t Mask ( int bits )					{ return (bits >= 32) ? 0xFFFFFFFFu : (1u << bits) - 1; }
+static inline int32_t SignExtend ( uint32_t v, int bits )	{ return (int32_t) (v << (32-bits)) >> (32-bits); }
+
+static inline uint32_t Fixed ( float v, float scale, int bits )
+{
+	float q = floorf ( v * scale + 0.5f );
+	if ( q < 0 ) q = 0;
+	if ( q > Mask(bits) ) q = (float) Mask(bits);
+	return (uint32_t) q;
+}
+
+static inline uint32_t FixedSigned ( float v, float scale, int bits )
+{
+	float lim = (float) (Mask(bits-1));
+	float q = floorf ( v * scale + 0.5f );
+	if ( q < -lim ) q = -lim;
+	if ( q > lim ) q = lim;
+	return (uint32_t) (int32_t) q & Mask(bits);
+}
+
+void NetQuantize ( NetState& q, Vec3F pos, Vec3F vel, Quaternion orient, float roll, float pitch, float power, float flaps )
+{
+	// Position, tile and offset
+	float tx = floorf ( pos.x / NET_TILE_SIZE ), tz = floorf ( pos.z / NET_TILE_SIZE );
+	q.f[NET_TILE_X] = (uint32_t) (int32_t) tx & Mask(16);
+	q.f[NET_TILE_Z] = (uint32_t) (int32_t) tz & Mask(16);
+	q.f[NET_X] = Fixed ( pos.x - tx*NET_TILE_SIZE, NET_POS_SCALE, g_field_bits[NET_X] );
+	q.f[NET_Y] = Fixed ( pos.y - NET_ALT_MIN, NET_POS_SCALE, g_field_bits[NET_Y] );
+	q.f[NET_Z] = Fixed ( pos.z - tz*NET_TILE_SIZE, NET_POS_SCALE, g_field_bits[NET_Z] );
+
+	q.f[NET_VX] = FixedSigned ( vel.x, NET_VEL_SCALE, 16 );
+	q.f[NET_VY] = FixedSigned ( vel.y, NET_VEL_SCALE, 16 );
+	q.f[NET_VZ] = FixedSigned ( vel.z, NET_VEL_SCALE, 16 );
+
+	// Orientation, smallest three. q and -q are the same rotation, so
+	// the dropped component is made positive.
+	float c[4] = { orient.X, orient.Y, orient.Z, orient.W };
+	int big = 0;
+	for (int k=1; k < 4; k++)
+		if ( fabsf(c[k]) > fabsf(c[big]) ) big = k;
+	float sign = (c[big] < 0) ? -1.0f : 1.0f;
+	q.f[NET_QI] = big;
+	const float qscale = Mask(NET_QUAT_BITS) * SQRT1_2;			// [-1/sqrt2, 1/sqrt2] to [0, max]
+	for (int k=0, j=NET_QA; k < 4; k++) {
+		if ( k == big ) continue;
+		q.f[j++] = Fixed ( c[k]*sign + SQRT1_2, qscale, NET_QUAT_BITS );
+	}
+
+	// Controls
+	q.f[NET_ROLL] = FixedSigned ( roll, 127, 8 );
+	q.f[NET_PITCH] = FixedSigned ( pitch, 127, 8 );
+	q.f[NET_POWER] = Fixed ( power, 10, 7 );
+	q.f[NET_FLAPS] = Fixed ( flaps, 15, 4 );
+}
+
+void NetDequantize ( const NetState& q, Vec3F& pos, Vec3F& vel, Quaternion& orient, float& roll, float& pitch, float& power, float& flaps )
+{
+	int tx = SignExtend ( q.f[NET_TILE_X], 16 ), tz = SignExtend ( q.f[NET_TILE_Z], 16 );
+	pos.x = tx * NET_TILE_SIZE + q.f[NET_X] / NET_POS_SCALE;
+	pos.y = NET_ALT_MIN + q.f[NET_Y] / NET_POS_SCALE;
+	pos.z = tz * NET_TILE_SIZE + q.f[NET_Z] / NET_POS_SCALE;
+
+	vel.x = SignExtend ( q.f[NET_VX], 16 ) / NET_VEL_SCALE;
+	vel.y = SignExtend ( q.f[NET_VY], 16 ) / NET_VEL_SCALE;
+	vel.z = SignExtend ( q.f[NET_VZ], 16 ) / NET_VEL_SCALE;
+
+	float c[4], sum = 0;
+	int big = q.f[NET_QI] & 3;
+	const float qscale = Mask(NET_QUAT_BITS) * SQRT1_2;
+	for (int k=0, j=NET_QA; k < 4; k++) {
+		if ( k == big ) continue;
+		c[k] = q.f[j++] / qscale - SQRT1_2;
+		sum += c[k]*c[k];
+	}
+	c[big] = sqrtf ( (sum < 1) ? 1 - sum : 0 );
+	orient.X = c[0]; orient.Y = c[1]; orient.Z = c[2]; orient.W = c[3];
+	orient.normalize ();
+
+	roll = SignExtend ( q.f[NET_ROLL], 8 ) / 127.0f;
+	pitch = SignExtend ( q.f[NET_PITCH], 8 ) / 127.0f;
+	power = q.f[NET_POWER] / 10.0f;
+	flaps = q.f[NET_FLAPS] / 15.0f;
+}
+
+void BitWriter::Write ( uint32_t v, int bits )
+{
+	m_acc |= (uint64_t) (v & Mask(bits)) << m_acc_bits;
+	m_acc_bits += bits;
+	while ( m_acc_bits >= 8 ) {
+		if ( m_bits + 8 <= m_cap ) m_buf[ m_bits >> 3 ] = (uint8_t) m_acc;
+		m_bits += 8;
+		m_acc >>= 8;
+		m_acc_bits -= 8;
+	}
+}
+
+void BitWriter::Flush ()
+{
+	if ( m_acc_bits > 0 ) {
+		if ( m_bits + 8 <= m_cap ) m_buf[ m_bits >> 3 ] = (uint8_t) m_acc;
+		m_bits += 8;
+		m_acc = 0;
+		m_acc_bits = 0;
+	}
+}
+
+uint32_t BitReader::Read ( int bits )
+{
+	uint32_t v = 0;
+	for (int got = 0; got < bits; ) {
+		if ( m_bits >= m_cap ) { m_bits += bits - got; return 0; }
+		int off = m_bits & 7;
+		int take = (8 - off < bits - got) ? 8 - off : bits - got;
+		v |= (uint32_t) ((m_buf[ m_bits >> 3 ] >> off) & Mask(take)) << got;
+		got += take;
+		m_bits += take;
+	}
+	return v;
+}
+
+void NetWriteState ( BitWriter& w, const NetState& s, const NetState* base )
+{
+	if ( base == 0x0 ) {
+		for (int k=0; k < NET_FIELDS; k++) w.Write ( s.f[k], g_field_bits[k] );
+		return;
+	}
+	bool same = true;
+	for (int k=0; k < NET_FIELDS; k++) same &= ( s.f[k] == base->f[k] );
+	w.Write ( same ? 0 : 1, 1 );
+	if ( same ) return;
+
+	for (int k=0; k < NET_FIELDS; k++) {
+		int bits = g_field_bits[k];
+		int32_t d = SignExtend ( (s.f[k] - base->f[k]) & Mask(bits), bits );		// wrapped difference
+		uint32_t zz = ((uint32_t) d << 1) ^ (uint32_t) (d >> 31);					// zigzag, small magnitudes first
+		if ( zz == 0 ) { w.Write ( 0, 1 ); continue; }
+		int c = 0;
+		while ( c < 3 && zz >= (1u << g_class_bits[c]) ) c++;
+		if ( c < 3 && g_class_bits[c] >= bits ) c = 3;			// no smaller than the field itself
+		w.Write ( 1 | (c << 1), 3 );
+		if ( c < 3 )	w.Write ( zz, g_class_bits[c] );
+		else			w.Write ( s.f[k], bits );
+	}
+}
+
+bool NetReadState ( BitReader& r, NetState& s, const NetState* base )
+{
+	if ( base == 0x0 ) {
+		for (int k=0; k < NET_FIELDS; k++) s.f[k] = r.Read ( g_field_bits[k] );
+		return !r.isOverflow ();
+	}
+	s = *base;
+	if ( r.Read ( 1 ) == 0 ) return !r.isOverflow ();
+
+	for (int k=0; k < NET_FIELDS; k++) {
+		int bits = g_field_bits[k];
+		if ( r.Read ( 1 ) == 0 ) continue;
+		int c = r.Read ( 2 );
+		if ( c < 3 ) {
+			uint32_t zz = r.Read ( g_class_bits[c] );
+			int32_t d = (int32_t) (zz >> 1) ^ -(int32_t) (zz & 1);
+			s.f[k] = (base->f[k] + (uint32_t) d) & Mask(bits);
+		} else {
+			s.f[k] = r.Read ( bits );
+		}
+	}
+	return !r.isOverflow ();
+}
@@ -0,0 +1,98 @@
+//--------------------------------------------------------
+//
+// Net codec - quantized aircraft state and delta bit packing
+//
+// An aircraft's network state is NET_FIELDS small integers:
+// - position in fixed point, as a NET_TILE_SIZE tile index plus an offset
+//   inside the tile in 1/NET_POS_SCALE m
+// - velocity in 1/NET_VEL_SCALE m/s
+// - orientation as smallest-three: the index of the largest quaternion
+//   component, which is dropped, and the other three in NET_QUAT_BITS each
+// - the control inputs
+// A full state is about 26 bytes against 56 as floats.
+//
+// States are written against a baseline the receiver already has. An
+// unchanged state costs one bit. Otherwise each field costs one bit when
+// unchanged, or a 2-bit size class and its zigzag difference. Steady
+// flight is about 12 bytes an aircraft at 60 Hz against the last tick, and
+// 16 against a baseline 8 ticks old (tools/net_check).
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_NET_CODEC
+	#define DEF_NET_CODEC
+
+	#include <stdint.h>
+	#include "vec.h"
+	#include "quaternion.h"
+
+	#define NET_TILE_SIZE	4096.0f		// position tile (m), offsets are 19 bits
+	#define NET_POS_SCALE	128.0f		// position units per m
+	#define NET_ALT_MIN		-1024.0f	// lowest altitude (m), altitude is 21 bits
+	#define NET_VEL_SCALE	32.0f		// velocity units per m/s, +/- 1024 m/s in 16 bits
+	#define NET_QUAT_BITS	12			// per smallest-three component
+
+	// State fields
+	#define NET_TILE_X		0
+	#define NET_TILE_Z		1
+	#define NET_X			2
+	#define NET_Y			3
+	#define NET_Z			4
+	#define NET_VX			5
+	#define NET_VY			6
+	#define NET_VZ			7
+	#define NET_QI			8			// index of the dropped component
+	#define NET_QA			9
+	#define NET_QB			10
+	#define NET_QC			11
+	#define NET_ROLL		12
+	#define NET_PITCH		13
+	#define NET_POWER		14
+	#define NET_FLAPS		15
+	#define NET_FIELDS		16
+
+	struct NetState {
+		uint32_t	f[NET_FIELDS];
+	};
+
+	int			NetFieldBits ( int field );
+	void		NetQuantize ( NetState& q, Vec3F pos, Vec3F vel, Quaternion orient, float roll, float pitch, float power, float flaps );
+	void		NetDequantize ( const NetState& q, Vec3F& pos, Vec3F& vel, Quaternion& orient, float& roll, float& pitch, float& power, float& flaps );
+
+	class BitWriter {
+	public:
+		BitWriter ( uint8_t* buf, int bytes )	{ m_buf = buf; m_cap = bytes * 8; m_bits = 0; m_acc = 0; m_acc_bits = 0; }
+
+		void		Write ( uint32_t v, int bits );		// low bits of v, bits <= 32
+		void		Flush ();							// pad the last byte
+		int			getBytes ()				{ return (m_bits + 7) / 8; }
+		int			getBits ()				{ return m_bits; }
+		bool		isOverflow ()			{ return m_bits > m_cap; }
+
+	private:
+		uint8_t*	m_buf;
+		int			m_cap, m_bits;
+		uint64_t	m_acc;
+		int			m_acc_bits;
+	};
+
+	class BitReader {
+	public:
+		BitReader ( const uint8_t* buf, int bytes )	{ m_buf = buf; m_cap = bytes * 8; m_bits = 0; }
+
+		uint32_t	Read ( int bits );					// 0 past the end, see isOverflow
+		bool		isOverflow ()			{ return m_bits > m_cap; }
+
+	private:
+		const uint8_t* m_buf;
+		int			m_cap, m_bits;
+	};
+
+	// Write s against base, or in full if base is 0x0. Read must be given the same base.
+	void		NetWriteState ( BitWriter& w, const NetState& s, const NetState* base );
+	bool		NetReadState ( BitReader& r, NetState& s, const NetState* base );
+
+#endif
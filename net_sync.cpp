@@ -0,0 +1,341 @@
+//--------------------------------------------------------
+//
+// Net sync - multiplayer aircraft state over UDP
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "net_sync.h"
+#include "flight_model.h"
+#include "common_defs.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	typedef int socklen_t;
+	#define CLOSE_SOCKET(s)		closesocket ( (SOCKET) s )
+#else
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#define CLOSE_SOCKET(s)		close ( (int) s )
+#endif
+
+static int64_t Now ()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static inline bool SeqNewer ( uint16_t a, uint16_t b )	{ return (int16_t) (a - b) > 0; }		// a after b, with wrap
+
+NetSync::NetSync ()
+{
+	m_sock = -1;
+	m_station = 0;
+	m_tick_ns = 0;
+	m_next_tick = 0;
+	m_next_poll = 0;
+	m_seq = 0;
+	m_num_local = 0;
+	m_bytes_sent = 0; m_packets_sent = 0; m_packets_recv = 0; m_packets_dropped = 0;
+	for (int k=0; k < NET_HISTORY; k++) m_sent[k].valid = false;
+}
+
+NetSync::~NetSync ()
+{
+	Close ();
+}
+
+bool NetSync::Load ( const char* fname )
+{
+	FILE* fp = fopen ( fname, "rt" );
+	if ( fp == 0x0 ) return false;
+
+	int station = 0, port = 0;
+	float tick = 60;
+	char buf[1024], cmd[64], ip[64];
+	std::vector<std::string> peer_ip;
+	std::vector<int> peer_port;
+	int line = 0;
+	bool ok = true;
+
+	while ( fgets ( buf, 1024, fp ) ) {
+		line++;
+		char* c = strchr ( buf, '#' );		// strip comments
+		if ( c ) *c = '\0';
+		if ( sscanf ( buf, "%63s", cmd ) != 1 ) continue;
+
+		int n = 0, pp = 0;
+		if      ( strcmp ( cmd, "station" ) == 0 )	n = sscanf ( buf, "%*s %d", &station ) - 1;
+		else if ( strcmp ( cmd, "port" ) == 0 )		n = sscanf ( buf, "%*s %d", &port ) - 1;
+		else if ( strcmp ( cmd, "tick" ) == 0 )		n = sscanf ( buf, "%*s %f", &tick ) - 1;
+		else if ( strcmp ( cmd, "peer" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s %d", ip, &pp ) - 2;
+			if ( n == 0 ) { peer_ip.push_back ( ip ); peer_port.push_back ( pp ); }
+		} else n = -1;
+		if ( n != 0 ) {
+			dbgprintf ( "ERROR: %s:%d: bad command: %s", fname, line, buf );
+			ok = false;
+		}
+	}
+	fclose ( fp );
+	if ( !ok || !Open ( station, port, tick ) ) return false;
+
+	for (size_t k=0; k < peer_ip.size(); k++)
+		if ( !AddPeer ( peer_ip[k].c_str(), peer_port[k] ) )
+			dbgprintf ( "ERROR: %s: bad peer %s %d\n", fname, peer_ip[k].c_str(), peer_port[k] );
+	return true;
+}
+
+bool NetSync::Open ( int station, int port, float tick )
+{
+	Close ();
+	#ifdef _WIN32
+		WSADATA wsa;
+		if ( WSAStartup ( MAKEWORD(2,2), &wsa ) != 0 ) return false;
+		SOCKET s = socket ( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+		if ( s == INVALID_SOCKET ) { dbgprintf ( "ERROR: Unable to create UDP socket\n" ); return false; }
+		u_long nonblock = 1;
+		ioctlsocket ( s, FIONBIO, &nonblock );
+	#else
+		int s = socket ( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+		if ( s < 0 ) { dbgprintf ( "ERROR: Unable to create UDP socket\n" ); return false; }
+		fcntl ( s, F_SETFL, fcntl ( s, F_GETFL, 0 ) | O_NONBLOCK );
+	#endif
+
+	sockaddr_in a;
+	memset ( &a, 0, sizeof(a) );
+	a.sin_family = AF_INET;
+	a.sin_addr.s_addr = htonl ( INADDR_ANY );
+	a.sin_port = htons ( (uint16_t) port );
+	if ( bind ( s, (sockaddr*) &a, sizeof(a) ) != 0 ) {
+		dbgprintf ( "ERROR: Unable to bind UDP port %d\n", port );
+		CLOSE_SOCKET ( s );
+		return false;
+	}
+	m_sock = (intptr_t) s;
+	m_station = station & 0xFF;
+	m_tick_ns = (int64_t) (1e9 / ((tick > 0) ? tick : 60));
+	m_next_tick = Now ();
+	m_next_poll = 0;
+	m_seq = 0;
+	for (int k=0; k < NET_HISTORY; k++) m_sent[k].valid = false;
+	dbgprintf ( "Net: station %d on UDP port %d, %g Hz\n", m_station, port, 1e9 / m_tick_ns );
+	return true;
+}
+
+void NetSync::Close ()
+{
+	if ( m_sock != -1 ) {
+		CLOSE_SOCKET ( m_sock );
+		#ifdef _WIN32
+			WSACleanup ();
+		#endif
+	}
+	m_sock = -1;
+	for (size_t k=0; k < m_peers.size(); k++) delete m_peers[k];
+	m_peers.clear ();
+	m_num_local = 0;
+}
+
+bool NetSync::AddPeer ( const char* ipv4, int port )
+{
+	if ( (int) m_peers.size() >= NET_MAX_PEERS ) return false;
+	in_addr ia;
+	if ( inet_pton ( AF_INET, ipv4, &ia ) != 1 ) return false;
+
+	NetPeer* p = new NetPeer;
+	p->addr = ntohl ( ia.s_addr );
+	p->port = (uint16_t) port;
+	p->station = -1;
+	p->acked = false;
+	p->ack_seq = 0;
+	p->rtt = 0;
+	p->heard = false;
+	p->recv_seq = 0;
+	p->recv_time = 0;
+	for (int k=0; k < NET_HISTORY; k++) p->recv[k].valid = false;
+	for (int k=0; k < NET_MAX_LOCAL; k++) p->index[k] = -1;
+	m_peers.push_back ( p );
+	return true;
+}
+
+void NetSync::Update ( FlightModel& m, float dt )
+{
+	if ( m_sock == -1 ) return;
+	int64_t now = Now ();
+	if ( now < m_next_poll ) return;
+	m_next_poll = now + (int64_t) (NET_POLL * 1e9);
+
+	Receive ( m, dt, now );
+
+	if ( now >= m_next_tick ) {
+		Send ( m, now );
+		m_next_tick += m_tick_ns;
+		if ( m_next_tick < now ) m_next_tick = now + m_tick_ns;		// dont send bursts after a stall
+	}
+}
+
+void NetSync::Receive ( FlightModel& m, float dt, int64_t now )
+{
+	uint8_t buf[NET_MAX_PACKET];
+	sockaddr_in from;
+	for (;;) {
+		socklen_t len = sizeof(from);
+		int n = (int) recvfrom ( m_sock, (char*) buf, NET_MAX_PACKET, 0, (sockaddr*) &from, &len );
+		if ( n <= 0 ) break;					// would block
+		m_packets_recv++;
+		Decode ( m, dt, now, buf, n, ntohl ( from.sin_addr.s_addr ), ntohs ( from.sin_port ) );
+	}
+}
+
+// Packet: magic 16, station 8, seq 16, ack flag 1 + seq 16 + hold ms NET_HOLD_BITS,
+// base flag 1 + seq 16, count 5, then count states against the base (full past the base's count)
+void NetSync::Decode ( FlightModel& m, float dt, int64_t now, const uint8_t* buf, int len, uint32_t addr, uint16_t port )
+{
+	NetPeer* p = 0x0;
+	for (size_t k=0; k < m_peers.size(); k++)
+		if ( m_peers[k]->addr == addr && m_peers[k]->port == port ) { p = m_peers[k]; break; }
+	if ( p == 0x0 ) { m_packets_dropped++; return; }		// not configured
+
+	BitReader r ( buf, len );
+	if ( r.Read ( 16 ) != NET_MAGIC ) { m_packets_dropped++; return; }
+	int station = r.Read ( 8 );
+	uint16_t seq = r.Read ( 16 );
+	bool has_ack = r.Read ( 1 ) != 0;
+	uint16_t ack = r.Read ( 16 );
+	int hold = r.Read ( NET_HOLD_BITS );
+	bool has_base = r.Read ( 1 ) != 0;
+	uint16_t base_seq = r.Read ( 16 );
+	int count = r.Read ( 5 );
+
+	// Acknowledgment of our stream, and the round trip it took less the peer's hold
+	if ( has_ack ) {
+		const NetSnapshot& s = m_sent[ ack & (NET_HISTORY-1) ];
+		if ( s.valid && s.seq == ack && ( !p->acked || SeqNewer ( ack, p->ack_seq ) ) ) {
+			float rtt = (now - s.sent) * 1e-9f - hold * 0.001f;
+			if ( rtt < 0 ) rtt = 0;
+			p->rtt = p->acked ? p->rtt + (rtt - p->rtt) * 0.1f : rtt;
+			p->acked = true;
+			p->ack_seq = ack;
+		}
+	}
+
+	// Out of order, or the baseline is gone
+	if ( p->heard && !SeqNewer ( seq, p->recv_seq ) ) { m_packets_dropped++; return; }
+	const NetSnapshot* base = 0x0;
+	if ( has_base ) {
+		base = &p->recv[ base_seq & (NET_HISTORY-1) ];
+		if ( !base->valid || base->seq != base_seq ) { m_packets_dropped++; return; }
+	}
+	if ( count > NET_MAX_LOCAL ) { m_packets_dropped++; return; }
+
+	NetSnapshot snap;
+	snap.seq = seq;
+	snap.count = count;
+	snap.sent = 0;
+	for (int k=0; k < count; k++) {
+		const NetState* b = ( base && k < base->count ) ? &base->states[k] : 0x0;
+		if ( !NetReadState ( r, snap.states[k], b ) ) { m_packets_dropped++; return; }
+	}
+	snap.valid = true;
+	p->recv[ seq & (NET_HISTORY-1) ] = snap;
+	p->recv_seq = seq;
+	p->recv_time = now;
+	p->heard = true;
+	p->station = station;
+
+	// Set the remote aircraft, then fly them ahead by the one-way latency
+	float ahead = p->rtt * 0.5f;
+	if ( ahead > NET_MAX_CATCHUP ) ahead = NET_MAX_CATCHUP;
+	int steps = (dt > 0) ? int( ahead / dt + 0.5f ) : 0;
+
+	Vec3F pos, vel;
+	Quaternion q;
+	float roll, pitch, power, flaps;
+	int idx[NET_MAX_LOCAL];
+	for (int k=0; k < count; k++) {
+		NetDequantize ( snap.states[k], pos, vel, q, roll, pitch, power, flaps );
+		int& i = p->index[k];
+		if ( i < 0 ) i = m.AddAircraft ( pos, vel, power );
+		m.setPos ( i, pos );
+		m.setVel ( i, vel );
+		m.setOrient ( i, q );
+		m.setControls ( i, roll, pitch, power, flaps );
+		idx[k] = i;
+	}
+	if ( steps == 0 ) return;
+
+	// The packet's aircraft stepped together, each run of adjacent indices
+	// in one block call a step. A peer's aircraft are added together, so
+	// usually one run.
+	std::sort ( idx, idx + count );
+	for (int k=0; k < count; ) {
+		int first = k++;
+		while ( k < count && idx[k] == idx[k-1] + 1 ) k++;
+		for (int s=0; s < steps; s++) m.AdvanceRange ( idx[first], idx[k-1] + 1, dt );
+	}
+}
+
+void NetSync::Send ( FlightModel& m, int64_t now )
+{
+	// Snapshot the local aircraft once, all peers get deltas of the same states
+	m_seq++;
+	NetSnapshot& snap = m_sent[ m_seq & (NET_HISTORY-1) ];
+	snap.seq = m_seq;
+	snap.valid = true;
+	snap.count = m_num_local;
+	snap.sent = now;
+	for (int k=0; k < m_num_local; k++) {
+		int i = m_local[k];
+		NetQuantize ( snap.states[k], m.getPos(i), m.getVel(i), m.getOrient(i), m.m_roll[i], m.m_pitch[i], m.m_power[i], m.m_flaps[i] );
+	}
+
+	uint8_t buf[NET_MAX_PACKET];
+	for (size_t n=0; n < m_peers.size(); n++) {
+		NetPeer* p = m_peers[n];
+
+		const NetSnapshot* base = 0x0;
+		if ( p->acked && (uint16_t) (m_seq - p->ack_seq) < NET_HISTORY ) {
+			base = &m_sent[ p->ack_seq & (NET_HISTORY-1) ];
+			if ( !base->valid || base->seq != p->ack_seq ) base = 0x0;
+		}
+
+		BitWriter w ( buf, NET_MAX_PACKET );
+		w.Write ( NET_MAGIC, 16 );
+		w.Write ( m_station, 8 );
+		w.Write ( m_seq, 16 );
+		w.Write ( p->heard ? 1 : 0, 1 );
+		w.Write ( p->recv_seq, 16 );
+		int64_t hold = p->heard ? (now - p->recv_time + 500000) / 1000000 : 0;
+		w.Write ( (uint32_t) std::min ( hold, (int64_t) (1 << NET_HOLD_BITS) - 1 ), NET_HOLD_BITS );
+		w.Write ( base ? 1 : 0, 1 );
+		w.Write ( base ? base->seq : 0, 16 );
+		w.Write ( snap.count, 5 );
+		for (int k=0; k < snap.count; k++)
+			NetWriteState ( w, snap.states[k], ( base && k < base->count ) ? &base->states[k] : 0x0 );
+		w.Flush ();
+		if ( w.isOverflow () ) continue;
+
+		sockaddr_in to;
+		memset ( &to, 0, sizeof(to) );
+		to.sin_family = AF_INET;
+		to.sin_addr.s_addr = htonl ( p->addr );
+		to.sin_port = htons ( p->port );
+		int sent = (int) sendto ( m_sock, (const char*) buf, w.getBytes(), 0, (sockaddr*) &to, sizeof(to) );
+		if ( sent > 0 ) {
+			m_bytes_sent += sent;
+			m_packets_sent++;
+		}
+	}
+}
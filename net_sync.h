@@ -0,0 +1,112 @@
+//--------------------------------------------------------
+//
+// Net sync - multiplayer aircraft state over UDP
+//
+// Each station sends its local aircraft to every peer at a fixed tick rate,
+// all in one datagram a tick. States are quantized by the net codec and
+// written against the last snapshot that peer acknowledged, so a packet is
+// mostly small deltas. Every packet carries an ack of the newest snapshot
+// received from its destination, with how long it was held before this
+// send, so the round trip excludes the wait for the tick. Nothing is resent: a lost packet is
+// replaced by the next tick, and once a peer's ack falls NET_HISTORY ticks
+// behind it gets full states again.
+//
+// Remote aircraft are added to the local FlightModel the first time they
+// are heard from. Each received state is set directly, then stepped ahead
+// by half the measured round trip. Between packets the model's own Advance
+// flies them on their last controls. Update runs on the thread that steps
+// the model, after each step.
+//
+// Config file, one command per line, # starts a comment:
+//   station <id>           this station, 0-255
+//   port <n>               local UDP port
+//   tick <hz>              send rate (default 60)
+//   peer <ipv4> <port>     another station, up to NET_MAX_PEERS
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_NET_SYNC
+	#define DEF_NET_SYNC
+
+	#include <stdint.h>
+	#include <vector>
+	#include "net_codec.h"
+
+	class FlightModel;
+
+	#define NET_MAGIC			0x4653		// "FS"
+	#define NET_MAX_PEERS		64
+	#define NET_MAX_LOCAL		16			// local aircraft per station
+	#define NET_HISTORY			64			// snapshots kept for baselines (power of 2)
+	#define NET_MAX_PACKET		1200		// bytes, under a typical MTU
+	#define NET_MAX_CATCHUP		0.25f		// longest latency stepped ahead (sec)
+	#define NET_POLL			0.001		// sec between socket polls
+	#define NET_HOLD_BITS		10			// ack hold time (ms) sent with the ack
+
+	struct NetSnapshot {
+		uint16_t	seq;
+		bool		valid;
+		int			count;
+		int64_t		sent;					// steady clock ns, for round trips
+		NetState	states[NET_MAX_LOCAL];
+	};
+
+	struct NetPeer {
+		uint32_t	addr;					// IPv4, host order
+		uint16_t	port;
+		int			station;				// from its packets, -1 until heard
+
+		// Our stream to the peer
+		bool		acked;					// peer has acknowledged ack_seq
+		uint16_t	ack_seq;
+		float		rtt;					// smoothed round trip (sec)
+
+		// The peer's stream to us
+		bool		heard;
+		uint16_t	recv_seq;				// newest decoded, echoed as the ack
+		int64_t		recv_time;				// steady clock ns it arrived, the ack's hold is from here
+		NetSnapshot	recv[NET_HISTORY];		// decoded snapshots, baselines for the next ones
+		int			index[NET_MAX_LOCAL];	// model index of each remote aircraft, -1 if not added
+	};
+
+	class NetSync {
+	public:
+		NetSync ();
+		~NetSync ();
+
+		bool		Load ( const char* fname );					// read config and Open, false if there is none
+		bool		Open ( int station, int port, float tick );
+		void		Close ();
+		bool		AddPeer ( const char* ipv4, int port );
+		void		AddLocal ( int i )		{ if ( m_num_local < NET_MAX_LOCAL ) m_local[m_num_local++] = i; }
+		bool		isOpen ()				{ return m_sock != -1; }
+
+		void		Update ( FlightModel& m, float dt );		// receive, apply and send when a tick is due
+
+		int			getNumPeers ()			{ return (int) m_peers.size(); }
+		const NetPeer& getPeer ( int k )	{ return *m_peers[k]; }
+		uint64_t	getBytesSent ()			{ return m_bytes_sent; }
+		uint64_t	getPacketsSent ()		{ return m_packets_sent; }
+		uint64_t	getPacketsReceived ()	{ return m_packets_recv; }
+		uint64_t	getPacketsDropped ()	{ return m_packets_dropped; }	// malformed, stale or missing baseline
+
+	private:
+		void		Receive ( FlightModel& m, float dt, int64_t now );
+		void		Decode ( FlightModel& m, float dt, int64_t now, const uint8_t* buf, int len, uint32_t addr, uint16_t port );
+		void		Send ( FlightModel& m, int64_t now );
+
+		intptr_t	m_sock;
+		int			m_station;
+		int64_t		m_tick_ns, m_next_tick, m_next_poll;
+		uint16_t	m_seq;
+		NetSnapshot	m_sent[NET_HISTORY];				// our snapshots by seq
+		int			m_local[NET_MAX_LOCAL];
+		int			m_num_local;
+		std::vector<NetPeer*> m_peers;
+		uint64_t	m_bytes_sent, m_packets_sent, m_packets_recv, m_packets_dropped;
+	};
+
+#endif
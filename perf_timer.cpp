@@ -0,0 +1,225 @@
+//--------------------------------------------------------
+//
+// Perf timer - scoped phase timers with rolling stats and trace export
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "perf_timer.h"
+#include "common_defs.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <algorithm>
+
+// Samples are written by the thread that owns the phase and read by the
+// HUD on the render thread. Each write is framed by a sequence number, odd
+// while writing, so a reader copies the whole window and retries if it
+// changed meanwhile.
+struct PerfPhase {
+	char		name[32];
+	std::atomic<uint32_t> seq;
+	std::atomic<float> ms[PERF_WINDOW];	// ring of recent samples
+	std::atomic<int> next, count;
+};
+
+// Event slots are published the same way, seq = 2n+2 once event n is
+// written, so the trace skips slots being written or overwritten.
+struct PerfEvent {
+	std::atomic<uint64_t> seq;
+	std::atomic<uint64_t> t0, t1;		// ns
+	std::atomic<uint32_t> id, tid;
+};
+
+#define PERF_READ_TRIES		8
+
+static PerfPhase	g_phases[PERF_MAX_PHASES];
+static std::atomic<int> g_num_phases (0);
+static std::mutex	g_register_mutex;
+
+static PerfEvent	g_events[PERF_TRACE_MAX];
+static std::atomic<uint64_t> g_num_events (0);
+
+struct PerfMark {
+	const char*	name;					// static string
+	uint64_t	t;						// ns
+};
+static PerfMark		g_marks[PERF_STARTUP_MAX];
+static int			g_num_marks = 0;
+
+static std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+uint64_t PerfNow ()
+{
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - g_epoch ).count();
+}
+
+int PerfRegister ( const char* name )
+{
+	std::lock_guard<std::mutex> lock ( g_register_mutex );
+	int n = g_num_phases;
+	for (int i = 0; i < n; i++)
+		if ( strcmp ( g_phases[i].name, name ) == 0 ) return i;
+	if ( n >= PERF_MAX_PHASES ) {
+		dbgprintf ( "WARNING: Too many perf phases, %s not timed.\n", name );
+		return -1;
+	}
+	PerfPhase& p = g_phases[n];
+	strncpy ( p.name, name, sizeof(p.name)-1 );
+	p.name[ sizeof(p.name)-1 ] = '\0';
+	p.next.store ( 0, std::memory_order_relaxed );
+	p.count.store ( 0, std::memory_order_relaxed );
+	g_num_phases = n + 1;
+	return n;
+}
+
+// Phase stats are updated by the thread that owns the phase. The event ring
+// is shared, slots are claimed with an atomic counter.
+void PerfRecord ( int id, uint64_t t0, uint64_t t1 )
+{
+	if ( id < 0 ) return;
+	PerfPhase& p = g_phases[id];
+	uint32_t seq = p.seq.load ( std::memory_order_relaxed );
+	p.seq.store ( seq + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence ( std::memory_order_release );
+	int next = p.next.load ( std::memory_order_relaxed );
+	int count = p.count.load ( std::memory_order_relaxed );
+	p.ms[next].store ( (t1 - t0) * 1e-6f, std::memory_order_relaxed );
+	p.next.store ( (next + 1) % PERF_WINDOW, std::memory_order_relaxed );
+	if ( count < PERF_WINDOW ) p.count.store ( count + 1, std::memory_order_relaxed );
+	p.seq.store ( seq + 2, std::memory_order_release );
+
+	static thread_local uint32_t tid = (uint32_t) std::hash<std::thread::id>()( std::this_thread::get_id() );
+	uint64_t n = g_num_events.fetch_add ( 1 );
+	PerfEvent& e = g_events[ n % PERF_TRACE_MAX ];
+	e.seq.store ( 2*n + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence ( std::memory_order_release );
+	e.t0.store ( t0, std::memory_order_relaxed );
+	e.t1.store ( t1, std::memory_order_relaxed );
+	e.id.store ( id, std::memory_order_relaxed );
+	e.tid.store ( tid, std::memory_order_relaxed );
+	e.seq.store ( 2*n + 2, std::memory_order_release );
+}
+
+int PerfNumPhases ()
+{
+	return g_num_phases;
+}
+
+const char* PerfName ( int id )
+{
+	return g_phases[id].name;
+}
+
+// Copy of the window, retried while the owner writes. False if it never
+// settled, the HUD keeps its last stats then.
+static int PerfSnapshot ( PerfPhase& p, float* s )
+{
+	for (int t = 0; t < PERF_READ_TRIES; t++) {
+		uint32_t seq = p.seq.load ( std::memory_order_acquire );
+		if ( seq & 1 ) { std::this_thread::yield(); continue; }
+		int count = p.count.load ( std::memory_order_relaxed );
+		for (int i = 0; i < count; i++) s[i] = p.ms[i].load ( std::memory_order_relaxed );
+		std::atomic_thread_fence ( std::memory_order_acquire );
+		if ( p.seq.load ( std::memory_order_relaxed ) == seq ) return count;
+	}
+	return -1;
+}
+
+bool PerfGetStats ( int id, PerfStats& st )
+{
+	float s[PERF_WINDOW];
+	int count = PerfSnapshot ( g_phases[id], s );
+	st.samples = count > 0 ? count : 0;
+	if ( count <= 0 ) {
+		st.min = st.mean = st.p99 = 0;
+		return false;
+	}
+	int k = (int) (count * 0.99f);
+	if ( k >= count ) k = count - 1;
+	std::nth_element ( s, s + k, s + count );
+	st.p99 = s[k];
+	st.min = s[0];
+	double sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += s[i];
+		if ( s[i] < st.min ) st.min = s[i];
+	}
+	st.mean = (float) (sum / count);
+	return true;
+}
+
+bool PerfWriteTrace ( const char* fname )
+{
+	FILE* fp = fopen ( fname, "wt" );
+	if ( fp == 0x0 ) {
+		dbgprintf ( "ERROR: Unable to write trace %s\n", fname );
+		return false;
+	}
+	uint64_t end = g_num_events;
+	uint64_t start = (end > PERF_TRACE_MAX) ? end - PERF_TRACE_MAX : 0;
+
+	int written = 0;
+	fprintf ( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+	for (uint64_t n = start; n < end; n++) {
+		// skip slots still being written, or overwritten since end was read
+		PerfEvent& e = g_events[ n % PERF_TRACE_MAX ];
+		uint64_t seq = e.seq.load ( std::memory_order_acquire );
+		if ( seq != 2*n + 2 ) continue;
+		uint64_t t0 = e.t0.load ( std::memory_order_relaxed );
+		uint64_t t1 = e.t1.load ( std::memory_order_relaxed );
+		uint32_t id = e.id.load ( std::memory_order_relaxed );
+		uint32_t tid = e.tid.load ( std::memory_order_relaxed );
+		std::atomic_thread_fence ( std::memory_order_acquire );
+		if ( e.seq.load ( std::memory_order_relaxed ) != seq ) continue;
+		fprintf ( fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			written ? "," : "", g_phases[id].name, tid, t0 * 1e-3, (t1 - t0) * 1e-3 );
+		written++;
+	}
+	fprintf ( fp, "\n]}\n" );
+	fclose ( fp );
+	dbgprintf ( "Wrote %d trace events to %s\n", written, fname );
+	return true;
+}
+
+void PerfReset ()
+{
+	int n = g_num_phases;
+	for (int i = 0; i < n; i++) {
+		PerfPhase& p = g_phases[i];
+		uint32_t seq = p.seq.load ( std::memory_order_relaxed );
+		p.seq.store ( seq + 1, std::memory_order_relaxed );
+		std::atomic_thread_fence ( std::memory_order_release );
+		p.next.store ( 0, std::memory_order_relaxed );
+		p.count.store ( 0, std::memory_order_relaxed );
+		p.seq.store ( seq + 2, std::memory_order_release );
+	}
+	g_num_events = 0;
+}
+
+// Main thread only, during startup
+void PerfStartupMark ( const char* name )
+{
+	if ( g_num_marks >= PERF_STARTUP_MAX ) return;
+	g_marks[g_num_marks].name = name;
+	g_marks[g_num_marks].t = PerfNow ();
+	g_num_marks++;
+}
+
+int PerfStartupReport ( char* buf, int size )
+{
+	uint64_t total = g_num_marks ? g_marks[g_num_marks-1].t : 0;
+	int len = snprintf ( buf, size, "startup %.1f ms:", total * 1e-6 );
+	uint64_t prev = 0;
+	for (int n = 0; n < g_num_marks && len < size; n++) {
+		len += snprintf ( buf + len, size - len, "%s %s %.1f", n ? "," : "", g_marks[n].name, (g_marks[n].t - prev) * 1e-6 );
+		prev = g_marks[n].t;
+	}
+	return len < size ? len : size - 1;
+}
@@ -0,0 +1,65 @@
+//--------------------------------------------------------
+//
+// Perf timer - scoped phase timers with rolling stats and trace export
+//
+// PERF_SCOPE("name") times the enclosing scope. Each named phase keeps the
+// last PERF_WINDOW samples for min / mean / p99, and every sample is also
+// kept in a ring of trace events that can be written as Chrome trace JSON
+// (chrome://tracing, Perfetto). Stats and the trace can be read from any
+// thread while phases are recorded; samples and events are published with
+// sequence numbers, so readers never see one half written.
+// Startup marks time the phases of app start, from the timer's static init
+// just before main, and are always compiled in; they are set once.
+// Timers are compiled in with PERF_TIMERS (cmake BUILD_PERF_TIMERS). Without
+// it PERF_SCOPE is empty and the stats functions report no phases.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_PERF_TIMER
+	#define DEF_PERF_TIMER
+
+	#include <stdint.h>
+
+	#define PERF_MAX_PHASES		32
+	#define PERF_WINDOW			240			// samples per phase for rolling stats
+	#define PERF_TRACE_MAX		65536		// trace events kept (ring)
+	#define PERF_STARTUP_MAX	16			// startup marks
+
+	struct PerfStats {
+		float		min, mean, p99;			// ms
+		int			samples;
+	};
+
+	uint64_t	PerfNow ();									// ns, steady clock
+	int			PerfRegister ( const char* name );			// phase id, same id for the same name
+	void		PerfRecord ( int id, uint64_t t0, uint64_t t1 );
+	int			PerfNumPhases ();
+	const char*	PerfName ( int id );
+	bool		PerfGetStats ( int id, PerfStats& st );
+	bool		PerfWriteTrace ( const char* fname );		// Chrome trace JSON of the event ring
+	void		PerfReset ();
+
+	void		PerfStartupMark ( const char* name );		// end of a startup phase, now
+	int			PerfStartupReport ( char* buf, int size );	// "startup NNN ms: name N ms, ...", length
+
+	#ifdef PERF_TIMERS
+
+		struct PerfScope {
+			PerfScope ( int id ) : m_id(id), m_t0 ( PerfNow() )	{}
+			~PerfScope ()										{ PerfRecord ( m_id, m_t0, PerfNow() ); }
+			int			m_id;
+			uint64_t	m_t0;
+		};
+
+		#define PERF_CAT2(a,b)		a##b
+		#define PERF_CAT(a,b)		PERF_CAT2(a,b)
+		#define PERF_SCOPE(name)	static const int PERF_CAT(perf_id_,__LINE__) = PerfRegister ( name ); \
+									PerfScope PERF_CAT(perf_scope_,__LINE__) ( PERF_CAT(perf_id_,__LINE__) )
+	#else
+		#define PERF_SCOPE(name)
+	#endif
+
+#endif
@@ -0,0 +1,343 @@
+//--------------------------------------------------------
+//
+// Physics thread - steps the flight model at a fixed rate on its own thread
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "physics_thread.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include "fleet_sched.h"
+#include "net_sync.h"
+#include "perf_timer.h"
+#include "common_defs.h"
+#include <chrono>
+#include <algorithm>
+
+PhysicsThread::PhysicsThread ()
+{
+	m_model = 0x0;
+	m_terrain = 0x0;
+	m_player = 0;
+	m_dt = 0.001;
+	m_running = true;
+	m_realtime = true;
+	m_scale = 1;
+	m_sched = 0x0;
+	m_net = 0x0;
+	m_wind = 0x0;
+	m_roll = 0; m_pitch = 0; m_power = 0; m_flaps = 0;
+	m_focus_x = 0; m_focus_z = 0;
+	m_step = 0;
+	m_focus_step = 0;
+	m_time = 0;
+	m_next = 0;
+	m_rewind_head = 0; m_rewind_count = 0; m_rewind_steps = 0;
+	m_sent = 0;
+	m_applied = 0;
+	m_quit = false;
+}
+
+int64_t PhysicsThread::Now ()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void PhysicsThread::Start ( FlightModel* model, int player, float dt, Terrain* terrain, const char* rec_name )
+{
+	Stop ();
+	m_model = model;
+	m_model->setAutopilot ( &m_autopilot );
+	m_model->setBroadphase ( &m_contacts );
+	m_contacts.Clear ();
+	m_contacts.RemoveQueue ( &m_contact_hud );
+	m_contacts.AddQueue ( &m_contact_hud );
+	m_player = player;
+	m_dt = dt;
+	m_terrain = terrain;
+	m_rec_name = rec_name;
+	m_sched = new FleetScheduler ( std::max ( 1, (int) std::thread::hardware_concurrency() - 1 ) );		// leave a core for rendering
+	m_step = 0;
+	m_focus_step = 0;
+	m_time = 0;
+	m_sent = 0;
+	m_applied = 0;
+	m_quit = false;
+
+	Vec3F p = m_model->getPos ( player );
+	m_focus_x = p.x; m_focus_z = p.z;
+	m_next = Now ();
+	Publish ( m_next, p, m_model->getOrient ( player ) );		// valid before the first step
+	m_model->SaveState ( player, m_rewind[0] );					// rewind as far as the start
+	m_rewind_head = 1; m_rewind_count = 1; m_rewind_steps = 0;
+
+	m_thread = std::thread ( &PhysicsThread::Loop, this );
+}
+
+void PhysicsThread::Stop ()
+{
+	if ( !m_thread.joinable() ) return;
+	m_quit = true;
+	m_thread.join ();
+	m_rec.Close ();
+	m_tel.Close ();
+	m_contacts.RemoveQueue ( m_tel.getContactQueue() );
+	m_model->setBroadphase ( 0x0 );
+	delete m_sched;
+	m_sched = 0x0;
+}
+
+void PhysicsThread::Send ( int type, float a, float b, float c, float d )
+{
+	PhysicsCmd cmd;
+	cmd.type = type;
+	cmd.seq = ++m_sent;
+	cmd.a = a; cmd.b = b; cmd.c = c; cmd.d = d;
+	while ( !m_cmds.Push ( cmd ) )		// full only if the physics thread is stalled
+		std::this_thread::yield ();
+}
+
+void PhysicsThread::Sync ()
+{
+	if ( !m_thread.joinable() ) return;
+	while ( m_applied.load ( std::memory_order_acquire ) != m_sent )
+		std::this_thread::yield ();
+}
+
+void PhysicsThread::Loop ()
+{
+	int64_t max_lag = (int64_t) (PHYS_MAX_LAG * 1e9);
+	int64_t publish_ns = (int64_t) (PHYS_PUBLISH * 1e9);
+	PhysicsCmd c;
+
+	while ( !m_quit.load ( std::memory_order_relaxed ) ) {
+
+		while ( m_cmds.Pop ( c ) ) {
+			Execute ( c );
+			m_applied.store ( c.seq, std::memory_order_release );
+		}
+
+		if ( m_running && m_realtime ) {
+			int64_t dt_ns = std::max ( (int64_t) 1, (int64_t) (m_dt * 1e9 / m_scale) );
+			int64_t now = Now ();
+			if ( now - m_next > max_lag ) m_next = now;		// long hitch, or faster than the CPU, dont try to catch up
+			int64_t publish_by = now + publish_ns;
+			for (int k = 1; m_next <= now; k++) {
+				int64_t due = m_next;
+				m_next += dt_ns;
+				bool last = ( m_next > now ) || ( k % PHYS_CHECK_STEPS == 0 && Now() > publish_by );
+				Step ( due, last );
+				if ( last ) break;							// more due, but show this one first
+			}
+			std::this_thread::sleep_until ( std::chrono::steady_clock::time_point ( std::chrono::nanoseconds ( m_next ) ) );
+		} else {
+			std::this_thread::sleep_for ( std::chrono::milliseconds ( 1 ) );
+		}
+	}
+}
+
+void PhysicsThread::Execute ( const PhysicsCmd& c )
+{
+	switch ( c.type ) {
+	case PHYS_CONTROLS:
+		m_roll = c.a; m_pitch = c.b; m_power = c.c; m_flaps = c.d;
+		break;
+	case PHYS_RUN:
+		m_running = (c.a != 0);
+		m_next = Now ();					// dont count paused time
+		break;
+	case PHYS_REALTIME:
+		m_realtime = (c.a != 0);
+		m_next = Now ();
+		break;
+	case PHYS_STEP:
+		if ( m_running && !m_realtime ) {
+			int n = std::max ( 1, (int) m_scale );
+			for (int k = 1; k <= n; k++) Step ( Now(), k == n );
+		}
+		break;
+	case PHYS_RECORD:
+		if ( c.a != 0 && !m_rec.isOpen() ) {
+			m_rec.Open ( m_rec_name.c_str(), m_dt );
+		} else if ( c.a == 0 && m_rec.isOpen() ) {
+			dbgprintf ( "Recorded %u steps.\n", m_rec.getNumRecords() );
+			m_rec.Close ();
+		}
+		break;
+	case PHYS_FOCUS:
+		m_focus_x = c.a; m_focus_z = c.b;
+		break;
+	case PHYS_TRAFFIC:
+		AddTraffic ( (int) c.a );
+		break;
+	case PHYS_SCALE:
+		m_scale = std::min ( std::max ( c.a, 1.0f ), (float) PHYS_MAX_SCALE );
+		m_next = Now ();
+		break;
+	case PHYS_TURBULENCE:
+		if ( m_wind ) m_wind->setTurbulence ( std::max ( c.a, 0.0f ) );
+		break;
+	case PHYS_REWIND:
+		Rewind ( c.a );
+		break;
+	case PHYS_TELEMETRY:
+		if ( c.a != 0 && !m_tel.isOpen() ) {
+			if ( m_tel.Open ( PHYS_TELEMETRY_FILE, PHYS_TELEMETRY_EVERY, 1, TEL_ALL, false ) )
+				m_contacts.AddQueue ( m_tel.getContactQueue() );
+		} else if ( c.a == 0 && m_tel.isOpen() ) {
+			m_contacts.RemoveQueue ( m_tel.getContactQueue() );
+			m_tel.Close ();
+			dbgprintf ( "Telemetry: %llu rows, %d batches, %llu contact events.\n", (unsigned long long) m_tel.getRows(), m_tel.getBatches(),
+				(unsigned long long) m_tel.getEvents() );
+		}
+		break;
+	case PHYS_AUTOPILOT:
+		if ( c.a != 0 ) {
+			m_autopilot.HoldCurrent ( *m_model, m_player );
+		} else {
+			m_autopilot.Disengage ( m_player );
+			m_power = m_model->m_power[m_player];		// manual from where the autopilot left it
+		}
+		break;
+	};
+}
+
+// Traffic gets the player's altitude and velocity, in world-aligned rows of
+// PHYS_TRAFFIC_ROW on the -z side of it, and holds them on the autopilot
+void PhysicsThread::AddTraffic ( int n )
+{
+	FlightModel& m = *m_model;
+	Vec3F p = m.getPos ( m_player ), v = m.getVel ( m_player );
+	int first = m.getNumAircraft ();
+	for (int k = first; k < first + n; k++) {
+		float dx = ((k % PHYS_TRAFFIC_ROW) - PHYS_TRAFFIC_ROW/2) * PHYS_TRAFFIC_SPACING;
+		float dz = (k / PHYS_TRAFFIC_ROW + 1) * PHYS_TRAFFIC_SPACING;
+		m.AddAircraft ( p + Vec3F(dx, 0, -dz), v, m_power );
+		m_autopilot.HoldCurrent ( m, k );
+	}
+}
+
+// Back to the kept state sec ago, or the oldest kept. Later states are
+// dropped, so rewinding again goes further back.
+void PhysicsThread::Rewind ( float sec )
+{
+	if ( m_rewind_count == 0 ) return;
+	int n = std::min ( (int) (sec / PHYS_REWIND_EVERY + 0.5f), m_rewind_count - 1 );
+	m_rewind_head = (m_rewind_head - n + PHYS_REWIND_SLOTS) % PHYS_REWIND_SLOTS;
+	m_rewind_count -= n;
+	m_rewind_steps = 0;
+
+	const FlightState& s = m_rewind[ (m_rewind_head - 1 + PHYS_REWIND_SLOTS) % PHYS_REWIND_SLOTS ];
+	FlightModel& m = *m_model;
+	Vec3F prev_pos = m.getPos ( m_player );
+	Quaternion prev_orient = m.getOrient ( m_player );
+	m.RestoreState ( m_player, s );
+	m_next = Now ();
+	Publish ( m_next, prev_pos, prev_orient );			// shown even when paused
+}
+
+void PhysicsThread::Step ( int64_t due, bool publish )
+{
+	PERF_SCOPE ( "Step" );
+	FlightModel& m = *m_model;
+	int i = m_player;
+	Vec3F prev_pos = m.getPos ( i );
+	Quaternion prev_orient = m.getOrient ( i );
+
+	if ( m_autopilot.getMode ( i ) == 0 )	m.setControls ( i, m_roll, m_pitch, m_power, m_flaps );
+	else									m.setControls ( i, m.m_roll[i], m.m_pitch[i], m.m_power[i], m_flaps );		// flaps stay manual
+	{
+		PERF_SCOPE ( "Advance" );
+		m.Advance ( m_dt, m_sched );
+	}
+	m_step++;
+	m_time += m_dt;
+	if ( m_net ) {
+		PERF_SCOPE ( "Net sync" );
+		m_net->Update ( m, m_dt );
+	}
+	{
+		PERF_SCOPE ( "Telemetry" );
+		m_tel.Capture ( m );
+	}
+
+	if ( m_rec.isOpen() ) {
+		Vec3F p = m.getPos ( i ), v = m.getVel ( i );
+		Quaternion q = m.getOrient ( i );
+		FlightRecord r;
+		r.step = m_rec.getNumRecords ();
+		r.time = m_time;
+		r.pos[0] = p.x;		r.pos[1] = p.y;		r.pos[2] = p.z;
+		r.vel[0] = v.x;		r.vel[1] = v.y;		r.vel[2] = v.z;
+		r.orient[0] = q.X;	r.orient[1] = q.Y;	r.orient[2] = q.Z;	r.orient[3] = q.W;
+		r.roll = m.m_roll[i];	r.pitch = m.m_pitch[i];	r.power = m.m_power[i];	r.flaps = m_flaps;
+		m_rec.Append ( r );
+	}
+
+	if ( ++m_rewind_steps * m_dt >= PHYS_REWIND_EVERY - 0.5f*m_dt ) {
+		m.SaveState ( i, m_rewind[m_rewind_head] );
+		m_rewind_head = (m_rewind_head + 1) % PHYS_REWIND_SLOTS;
+		m_rewind_count = std::min ( m_rewind_count + 1, PHYS_REWIND_SLOTS );
+		m_rewind_steps = 0;
+	}
+
+	// Page terrain in around the camera and aircraft. Skipped while the
+	// renderer is reading tiles, and tried again next step.
+	if ( m_terrain && m_terrain->isOpen() && m_step >= m_focus_step ) {
+		float fx[2] = { m_focus_x, m.getPos(i).x }, fz[2] = { m_focus_z, m.getPos(i).z };
+		if ( m_terrain->UpdateFocus ( 2, fx, fz, PHYS_FOCUS_RADIUS ) )
+			m_focus_step = m_step + PHYS_FOCUS_STEPS;
+	}
+	// Wind tiles are made in the background, never waited on here
+	if ( m_wind && m_wind->isOpen() && m_step % PHYS_FOCUS_STEPS == 0 )
+		m_wind->UpdateFocus ( m.getNumAircraft(), m.m_px.data(), m.m_pz.data(), PHYS_WIND_RADIUS );
+
+	if ( publish ) Publish ( due, prev_pos, prev_orient );
+}
+
+void PhysicsThread::Publish ( int64_t due, Vec3F prev_pos, Quaternion prev_orient )
+{
+	FlightModel& m = *m_model;
+	int i = m_player;
+	FlightSnapshot& s = m_snap.Back ();
+
+	s.step = m_step;
+	s.time = m_time;
+	s.wall = due;
+	s.running = m_running;
+	s.realtime = m_realtime;
+	s.scale = m_scale;
+	s.recording = m_rec.isOpen ();
+	s.rec_steps = m_rec.isOpen() ? m_rec.getNumRecords() : 0;
+	s.pos = m.getPos ( i );
+	s.vel = m.getVel ( i );
+	s.prev_pos = prev_pos;
+	s.orient = m.getOrient ( i );
+	s.prev_orient = prev_orient;
+	s.lift = m.getLift ( i );
+	s.drag = m.getDrag ( i );
+	s.thrust = m.getThrust ( i );
+	s.speed = m.m_speed[i];
+	s.aoa = m.m_aoa[i];
+	s.ground = m.m_ground[i];
+	s.autopilot = ( m_autopilot.getMode ( i ) != 0 );
+	s.telemetry = m_tel.isOpen ();
+	s.contacts = m_contacts.getActivePairs ();
+	s.roll = m.m_roll[i]; s.pitch = m.m_pitch[i]; s.power = m.m_power[i]; s.flaps = m_flaps;
+	m.getLanding ( i, s.land );
+
+	int n = m.getNumAircraft ();
+	s.num = n;
+	s.px.assign ( m.m_px.begin(), m.m_px.begin() + n );
+	s.py.assign ( m.m_py.begin(), m.m_py.begin() + n );
+	s.pz.assign ( m.m_pz.begin(), m.m_pz.begin() + n );
+	s.qx.assign ( m.m_qx.begin(), m.m_qx.begin() + n );
+	s.qy.assign ( m.m_qy.begin(), m.m_qy.begin() + n );
+	s.qz.assign ( m.m_qz.begin(), m.m_qz.begin() + n );
+	s.qw.assign ( m.m_qw.begin(), m.m_qw.begin() + n );
+
+	m_snap.Publish ();
+}
@@ -0,0 +1,181 @@
+//--------------------------------------------------------
+//
+// Physics thread - steps the flight model at a fixed rate on its own thread
+//
+// The physics thread owns the model once started. After every step it
+// publishes a FlightSnapshot of the player aircraft through a triple buffer,
+// which the render thread reads without blocking. Inputs go the other way
+// as PhysicsCmd entries through an SPSC queue, applied before the next step.
+// A render hitch never delays a step, and a slow step never holds up a
+// frame; the renderer just shows the latest snapshot.
+//
+// In realtime mode steps are paced to the wall clock, one every dt. A hitch
+// longer than PHYS_MAX_LAG is dropped rather than caught up. Otherwise the
+// thread steps once per PHYS_STEP command, the renderer sends one a frame.
+//
+// Fast time (PHYS_SCALE) runs scale steps per dt of wall clock, or scale
+// steps per PHYS_STEP. Only the last step of a batch is published, and at
+// least every PHYS_PUBLISH sec while catching up, so a frame costs one
+// snapshot however many steps it covers. Fleets are stepped on a scheduler.
+// The flight recorder, terrain and wind tile paging and net sync run here
+// too, between steps.
+//
+// The player's FlightState is kept every PHYS_REWIND_EVERY sec of flight in
+// a ring, so PHYS_REWIND can put the aircraft back to where it was up to
+// PHYS_REWIND_SLOTS of those ago. The rest of the fleet flies on.
+//
+// Traffic is flown by the autopilot, holding the altitude, heading and speed
+// it was added with. PHYS_AUTOPILOT does the same for the player, whose
+// controls are then the autopilot's and are published in the snapshot.
+//
+// PHYS_TELEMETRY streams the whole fleet to PHYS_TELEMETRY_FILE as Arrow
+// columns, every PHYS_TELEMETRY_EVERY steps. Samples are dropped rather
+// than waited for if the writer falls behind.
+//
+// Near misses and collisions between aircraft are found by a broadphase
+// after every step (broadphase.h). Its events go to the render thread
+// through getContacts, a lock-free queue, and to telemetry while streaming.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_PHYSICS_THREAD
+	#define DEF_PHYSICS_THREAD
+
+	#include <stdint.h>
+	#include <atomic>
+	#include <thread>
+	#include <string>
+	#include "flight_model.h"
+	#include "flight_recorder.h"
+	#include "autopilot.h"
+	#include "telemetry.h"
+	#include "broadphase.h"
+	#include "triple_buffer.h"
+	#include "spsc_queue.h"
+
+	class Terrain;
+	class WindField;
+	class FleetScheduler;
+	class NetSync;
+
+	#define PHYS_CONTROLS		0		// a..d = roll, pitch, power, flaps
+	#define PHYS_RUN			1		// a = 1 run, 0 pause
+	#define PHYS_REALTIME		2		// a = 1 wall-clock paced, 0 one step per PHYS_STEP
+	#define PHYS_STEP			3		// one step, when not realtime
+	#define PHYS_RECORD			4		// a = 1 start recording, 0 stop
+	#define PHYS_FOCUS			5		// a, b = camera x, z, for terrain paging
+	#define PHYS_TRAFFIC		6		// a = aircraft to add around the player
+	#define PHYS_SCALE			7		// a = time scale, sim sec per wall sec (1 to PHYS_MAX_SCALE)
+	#define PHYS_TURBULENCE		8		// a = W20 (m/s), 0 = none
+	#define PHYS_REWIND			9		// a = sec of the player's flight to undo
+	#define PHYS_AUTOPILOT		10		// a = 1 hold the player's present altitude, heading and speed, 0 off
+	#define PHYS_TELEMETRY		11		// a = 1 start streaming telemetry, 0 stop
+
+	#define PHYS_QUEUE			256		// commands in flight
+	#define PHYS_MAX_LAG		0.25	// sec behind the wall clock before time is dropped
+	#define PHYS_MAX_SCALE		1000	// fastest time scale
+	#define PHYS_PUBLISH		0.004	// sec between snapshots while catching up
+	#define PHYS_CHECK_STEPS	64		// steps between clock reads while catching up
+	#define PHYS_FOCUS_STEPS	16		// steps between terrain paging updates
+	#define PHYS_FOCUS_RADIUS	16000	// keep terrain tiles within this of the camera and aircraft (m)
+	#define PHYS_WIND_RADIUS	1500	// keep wind tiles within this of each aircraft (m)
+	#define PHYS_TRAFFIC_SPACING 100	// traffic grid spacing (m)
+	#define PHYS_TRAFFIC_ROW	32		// traffic aircraft abreast
+	#define PHYS_REWIND_EVERY	0.1		// sec of flight between rewind states
+	#define PHYS_REWIND_SLOTS	600		// rewind states kept, 60 sec at 0.1
+	#define PHYS_TELEMETRY_EVERY 10		// steps between telemetry samples, 100 Hz at 1 ms
+	#define PHYS_TELEMETRY_FILE	"flightsim_telemetry.arrows"
+
+	struct PhysicsCmd {
+		int			type;				// PHYS_
+		uint32_t	seq;
+		float		a, b, c, d;
+	};
+
+	// Player aircraft after a step, and positions of the whole fleet for drawing
+	struct FlightSnapshot {
+		uint64_t	step;
+		float		time;				// sim time (sec)
+		int64_t		wall;				// steady clock ns the step was due, for interpolation
+		bool		running, realtime, recording;
+		bool		autopilot;						// player flown by the autopilot
+		bool		telemetry;						// streaming
+		float		scale;							// time scale
+		uint32_t	rec_steps;
+		int			contacts;						// pairs of aircraft within the near-miss distance
+		Vec3F		pos, vel, prev_pos;
+		Quaternion	orient, prev_orient;
+		Vec3F		lift, drag, thrust;
+		float		speed, aoa, ground;
+		float		roll, pitch, power, flaps;		// controls the step used
+		LandingStatus land;
+		int			num;							// aircraft in the fleet arrays
+		FloatArray	px, py, pz, qx, qy, qz, qw;		// SoA, capacity kept between steps
+	};
+
+	class PhysicsThread {
+	public:
+		PhysicsThread ();
+		~PhysicsThread ()		{ Stop(); }
+
+		// Start stepping. The model and terrain belong to the thread until Stop.
+		void		Start ( FlightModel* model, int player, float dt, Terrain* terrain, const char* rec_name );
+		void		Stop ();
+		bool		isStarted ()		{ return m_thread.joinable(); }
+		void		setNet ( NetSync* net )	{ m_net = net; }		// before Start, updated after each step
+		void		setWind ( WindField* w )	{ m_wind = w; }		// before Start, already set on the model
+
+		// Render thread
+		void		Send ( int type, float a = 0, float b = 0, float c = 0, float d = 0 );
+		void		Sync ();							// wait until sent commands are applied
+		const FlightSnapshot& Read ()	{ m_snap.Update (); return m_snap.Front (); }
+		ContactQueue& getContacts ()	{ return m_contact_hud; }		// contact events, popped by the render thread
+
+		static int64_t	Now ();							// steady clock ns
+
+	private:
+		void		Loop ();
+		void		Execute ( const PhysicsCmd& c );
+		void		Step ( int64_t due, bool publish = true );
+		void		Publish ( int64_t due, Vec3F prev_pos, Quaternion prev_orient );
+		void		AddTraffic ( int n );
+		void		Rewind ( float sec );
+
+		FlightModel* m_model;
+		Terrain*	m_terrain;
+		int			m_player;
+		float		m_dt;
+
+		// physics thread only
+		bool		m_running, m_realtime;
+		float		m_scale;
+		FleetScheduler* m_sched;					// steps traffic in parallel, owned
+		NetSync*	m_net;							// multiplayer, not owned
+		WindField*	m_wind;							// turbulence, not owned
+		Autopilot	m_autopilot;					// set on the model while started
+		float		m_roll, m_pitch, m_power, m_flaps;
+		float		m_focus_x, m_focus_z;
+		uint64_t	m_step, m_focus_step;
+		float		m_time;
+		int64_t		m_next;							// steady clock ns the next realtime step is due
+		FlightRecorder m_rec;
+		TelemetrySink m_tel;
+		Broadphase	m_contacts;						// set on the model while started
+		ContactQueue m_contact_hud;
+		FlightState	m_rewind[PHYS_REWIND_SLOTS];	// ring of player states, newest at m_rewind_head-1
+		int			m_rewind_head, m_rewind_count;
+		int			m_rewind_steps;					// steps since the newest was kept
+		std::string	m_rec_name;
+
+		TripleBuffer<FlightSnapshot> m_snap;
+		SpscQueue<PhysicsCmd, PHYS_QUEUE> m_cmds;
+		uint32_t	m_sent;							// render thread only
+		std::atomic<uint32_t> m_applied;			// last seq applied
+		std::atomic<bool> m_quit;
+		std::thread	m_thread;
+	};
+
+#endif
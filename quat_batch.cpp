@@ -0,0 +1,366 @@
+//--------------------------------------------------------
+//
+// Quaternion batch - libmin Quaternion operations over arrays of quaternions
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "quat_batch.h"
+#include "cpu_features.h"
+#include "simd_math.h"
+#include <math.h>
+
+//---------------------------------------------------------------- Scalar, also remainders
+
+static void RotateScalar ( int j, int n, QuatSoA q, Vec3SoA v )
+{
+	for ( ; j < n; j++) {
+		float qx = q.x[j], qy = q.y[j], qz = q.z[j], qw = q.w[j];
+		float vx = v.x[j], vy = v.y[j], vz = v.z[j];
+		float ux = qy*vz - qz*vy, uy = qz*vx - qx*vz, uz = qx*vy - qy*vx;		// uv = q.xyz x v
+		float wx = qy*uz - qz*uy, wy = qz*ux - qx*uz, wz = qx*uy - qy*ux;		// uuv = q.xyz x uv
+		v.x[j] = vx + 2.0f*(qw*ux + wx);
+		v.y[j] = vy + 2.0f*(qw*uy + wy);
+		v.z[j] = vz + 2.0f*(qw*uz + wz);
+	}
+}
+
+static void BasisScalar ( int j, int n, QuatSoA q, Vec3SoA fwd, Vec3SoA up, Vec3SoA right )
+{
+	for ( ; j < n; j++) {
+		float qx = q.x[j], qy = q.y[j], qz = q.z[j], qw = q.w[j];
+		float xx = qx*qx, yy = qy*qy, zz = qz*qz;
+		float xy = qx*qy, xz = qx*qz, yz = qy*qz;
+		float wx = qw*qx, wy = qw*qy, wz = qw*qz;
+		if ( fwd.x ) {		fwd.x[j] = 1 - 2*(yy + zz);		fwd.y[j] = 2*(xy + wz);			fwd.z[j] = 2*(xz - wy); }
+		if ( up.x ) {		up.x[j] = 2*(xy - wz);			up.y[j] = 1 - 2*(xx + zz);		up.z[j] = 2*(yz + wx); }
+		if ( right.x ) {	right.x[j] = 2*(xz + wy);		right.y[j] = 2*(yz - wx);		right.z[j] = 1 - 2*(xx + yy); }
+	}
+}
+
+static void NormalizeScalar ( int j, int n, QuatSoA q )
+{
+	for ( ; j < n; j++) {
+		float len = sqrtf ( q.x[j]*q.x[j] + q.y[j]*q.y[j] + q.z[j]*q.z[j] + q.w[j]*q.w[j] );
+		q.x[j] /= len;	q.y[j] /= len;	q.z[j] /= len;	q.w[j] /= len;
+	}
+}
+
+static void ComposeScalar ( int j, int n, QuatSoA a, QuatSoA b )
+{
+	for ( ; j < n; j++) {
+		float ax = a.x[j], ay = a.y[j], az = a.z[j], aw = a.w[j];
+		float bx = b.x[j], by = b.y[j], bz = b.z[j], bw = b.w[j];
+		a.w[j] = bw*aw - bx*ax - by*ay - bz*az;
+		a.x[j] = bw*ax + bx*aw + by*az - bz*ay;
+		a.y[j] = bw*ay + by*aw + bz*ax - bx*az;
+		a.z[j] = bw*az + bz*aw + bx*ay - by*ax;
+	}
+}
+
+static void FromAngleAxisScalar ( int j, int n, const float* angle, Vec3SoA axis, QuatSoA q )
+{
+	for ( ; j < n; j++) {
+		float s = sinf ( angle[j]*0.5f );
+		q.w[j] = cosf ( angle[j]*0.5f );
+		q.x[j] = axis.x[j]*s;	q.y[j] = axis.y[j]*s;	q.z[j] = axis.z[j]*s;
+	}
+}
+
+static void FromToScalar ( int j, int n, Vec3SoA from, Vec3SoA to, float frac, QuatSoA q )
+{
+	for ( ; j < n; j++) {
+		float fx = from.x[j], fy = from.y[j], fz = from.z[j];
+		float tx = to.x[j], ty = to.y[j], tz = to.z[j];
+		float cx = fy*tz - fz*ty, cy = fz*tx - fx*tz, cz = fx*ty - fy*tx;
+		float len = sqrtf ( cx*cx + cy*cy + cz*cz );
+		if ( !(len > 0) ) {
+			q.x[j] = 0;	q.y[j] = 0;	q.z[j] = 0;	q.w[j] = 1;
+			continue;
+		}
+		float d = fx*tx + fy*ty + fz*tz;
+		d = (d > 1) ? 1 : (d < -1) ? -1 : d;
+		float half = acosf ( d ) * frac * 0.5f;
+		float s = sinf ( half ) / len;
+		q.w[j] = cosf ( half );
+		q.x[j] = cx*s;	q.y[j] = cy*s;	q.z[j] = cz*s;
+	}
+}
+
+//---------------------------------------------------------------- AVX2
+#if defined(CPU_X86)
+
+static bool UseAVX2 ()
+{
+	static const bool avx2 = cpuHasAVX2 ();
+	return avx2;
+}
+
+SIMD_AVX2 static void RotateAVX2 ( int n8, QuatSoA q, Vec3SoA v )
+{
+	const __m256 two = _mm256_set1_ps ( 2.0f );
+	for (int j = 0; j < n8; j += 8) {
+		__m256 qx = _mm256_loadu_ps ( q.x+j ), qy = _mm256_loadu_ps ( q.y+j ), qz = _mm256_loadu_ps ( q.z+j ), qw = _mm256_loadu_ps ( q.w+j );
+		__m256 vx = _mm256_loadu_ps ( v.x+j ), vy = _mm256_loadu_ps ( v.y+j ), vz = _mm256_loadu_ps ( v.z+j );
+		__m256 ux = _mm256_fmsub_ps ( qy, vz, _mm256_mul_ps ( qz, vy ) );
+		__m256 uy = _mm256_fmsub_ps ( qz, vx, _mm256_mul_ps ( qx, vz ) );
+		__m256 uz = _mm256_fmsub_ps ( qx, vy, _mm256_mul_ps ( qy, vx ) );
+		__m256 wx = _mm256_fmsub_ps ( qy, uz, _mm256_mul_ps ( qz, uy ) );
+		__m256 wy = _mm256_fmsub_ps ( qz, ux, _mm256_mul_ps ( qx, uz ) );
+		__m256 wz = _mm256_fmsub_ps ( qx, uy, _mm256_mul_ps ( qy, ux ) );
+		_mm256_storeu_ps ( v.x+j, _mm256_fmadd_ps ( two, _mm256_fmadd_ps ( qw, ux, wx ), vx ) );
+		_mm256_storeu_ps ( v.y+j, _mm256_fmadd_ps ( two, _mm256_fmadd_ps ( qw, uy, wy ), vy ) );
+		_mm256_storeu_ps ( v.z+j, _mm256_fmadd_ps ( two, _mm256_fmadd_ps ( qw, uz, wz ), vz ) );
+	}
+}
+
+SIMD_AVX2 static void BasisAVX2 ( int n8, QuatSoA q, Vec3SoA fwd, Vec3SoA up, Vec3SoA right )
+{
+	const __m256 one = _mm256_set1_ps ( 1.0f );
+	const __m256 two = _mm256_set1_ps ( 2.0f );
+	for (int j = 0; j < n8; j += 8) {
+		__m256 qx = _mm256_loadu_ps ( q.x+j ), qy = _mm256_loadu_ps ( q.y+j ), qz = _mm256_loadu_ps ( q.z+j ), qw = _mm256_loadu_ps ( q.w+j );
+		__m256 xx = _mm256_mul_ps ( qx, qx ), yy = _mm256_mul_ps ( qy, qy ), zz = _mm256_mul_ps ( qz, qz );
+		__m256 xy = _mm256_mul_ps ( qx, qy ), xz = _mm256_mul_ps ( qx, qz ), yz = _mm256_mul_ps ( qy, qz );
+		__m256 wx = _mm256_mul_ps ( qw, qx ), wy = _mm256_mul_ps ( qw, qy ), wz = _mm256_mul_ps ( qw, qz );
+		if ( fwd.x ) {
+			_mm256_storeu_ps ( fwd.x+j, _mm256_fnmadd_ps ( two, _mm256_add_ps ( yy, zz ), one ) );
+			_mm256_storeu_ps ( fwd.y+j, _mm256_mul_ps ( two, _mm256_add_ps ( xy, wz ) ) );
+			_mm256_storeu_ps ( fwd.z+j, _mm256_mul_ps ( two, _mm256_sub_ps ( xz, wy ) ) );
+		}
+		if ( up.x ) {
+			_mm256_storeu_ps ( up.x+j, _mm256_mul_ps ( two, _mm256_sub_ps ( xy, wz ) ) );
+			_mm256_storeu_ps ( up.y+j, _mm256_fnmadd_ps ( two, _mm256_add_ps ( xx, zz ), one ) );
+			_mm256_storeu_ps ( up.z+j, _mm256_mul_ps ( two, _mm256_add_ps ( yz, wx ) ) );
+		}
+		if ( right.x ) {
+			_mm256_storeu_ps ( right.x+j, _mm256_mul_ps ( two, _mm256_add_ps ( xz, wy ) ) );
+			_mm256_storeu_ps ( right.y+j, _mm256_mul_ps ( two, _mm256_sub_ps ( yz, wx ) ) );
+			_mm256_storeu_ps ( right.z+j, _mm256_fnmadd_ps ( two, _mm256_add_ps ( xx, yy ), one ) );
+		}
+	}
+}
+
+SIMD_AVX2 static void NormalizeAVX2 ( int n8, QuatSoA q )
+{
+	for (int j = 0; j < n8; j += 8) {
+		__m256 qx = _mm256_loadu_ps ( q.x+j ), qy = _mm256_loadu_ps ( q.y+j ), qz = _mm256_loadu_ps ( q.z+j ), qw = _mm256_loadu_ps ( q.w+j );
+		__m256 len = _mm256_sqrt_ps ( _mm256_fmadd_ps ( qw, qw, _mm256_fmadd_ps ( qz, qz, _mm256_fmadd_ps ( qy, qy, _mm256_mul_ps ( qx, qx ) ) ) ) );
+		_mm256_storeu_ps ( q.x+j, _mm256_div_ps ( qx, len ) );
+		_mm256_storeu_ps ( q.y+j, _mm256_div_ps ( qy, len ) );
+		_mm256_storeu_ps ( q.z+j, _mm256_div_ps ( qz, len ) );
+		_mm256_storeu_ps ( q.w+j, _mm256_div_ps ( qw, len ) );
+	}
+}
+
+SIMD_AVX2 static void ComposeAVX2 ( int n8, QuatSoA a, QuatSoA b )
+{
+	for (int j = 0; j < n8; j += 8) {
+		__m256 ax = _mm256_loadu_ps ( a.x+j ), ay = _mm256_loadu_ps ( a.y+j ), az = _mm256_loadu_ps ( a.z+j ), aw = _mm256_loadu_ps ( a.w+j );
+		__m256 bx = _mm256_loadu_ps ( b.x+j ), by = _mm256_loadu_ps ( b.y+j ), bz = _mm256_loadu_ps ( b.z+j ), bw = _mm256_loadu_ps ( b.w+j );
+		_mm256_storeu_ps ( a.w+j, _mm256_fnmadd_ps ( bz, az, _mm256_fnmadd_ps ( by, ay, _mm256_fmsub_ps ( bw, aw, _mm256_mul_ps ( bx, ax ) ) ) ) );
+		_mm256_storeu_ps ( a.x+j, _mm256_fnmadd_ps ( bz, ay, _mm256_fmadd_ps ( by, az, _mm256_fmadd_ps ( bw, ax, _mm256_mul_ps ( bx, aw ) ) ) ) );
+		_mm256_storeu_ps ( a.y+j, _mm256_fnmadd_ps ( bx, az, _mm256_fmadd_ps ( bz, ax, _mm256_fmadd_ps ( bw, ay, _mm256_mul_ps ( by, aw ) ) ) ) );
+		_mm256_storeu_ps ( a.z+j, _mm256_fnmadd_ps ( by, ax, _mm256_fmadd_ps ( bx, ay, _mm256_fmadd_ps ( bw, az, _mm256_mul_ps ( bz, aw ) ) ) ) );
+	}
+}
+
+SIMD_AVX2 static void FromAngleAxisAVX2 ( int n8, const float* angle, Vec3SoA axis, QuatSoA q )
+{
+	const __m256 half = _mm256_set1_ps ( 0.5f );
+	for (int j = 0; j < n8; j += 8) {
+		__m256 h = _mm256_mul_ps ( _mm256_loadu_ps ( angle+j ), half );
+		__m256 s = avx_sin ( h );
+		_mm256_storeu_ps ( q.w+j, avx_cos ( h ) );
+		_mm256_storeu_ps ( q.x+j, _mm256_mul_ps ( _mm256_loadu_ps ( axis.x+j ), s ) );
+		_mm256_storeu_ps ( q.y+j, _mm256_mul_ps ( _mm256_loadu_ps ( axis.y+j ), s ) );
+		_mm256_storeu_ps ( q.z+j, _mm256_mul_ps ( _mm256_loadu_ps ( axis.z+j ), s ) );
+	}
+}
+
+SIMD_AVX2 static void FromToAVX2 ( int n8, Vec3SoA from, Vec3SoA to, float frac, QuatSoA q )
+{
+	const __m256 zero = _mm256_setzero_ps ();
+	const __m256 one = _mm256_set1_ps ( 1.0f );
+	const __m256 k = _mm256_set1_ps ( frac * 0.5f );
+	for (int j = 0; j < n8; j += 8) {
+		__m256 fx = _mm256_loadu_ps ( from.x+j ), fy = _mm256_loadu_ps ( from.y+j ), fz = _mm256_loadu_ps ( from.z+j );
+		__m256 tx = _mm256_loadu_ps ( to.x+j ), ty = _mm256_loadu_ps ( to.y+j ), tz = _mm256_loadu_ps ( to.z+j );
+		__m256 cx = _mm256_fmsub_ps ( fy, tz, _mm256_mul_ps ( fz, ty ) );
+		__m256 cy = _mm256_fmsub_ps ( fz, tx, _mm256_mul_ps ( fx, tz ) );
+		__m256 cz = _mm256_fmsub_ps ( fx, ty, _mm256_mul_ps ( fy, tx ) );
+		__m256 len = _mm256_sqrt_ps ( _mm256_fmadd_ps ( cz, cz, _mm256_fmadd_ps ( cy, cy, _mm256_mul_ps ( cx, cx ) ) ) );
+		__m256 d = _mm256_fmadd_ps ( fz, tz, _mm256_fmadd_ps ( fy, ty, _mm256_mul_ps ( fx, tx ) ) );
+		__m256 h = _mm256_mul_ps ( avx_acos ( d ), k );					// avx_acos clamps d to [-1,1]
+		__m256 rot = _mm256_cmp_ps ( len, zero, _CMP_GT_OQ );			// else parallel, identity
+		__m256 s = _mm256_and_ps ( _mm256_div_ps ( avx_sin ( h ), len ), rot );
+		_mm256_storeu_ps ( q.w+j, _mm256_blendv_ps ( one, avx_cos ( h ), rot ) );
+		_mm256_storeu_ps ( q.x+j, _mm256_mul_ps ( cx, s ) );
+		_mm256_storeu_ps ( q.y+j, _mm256_mul_ps ( cy, s ) );
+		_mm256_storeu_ps ( q.z+j, _mm256_mul_ps ( cz, s ) );
+	}
+}
+
+#endif
+
+//---------------------------------------------------------------- NEON
+#if defined(CPU_ARM64)
+
+static bool UseNEON ()
+{
+	static const bool neon = cpuHasNEON ();
+	return neon;
+}
+
+static void RotateNEON ( int n4, QuatSoA q, Vec3SoA v )
+{
+	for (int j = 0; j < n4; j += 4) {
+		float32x4_t qx = vld1q_f32 ( q.x+j ), qy = vld1q_f32 ( q.y+j ), qz = vld1q_f32 ( q.z+j ), qw = vld1q_f32 ( q.w+j );
+		float32x4_t vx = vld1q_f32 ( v.x+j ), vy = vld1q_f32 ( v.y+j ), vz = vld1q_f32 ( v.z+j );
+		float32x4_t ux = vfmsq_f32 ( vmulq_f32 ( qy, vz ), qz, vy );
+		float32x4_t uy = vfmsq_f32 ( vmulq_f32 ( qz, vx ), qx, vz );
+		float32x4_t uz = vfmsq_f32 ( vmulq_f32 ( qx, vy ), qy, vx );
+		float32x4_t wx = vfmsq_f32 ( vmulq_f32 ( qy, uz ), qz, uy );
+		float32x4_t wy = vfmsq_f32 ( vmulq_f32 ( qz, ux ), qx, uz );
+		float32x4_t wz = vfmsq_f32 ( vmulq_f32 ( qx, uy ), qy, ux );
+		vst1q_f32 ( v.x+j, vfmaq_n_f32 ( vx, vfmaq_f32 ( wx, qw, ux ), 2.0f ) );
+		vst1q_f32 ( v.y+j, vfmaq_n_f32 ( vy, vfmaq_f32 ( wy, qw, uy ), 2.0f ) );
+		vst1q_f32 ( v.z+j, vfmaq_n_f32 ( vz, vfmaq_f32 ( wz, qw, uz ), 2.0f ) );
+	}
+}
+
+static void BasisNEON ( int n4, QuatSoA q, Vec3SoA fwd, Vec3SoA up, Vec3SoA right )
+{
+	const float32x4_t one = vdupq_n_f32 ( 1.0f );
+	const float32x4_t two = vdupq_n_f32 ( 2.0f );
+	for (int j = 0; j < n4; j += 4) {
+		float32x4_t qx = vld1q_f32 ( q.x+j ), qy = vld1q_f32 ( q.y+j ), qz = vld1q_f32 ( q.z+j ), qw = vld1q_f32 ( q.w+j );
+		float32x4_t xx = vmulq_f32 ( qx, qx ), yy = vmulq_f32 ( qy, qy ), zz = vmulq_f32 ( qz, qz );
+		float32x4_t xy = vmulq_f32 ( qx, qy ), xz = vmulq_f32 ( qx, qz ), yz = vmulq_f32 ( qy, qz );
+		float32x4_t wx = vmulq_f32 ( qw, qx ), wy = vmulq_f32 ( qw, qy ), wz = vmulq_f32 ( qw, qz );
+		if ( fwd.x ) {
+			vst1q_f32 ( fwd.x+j, vfmsq_f32 ( one, two, vaddq_f32 ( yy, zz ) ) );
+			vst1q_f32 ( fwd.y+j, vmulq_f32 ( two, vaddq_f32 ( xy, wz ) ) );
+			vst1q_f32 ( fwd.z+j, vmulq_f32 ( two, vsubq_f32 ( xz, wy ) ) );
+		}
+		if ( up.x ) {
+			vst1q_f32 ( up.x+j, vmulq_f32 ( two, vsubq_f32 ( xy, wz ) ) );
+			vst1q_f32 ( up.y+j, vfmsq_f32 ( one, two, vaddq_f32 ( xx, zz ) ) );
+			vst1q_f32 ( up.z+j, vmulq_f32 ( two, vaddq_f32 ( yz, wx ) ) );
+		}
+		if ( right.x ) {
+			vst1q_f32 ( right.x+j, vmulq_f32 ( two, vaddq_f32 ( xz, wy ) ) );
+			vst1q_f32 ( right.y+j, vmulq_f32 ( two, vsubq_f32 ( yz, wx ) ) );
+			vst1q_f32 ( right.z+j, vfmsq_f32 ( one, two, vaddq_f32 ( xx, yy ) ) );
+		}
+	}
+}
+
+static void NormalizeNEON ( int n4, QuatSoA q )
+{
+	for (int j = 0; j < n4; j += 4) {
+		float32x4_t qx = vld1q_f32 ( q.x+j ), qy = vld1q_f32 ( q.y+j ), qz = vld1q_f32 ( q.z+j ), qw = vld1q_f32 ( q.w+j );
+		float32x4_t len = vsqrtq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( qx, qx ), qy, qy ), qz, qz ), qw, qw ) );
+		vst1q_f32 ( q.x+j, vdivq_f32 ( qx, len ) );
+		vst1q_f32 ( q.y+j, vdivq_f32 ( qy, len ) );
+		vst1q_f32 ( q.z+j, vdivq_f32 ( qz, len ) );
+		vst1q_f32 ( q.w+j, vdivq_f32 ( qw, len ) );
+	}
+}
+
+static void ComposeNEON ( int n4, QuatSoA a, QuatSoA b )
+{
+	for (int j = 0; j < n4; j += 4) {
+		float32x4_t ax = vld1q_f32 ( a.x+j ), ay = vld1q_f32 ( a.y+j ), az = vld1q_f32 ( a.z+j ), aw = vld1q_f32 ( a.w+j );
+		float32x4_t bx = vld1q_f32 ( b.x+j ), by = vld1q_f32 ( b.y+j ), bz = vld1q_f32 ( b.z+j ), bw = vld1q_f32 ( b.w+j );
+		vst1q_f32 ( a.w+j, vfmsq_f32 ( vfmsq_f32 ( vfmsq_f32 ( vmulq_f32 ( bw, aw ), bx, ax ), by, ay ), bz, az ) );
+		vst1q_f32 ( a.x+j, vfmsq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( bx, aw ), bw, ax ), by, az ), bz, ay ) );
+		vst1q_f32 ( a.y+j, vfmsq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( by, aw ), bw, ay ), bz, ax ), bx, az ) );
+		vst1q_f32 ( a.z+j, vfmsq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( bz, aw ), bw, az ), bx, ay ), by, ax ) );
+	}
+}
+
+static void FromAngleAxisNEON ( int n4, const float* angle, Vec3SoA axis, QuatSoA q )
+{
+	for (int j = 0; j < n4; j += 4) {
+		float32x4_t h = vmulq_n_f32 ( vld1q_f32 ( angle+j ), 0.5f );
+		float32x4_t s = neon_sin ( h );
+		vst1q_f32 ( q.w+j, neon_cos ( h ) );
+		vst1q_f32 ( q.x+j, vmulq_f32 ( vld1q_f32 ( axis.x+j ), s ) );
+		vst1q_f32 ( q.y+j, vmulq_f32 ( vld1q_f32 ( axis.y+j ), s ) );
+		vst1q_f32 ( q.z+j, vmulq_f32 ( vld1q_f32 ( axis.z+j ), s ) );
+	}
+}
+
+static void FromToNEON ( int n4, Vec3SoA from, Vec3SoA to, float frac, QuatSoA q )
+{
+	const float32x4_t zero = vdupq_n_f32 ( 0.0f );
+	const float32x4_t one = vdupq_n_f32 ( 1.0f );
+	for (int j = 0; j < n4; j += 4) {
+		float32x4_t fx = vld1q_f32 ( from.x+j ), fy = vld1q_f32 ( from.y+j ), fz = vld1q_f32 ( from.z+j );
+		float32x4_t tx = vld1q_f32 ( to.x+j ), ty = vld1q_f32 ( to.y+j ), tz = vld1q_f32 ( to.z+j );
+		float32x4_t cx = vfmsq_f32 ( vmulq_f32 ( fy, tz ), fz, ty );
+		float32x4_t cy = vfmsq_f32 ( vmulq_f32 ( fz, tx ), fx, tz );
+		float32x4_t cz = vfmsq_f32 ( vmulq_f32 ( fx, ty ), fy, tx );
+		float32x4_t len = vsqrtq_f32 ( vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( cx, cx ), cy, cy ), cz, cz ) );
+		float32x4_t d = vfmaq_f32 ( vfmaq_f32 ( vmulq_f32 ( fx, tx ), fy, ty ), fz, tz );
+		float32x4_t h = vmulq_n_f32 ( neon_acos ( d ), frac * 0.5f );		// neon_acos clamps d to [-1,1]
+		uint32x4_t rot = vcgtq_f32 ( len, zero );							// else parallel, identity
+		float32x4_t s = vbslq_f32 ( rot, vdivq_f32 ( neon_sin ( h ), len ), zero );
+		vst1q_f32 ( q.w+j, vbslq_f32 ( rot, neon_cos ( h ), one ) );
+		vst1q_f32 ( q.x+j, vmulq_f32 ( cx, s ) );
+		vst1q_f32 ( q.y+j, vmulq_f32 ( cy, s ) );
+		vst1q_f32 ( q.z+j, vmulq_f32 ( cz, s ) );
+	}
+}
+
+#endif
+
+//---------------------------------------------------------------- Dispatch
+
+// Entries handled by the SIMD path, the rest go to the scalar loop
+#if defined(CPU_X86)
+	#define QUAT_SIMD(fn, ...)		int j = 0; if ( UseAVX2() ) { j = n & ~7; fn##AVX2 ( j, __VA_ARGS__ ); }
+#elif defined(CPU_ARM64)
+	#define QUAT_SIMD(fn, ...)		int j = 0; if ( UseNEON() ) { j = n & ~3; fn##NEON ( j, __VA_ARGS__ ); }
+#else
+	#define QUAT_SIMD(fn, ...)		int j = 0;
+#endif
+
+void QuatRotateN ( int n, QuatSoA q, Vec3SoA v )
+{
+	QUAT_SIMD ( Rotate, q, v );
+	RotateScalar ( j, n, q, v );
+}
+
+void QuatBasisN ( int n, QuatSoA q, Vec3SoA fwd, Vec3SoA up, Vec3SoA right )
+{
+	QUAT_SIMD ( Basis, q, fwd, up, right );
+	BasisScalar ( j, n, q, fwd, up, right );
+}
+
+void QuatNormalizeN ( int n, QuatSoA q )
+{
+	QUAT_SIMD ( Normalize, q );
+	NormalizeScalar ( j, n, q );
+}
+
+void QuatComposeN ( int n, QuatSoA a, QuatSoA b )
+{
+	QUAT_SIMD ( Compose, a, b );
+	ComposeScalar ( j, n, a, b );
+}
+
+void QuatFromAngleAxisN ( int n, const float* angle, Vec3SoA axis, QuatSoA q )
+{
+	QUAT_SIMD ( FromAngleAxis, angle, axis, q );
+	FromAngleAxisScalar ( j, n, angle, axis, q );
+}
+
+void QuatFromToN ( int n, Vec3SoA from, Vec3SoA to, float frac, QuatSoA q )
+{
+	QUAT_SIMD ( FromTo, from, to, frac, q );
+	FromToScalar ( j, n, from, to, frac, q );
+}
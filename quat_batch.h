@@ -0,0 +1,47 @@
+//--------------------------------------------------------
+//
+// Quaternion batch - libmin Quaternion operations over arrays of quaternions
+//
+// The flight model keeps orientations as structure-of-arrays, so these take
+// separate x, y, z (w) arrays and process n entries at once, 8 per AVX2 or
+// 4 per NEON register, with a scalar loop for the remainder and for CPUs
+// without either. Each follows the convention of the libmin call it
+// replaces, noted per function:
+//   Rotate     v = v * q, libmin's Vec3F * Quaternion
+//   Compose    a *= b
+//   Basis      Vec3F(1,0,0) * q, (0,1,0) * q and (0,0,1) * q as the columns of
+//              one rotation matrix, so a body frame costs one conversion
+//
+// Arithmetic is in a different order than libmin (fused multiply-adds, the
+// matrix form), so results agree with the scalar calls up to float rounding.
+// The SIMD sin, cos and acos are the simd_math.h polynomials, within 4e-7.
+// Arrays may be aliased only where an argument is marked in/out.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_QUAT_BATCH
+	#define DEF_QUAT_BATCH
+
+	struct QuatSoA {
+		float		*x, *y, *z, *w;
+	};
+	struct Vec3SoA {
+		float		*x, *y, *z;
+	};
+
+	void	QuatRotateN ( int n, QuatSoA q, Vec3SoA v );					// v in/out
+	void	QuatBasisN ( int n, QuatSoA q, Vec3SoA fwd, Vec3SoA up, Vec3SoA right );	// outputs may be {0x0} to skip
+	void	QuatNormalizeN ( int n, QuatSoA q );							// q in/out
+	void	QuatComposeN ( int n, QuatSoA a, QuatSoA b );					// a in/out, a = a * b
+
+	// q.fromAngleAxis ( angle[k], axis[k] ), axis of unit length
+	void	QuatFromAngleAxisN ( int n, const float* angle, Vec3SoA axis, QuatSoA q );
+
+	// q.fromRotationFromTo ( from[k], to[k], frac ) for unit vectors. Where they
+	// are parallel libmin gives NaN, this gives the identity.
+	void	QuatFromToN ( int n, Vec3SoA from, Vec3SoA to, float frac, QuatSoA q );
+
+#endif
@@ -0,0 +1,334 @@
+//--------------------------------------------------------
+//
+// Aircraft renderer - instanced aircraft meshes from SoA state arrays
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "render_aircraft.h"
+#include "grid_mesh.h"			// GridViewFromMatrices
+#include <math.h>
+#include <stddef.h>
+#include <string>
+
+// Instance position and orientation come either from the cull pass output
+// (INST, one vec4 each) or straight from the seven SoA arrays (SOA).
+static const char* g_aircraft_vs =
+	"layout(location=0) in vec3 inPos;\n"
+	"layout(location=1) in vec3 inNorm;\n"
+	"#ifdef SOA\n"
+	"layout(location=2) in float inPx;\n"
+	"layout(location=3) in float inPy;\n"
+	"layout(location=4) in float inPz;\n"
+	"layout(location=5) in float inQx;\n"
+	"layout(location=6) in float inQy;\n"
+	"layout(location=7) in float inQz;\n"
+	"layout(location=8) in float inQw;\n"
+	"uniform int skipInstance;\n"
+	"#else\n"
+	"layout(location=2) in vec4 inP;\n"
+	"layout(location=3) in vec4 inQ;\n"
+	"#endif\n"
+	"uniform mat4 viewMatrix;\n"
+	"uniform mat4 projMatrix;\n"
+	"out vec3 vNorm;\n"
+	"vec3 qrot ( vec4 q, vec3 v ) {\n"			// same rotation as Vec3F * Quaternion
+	"  vec3 t = 2.0 * cross ( q.xyz, v );\n"
+	"  return v + q.w * t + cross ( q.xyz, t );\n"
+	"}\n"
+	"void main() {\n"
+	"#ifdef SOA\n"
+	"  vec3 p = vec3 ( inPx, inPy, inPz );\n"
+	"  vec4 q = vec4 ( inQx, inQy, inQz, inQw );\n"
+	"#else\n"
+	"  vec3 p = inP.xyz;\n"
+	"  vec4 q = inQ;\n"
+	"#endif\n"
+	"  vNorm = qrot ( q, inNorm );\n"
+	"  gl_Position = projMatrix * viewMatrix * vec4 ( p + qrot ( q, inPos ), 1 );\n"
+	"#ifdef SOA\n"
+	"  if ( gl_InstanceID == skipInstance ) gl_Position = vec4 ( 2, 2, 2, 1 );\n"		// outside the clip volume
+	"#endif\n"
+	"}\n";
+
+static const char* g_aircraft_fs =
+	"#version 330 core\n"
+	"in vec3 vNorm;\n"
+	"out vec4 outClr;\n"
+	"void main() {\n"
+	"  float light = 0.35 + 0.65 * abs ( dot ( normalize(vNorm), normalize(vec3(0.3, 1.0, 0.2)) ) );\n"
+	"  outClr = vec4 ( vec3(0.85, 0.85, 0.9) * light, 1 );\n"
+	"}\n";
+
+// One thread per aircraft. Survivors are appended to the instance buffer and
+// counted into the indirect command, which the draw then reads on the GPU.
+static const char* g_aircraft_cs =
+	"#version 420\n"
+	"#extension GL_ARB_compute_shader : require\n"
+	"#extension GL_ARB_shader_storage_buffer_object : require\n"
+	"layout(local_size_x = 256) in;\n"
+	"layout(std430, binding = 0) readonly buffer Soa { float soa[]; };\n"
+	"struct Inst { vec4 p; vec4 q; };\n"
+	"layout(std430, binding = 1) writeonly buffer Visible { Inst inst[]; };\n"
+	"layout(std430, binding = 2) buffer Cmd { uint count; uint instanceCount; uint first; uint baseInstance; };\n"
+	"uniform int numAircraft;\n"
+	"uniform int stride;\n"						// floats per SoA array
+	"uniform int skipAircraft;\n"
+	"uniform vec4 planes[6];\n"					// normalized, inside where dot >= 0
+	"uniform float radius;\n"
+	"void main() {\n"
+	"  int i = int ( gl_GlobalInvocationID.x );\n"
+	"  if ( i >= numAircraft || i == skipAircraft ) return;\n"
+	"  vec3 p = vec3 ( soa[i], soa[stride + i], soa[2*stride + i] );\n"
+	"  for (int k = 0; k < 6; k++)\n"
+	"    if ( dot ( planes[k].xyz, p ) + planes[k].w < -radius ) return;\n"
+	"  uint slot = atomicAdd ( instanceCount, 1u );\n"
+	"  inst[slot].p = vec4 ( p, 1 );\n"
+	"  inst[slot].q = vec4 ( soa[3*stride + i], soa[4*stride + i], soa[5*stride + i], soa[6*stride + i] );\n"
+	"}\n";
+
+struct DrawArraysIndirectCmd {
+	GLuint		count, instanceCount, first, baseInstance;
+};
+
+static void AddTri ( std::vector<AircraftVert>& v, Vec3F a, Vec3F b, Vec3F c )
+{
+	Vec3F n = (b - a).Cross ( c - a );
+	n.Normalize ();
+	Vec3F p[3] = { a, b, c };
+	for (int k = 0; k < 3; k++) {
+		AircraftVert av;
+		av.x = p[k].x; av.y = p[k].y; av.z = p[k].z;
+		av.nx = n.x; av.ny = n.y; av.nz = n.z;
+		v.push_back ( av );
+	}
+}
+
+static void AddQuad ( std::vector<AircraftVert>& v, Vec3F a, Vec3F b, Vec3F c, Vec3F d )
+{
+	AddTri ( v, a, b, c );
+	AddTri ( v, a, c, d );
+}
+
+// A low-poly light aircraft, about 8 m long with a 10 m span, fitting in AIRCRAFT_RADIUS
+void BuildAircraftMesh ( std::vector<AircraftVert>& v )
+{
+	v.clear ();
+
+	// fuselage, a nose and tail cone on a diamond section
+	Vec3F nose (4, 0, 0), tail (-4, 0.3, 0);
+	Vec3F ring[4] = { Vec3F(1, 0.6, 0), Vec3F(1, 0, 0.6), Vec3F(1, -0.6, 0), Vec3F(1, 0, -0.6) };
+	for (int k = 0; k < 4; k++) {
+		AddTri ( v, nose, ring[k], ring[(k+1) % 4] );
+		AddTri ( v, tail, ring[(k+1) % 4], ring[k] );
+	}
+
+	// wings, tapered, both sides
+	for (int s = -1; s <= 1; s += 2) {
+		AddQuad ( v, Vec3F(0.8, 0, 0), Vec3F(0.2, 0, s*5.0f), Vec3F(-0.6, 0, s*5.0f), Vec3F(-0.8, 0, 0) );
+		AddQuad ( v, Vec3F(-3, 0.3, 0), Vec3F(-3.6, 0.3, s*1.8f), Vec3F(-4, 0.3, s*1.8f), Vec3F(-4, 0.3, 0) );
+	}
+
+	// vertical fin
+	AddQuad ( v, Vec3F(-3, 0.3, 0), Vec3F(-3.6, 2, 0), Vec3F(-4, 2, 0), Vec3F(-4, 0.3, 0) );
+}
+
+AircraftRenderer::AircraftRenderer ()
+{
+	m_prog = 0; m_soa_prog = 0; m_cull_prog = 0;
+	m_mesh_vbo = 0; m_vao = 0; m_soa_vao = 0;
+	m_soa_buf = 0; m_inst_buf = 0; m_cmd_buf = 0;
+	m_mesh_verts = 0;
+	m_capacity = 0;
+	m_submitted = 0;
+}
+
+bool AircraftRenderer::Init ()
+{
+	std::string vs_inst = std::string ( "#version 330 core\n" ) + g_aircraft_vs;
+	std::string vs_soa = std::string ( "#version 330 core\n#define SOA\n" ) + g_aircraft_vs;
+	m_soa_prog = glCompileProgram ( "aircraft soa", vs_soa.c_str(), g_aircraft_fs );
+	if ( m_soa_prog == 0 ) return false;
+	m_soa_view = glGetUniformLocation ( m_soa_prog, "viewMatrix" );
+	m_soa_proj = glGetUniformLocation ( m_soa_prog, "projMatrix" );
+	m_soa_skip = glGetUniformLocation ( m_soa_prog, "skipInstance" );
+
+	// GPU culling is optional, the SoA path draws everything
+	if ( GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object ) {
+		m_cull_prog = glCompileCompute ( "aircraft cull", g_aircraft_cs );
+		m_prog = glCompileProgram ( "aircraft", vs_inst.c_str(), g_aircraft_fs );
+		if ( m_cull_prog == 0 || m_prog == 0 ) {
+			if ( m_cull_prog ) glDeleteProgram ( m_cull_prog );
+			if ( m_prog ) glDeleteProgram ( m_prog );
+			m_cull_prog = 0; m_prog = 0;
+		}
+	}
+	if ( m_cull_prog ) {
+		m_loc_view = glGetUniformLocation ( m_prog, "viewMatrix" );
+		m_loc_proj = glGetUniformLocation ( m_prog, "projMatrix" );
+		m_cull_count = glGetUniformLocation ( m_cull_prog, "numAircraft" );
+		m_cull_stride = glGetUniformLocation ( m_cull_prog, "stride" );
+		m_cull_skip = glGetUniformLocation ( m_cull_prog, "skipAircraft" );
+		m_cull_planes = glGetUniformLocation ( m_cull_prog, "planes" );
+		m_cull_radius = glGetUniformLocation ( m_cull_prog, "radius" );
+	}
+
+	std::vector<AircraftVert> mesh;
+	BuildAircraftMesh ( mesh );
+	m_mesh_verts = (int) mesh.size();
+	glGenBuffers ( 1, &m_mesh_vbo );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_mesh_vbo );
+	glBufferData ( GL_ARRAY_BUFFER, mesh.size() * sizeof(AircraftVert), mesh.data(), GL_STATIC_DRAW );
+
+	glGenBuffers ( 1, &m_soa_buf );
+	glGenBuffers ( 1, &m_inst_buf );
+	glGenBuffers ( 1, &m_cmd_buf );
+	glBindBuffer ( GL_DRAW_INDIRECT_BUFFER, m_cmd_buf );
+	glBufferData ( GL_DRAW_INDIRECT_BUFFER, sizeof(DrawArraysIndirectCmd), 0x0, GL_DYNAMIC_DRAW );
+	glBindBuffer ( GL_DRAW_INDIRECT_BUFFER, 0 );
+
+	// Mesh attributes are the same in both VAOs, instance attributes are
+	// set by Reserve once the buffer sizes are known.
+	glGenVertexArrays ( 1, &m_vao );
+	glGenVertexArrays ( 1, &m_soa_vao );
+	GLuint vaos[2] = { m_vao, m_soa_vao };
+	for (int k = 0; k < 2; k++) {
+		glBindVertexArray ( vaos[k] );
+		glBindBuffer ( GL_ARRAY_BUFFER, m_mesh_vbo );
+		glEnableVertexAttribArray ( 0 );
+		glVertexAttribPointer ( 0, 3, GL_FLOAT, GL_FALSE, sizeof(AircraftVert), (void*) offsetof(AircraftVert, x) );
+		glEnableVertexAttribArray ( 1 );
+		glVertexAttribPointer ( 1, 3, GL_FLOAT, GL_FALSE, sizeof(AircraftVert), (void*) offsetof(AircraftVert, nx) );
+	}
+	glBindVertexArray ( 0 );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+
+	Reserve ( 256 );
+	return true;
+}
+
+void AircraftRenderer::Reserve ( int n )
+{
+	if ( n <= m_capacity ) return;
+	int cap = m_capacity * 2;
+	if ( cap < n ) cap = n;
+	m_capacity = cap;
+
+	glBindBuffer ( GL_ARRAY_BUFFER, m_soa_buf );
+	glBufferData ( GL_ARRAY_BUFFER, 7 * cap * sizeof(float), 0x0, GL_STREAM_DRAW );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_inst_buf );
+	glBufferData ( GL_ARRAY_BUFFER, cap * 8 * sizeof(float), 0x0, GL_DYNAMIC_DRAW );
+
+	// SoA path, one float attribute per array
+	glBindVertexArray ( m_soa_vao );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_soa_buf );
+	for (int k = 0; k < 7; k++) {
+		glEnableVertexAttribArray ( 2 + k );
+		glVertexAttribPointer ( 2 + k, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*) (k * cap * sizeof(float)) );
+		glVertexAttribDivisor ( 2 + k, 1 );
+	}
+
+	// Culled path, compacted vec4 position and quaternion
+	glBindVertexArray ( m_vao );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_inst_buf );
+	glEnableVertexAttribArray ( 2 );
+	glVertexAttribPointer ( 2, 4, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*) 0 );
+	glVertexAttribDivisor ( 2, 1 );
+	glEnableVertexAttribArray ( 3 );
+	glVertexAttribPointer ( 3, 4, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*) (4*sizeof(float)) );
+	glVertexAttribDivisor ( 3, 1 );
+
+	glBindVertexArray ( 0 );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+}
+
+void AircraftRenderer::Draw ( Camera3D* cam, int n, const float* px, const float* py, const float* pz,
+							const float* qx, const float* qy, const float* qz, const float* qw, int skip )
+{
+	m_submitted = 0;
+	if ( m_soa_prog == 0 || n <= 0 ) return;
+	Reserve ( n );
+
+	// Upload the arrays as they are, orphaning last frame's copy
+	const float* arrays[7] = { px, py, pz, qx, qy, qz, qw };
+	size_t bytes = n * sizeof(float);
+	glBindBuffer ( GL_ARRAY_BUFFER, m_soa_buf );
+	glBufferData ( GL_ARRAY_BUFFER, 7 * m_capacity * sizeof(float), 0x0, GL_STREAM_DRAW );
+	for (int k = 0; k < 7; k++)
+		glBufferSubData ( GL_ARRAY_BUFFER, k * m_capacity * sizeof(float), bytes, arrays[k] );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+
+	Matrix4F viewmtx = cam->getViewMatrix();
+	Matrix4F projmtx = cam->getProjMatrix();
+	const float* view = viewmtx.GetDataF();
+	const float* proj = projmtx.GetDataF();
+
+	glDisable ( GL_BLEND );
+	glEnable ( GL_DEPTH_TEST );
+
+	if ( m_cull_prog ) {
+		GridView gv;
+		GridViewFromMatrices ( gv, view, proj );
+		float planes[6][4];
+		for (int p = 0; p < 6; p++) {
+			const float* pl = gv.planes[p];
+			float len = sqrtf ( pl[0]*pl[0] + pl[1]*pl[1] + pl[2]*pl[2] );
+			if ( len <= 0 ) len = 1;
+			for (int k = 0; k < 4; k++) planes[p][k] = pl[k] / len;
+		}
+
+		DrawArraysIndirectCmd cmd = { (GLuint) m_mesh_verts, 0, 0, 0 };
+		glBindBuffer ( GL_DRAW_INDIRECT_BUFFER, m_cmd_buf );
+		glBufferSubData ( GL_DRAW_INDIRECT_BUFFER, 0, sizeof(cmd), &cmd );
+
+		glUseProgram ( m_cull_prog );
+		glUniform1i ( m_cull_count, n );
+		glUniform1i ( m_cull_stride, m_capacity );
+		glUniform1i ( m_cull_skip, skip );
+		glUniform4fv ( m_cull_planes, 6, &planes[0][0] );
+		glUniform1f ( m_cull_radius, AIRCRAFT_RADIUS );
+		glBindBufferBase ( GL_SHADER_STORAGE_BUFFER, 0, m_soa_buf );
+		glBindBufferBase ( GL_SHADER_STORAGE_BUFFER, 1, m_inst_buf );
+		glBindBufferBase ( GL_SHADER_STORAGE_BUFFER, 2, m_cmd_buf );
+		glDispatchCompute ( (n + AIRCRAFT_CULL_GROUP - 1) / AIRCRAFT_CULL_GROUP, 1, 1 );
+		glMemoryBarrier ( GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT );
+
+		glUseProgram ( m_prog );
+		glUniformMatrix4fv ( m_loc_view, 1, GL_FALSE, view );
+		glUniformMatrix4fv ( m_loc_proj, 1, GL_FALSE, proj );
+		glBindVertexArray ( m_vao );
+		glDrawArraysIndirect ( GL_TRIANGLES, (void*) 0 );
+		glBindBuffer ( GL_DRAW_INDIRECT_BUFFER, 0 );
+	} else {
+		glUseProgram ( m_soa_prog );
+		glUniformMatrix4fv ( m_soa_view, 1, GL_FALSE, view );
+		glUniformMatrix4fv ( m_soa_proj, 1, GL_FALSE, proj );
+		glUniform1i ( m_soa_skip, skip );
+		glBindVertexArray ( m_soa_vao );
+		glDrawArraysInstanced ( GL_TRIANGLES, 0, m_mesh_verts, n );
+	}
+	glBindVertexArray ( 0 );
+	glUseProgram ( 0 );
+	m_submitted = n;
+}
+
+void AircraftRenderer::Clear ()
+{
+	if ( m_mesh_vbo ) glDeleteBuffers ( 1, &m_mesh_vbo );
+	if ( m_soa_buf ) glDeleteBuffers ( 1, &m_soa_buf );
+	if ( m_inst_buf ) glDeleteBuffers ( 1, &m_inst_buf );
+	if ( m_cmd_buf ) glDeleteBuffers ( 1, &m_cmd_buf );
+	if ( m_vao ) glDeleteVertexArrays ( 1, &m_vao );
+	if ( m_soa_vao ) glDeleteVertexArrays ( 1, &m_soa_vao );
+	if ( m_prog ) glDeleteProgram ( m_prog );
+	if ( m_soa_prog ) glDeleteProgram ( m_soa_prog );
+	if ( m_cull_prog ) glDeleteProgram ( m_cull_prog );
+	m_prog = 0; m_soa_prog = 0; m_cull_prog = 0;
+	m_mesh_vbo = 0; m_vao = 0; m_soa_vao = 0;
+	m_soa_buf = 0; m_inst_buf = 0; m_cmd_buf = 0;
+	m_mesh_verts = 0;
+	m_capacity = 0;
+	m_submitted = 0;
+}
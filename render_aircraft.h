@@ -0,0 +1,66 @@
+//--------------------------------------------------------
+//
+// Aircraft renderer - instanced aircraft meshes from SoA state arrays
+//
+// Positions and orientations are uploaded as they are in the model, seven
+// float arrays in one buffer, and each instance is rotated by its quaternion
+// in the vertex shader. No per-aircraft matrix is built on the CPU.
+//
+// With compute shaders (ARB_compute_shader and shader storage buffers) a
+// cull pass tests each aircraft's bounding sphere against the frustum,
+// compacts the survivors and counts them into an indirect draw command, so
+// the CPU never reads the count back. Without them every aircraft is drawn,
+// reading the SoA arrays directly as instance attributes.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_RENDER_AIRCRAFT
+	#define DEF_RENDER_AIRCRAFT
+
+	#include <vector>
+	#include "render_gl.h"
+	#include "camera3d.h"
+
+	#define AIRCRAFT_RADIUS		6.0f		// bounding sphere of the mesh (m)
+	#define AIRCRAFT_CULL_GROUP	256			// cull shader work group size
+
+	// Flat-shaded triangles in the body frame: x forward, y up, z right
+	struct AircraftVert {
+		float		x, y, z;
+		float		nx, ny, nz;
+	};
+	void	BuildAircraftMesh ( std::vector<AircraftVert>& verts );
+
+	class AircraftRenderer {
+	public:
+		AircraftRenderer ();
+
+		bool		Init ();						// create programs and mesh, call with a GL context
+		void		Clear ();
+
+		// Draw n aircraft from SoA arrays. skip is an aircraft not to draw
+		// (the one the camera is in), -1 for none.
+		void		Draw ( Camera3D* cam, int n, const float* px, const float* py, const float* pz,
+						const float* qx, const float* qy, const float* qz, const float* qw, int skip = -1 );
+
+		bool		isCulled ()			{ return m_cull_prog != 0; }		// GPU culling available
+		int			getSubmitted ()		{ return m_submitted; }
+
+	private:
+		void		Reserve ( int n );
+
+		GLuint		m_prog, m_soa_prog, m_cull_prog;
+		GLint		m_loc_view, m_loc_proj;
+		GLint		m_soa_view, m_soa_proj, m_soa_skip;
+		GLint		m_cull_count, m_cull_stride, m_cull_skip, m_cull_planes, m_cull_radius;
+		GLuint		m_mesh_vbo, m_vao, m_soa_vao;
+		GLuint		m_soa_buf, m_inst_buf, m_cmd_buf;
+		int			m_mesh_verts;
+		int			m_capacity;						// aircraft the buffers hold
+		int			m_submitted;
+	};
+
+#endif
@@ -0,0 +1,74 @@
+//--------------------------------------------------------
+//
+// GL helpers shared by the retained-mode renderers
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "render_gl.h"
+#include "common_defs.h"
+
+static GLuint CompileShader ( const char* name, GLenum type, const char* src )
+{
+	GLuint s = glCreateShader ( type );
+	glShaderSource ( s, 1, &src, 0x0 );
+	glCompileShader ( s );
+
+	GLint ok;
+	glGetShaderiv ( s, GL_COMPILE_STATUS, &ok );
+	if ( !ok ) {
+		char log[2048];
+		glGetShaderInfoLog ( s, 2048, 0x0, log );
+		dbgprintf ( "ERROR: %s %s shader: %s\n", name, (type==GL_VERTEX_SHADER) ? "vertex" : (type==GL_COMPUTE_SHADER) ? "compute" : "fragment", log );
+		glDeleteShader ( s );
+		return 0;
+	}
+	return s;
+}
+
+static GLuint LinkProgram ( const char* name, GLuint prog )
+{
+	glLinkProgram ( prog );
+
+	GLint ok;
+	glGetProgramiv ( prog, GL_LINK_STATUS, &ok );
+	if ( !ok ) {
+		char log[2048];
+		glGetProgramInfoLog ( prog, 2048, 0x0, log );
+		dbgprintf ( "ERROR: %s program: %s\n", name, log );
+		glDeleteProgram ( prog );
+		return 0;
+	}
+	return prog;
+}
+
+GLuint glCompileProgram ( const char* name, const char* vs, const char* fs )
+{
+	GLuint v = CompileShader ( name, GL_VERTEX_SHADER, vs );
+	GLuint f = CompileShader ( name, GL_FRAGMENT_SHADER, fs );
+	if ( v == 0 || f == 0 ) {
+		if ( v ) glDeleteShader ( v );
+		if ( f ) glDeleteShader ( f );
+		return 0;
+	}
+	GLuint prog = glCreateProgram ();
+	glAttachShader ( prog, v );
+	glAttachShader ( prog, f );
+	prog = LinkProgram ( name, prog );
+	glDeleteShader ( v );
+	glDeleteShader ( f );
+	return prog;
+}
+
+GLuint glCompileCompute ( const char* name, const char* cs )
+{
+	GLuint c = CompileShader ( name, GL_COMPUTE_SHADER, cs );
+	if ( c == 0 ) return 0;
+	GLuint prog = glCreateProgram ();
+	glAttachShader ( prog, c );
+	prog = LinkProgram ( name, prog );
+	glDeleteShader ( c );
+	return prog;
+}
@@ -0,0 +1,21 @@
+//--------------------------------------------------------
+//
+// GL helpers shared by the retained-mode renderers
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_RENDER_GL
+	#define DEF_RENDER_GL
+
+	#include <GL/glew.h>
+
+	// Compile and link a vertex/fragment program. Prints the log and returns 0 on failure.
+	GLuint	glCompileProgram ( const char* name, const char* vs, const char* fs );
+
+	// Compile and link a compute program, needs ARB_compute_shader. Returns 0 on failure.
+	GLuint	glCompileCompute ( const char* name, const char* cs );
+
+#endif
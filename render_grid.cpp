@@ -0,0 +1,193 @@
+//--------------------------------------------------------
+//
+// Grid renderer - tiled ground grid with frustum culling and distance LOD
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "render_grid.h"
+#include <stddef.h>
+
+// inTile is the per-instance tile origin, (0,0) for the world range.
+// Fade is done per fragment, since a 5 km line has both near and far parts.
+static const char* g_grid_vs =
+	"#version 330 core\n"
+	"layout(location=0) in vec3 inPos;\n"
+	"layout(location=1) in vec4 inClr;\n"
+	"layout(location=2) in vec2 inTile;\n"
+	"uniform mat4 viewMatrix;\n"
+	"uniform mat4 projMatrix;\n"
+	"out vec4 vClr;\n"
+	"out vec3 vWorld;\n"
+	"void main() {\n"
+	"  vClr = inClr;\n"
+	"  vWorld = inPos + vec3(inTile.x, 0, inTile.y);\n"
+	"  gl_Position = projMatrix * viewMatrix * vec4(vWorld, 1);\n"
+	"}\n";
+
+static const char* g_grid_fs =
+	"#version 330 core\n"
+	"in vec4 vClr;\n"
+	"in vec3 vWorld;\n"
+	"uniform vec3 eyePos;\n"
+	"uniform vec2 fadeRange;\n"			// fully visible until x, gone at y, y=0 never fades
+	"out vec4 outClr;\n"
+	"void main() {\n"
+	"  float f = 1.0;\n"
+	"  if ( fadeRange.y > 0 ) f = 1.0 - smoothstep ( fadeRange.x, fadeRange.y, distance ( vWorld, eyePos ) );\n"
+	"  outClr = vec4 ( vClr.rgb, vClr.a * f );\n"
+	"}\n";
+
+GridRenderer::GridRenderer ()
+{
+	m_prog = 0; m_vao = 0; m_vbo = 0; m_inst_vbo = 0;
+	m_world_first = 0; m_world_count = 0; m_tile_first = 0;
+	m_runway_width = -1;
+	m_runway_length = -1;
+	m_extent = 0;
+	m_bundle = 0x0;
+	m_upload = false;
+	m_mesh.tiles = 0;
+	m_visible = 0;
+	m_drawn_verts = 0;
+}
+
+bool GridRenderer::Init ()
+{
+	m_prog = glCompileProgram ( "grid", g_grid_vs, g_grid_fs );
+	if ( m_prog == 0 ) return false;
+	m_loc_view = glGetUniformLocation ( m_prog, "viewMatrix" );
+	m_loc_proj = glGetUniformLocation ( m_prog, "projMatrix" );
+	m_loc_eye  = glGetUniformLocation ( m_prog, "eyePos" );
+	m_loc_fade = glGetUniformLocation ( m_prog, "fadeRange" );
+
+	glGenVertexArrays ( 1, &m_vao );
+	glGenBuffers ( 1, &m_vbo );
+	glGenBuffers ( 1, &m_inst_vbo );
+	glBindVertexArray ( m_vao );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_vbo );
+	glEnableVertexAttribArray ( 0 );
+	glVertexAttribPointer ( 0, 3, GL_FLOAT, GL_FALSE, sizeof(LineVert), (void*) offsetof(LineVert, x) );
+	glEnableVertexAttribArray ( 1 );
+	glVertexAttribPointer ( 1, 4, GL_FLOAT, GL_FALSE, sizeof(LineVert), (void*) offsetof(LineVert, r) );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_inst_vbo );
+	glVertexAttribDivisor ( 2, 1 );
+	glBindVertexArray ( 0 );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+	return true;
+}
+
+void GridRenderer::Build ( float runway_width, float runway_length, float extent, const AssetBundle* bundle )
+{
+	if ( bundle ) m_bundle = bundle;
+
+	// prebuilt by asset_pack for this runway and extent, or built here
+	const BundleEntry* e = m_bundle ? m_bundle->Find ( "grid", BUNDLE_GRID ) : 0x0;
+	bool match = e && e->param[0] == BundleFloatBits ( runway_width ) && e->param[1] == BundleFloatBits ( runway_length )
+				&& e->param[2] == BundleFloatBits ( extent );
+	if ( !match || !LoadGridMesh ( m_bundle->getData ( e ), (size_t) e->size, m_mesh ) )
+		BuildGridMesh ( m_mesh, runway_width, runway_length, extent );
+
+	m_world_first = 0;
+	m_world_count = (int) m_mesh.world.size();
+	m_tile_first = m_world_count;
+	m_runway_width = runway_width;
+	m_runway_length = runway_length;
+	m_extent = extent;
+	m_upload = true;
+}
+
+// World lines, then the tile mesh, in one static buffer
+void GridRenderer::Upload ()
+{
+	size_t bytes_world = m_mesh.world.size() * sizeof(LineVert);
+	size_t bytes_tile = m_mesh.tile.size() * sizeof(LineVert);
+
+	glBindBuffer ( GL_ARRAY_BUFFER, m_vbo );
+	glBufferData ( GL_ARRAY_BUFFER, bytes_world + bytes_tile, 0x0, GL_STATIC_DRAW );
+	glBufferSubData ( GL_ARRAY_BUFFER, 0, bytes_world, m_mesh.world.data() );
+	glBufferSubData ( GL_ARRAY_BUFFER, bytes_world, bytes_tile, m_mesh.tile.data() );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_inst_vbo );
+	glBufferData ( GL_ARRAY_BUFFER, m_mesh.tiles * m_mesh.tiles * GRID_LEVELS * 2 * sizeof(float), 0x0, GL_STREAM_DRAW );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+	m_upload = false;
+}
+
+// Visible tile lists are culled into the frame arena. If it is full only
+// the runway is drawn.
+void GridRenderer::Draw ( Camera3D* cam, float runway_width, float runway_length, FrameArena& frame )
+{
+	if ( m_prog == 0 ) return;
+	if ( runway_width != m_runway_width || runway_length != m_runway_length )
+		Build ( runway_width, runway_length, (m_extent > 0) ? m_extent : 27500 );
+	if ( m_upload ) Upload ();
+
+	Matrix4F viewmtx = cam->getViewMatrix();
+	Matrix4F projmtx = cam->getProjMatrix();
+	const float* view = viewmtx.GetDataF();
+	const float* proj = projmtx.GetDataF();
+	GridView gv;
+	GridViewFromMatrices ( gv, view, proj );
+	int count[GRID_LEVELS] = { 0 };
+	int stride = m_mesh.tiles * m_mesh.tiles * 2;
+	float* inst = frame.Alloc<float> ( GridInstFloats ( m_mesh ) );
+	m_visible = inst ? CullGridTiles ( m_mesh, gv, inst, count ) : 0;
+
+	glEnable ( GL_BLEND );
+	glBlendFunc ( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	glEnable ( GL_DEPTH_TEST );
+
+	glUseProgram ( m_prog );
+	glUniformMatrix4fv ( m_loc_view, 1, GL_FALSE, view );
+	glUniformMatrix4fv ( m_loc_proj, 1, GL_FALSE, proj );
+	glUniform3f ( m_loc_eye, gv.eye[0], gv.eye[1], gv.eye[2] );
+	glBindVertexArray ( m_vao );
+
+	// runway and border, no offset
+	glDisableVertexAttribArray ( 2 );
+	glVertexAttrib2f ( 2, 0, 0 );
+	glUniform2f ( m_loc_fade, 0, 0 );
+	glDrawArrays ( GL_LINES, m_world_first, m_world_count );
+	m_drawn_verts = m_world_count;
+
+	// tile levels, instanced over visible tiles. All lists go in one upload,
+	// each level points attribute 2 at its own part of the buffer.
+	size_t total = 0;
+	for (int L=0; L < GRID_LEVELS; L++) total += count[L] * 2;
+	glBindBuffer ( GL_ARRAY_BUFFER, m_inst_vbo );
+	glBufferData ( GL_ARRAY_BUFFER, total * sizeof(float), 0x0, GL_STREAM_DRAW );		// orphan
+	size_t ofs = 0;
+	for (int L=0; L < GRID_LEVELS; L++) {
+		size_t sz = count[L] * 2 * sizeof(float);
+		if ( sz > 0 ) glBufferSubData ( GL_ARRAY_BUFFER, ofs, sz, inst + L*stride );
+		ofs += sz;
+	}
+	glEnableVertexAttribArray ( 2 );
+	ofs = 0;
+	for (int L=0; L < GRID_LEVELS; L++) {
+		int n = count[L];
+		if ( n > 0 && m_mesh.level_count[L] > 0 ) {
+			glVertexAttribPointer ( 2, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*) ofs );
+			glUniform2f ( m_loc_fade, m_mesh.levels[L].fade_near, m_mesh.levels[L].fade_far );
+			glDrawArraysInstanced ( GL_LINES, m_tile_first + m_mesh.level_first[L], m_mesh.level_count[L], n );
+			m_drawn_verts += m_mesh.level_count[L] * n;
+		}
+		ofs += count[L] * 2 * sizeof(float);
+	}
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+	glBindVertexArray ( 0 );
+	glUseProgram ( 0 );
+}
+
+void GridRenderer::Clear ()
+{
+	if ( m_vbo ) glDeleteBuffers ( 1, &m_vbo );
+	if ( m_inst_vbo ) glDeleteBuffers ( 1, &m_inst_vbo );
+	if ( m_vao ) glDeleteVertexArrays ( 1, &m_vao );
+	if ( m_prog ) glDeleteProgram ( m_prog );
+	m_prog = 0; m_vao = 0; m_vbo = 0; m_inst_vbo = 0;
+	m_visible = 0;
+	m_drawn_verts = 0;
+}
@@ -0,0 +1,54 @@
+//--------------------------------------------------------
+//
+// Grid renderer - tiled ground grid with frustum culling and distance LOD
+//
+// The grid is a square of tiles that all share one static tile mesh from
+// BuildGridMesh. Each frame tiles are culled against the camera frustum, and
+// each LOD level is drawn instanced over the visible tiles still within its
+// fade distance, so cost follows what is on screen rather than world size.
+// The fragment shader fades fine levels out with distance to avoid popping.
+// The runway is a separate static range, drawn unculled.
+// The mesh is taken from the asset bundle when it has one built for the same
+// runway and extent, and is sent to GL on the first Draw rather than in Build.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_RENDER_GRID
+	#define DEF_RENDER_GRID
+
+	#include "render_gl.h"
+	#include "camera3d.h"
+	#include "grid_mesh.h"
+	#include "frame_arena.h"
+	#include "asset_bundle.h"
+
+	class GridRenderer {
+	public:
+		GridRenderer ();
+
+		bool		Init ();										// create program, call with a GL context
+		void		Build ( float runway_width, float runway_length, float extent = 27500, const AssetBundle* bundle = 0x0 );
+		void		Draw ( Camera3D* cam, float runway_width, float runway_length, FrameArena& frame );	// rebuilds if the runway changed
+		void		Clear ();
+
+		int			getNumTiles ()		{ return m_mesh.tiles * m_mesh.tiles; }
+		int			getVisibleTiles ()	{ return m_visible; }
+		int			getDrawnVerts ()	{ return m_drawn_verts; }
+
+	private:
+		void		Upload ();
+
+		GLuint		m_prog, m_vao, m_vbo, m_inst_vbo;
+		GLint		m_loc_view, m_loc_proj, m_loc_eye, m_loc_fade;
+		GridMesh	m_mesh;
+		int			m_world_first, m_world_count, m_tile_first;		// vertex ranges in m_vbo
+		float		m_runway_width, m_runway_length, m_extent;
+		const AssetBundle* m_bundle;			// kept open by the app, or 0x0
+		bool		m_upload;								// mesh changed since the last Draw
+		int			m_visible, m_drawn_verts;
+	};
+
+#endif
@@ -0,0 +1,300 @@
+//--------------------------------------------------------
+//
+// Line batcher - debug lines and arrows, one draw call each per frame
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "render_lines.h"
+#include <stddef.h>
+
+static const char* g_line_vs =
+	"#version 330 core\n"
+	"layout(location=0) in vec3 inPos;\n"
+	"layout(location=1) in vec4 inClr;\n"
+	"uniform mat4 viewMatrix;\n"
+	"uniform mat4 projMatrix;\n"
+	"out vec4 vClr;\n"
+	"void main() {\n"
+	"  vClr = inClr;\n"
+	"  gl_Position = projMatrix * viewMatrix * vec4(inPos, 1);\n"
+	"}\n";
+
+// inLocal is (side, up, along, back): along the arrow as a fraction of its
+// length, then back from there and out to the side in units of head length.
+static const char* g_arrow_vs =
+	"#version 330 core\n"
+	"layout(location=0) in vec4 inLocal;\n"
+	"layout(location=1) in vec3 inOrigin;\n"
+	"layout(location=2) in vec4 inClr;\n"
+	"layout(location=3) in vec4 inVec;\n"		// xyz = vector, w = head fraction
+	"uniform mat4 viewMatrix;\n"
+	"uniform mat4 projMatrix;\n"
+	"out vec4 vClr;\n"
+	"void main() {\n"
+	"  float len = length ( inVec.xyz );\n"
+	"  vec3 f = (len > 0.0) ? inVec.xyz / len : vec3(0,0,1);\n"
+	"  vec3 u = (abs(f.y) < 0.99) ? vec3(0,1,0) : vec3(1,0,0);\n"
+	"  vec3 s = normalize ( cross ( f, u ) );\n"
+	"  u = cross ( s, f );\n"
+	"  float h = inVec.w * len;\n"
+	"  vec3 p = inOrigin + f * (inLocal.z * len - inLocal.w * h) + (s * inLocal.x + u * inLocal.y) * (0.4 * h);\n"
+	"  vClr = inClr;\n"
+	"  gl_Position = projMatrix * viewMatrix * vec4(p, 1);\n"
+	"}\n";
+
+static const char* g_line_fs =
+	"#version 330 core\n"
+	"in vec4 vClr;\n"
+	"out vec4 outClr;\n"
+	"void main() {\n"
+	"  outClr = vClr;\n"
+	"}\n";
+
+// Shaft, then four head lines from the tip
+static const float g_arrow_mesh[10][4] = {
+	{ 0, 0, 0, 0 },	{ 0, 0, 1, 0 },
+	{ 0, 0, 1, 0 },	{ 1, 0, 1, 1 },
+	{ 0, 0, 1, 0 },	{-1, 0, 1, 1 },
+	{ 0, 0, 1, 0 },	{ 0, 1, 1, 1 },
+	{ 0, 0, 1, 0 },	{ 0,-1, 1, 1 },
+};
+
+LineBatcher::LineBatcher ()
+{
+	m_line_prog = 0; m_arrow_prog = 0;
+	m_line_vao = 0; m_arrow_vao = 0; m_arrow_mesh = 0;
+	m_verts.buf = 0; m_verts.map = 0x0;
+	m_arrows.buf = 0; m_arrows.map = 0x0;
+	for (int f = 0; f < LINES_FRAMES; f++) { m_verts.fence[f] = 0; m_arrows.fence[f] = 0; }
+	m_persistent = false;
+	m_base_instance = false;
+	m_frame = 0;
+	m_vp = 0x0; m_ap = 0x0;
+	m_num_verts = 0; m_num_arrows = 0;
+	m_draw_calls = 0; m_dropped = 0;
+}
+
+uint32_t LineBatcher::PackColor ( Vec4F c )
+{
+	int r = int(c.x * 255.0f + 0.5f), g = int(c.y * 255.0f + 0.5f), b = int(c.z * 255.0f + 0.5f), a = int(c.w * 255.0f + 0.5f);
+	r = (r < 0) ? 0 : (r > 255) ? 255 : r;
+	g = (g < 0) ? 0 : (g > 255) ? 255 : g;
+	b = (b < 0) ? 0 : (b > 255) ? 255 : b;
+	a = (a < 0) ? 0 : (a > 255) ? 255 : a;
+	return uint32_t(r) | (uint32_t(g) << 8) | (uint32_t(b) << 16) | (uint32_t(a) << 24);
+}
+
+bool LineBatcher::InitRing ( LineRing& r, size_t seg )
+{
+	r.seg = seg;
+	for (int f = 0; f < LINES_FRAMES; f++) r.fence[f] = 0;
+	glGenBuffers ( 1, &r.buf );
+	glBindBuffer ( GL_ARRAY_BUFFER, r.buf );
+	if ( m_persistent ) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage ( GL_ARRAY_BUFFER, seg * LINES_FRAMES, 0x0, flags );
+		r.map = (char*) glMapBufferRange ( GL_ARRAY_BUFFER, 0, seg * LINES_FRAMES, flags );
+	} else {
+		glBufferData ( GL_ARRAY_BUFFER, seg * LINES_FRAMES, 0x0, GL_STREAM_DRAW );
+		r.staging.resize ( seg );
+		r.map = r.staging.data();
+	}
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+	return r.map != 0x0;
+}
+
+bool LineBatcher::Init ()
+{
+	m_line_prog = glCompileProgram ( "lines", g_line_vs, g_line_fs );
+	m_arrow_prog = glCompileProgram ( "arrows", g_arrow_vs, g_line_fs );
+	if ( m_line_prog == 0 || m_arrow_prog == 0 ) return false;
+	m_line_view = glGetUniformLocation ( m_line_prog, "viewMatrix" );
+	m_line_proj = glGetUniformLocation ( m_line_prog, "projMatrix" );
+	m_arrow_view = glGetUniformLocation ( m_arrow_prog, "viewMatrix" );
+	m_arrow_proj = glGetUniformLocation ( m_arrow_prog, "projMatrix" );
+
+	m_persistent = GLEW_ARB_buffer_storage != 0;
+	m_base_instance = GLEW_ARB_base_instance != 0;
+	if ( !InitRing ( m_verts, LINES_MAX_VERTS * sizeof(LineBatchVert) ) ||
+		 !InitRing ( m_arrows, LINES_MAX_ARROWS * sizeof(LineBatchArrow) ) ) {
+		Clear ();
+		return false;
+	}
+
+	// Vertex attributes point at the start of the ring, draws pick the
+	// segment with first vertex / base instance. Base instance is GL 4.2,
+	// without it the arrow attributes are pointed at the segment each Flush.
+	glGenVertexArrays ( 1, &m_line_vao );
+	glBindVertexArray ( m_line_vao );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_verts.buf );
+	glEnableVertexAttribArray ( 0 );
+	glVertexAttribPointer ( 0, 3, GL_FLOAT, GL_FALSE, sizeof(LineBatchVert), (void*) offsetof(LineBatchVert, x) );
+	glEnableVertexAttribArray ( 1 );
+	glVertexAttribPointer ( 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LineBatchVert), (void*) offsetof(LineBatchVert, clr) );
+
+	glGenBuffers ( 1, &m_arrow_mesh );
+	glGenVertexArrays ( 1, &m_arrow_vao );
+	glBindVertexArray ( m_arrow_vao );
+	glBindBuffer ( GL_ARRAY_BUFFER, m_arrow_mesh );
+	glBufferData ( GL_ARRAY_BUFFER, sizeof(g_arrow_mesh), g_arrow_mesh, GL_STATIC_DRAW );
+	glEnableVertexAttribArray ( 0 );
+	glVertexAttribPointer ( 0, 4, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*) 0 );
+	glEnableVertexAttribArray ( 1 );
+	glVertexAttribDivisor ( 1, 1 );
+	glEnableVertexAttribArray ( 2 );
+	glVertexAttribDivisor ( 2, 1 );
+	glEnableVertexAttribArray ( 3 );
+	glVertexAttribDivisor ( 3, 1 );
+	PointArrows ( 0 );
+
+	glBindVertexArray ( 0 );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+
+	m_frame = 0;
+	Begin ();
+	return true;
+}
+
+// Arrow instance attributes at byte ofs of the ring, arrow VAO bound
+void LineBatcher::PointArrows ( size_t ofs )
+{
+	glBindBuffer ( GL_ARRAY_BUFFER, m_arrows.buf );
+	glVertexAttribPointer ( 1, 3, GL_FLOAT, GL_FALSE, sizeof(LineBatchArrow), (void*) (ofs + offsetof(LineBatchArrow, x)) );
+	glVertexAttribPointer ( 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LineBatchArrow), (void*) (ofs + offsetof(LineBatchArrow, clr)) );
+	glVertexAttribPointer ( 3, 4, GL_FLOAT, GL_FALSE, sizeof(LineBatchArrow), (void*) (ofs + offsetof(LineBatchArrow, vx)) );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+}
+
+void LineBatcher::WaitRing ( LineRing& r )
+{
+	GLsync& f = r.fence[m_frame];
+	if ( f == 0 ) return;
+	while ( glClientWaitSync ( f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 ) == GL_TIMEOUT_EXPIRED )
+		;
+	glDeleteSync ( f );
+	f = 0;
+}
+
+void LineBatcher::Begin ()
+{
+	m_frame = (m_frame + 1) % LINES_FRAMES;
+	m_num_verts = 0;
+	m_num_arrows = 0;
+	m_dropped = 0;
+	if ( m_verts.buf == 0 ) return;
+
+	WaitRing ( m_verts );
+	WaitRing ( m_arrows );
+	size_t vofs = m_persistent ? m_frame * m_verts.seg : 0;			// staging holds one segment
+	size_t aofs = m_persistent ? m_frame * m_arrows.seg : 0;
+	m_vp = (LineBatchVert*) (m_verts.map + vofs);
+	m_ap = (LineBatchArrow*) (m_arrows.map + aofs);
+}
+
+void LineBatcher::Line ( Vec3F a, Vec3F b, Vec4F ca, Vec4F cb )
+{
+	if ( m_vp == 0x0 || m_num_verts + 2 > LINES_MAX_VERTS ) { m_dropped++; return; }
+	LineBatchVert* v = m_vp + m_num_verts;
+	v[0].x = a.x; v[0].y = a.y; v[0].z = a.z; v[0].clr = PackColor ( ca );
+	v[1].x = b.x; v[1].y = b.y; v[1].z = b.z; v[1].clr = PackColor ( cb );
+	m_num_verts += 2;
+}
+
+void LineBatcher::Arrow ( Vec3F p, Vec3F v, Vec4F clr, float head )
+{
+	if ( m_ap == 0x0 || m_num_arrows >= LINES_MAX_ARROWS ) { m_dropped++; return; }
+	LineBatchArrow* a = m_ap + m_num_arrows;
+	a->x = p.x; a->y = p.y; a->z = p.z;
+	a->clr = PackColor ( clr );
+	a->vx = v.x; a->vy = v.y; a->vz = v.z;
+	a->head = head;
+	m_num_arrows++;
+}
+
+void LineBatcher::UploadRing ( LineRing& r, size_t bytes )
+{
+	if ( m_persistent || bytes == 0 ) return;			// coherent mapping, nothing to do
+	glBindBuffer ( GL_ARRAY_BUFFER, r.buf );
+	glBufferSubData ( GL_ARRAY_BUFFER, m_frame * r.seg, bytes, r.staging.data() );
+}
+
+void LineBatcher::Flush ( Camera3D* cam )
+{
+	m_draw_calls = 0;
+	if ( m_line_prog == 0 || (m_num_verts == 0 && m_num_arrows == 0) ) return;
+
+	UploadRing ( m_verts, m_num_verts * sizeof(LineBatchVert) );
+	UploadRing ( m_arrows, m_num_arrows * sizeof(LineBatchArrow) );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+
+	Matrix4F viewmtx = cam->getViewMatrix();
+	Matrix4F projmtx = cam->getProjMatrix();
+
+	glEnable ( GL_BLEND );
+	glBlendFunc ( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	glEnable ( GL_DEPTH_TEST );
+
+	if ( m_num_verts > 0 ) {
+		glUseProgram ( m_line_prog );
+		glUniformMatrix4fv ( m_line_view, 1, GL_FALSE, viewmtx.GetDataF() );
+		glUniformMatrix4fv ( m_line_proj, 1, GL_FALSE, projmtx.GetDataF() );
+		glBindVertexArray ( m_line_vao );
+		glDrawArrays ( GL_LINES, m_frame * LINES_MAX_VERTS, m_num_verts );
+		m_draw_calls++;
+	}
+	if ( m_num_arrows > 0 ) {
+		glUseProgram ( m_arrow_prog );
+		glUniformMatrix4fv ( m_arrow_view, 1, GL_FALSE, viewmtx.GetDataF() );
+		glUniformMatrix4fv ( m_arrow_proj, 1, GL_FALSE, projmtx.GetDataF() );
+		glBindVertexArray ( m_arrow_vao );
+		if ( m_base_instance ) {
+			glDrawArraysInstancedBaseInstance ( GL_LINES, 0, 10, m_num_arrows, m_frame * LINES_MAX_ARROWS );
+		} else {
+			PointArrows ( m_frame * m_arrows.seg );
+			glDrawArraysInstanced ( GL_LINES, 0, 10, m_num_arrows );
+		}
+		m_draw_calls++;
+	}
+	glBindVertexArray ( 0 );
+	glUseProgram ( 0 );
+
+	// Both rings were read by the draws above
+	m_verts.fence[m_frame] = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	m_arrows.fence[m_frame] = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+void LineBatcher::ClearRing ( LineRing& r )
+{
+	for (int f = 0; f < LINES_FRAMES; f++)
+		if ( r.fence[f] ) { glDeleteSync ( r.fence[f] ); r.fence[f] = 0; }
+	if ( r.buf ) {
+		if ( m_persistent && r.map ) {
+			glBindBuffer ( GL_ARRAY_BUFFER, r.buf );
+			glUnmapBuffer ( GL_ARRAY_BUFFER );
+			glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+		}
+		glDeleteBuffers ( 1, &r.buf );
+	}
+	r.buf = 0;
+	r.map = 0x0;
+	r.staging.clear ();
+}
+
+void LineBatcher::Clear ()
+{
+	ClearRing ( m_verts );
+	ClearRing ( m_arrows );
+	if ( m_arrow_mesh ) glDeleteBuffers ( 1, &m_arrow_mesh );
+	if ( m_line_vao ) glDeleteVertexArrays ( 1, &m_line_vao );
+	if ( m_arrow_vao ) glDeleteVertexArrays ( 1, &m_arrow_vao );
+	if ( m_line_prog ) glDeleteProgram ( m_line_prog );
+	if ( m_arrow_prog ) glDeleteProgram ( m_arrow_prog );
+	m_line_prog = 0; m_arrow_prog = 0;
+	m_line_vao = 0; m_arrow_vao = 0; m_arrow_mesh = 0;
+	m_vp = 0x0; m_ap = 0x0;
+	m_num_verts = 0; m_num_arrows = 0;
+	m_draw_calls = 0; m_dropped = 0;
+}
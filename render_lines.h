@@ -0,0 +1,98 @@
+//--------------------------------------------------------
+//
+// Line batcher - debug lines and arrows, one draw call each per frame
+//
+// Lines and arrows are written straight into a GPU buffer, then drawn with
+// one glDrawArrays for the lines and one instanced draw for the arrows. An
+// arrow is a single 32-byte instance (origin, vector, color) expanded to a
+// shaft and a four-line head in the vertex shader, so force vectors for a
+// whole fleet cost one call.
+//
+// The buffers are rings of LINES_FRAMES segments, one per frame in flight,
+// persistently mapped when ARB_buffer_storage is available. A fence per
+// segment keeps the CPU from overwriting one the GPU is still reading.
+// Without buffer storage each segment is staged and uploaded at Flush.
+// Instanced arrows pick their segment by base instance where there is
+// ARB_base_instance, otherwise by pointing the attributes at it.
+// Past the per-frame capacity lines are dropped and counted.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_RENDER_LINES
+	#define DEF_RENDER_LINES
+
+	#include <stdint.h>
+	#include <vector>
+	#include "render_gl.h"
+	#include "camera3d.h"
+
+	#define LINES_FRAMES		3				// ring segments, frames the GPU may lag behind
+	#define LINES_MAX_VERTS		(1 << 17)		// line vertices per frame (2 MB)
+	#define LINES_MAX_ARROWS	(1 << 17)		// arrows per frame (4 MB)
+
+	struct LineBatchVert {
+		float		x, y, z;
+		uint32_t	clr;						// RGBA8
+	};
+
+	struct LineBatchArrow {
+		float		x, y, z;					// tail
+		uint32_t	clr;
+		float		vx, vy, vz;					// tail to tip
+		float		head;						// head length, fraction of the arrow
+	};
+
+	// One buffer, LINES_FRAMES segments of seg bytes
+	struct LineRing {
+		GLuint		buf;
+		char*		map;						// persistent mapping, or the staging copy
+		std::vector<char> staging;
+		size_t		seg;
+		GLsync		fence[LINES_FRAMES];
+	};
+
+	class LineBatcher {
+	public:
+		LineBatcher ();
+
+		bool		Init ();								// create programs and buffers, call with a GL context
+		void		Clear ();
+
+		void		Begin ();								// start a frame, waits if the GPU still has its segment
+		void		Line ( Vec3F a, Vec3F b, Vec4F clr )	{ Line ( a, b, clr, clr ); }
+		void		Line ( Vec3F a, Vec3F b, Vec4F ca, Vec4F cb );
+		void		Arrow ( Vec3F p, Vec3F v, Vec4F clr, float head = 0.15f );
+		void		Flush ( Camera3D* cam );				// draw everything since Begin
+
+		int			getLines ()			{ return m_num_verts / 2; }		// since Begin
+		int			getArrows ()		{ return m_num_arrows; }
+		int			getDrawCalls ()		{ return m_draw_calls; }
+		int			getDropped ()		{ return m_dropped; }
+		bool		isPersistent ()		{ return m_persistent; }
+
+		static uint32_t	PackColor ( Vec4F c );
+
+	private:
+		bool		InitRing ( LineRing& r, size_t seg );
+		void		WaitRing ( LineRing& r );
+		void		UploadRing ( LineRing& r, size_t bytes );
+		void		ClearRing ( LineRing& r );
+		void		PointArrows ( size_t ofs );
+
+		GLuint		m_line_prog, m_arrow_prog;
+		GLint		m_line_view, m_line_proj, m_arrow_view, m_arrow_proj;
+		GLuint		m_line_vao, m_arrow_vao, m_arrow_mesh;
+		LineRing	m_verts, m_arrows;
+		bool		m_persistent;
+		bool		m_base_instance;				// ARB_base_instance, else arrows re-pointed per segment
+		int			m_frame;						// current segment
+		LineBatchVert*	m_vp;						// write pointers into the current segment
+		LineBatchArrow*	m_ap;
+		int			m_num_verts, m_num_arrows;
+		int			m_draw_calls, m_dropped;
+	};
+
+#endif
@@ -0,0 +1,117 @@
+//--------------------------------------------------------
+//
+// Terrain renderer - draws the clipmap levels from terrain_mesh
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "render_terrain.h"
+#include "terrain.h"
+
+static const char* g_terrain_vs =
+	"#version 330 core\n"
+	"layout(location=0) in vec3 inPos;\n"
+	"uniform mat4 viewMatrix;\n"
+	"uniform mat4 projMatrix;\n"
+	"out vec3 vWorld;\n"
+	"void main() {\n"
+	"  vWorld = inPos;\n"
+	"  gl_Position = projMatrix * viewMatrix * vec4(inPos, 1);\n"
+	"}\n";
+
+// Grass to rock with height, darker on steep slopes. Sea level is the runway plain.
+static const char* g_terrain_fs =
+	"#version 330 core\n"
+	"in vec3 vWorld;\n"
+	"out vec4 outClr;\n"
+	"void main() {\n"
+	"  vec3 n = normalize ( cross ( dFdx(vWorld), dFdy(vWorld) ) );\n"
+	"  if ( n.y < 0 ) n = -n;\n"
+	"  vec3 clr = mix ( vec3(0.25, 0.35, 0.2), vec3(0.45, 0.4, 0.35), clamp ( vWorld.y / 1200.0, 0.0, 1.0 ) );\n"
+	"  float light = 0.35 + 0.65 * max ( dot ( n, normalize(vec3(0.3, 1.0, 0.2)) ), 0.0 );\n"
+	"  outClr = vec4 ( clr * light, 1 );\n"
+	"}\n";
+
+TerrainRenderer::TerrainRenderer ()
+{
+	m_prog = 0;
+	for (int L = 0; L < CLIPMAP_LEVELS; L++) { m_vao[L] = 0; m_vbo[L] = 0; m_ibo[L] = 0; }
+	m_resampled = 0;
+	m_drawn_tris = 0;
+}
+
+bool TerrainRenderer::Init ( float base_spacing )
+{
+	m_prog = glCompileProgram ( "terrain", g_terrain_vs, g_terrain_fs );
+	if ( m_prog == 0 ) return false;
+	m_loc_view = glGetUniformLocation ( m_prog, "viewMatrix" );
+	m_loc_proj = glGetUniformLocation ( m_prog, "projMatrix" );
+
+	InitClipmap ( m_clip, base_spacing );
+	glGenVertexArrays ( CLIPMAP_LEVELS, m_vao );
+	glGenBuffers ( CLIPMAP_LEVELS, m_vbo );
+	glGenBuffers ( CLIPMAP_LEVELS, m_ibo );
+	for (int L = 0; L < CLIPMAP_LEVELS; L++) {
+		glBindVertexArray ( m_vao[L] );
+		glBindBuffer ( GL_ARRAY_BUFFER, m_vbo[L] );
+		glBufferData ( GL_ARRAY_BUFFER, m_clip.levels[L].verts.size() * sizeof(float), 0x0, GL_DYNAMIC_DRAW );
+		glEnableVertexAttribArray ( 0 );
+		glVertexAttribPointer ( 0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*) 0 );
+		glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, m_ibo[L] );		// recorded in the VAO
+	}
+	glBindVertexArray ( 0 );
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+	return true;
+}
+
+void TerrainRenderer::Draw ( Camera3D* cam, Terrain& terrain )
+{
+	if ( m_prog == 0 || !terrain.isOpen() ) return;
+
+	Vec3F eye = cam->getPos ();
+	terrain.BeginRead ();			// physics pages tiles on its own thread
+	m_resampled = UpdateClipmap ( m_clip, terrain, eye.x, eye.z );
+	terrain.EndRead ();
+
+	Matrix4F viewmtx = cam->getViewMatrix();
+	Matrix4F projmtx = cam->getProjMatrix();
+
+	glDisable ( GL_BLEND );
+	glEnable ( GL_DEPTH_TEST );
+	glUseProgram ( m_prog );
+	glUniformMatrix4fv ( m_loc_view, 1, GL_FALSE, viewmtx.GetDataF() );
+	glUniformMatrix4fv ( m_loc_proj, 1, GL_FALSE, projmtx.GetDataF() );
+
+	m_drawn_tris = 0;
+	for (int L = 0; L < CLIPMAP_LEVELS; L++) {
+		ClipmapLevel& l = m_clip.levels[L];
+		glBindVertexArray ( m_vao[L] );
+		if ( l.dirty ) {
+			glBindBuffer ( GL_ARRAY_BUFFER, m_vbo[L] );
+			glBufferSubData ( GL_ARRAY_BUFFER, 0, l.verts.size() * sizeof(float), l.verts.data() );
+			glBufferData ( GL_ELEMENT_ARRAY_BUFFER, l.indices.size() * sizeof(uint16_t), l.indices.data(), GL_DYNAMIC_DRAW );
+			l.dirty = false;
+		}
+		glDrawElements ( GL_TRIANGLES, (GLsizei) l.indices.size(), GL_UNSIGNED_SHORT, (void*) 0 );
+		m_drawn_tris += (int) l.indices.size() / 3;
+	}
+	glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+	glBindVertexArray ( 0 );
+	glUseProgram ( 0 );
+}
+
+void TerrainRenderer::Clear ()
+{
+	if ( m_vbo[0] ) {
+		glDeleteBuffers ( CLIPMAP_LEVELS, m_vbo );
+		glDeleteBuffers ( CLIPMAP_LEVELS, m_ibo );
+		glDeleteVertexArrays ( CLIPMAP_LEVELS, m_vao );
+	}
+	if ( m_prog ) glDeleteProgram ( m_prog );
+	m_prog = 0;
+	for (int L = 0; L < CLIPMAP_LEVELS; L++) { m_vao[L] = 0; m_vbo[L] = 0; m_ibo[L] = 0; }
+	m_resampled = 0;
+	m_drawn_tris = 0;
+}
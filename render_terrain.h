@@ -0,0 +1,40 @@
+//--------------------------------------------------------
+//
+// Terrain renderer - draws the clipmap levels from terrain_mesh
+//
+// Each level has its own vertex and index buffer, uploaded only when
+// UpdateClipmap resampled it or moved its hole. Shading is from the height
+// and the screen-space normal, so the vertices carry positions only.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_RENDER_TERRAIN
+	#define DEF_RENDER_TERRAIN
+
+	#include "render_gl.h"
+	#include "camera3d.h"
+	#include "terrain_mesh.h"
+
+	class TerrainRenderer {
+	public:
+		TerrainRenderer ();
+
+		bool		Init ( float base_spacing );				// create program, call with a GL context
+		void		Draw ( Camera3D* cam, Terrain& terrain );	// follows the camera
+		void		Clear ();
+
+		int			getResampled ()		{ return m_resampled; }	// levels resampled in the last Draw
+		int			getDrawnTris ()		{ return m_drawn_tris; }
+
+	private:
+		GLuint		m_prog;
+		GLuint		m_vao[CLIPMAP_LEVELS], m_vbo[CLIPMAP_LEVELS], m_ibo[CLIPMAP_LEVELS];
+		GLint		m_loc_view, m_loc_proj;
+		Clipmap		m_clip;
+		int			m_resampled, m_drawn_tris;
+	};
+
+#endif
@@ -0,0 +1,149 @@
+//--------------------------------------------------------
+//
+// SIMD math - vector polynomial sin, cos and acos for the AVX2 and NEON kernels
+//
+//   sin(x)   Cody-Waite reduction by pi, odd Taylor series to x^11 on [-pi/2,pi/2]
+//            |err| < 2e-7 for |x| < 1000
+//   cos(x)   sin(x + pi/2), |err| < 3e-7 for |x| < 1000
+//   acos(x)  Abramowitz & Stegun 4.4.46, sqrt(1-x) * poly7(x) on [0,1], mirrored for x < 0
+//            |err| < 4e-7 rad over [-1,1]
+//
+// AVX2 functions are compiled for AVX2 + FMA whatever the build flags, so
+// callers must check cpuHasAVX2 first.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_SIMD_MATH
+	#define DEF_SIMD_MATH
+
+	#include "cpu_features.h"
+
+	// Polynomial constants
+	#define SIMD_INV_PI		0.31830988618f
+	#define SIMD_HALF_PI	1.57079632679f
+	#define SIMD_PI			3.14159265359f
+	#define SIMD_PI_A		3.140625f				// pi = A + B + C, A and B exact for small multiples
+	#define SIMD_PI_B		0.0009675025939941406f
+	#define SIMD_PI_C		1.5099580252808664e-07f
+	#define SIMD_S3			-1.6666666667e-1f		// -1/3!
+	#define SIMD_S5			8.3333333333e-3f		//  1/5!
+	#define SIMD_S7			-1.9841269841e-4f		// -1/7!
+	#define SIMD_S9			2.7557319224e-6f		//  1/9!
+	#define SIMD_S11		-2.5052108385e-8f		// -1/11!
+	#define SIMD_AC0		1.5707963050f			// A&S 4.4.46
+	#define SIMD_AC1		-0.2145988016f
+	#define SIMD_AC2		0.0889789874f
+	#define SIMD_AC3		-0.0501743046f
+	#define SIMD_AC4		0.0308918810f
+	#define SIMD_AC5		-0.0170881256f
+	#define SIMD_AC6		0.0066700901f
+	#define SIMD_AC7		-0.0012624911f
+
+	//---------------------------------------------------------------- AVX2
+	#if defined(CPU_X86)
+
+	#include <immintrin.h>
+
+	#if defined(__GNUC__) || defined(__clang__)
+		#define SIMD_AVX2	__attribute__((target("avx2,fma")))
+	#else
+		#define SIMD_AVX2
+	#endif
+
+	SIMD_AVX2 static inline __m256 avx_sin ( __m256 x )
+	{
+		__m256 k = _mm256_round_ps ( _mm256_mul_ps ( x, _mm256_set1_ps(SIMD_INV_PI) ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+		__m256 r = _mm256_fnmadd_ps ( k, _mm256_set1_ps(SIMD_PI_A), x );
+		r = _mm256_fnmadd_ps ( k, _mm256_set1_ps(SIMD_PI_B), r );
+		r = _mm256_fnmadd_ps ( k, _mm256_set1_ps(SIMD_PI_C), r );
+		__m256 sign = _mm256_castsi256_ps ( _mm256_slli_epi32 ( _mm256_cvtps_epi32(k), 31 ) );	// odd multiples of pi flip sign
+
+		__m256 r2 = _mm256_mul_ps ( r, r );
+		__m256 p = _mm256_set1_ps ( SIMD_S11 );
+		p = _mm256_fmadd_ps ( p, r2, _mm256_set1_ps(SIMD_S9) );
+		p = _mm256_fmadd_ps ( p, r2, _mm256_set1_ps(SIMD_S7) );
+		p = _mm256_fmadd_ps ( p, r2, _mm256_set1_ps(SIMD_S5) );
+		p = _mm256_fmadd_ps ( p, r2, _mm256_set1_ps(SIMD_S3) );
+		p = _mm256_fmadd_ps ( _mm256_mul_ps ( p, r2 ), r, r );
+		return _mm256_xor_ps ( p, sign );
+	}
+
+	SIMD_AVX2 static inline __m256 avx_cos ( __m256 x )
+	{
+		return avx_sin ( _mm256_add_ps ( x, _mm256_set1_ps(SIMD_HALF_PI) ) );
+	}
+
+	SIMD_AVX2 static inline __m256 avx_acos ( __m256 x )
+	{
+		__m256 one = _mm256_set1_ps ( 1.0f );
+		x = _mm256_min_ps ( _mm256_max_ps ( x, _mm256_set1_ps(-1.0f) ), one );
+		__m256 neg = _mm256_cmp_ps ( x, _mm256_setzero_ps(), _CMP_LT_OQ );
+		__m256 ax = _mm256_andnot_ps ( _mm256_set1_ps(-0.0f), x );
+
+		__m256 p = _mm256_set1_ps ( SIMD_AC7 );
+		p = _mm256_fmadd_ps ( p, ax, _mm256_set1_ps(SIMD_AC6) );
+		p = _mm256_fmadd_ps ( p, ax, _mm256_set1_ps(SIMD_AC5) );
+		p = _mm256_fmadd_ps ( p, ax, _mm256_set1_ps(SIMD_AC4) );
+		p = _mm256_fmadd_ps ( p, ax, _mm256_set1_ps(SIMD_AC3) );
+		p = _mm256_fmadd_ps ( p, ax, _mm256_set1_ps(SIMD_AC2) );
+		p = _mm256_fmadd_ps ( p, ax, _mm256_set1_ps(SIMD_AC1) );
+		p = _mm256_fmadd_ps ( p, ax, _mm256_set1_ps(SIMD_AC0) );
+		__m256 r = _mm256_mul_ps ( _mm256_sqrt_ps ( _mm256_sub_ps ( one, ax ) ), p );
+		return _mm256_blendv_ps ( r, _mm256_sub_ps ( _mm256_set1_ps(SIMD_PI), r ), neg );		// acos(-x) = pi - acos(x)
+	}
+
+	#endif
+
+	//---------------------------------------------------------------- NEON
+	#if defined(CPU_ARM64)
+
+	#include <arm_neon.h>
+
+	static inline float32x4_t neon_sin ( float32x4_t x )
+	{
+		float32x4_t k = vrndnq_f32 ( vmulq_n_f32 ( x, SIMD_INV_PI ) );
+		float32x4_t r = vfmsq_f32 ( x, k, vdupq_n_f32(SIMD_PI_A) );
+		r = vfmsq_f32 ( r, k, vdupq_n_f32(SIMD_PI_B) );
+		r = vfmsq_f32 ( r, k, vdupq_n_f32(SIMD_PI_C) );
+		uint32x4_t sign = vshlq_n_u32 ( vreinterpretq_u32_s32 ( vcvtq_s32_f32(k) ), 31 );		// odd multiples of pi flip sign
+
+		float32x4_t r2 = vmulq_f32 ( r, r );
+		float32x4_t p = vdupq_n_f32 ( SIMD_S11 );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_S9), p, r2 );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_S7), p, r2 );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_S5), p, r2 );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_S3), p, r2 );
+		p = vfmaq_f32 ( r, vmulq_f32 ( p, r2 ), r );
+		return vreinterpretq_f32_u32 ( veorq_u32 ( vreinterpretq_u32_f32(p), sign ) );
+	}
+
+	static inline float32x4_t neon_cos ( float32x4_t x )
+	{
+		return neon_sin ( vaddq_f32 ( x, vdupq_n_f32(SIMD_HALF_PI) ) );
+	}
+
+	static inline float32x4_t neon_acos ( float32x4_t x )
+	{
+		float32x4_t one = vdupq_n_f32 ( 1.0f );
+		x = vminq_f32 ( vmaxq_f32 ( x, vdupq_n_f32(-1.0f) ), one );
+		uint32x4_t neg = vcltq_f32 ( x, vdupq_n_f32(0) );
+		float32x4_t ax = vabsq_f32 ( x );
+
+		float32x4_t p = vdupq_n_f32 ( SIMD_AC7 );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_AC6), p, ax );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_AC5), p, ax );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_AC4), p, ax );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_AC3), p, ax );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_AC2), p, ax );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_AC1), p, ax );
+		p = vfmaq_f32 ( vdupq_n_f32(SIMD_AC0), p, ax );
+		float32x4_t r = vmulq_f32 ( vsqrtq_f32 ( vsubq_f32 ( one, ax ) ), p );
+		return vbslq_f32 ( neg, vsubq_f32 ( vdupq_n_f32(SIMD_PI), r ), r );		// acos(-x) = pi - acos(x)
+	}
+
+	#endif
+
+#endif
@@ -0,0 +1,248 @@
+//--------------------------------------------------------
+//
+// Spatial grid - uniform grid index on the ground plane (x,z)
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "spatial_grid.h"
+#include <math.h>
+#include <algorithm>
+
+#define EMPTY_CELL		0xFFFFFFFFFFFFFFFFull		// not a valid key, cell coordinates are clamped below 2^30
+#define CELL_LIMIT		1073741824.0f
+
+static inline int CellCoord ( float v, float inv_cell )
+{
+	float c = floorf ( v * inv_cell );
+	if ( !(c > -CELL_LIMIT) ) c = -CELL_LIMIT;		// also catches NaN
+	if ( c > CELL_LIMIT ) c = CELL_LIMIT;
+	return (int) c;
+}
+
+//---- CellTable
+
+CellTable::CellTable ()
+{
+	Clear ();
+}
+
+void CellTable::Clear ()
+{
+	m_slots.clear ();
+	m_used = 0;
+	Rehash ( 64 );
+}
+
+static inline uint32_t CellHash ( uint64_t key, int shift )
+{
+	return (uint32_t) ((key * 0x9E3779B97F4A7C15ull) >> shift);
+}
+
+const CellTable::Slot* CellTable::Find ( uint64_t key ) const
+{
+	uint32_t mask = (uint32_t) m_slots.size() - 1;
+	for (uint32_t h = CellHash ( key, m_shift ); ; h = (h + 1) & mask) {
+		const Slot& s = m_slots[h];
+		if ( s.key == key ) return &s;
+		if ( s.key == EMPTY_CELL ) return 0x0;
+	}
+}
+
+CellTable::Slot* CellTable::Insert ( uint64_t key )
+{
+	uint32_t mask = (uint32_t) m_slots.size() - 1;
+	for (uint32_t h = CellHash ( key, m_shift ); ; h = (h + 1) & mask) {
+		Slot& s = m_slots[h];
+		if ( s.key == key ) return &s;
+		if ( s.key == EMPTY_CELL ) {
+			if ( (m_used + 1) * 2 > (int) m_slots.size() ) {		// keep load <= 1/2
+				Rehash ( (int) m_slots.size() * 2 );
+				return Insert ( key );
+			}
+			s.key = key;
+			s.first = -1;
+			s.count = 0;
+			m_used++;
+			return &s;
+		}
+	}
+}
+
+void CellTable::Rehash ( int size )
+{
+	std::vector<Slot> old;
+	old.swap ( m_slots );
+
+	Slot empty;
+	empty.key = EMPTY_CELL;
+	empty.first = -1;
+	empty.count = 0;
+	m_slots.assign ( size, empty );
+	m_shift = 64;
+	for (int n = size; n > 1; n >>= 1) m_shift--;
+	m_used = 0;
+
+	for (size_t k = 0; k < old.size(); k++) {
+		if ( old[k].key == EMPTY_CELL || old[k].count == 0 ) continue;
+		Slot* s = Insert ( old[k].key );
+		s->first = old[k].first;
+		s->count = old[k].count;
+	}
+}
+
+void CellTable::Compact ()
+{
+	Rehash ( (int) m_slots.size() );
+}
+
+//---- SpatialGrid
+
+SpatialGrid::SpatialGrid ( float cell_size )
+{
+	setCellSize ( cell_size );
+}
+
+void SpatialGrid::setCellSize ( float s )
+{
+	m_cell = s;
+	m_inv_cell = 1.0f / s;
+	Clear ();
+}
+
+void SpatialGrid::Clear ()
+{
+	m_table.Clear ();
+	m_cellkey.clear ();
+	m_next.clear (); m_prev.clear ();
+	m_x.clear (); m_z.clear ();
+	m_occupied = 0;
+	m_moves = 0;
+}
+
+void SpatialGrid::Link ( int i, uint64_t key )
+{
+	CellTable::Slot* s = m_table.Insert ( key );
+	m_cellkey[i] = key;
+	m_prev[i] = -1;
+	m_next[i] = s->first;
+	if ( s->first >= 0 ) m_prev[ s->first ] = i;
+	s->first = i;
+	if ( s->count++ == 0 ) m_occupied++;
+}
+
+void SpatialGrid::Unlink ( int i )
+{
+	CellTable::Slot* s = m_table.Insert ( m_cellkey[i] );		// always present
+	if ( m_prev[i] >= 0 )	m_next[ m_prev[i] ] = m_next[i];
+	else					s->first = m_next[i];
+	if ( m_next[i] >= 0 )	m_prev[ m_next[i] ] = m_prev[i];
+	if ( --s->count == 0 ) m_occupied--;
+}
+
+void SpatialGrid::Update ( int num, const float* px, const float* pz )
+{
+	m_moves = 0;
+
+	int old = (int) m_cellkey.size();
+	if ( num < old ) {
+		Clear ();						// fleet shrank, entries were renumbered
+		old = 0;
+	}
+	m_cellkey.resize ( num );
+	m_next.resize ( num ); m_prev.resize ( num );
+	m_x.resize ( num ); m_z.resize ( num );
+
+	for (int i = 0; i < num; i++) {
+		m_x[i] = px[i];
+		m_z[i] = pz[i];
+		uint64_t key = CellTable::Key ( CellCoord ( px[i], m_inv_cell ), CellCoord ( pz[i], m_inv_cell ) );
+		if ( i < old ) {
+			if ( key == m_cellkey[i] ) continue;
+			Unlink ( i );
+			m_moves++;
+		}
+		Link ( i, key );
+	}
+
+	// Cells left empty keep their slots until they outnumber the occupied ones
+	if ( m_table.getNumSlots() > 2 * m_occupied + 64 ) m_table.Compact ();
+}
+
+void SpatialGrid::NeighborsWithin ( float x, float z, float r, std::vector<int>& out ) const
+{
+	int cx0 = CellCoord ( x - r, m_inv_cell ), cx1 = CellCoord ( x + r, m_inv_cell );
+	int cz0 = CellCoord ( z - r, m_inv_cell ), cz1 = CellCoord ( z + r, m_inv_cell );
+	float r2 = r * r;
+
+	for (int cx = cx0; cx <= cx1; cx++) {
+		for (int cz = cz0; cz <= cz1; cz++) {
+			const CellTable::Slot* s = m_table.Find ( CellTable::Key ( cx, cz ) );
+			if ( s == 0x0 ) continue;
+			for (int i = s->first; i >= 0; i = m_next[i]) {
+				float dx = m_x[i] - x, dz = m_z[i] - z;
+				if ( dx*dx + dz*dz <= r2 ) out.push_back ( i );
+			}
+		}
+	}
+}
+
+//---- RunwayIndex
+
+RunwayIndex::RunwayIndex ( float cell_size )
+{
+	m_cell = cell_size;
+	m_inv_cell = 1.0f / cell_size;
+}
+
+void RunwayIndex::Build ( const std::vector<Runway>& runways )
+{
+	m_runways = runways;
+	m_sin.resize ( runways.size() );
+	m_cos.resize ( runways.size() );
+	m_table.Clear ();
+	m_list.clear ();
+
+	// (cell, runway) pairs for every cell a runway's bounding box overlaps
+	std::vector< std::pair<uint64_t, int> > pairs;
+	for (int k = 0; k < (int) runways.size(); k++) {
+		const Runway& r = runways[k];
+		float a = r.heading * 3.141592653589f / 180.0f;
+		m_sin[k] = (r.heading == 0) ? 0 : sinf ( a );
+		m_cos[k] = (r.heading == 0) ? 1 : cosf ( a );
+		float ex = fabs ( m_cos[k] ) * r.half_width + fabs ( m_sin[k] ) * r.half_length;
+		float ez = fabs ( m_sin[k] ) * r.half_width + fabs ( m_cos[k] ) * r.half_length;
+		int cx0 = CellCoord ( r.x - ex, m_inv_cell ), cx1 = CellCoord ( r.x + ex, m_inv_cell );
+		int cz0 = CellCoord ( r.z - ez, m_inv_cell ), cz1 = CellCoord ( r.z + ez, m_inv_cell );
+		for (int cx = cx0; cx <= cx1; cx++)
+			for (int cz = cz0; cz <= cz1; cz++)
+				pairs.push_back ( std::make_pair ( CellTable::Key ( cx, cz ), k ) );
+	}
+	std::sort ( pairs.begin(), pairs.end() );
+
+	// Runways of a cell are contiguous in m_list, in runway order
+	for (size_t p = 0; p < pairs.size(); p++) {
+		CellTable::Slot* s = m_table.Insert ( pairs[p].first );
+		if ( s->count == 0 ) s->first = (int) m_list.size();
+		s->count++;
+		m_list.push_back ( pairs[p].second );
+	}
+}
+
+int RunwayIndex::RunwayAt ( float x, float z ) const
+{
+	const CellTable::Slot* s = m_table.Find ( CellTable::Key ( CellCoord ( x, m_inv_cell ), CellCoord ( z, m_inv_cell ) ) );
+	if ( s == 0x0 ) return -1;
+
+	for (int n = s->first; n < s->first + s->count; n++) {
+		int k = m_list[n];
+		const Runway& r = m_runways[k];
+		float dx = x - r.x, dz = z - r.z;
+		float along = dz * m_cos[k] + dx * m_sin[k];
+		float across = dx * m_cos[k] - dz * m_sin[k];
+		if ( across > -r.half_width && across < r.half_width && along > -r.half_length && along < r.half_length ) return k;
+	}
+	return -1;
+}
@@ -0,0 +1,109 @@
+//--------------------------------------------------------
+//
+// Spatial grid - uniform grid index on the ground plane (x,z)
+//
+// SpatialGrid keeps every aircraft in a square cell of the ground plane.
+// Cells are found through an open-addressing hash of the cell coordinates,
+// so the world is unbounded and only occupied cells cost memory. Each cell
+// heads a doubly linked list threaded through per-aircraft arrays. Update is
+// incremental: an aircraft is relinked only when it crosses a cell border,
+// which at flight speeds and a 1 ms step is rare, so a step costs one cell
+// computation and compare per aircraft.
+//
+// RunwayIndex is the static counterpart for runways, built once: each runway
+// is listed in every cell its bounds overlap, so "which runway am I over"
+// tests only the few runways of one cell.
+//
+// Both answer queries in O(1) average for a cell size near the query radius.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_SPATIAL_GRID
+	#define DEF_SPATIAL_GRID
+
+	#include <stdint.h>
+	#include <vector>
+
+	// Runway rectangle. Heading 0 runs the length along +z, as the runway at the origin.
+	struct Runway {
+		float	x, z;							// center (m)
+		float	heading;						// deg, clockwise from +z toward +x
+		float	half_width, half_length;		// (m)
+	};
+
+	// Hash table from cell coordinates to a (first, count) pair
+	class CellTable {
+	public:
+		struct Slot {
+			uint64_t	key;
+			int			first, count;
+		};
+		CellTable ();
+
+		void		Clear ();
+		const Slot*	Find ( uint64_t key ) const;		// 0x0 if absent
+		Slot*		Insert ( uint64_t key );			// existing or new slot
+		void		Compact ();							// drop slots with count 0
+		int			getNumSlots ()		{ return m_used; }		// including empty cells not yet compacted
+
+		static uint64_t	Key ( int cx, int cz )	{ return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cz); }
+
+	private:
+		void		Rehash ( int size );
+
+		std::vector<Slot> m_slots;					// power of two, key EMPTY_CELL when free
+		int			m_used;
+		int			m_shift;
+	};
+
+	class SpatialGrid {
+	public:
+		SpatialGrid ( float cell_size = 1000 );
+
+		void		setCellSize ( float s );		// clears the grid
+		float		getCellSize ()		{ return m_cell; }
+		void		Clear ();
+
+		// Move entries [0, num) to their new positions, adding new ones
+		void		Update ( int num, const float* px, const float* pz );
+
+		// Entries within horizontal distance r of (x, z), appended to out
+		void		NeighborsWithin ( float x, float z, float r, std::vector<int>& out ) const;
+
+		int			getNumEntries ()	{ return (int) m_cellkey.size(); }
+		int			getNumCells ()		{ return m_occupied; }
+		int			getMoves ()			{ return m_moves; }	// relinks in the last Update
+
+	private:
+		void		Link ( int i, uint64_t key );
+		void		Unlink ( int i );
+
+		float		m_cell, m_inv_cell;
+		CellTable	m_table;						// first = list head
+		std::vector<uint64_t> m_cellkey;			// per entry
+		std::vector<int> m_next, m_prev;
+		std::vector<float> m_x, m_z;				// positions as of the last Update
+		int			m_occupied;
+		int			m_moves;
+	};
+
+	class RunwayIndex {
+	public:
+		RunwayIndex ( float cell_size = 1000 );
+
+		void		Build ( const std::vector<Runway>& runways );
+		int			RunwayAt ( float x, float z ) const;		// runway index, or -1
+		int			getNumRunways ()	{ return (int) m_runways.size(); }
+
+	private:
+		float		m_cell, m_inv_cell;
+		CellTable	m_table;						// first, count into m_list
+		std::vector<int> m_list;
+		std::vector<Runway> m_runways;
+		std::vector<float> m_sin, m_cos;
+	};
+
+#endif
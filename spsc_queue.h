@@ -0,0 +1,52 @@
+//--------------------------------------------------------
+//
+// SPSC queue - lock-free bounded queue, one producer and one consumer
+//
+// A ring of N entries (a power of two) with a head written only by the
+// consumer and a tail written only by the producer, each on its own cache
+// line. Push fails when full rather than waiting, Pop fails when empty.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_SPSC_QUEUE
+	#define DEF_SPSC_QUEUE
+
+	#include <stdint.h>
+	#include <atomic>
+
+	template<class T, int N> class SpscQueue {
+	public:
+		static_assert ( (N & (N-1)) == 0, "SpscQueue size must be a power of two" );
+
+		SpscQueue () : m_head ( 0 ), m_tail ( 0 )		{}
+
+		// Producer
+		bool		Push ( const T& v ) {
+			uint32_t t = m_tail.load ( std::memory_order_relaxed );
+			if ( t - m_head.load ( std::memory_order_acquire ) >= (uint32_t) N ) return false;		// full
+			m_items[t & (N-1)] = v;
+			m_tail.store ( t + 1, std::memory_order_release );
+			return true;
+		}
+
+		// Consumer
+		bool		Pop ( T& v ) {
+			uint32_t h = m_head.load ( std::memory_order_relaxed );
+			if ( h == m_tail.load ( std::memory_order_acquire ) ) return false;			// empty
+			v = m_items[h & (N-1)];
+			m_head.store ( h + 1, std::memory_order_release );
+			return true;
+		}
+
+		bool		isEmpty ()		{ return m_head.load ( std::memory_order_acquire ) == m_tail.load ( std::memory_order_acquire ); }
+
+	private:
+		alignas(64) std::atomic<uint32_t> m_head;		// next to pop, written by the consumer
+		alignas(64) std::atomic<uint32_t> m_tail;		// next to push, written by the producer
+		alignas(64) T		m_items[N];
+	};
+
+#endif
@@ -0,0 +1,402 @@
+//--------------------------------------------------------
+//
+// Telemetry - columnar fleet telemetry streamed to an Arrow IPC file
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "telemetry.h"
+#include "common_defs.h"
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+// Columns. Roll, pitch and heading are made by the writer from the
+// orientation, which is captured after the written columns.
+#define TC_TIME			0
+#define TC_ID			1
+#define TC_ROLL			8
+#define TC_PITCH		9
+#define TC_HEADING		10
+#define TC_LANDINGS		22
+#define TC_LAND_FLAGS	23
+#define TC_LAND_RUNWAY	24
+#define TC_QX			29
+#define TC_QY			30
+#define TC_QZ			31
+#define TC_QW			32
+#define TC_NUM			33
+
+struct TelChannel {
+	const char*	name;
+	int			type;				// ARROW_
+	int			group;				// TEL_, 0 = always
+	FloatArray FlightModel::* src;	// copied as is, 0x0 = made in Fill or Encode
+};
+
+static const TelChannel g_channels[TC_NUM] = {
+	{ "time",		ARROW_F64,	0,				0x0 },
+	{ "id",			ARROW_I32,	0,				0x0 },
+	{ "x",			ARROW_F32,	TEL_STATE,		&FlightModel::m_px },
+	{ "y",			ARROW_F32,	TEL_STATE,		&FlightModel::m_py },
+	{ "z",			ARROW_F32,	TEL_STATE,		&FlightModel::m_pz },
+	{ "speed",		ARROW_F32,	TEL_STATE,		&FlightModel::m_speed },
+	{ "aoa",		ARROW_F32,	TEL_STATE,		&FlightModel::m_aoa },
+	{ "vy",			ARROW_F32,	TEL_STATE,		&FlightModel::m_vy },
+	{ "roll",		ARROW_F32,	TEL_ATTITUDE,	0x0 },
+	{ "pitch",		ARROW_F32,	TEL_ATTITUDE,	0x0 },
+	{ "heading",	ARROW_F32,	TEL_ATTITUDE,	0x0 },
+	{ "power",		ARROW_F32,	TEL_CONTROLS,	&FlightModel::m_power },
+	{ "flaps",		ARROW_F32,	TEL_CONTROLS,	&FlightModel::m_flaps },
+	{ "lift_x",		ARROW_F32,	TEL_FORCES,		&FlightModel::m_lx },
+	{ "lift_y",		ARROW_F32,	TEL_FORCES,		&FlightModel::m_ly },
+	{ "lift_z",		ARROW_F32,	TEL_FORCES,		&FlightModel::m_lz },
+	{ "drag_x",		ARROW_F32,	TEL_FORCES,		&FlightModel::m_dx },
+	{ "drag_y",		ARROW_F32,	TEL_FORCES,		&FlightModel::m_dy },
+	{ "drag_z",		ARROW_F32,	TEL_FORCES,		&FlightModel::m_dz },
+	{ "thrust_x",	ARROW_F32,	TEL_FORCES,		&FlightModel::m_tx },
+	{ "thrust_y",	ARROW_F32,	TEL_FORCES,		&FlightModel::m_ty },
+	{ "thrust_z",	ARROW_F32,	TEL_FORCES,		&FlightModel::m_tz },
+	{ "landings",	ARROW_I32,	TEL_LANDING,	0x0 },
+	{ "land_flags",	ARROW_I32,	TEL_LANDING,	0x0 },
+	{ "land_runway", ARROW_I32,	TEL_LANDING,	0x0 },
+	{ "land_speed",	ARROW_F32,	TEL_LANDING,	&FlightModel::m_land_speed },
+	{ "land_sink",	ARROW_F32,	TEL_LANDING,	&FlightModel::m_land_sink },
+	{ "land_pitch",	ARROW_F32,	TEL_LANDING,	&FlightModel::m_land_pitch },
+	{ "land_roll",	ARROW_F32,	TEL_LANDING,	&FlightModel::m_land_roll },
+	{ "qx",			ARROW_F32,	TEL_ATTITUDE,	&FlightModel::m_qx },
+	{ "qy",			ARROW_F32,	TEL_ATTITUDE,	&FlightModel::m_qy },
+	{ "qz",			ARROW_F32,	TEL_ATTITUDE,	&FlightModel::m_qz },
+	{ "qw",			ARROW_F32,	TEL_ATTITUDE,	&FlightModel::m_qw },
+};
+
+static const char* g_group_names[] = { "state", "attitude", "controls", "forces", "landing" };
+
+#define TE_NUM			8
+
+static const ArrowColumn g_event_cols[TE_NUM] = {
+	{ "time", ARROW_F64 }, { "type", ARROW_I32 }, { "a", ARROW_I32 }, { "b", ARROW_I32 },
+	{ "dist", ARROW_F32 }, { "x", ARROW_F32 }, { "y", ARROW_F32 }, { "z", ARROW_F32 },
+};
+
+TelemetrySink::TelemetrySink ()
+{
+	m_fp = 0x0;
+	m_every = 1;
+	m_stride = 1;
+	m_groups = TEL_ALL;
+	m_wait = true;
+	m_calls = 0;
+	m_rows = 0;
+	m_dropped = 0;
+	m_num_out = 0;
+	m_failed = false;
+	m_chunks = 0x0;
+	m_cur = 0x0;
+	m_batches = 0;
+	m_bytes = 0;
+	m_quit = false;
+	m_events_fp = 0x0;
+	m_events = 0;
+}
+
+int TelemetrySink::ParseGroups ( const char* list )
+{
+	int groups = 0;
+	char name[64];
+	while ( *list ) {
+		int len = (int) strcspn ( list, "," );
+		if ( len > 63 ) return -1;
+		memcpy ( name, list, len );
+		name[len] = '\0';
+		int g;
+		for (g = 0; g < 5; g++)
+			if ( strcmp ( name, g_group_names[g] ) == 0 ) break;
+		if ( g < 5 )							groups |= (1 << g);
+		else if ( strcmp ( name, "all" ) == 0 )	groups |= TEL_ALL;
+		else									return -1;
+		list += len;
+		if ( *list == ',' ) list++;
+	}
+	return groups;
+}
+
+bool TelemetrySink::Open ( const char* fname, int every, int stride, int groups, bool wait )
+{
+	Close ();
+	m_fp = fopen ( fname, "wb" );
+	if ( m_fp == 0x0 ) {
+		dbgprintf ( "ERROR: Unable to write telemetry %s\n", fname );
+		return false;
+	}
+	m_file_buf.resize ( TEL_FILE_BUFFER );
+	setvbuf ( m_fp, m_file_buf.data(), _IOFBF, m_file_buf.size() );
+	m_every = std::max ( every, 1 );
+	m_stride = std::max ( stride, 1 );
+	m_groups = groups & TEL_ALL;
+	m_wait = wait;
+
+	// Written columns in schema order, then the orientation for the angles
+	std::vector<ArrowColumn> schema;
+	m_cols.clear ();
+	for (int c = 0; c < TC_QX; c++) {
+		if ( g_channels[c].group != 0 && !(g_channels[c].group & m_groups) ) continue;
+		m_cols.push_back ( c );
+		ArrowColumn col = { g_channels[c].name, g_channels[c].type };
+		schema.push_back ( col );
+	}
+	m_num_out = (int) m_cols.size();
+	if ( m_groups & TEL_ATTITUDE )
+		for (int c = TC_QX; c <= TC_QW; c++) m_cols.push_back ( c );
+
+	size_t size = 0;
+	m_col_offset.assign ( TC_NUM, 0 );
+	for (size_t k = 0; k < m_cols.size(); k++) {
+		m_col_offset[ m_cols[k] ] = size;
+		size += (size_t) TEL_CHUNK_ROWS * ArrowStreamWriter::TypeSize ( g_channels[ m_cols[k] ].type );
+	}
+	m_chunks = new Chunk[ TEL_CHUNKS ];
+	m_free.clear ();
+	for (int k = 0; k < TEL_CHUNKS; k++) {
+		m_chunks[k].rows = 0;
+		m_chunks[k].data.resize ( size );
+		m_free.push_back ( &m_chunks[k] );
+	}
+	m_out.resize ( m_num_out );
+
+	// contact events beside, x.arrows as x.events.arrows
+	std::string name = fname;
+	size_t dot = name.find_last_of ( '.' );
+	size_t slash = name.find_last_of ( "/\\" );
+	if ( dot == std::string::npos || (slash != std::string::npos && dot < slash) ) dot = name.size();
+	m_events_name = name.substr ( 0, dot ) + ".events" + name.substr ( dot );
+	ContactEvent e;
+	while ( m_contacts.Pop ( e ) ) ;					// left from before, the writer is not running
+	m_ev.clear ();
+	m_ev.reserve ( TEL_EVENT_ROWS );
+	m_events = 0;
+
+	m_calls = 0;
+	m_rows = 0;
+	m_dropped = 0;
+	m_batches = 0;
+	m_cur = 0x0;
+	m_failed = false;
+	m_quit = false;
+	m_arrow.Begin ( m_fp, m_num_out, schema.data() );
+	m_bytes = m_arrow.getBytes ();
+	m_writer = std::thread ( &TelemetrySink::WriterLoop, this );
+	return true;
+}
+
+void TelemetrySink::Close ()
+{
+	if ( m_fp == 0x0 ) return;
+	if ( m_cur && m_cur->rows > 0 ) Submit ();
+	{
+		std::lock_guard<std::mutex> lock ( m_mutex );
+		m_quit = true;
+	}
+	m_wake.notify_all ();
+	m_writer.join ();					// after the queue is written
+
+	if ( !m_arrow.End () ) dbgprintf ( "ERROR: Telemetry write failed.\n" );
+	m_bytes = m_arrow.getBytes ();
+	fclose ( m_fp );
+	m_fp = 0x0;
+	if ( m_dropped > 0 ) dbgprintf ( "Telemetry: %llu rows dropped, the writer was behind.\n", (unsigned long long) m_dropped );
+
+	delete [] m_chunks;
+	m_chunks = 0x0;
+	m_cur = 0x0;
+	m_free.clear ();
+	m_queue.clear ();
+}
+
+void TelemetrySink::Capture ( FlightModel& m )
+{
+	if ( m_fp == 0x0 || m_calls++ % m_every != 0 ) return;
+
+	int num = m.getNumAircraft ();
+	double time = m.getTime ();
+	for (int i = 0; i < num; ) {
+		int want = (num - i + m_stride - 1) / m_stride;
+		if ( m_cur == 0x0 && !NextChunk () ) {
+			m_dropped += want;
+			return;
+		}
+		int n = std::min ( want, TEL_CHUNK_ROWS - m_cur->rows );
+		Fill ( *m_cur, m, i, n, time );
+		m_cur->rows += n;
+		m_rows += n;
+		i += n * m_stride;
+		if ( m_cur->rows == TEL_CHUNK_ROWS ) Submit ();
+	}
+}
+
+// n rows from aircraft first, every m_stride-th, appended to the chunk
+void TelemetrySink::Fill ( Chunk& c, FlightModel& m, int first, int n, double time )
+{
+	int r = c.rows, st = m_stride;
+	for (size_t k = 0; k < m_cols.size(); k++) {
+		int col = m_cols[k];
+		void* dst = Column ( c, col );
+		switch ( col ) {
+		case TC_TIME: {
+			double* d = (double*) dst + r;
+			for (int j = 0; j < n; j++) d[j] = time;
+			} break;
+		case TC_ID: {
+			int32_t* d = (int32_t*) dst + r;
+			for (int j = 0; j < n; j++) d[j] = first + j*st;
+			} break;
+		case TC_LANDINGS: case TC_LAND_RUNWAY: {
+			const int* s = (col == TC_LANDINGS) ? &m.m_land_count[first] : &m.m_land_runway[first];
+			int32_t* d = (int32_t*) dst + r;
+			for (int j = 0; j < n; j++) d[j] = s[j*st];
+			} break;
+		case TC_LAND_FLAGS: {
+			const uint8_t* s = &m.m_land_flags[first];
+			int32_t* d = (int32_t*) dst + r;
+			for (int j = 0; j < n; j++) d[j] = s[j*st];
+			} break;
+		case TC_ROLL: case TC_PITCH: case TC_HEADING:
+			break;
+		default: {
+			const float* s = &(m.*g_channels[col].src)[first];
+			float* d = (float*) dst + r;
+			if ( st == 1 )	memcpy ( d, s, n * sizeof(float) );
+			else			for (int j = 0; j < n; j++) d[j] = s[j*st];
+			} break;
+		};
+	}
+}
+
+bool TelemetrySink::NextChunk ()
+{
+	std::unique_lock<std::mutex> lock ( m_mutex );
+	if ( m_free.empty() ) {
+		if ( !m_wait ) return false;
+		m_done.wait ( lock, [this] { return !m_free.empty(); } );
+	}
+	m_cur = m_free.back ();
+	m_free.pop_back ();
+	return true;
+}
+
+void TelemetrySink::Submit ()
+{
+	{
+		std::lock_guard<std::mutex> lock ( m_mutex );
+		m_queue.push_back ( m_cur );
+	}
+	m_cur = 0x0;
+	m_wake.notify_all ();
+}
+
+void TelemetrySink::WriterLoop ()
+{
+	std::unique_lock<std::mutex> lock ( m_mutex );
+	for (;;) {
+		m_wake.wait_for ( lock, std::chrono::milliseconds ( TEL_EVENT_POLL ), [this] { return m_quit || !m_queue.empty(); } );
+		if ( m_queue.empty() ) {
+			bool quit = m_quit;
+			lock.unlock ();
+			PollEvents ( quit );
+			if ( quit ) return;							// quitting, all written
+			lock.lock ();
+			continue;
+		}
+		Chunk* c = m_queue.front ();
+		m_queue.pop_front ();
+		lock.unlock ();
+
+		Encode ( *c );
+		PollEvents ( false );
+
+		lock.lock ();
+		c->rows = 0;
+		m_free.push_back ( c );
+		m_done.notify_all ();
+	}
+}
+
+// Writer thread. Pops the queued contact events, writing full batches, and
+// the rest and the end of the stream when last.
+void TelemetrySink::PollEvents ( bool last )
+{
+	ContactEvent e;
+	while ( m_contacts.Pop ( e ) ) {
+		m_ev.push_back ( e );
+		if ( m_ev.size() == TEL_EVENT_ROWS ) WriteEvents ();
+	}
+	if ( !last ) return;
+	if ( !m_ev.empty() ) WriteEvents ();
+	if ( m_events_fp ) {
+		m_events_arrow.End ();
+		fclose ( m_events_fp );
+		m_events_fp = 0x0;
+	}
+}
+
+void TelemetrySink::WriteEvents ()
+{
+	if ( m_events_fp == 0x0 ) {
+		m_events_fp = fopen ( m_events_name.c_str(), "wb" );
+		if ( m_events_fp == 0x0 ) {
+			if ( !m_failed ) dbgprintf ( "ERROR: Unable to write telemetry %s\n", m_events_name.c_str() );
+			m_failed = true;
+			m_ev.clear ();
+			return;
+		}
+		m_events_arrow.Begin ( m_events_fp, TE_NUM, g_event_cols );
+	}
+	int n = (int) m_ev.size();
+	m_ev_cols.resize ( (size_t) n * (8 + 7*4) );
+	double* time = (double*) m_ev_cols.data();
+	int32_t* type = (int32_t*) (time + n);
+	int32_t* a = type + n;
+	int32_t* b = a + n;
+	float* dist = (float*) (b + n);
+	float* x = dist + n;
+	float* y = x + n;
+	float* z = y + n;
+	for (int k = 0; k < n; k++) {
+		const ContactEvent& e = m_ev[k];
+		time[k] = e.time;	type[k] = e.type;	a[k] = e.a;		b[k] = e.b;
+		dist[k] = e.dist;	x[k] = e.x;			y[k] = e.y;		z[k] = e.z;
+	}
+	const void* cols[TE_NUM] = { time, type, a, b, dist, x, y, z };
+	if ( !m_events_arrow.WriteBatch ( n, cols ) && !m_failed ) {
+		dbgprintf ( "ERROR: Telemetry write failed.\n" );
+		m_failed = true;
+	}
+	m_events += n;
+	m_ev.clear ();
+}
+
+void TelemetrySink::Encode ( Chunk& c )
+{
+	// Angles as the HUD shows them
+	if ( m_groups & TEL_ATTITUDE ) {
+		const float *qx = (float*) Column ( c, TC_QX ), *qy = (float*) Column ( c, TC_QY );
+		const float *qz = (float*) Column ( c, TC_QZ ), *qw = (float*) Column ( c, TC_QW );
+		float *roll = (float*) Column ( c, TC_ROLL ), *pitch = (float*) Column ( c, TC_PITCH ), *heading = (float*) Column ( c, TC_HEADING );
+		Quaternion q;
+		Vec3F angs;
+		for (int j = 0; j < c.rows; j++) {
+			q.X = qx[j]; q.Y = qy[j]; q.Z = qz[j]; q.W = qw[j];
+			q.toEuler ( angs );
+			roll[j] = angs.x; pitch[j] = angs.y; heading[j] = angs.z;
+		}
+	}
+	for (int k = 0; k < m_num_out; k++) m_out[k] = Column ( c, m_cols[k] );
+	if ( !m_arrow.WriteBatch ( c.rows, m_out.data() ) && !m_failed ) {
+		dbgprintf ( "ERROR: Telemetry write failed.\n" );
+		m_failed = true;
+	}
+	m_batches++;
+	m_bytes = m_arrow.getBytes ();
+}
@@ -0,0 +1,129 @@
+//--------------------------------------------------------
+//
+// Telemetry - columnar fleet telemetry streamed to an Arrow IPC file
+//
+// Every channel the HUD shows, for every aircraft, as one row per aircraft
+// per sample: time, id, position and altitude, speed, AOA, sink rate,
+// roll/pitch/heading (toEuler, deg), power, flaps, lift, drag and thrust,
+// and the last touchdown. Columns are named as the batch CSV.
+//
+// Capture runs on the stepping thread between steps and only copies the
+// model's arrays into a chunk of TEL_CHUNK_ROWS rows per channel. Full
+// chunks go to a writer thread, which converts orientations to angles and
+// writes each chunk as one Arrow record batch. Chunks are recycled, so a
+// long run allocates nothing after Open. If the writer falls behind,
+// Capture waits for a free chunk, or drops the sample when opened without
+// waiting (realtime stepping), counting the dropped rows.
+//
+// Decimation: a sample every 'every' Capture calls, every 'stride'-th
+// aircraft, and only the TEL_ channel groups asked for.
+//
+// Contact events (broadphase.h) pushed to getContactQueue are popped by the
+// writer thread, at least every TEL_EVENT_POLL ms, and written undecimated
+// as a second stream beside the first, <name>.events.arrows: time, type, a,
+// b, dist, x, y, z. It is made on the first event.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_TELEMETRY
+	#define DEF_TELEMETRY
+
+	#include <stdio.h>
+	#include <stdint.h>
+	#include <vector>
+	#include <string>
+	#include <deque>
+	#include <atomic>
+	#include <thread>
+	#include <mutex>
+	#include <condition_variable>
+	#include "flight_model.h"
+	#include "arrow_ipc.h"
+	#include "broadphase.h"
+
+	// Channel groups, time and id are always written
+	#define TEL_STATE			1			// x, y, z, speed, aoa, vy
+	#define TEL_ATTITUDE		2			// roll, pitch, heading
+	#define TEL_CONTROLS		4			// power, flaps
+	#define TEL_FORCES			8			// lift, drag, thrust xyz
+	#define TEL_LANDING			16			// touchdowns, flags, runway, speed, sink, pitch, roll
+	#define TEL_ALL				31
+
+	#define TEL_CHUNK_ROWS		65536		// rows per chunk and record batch
+	#define TEL_CHUNKS			4			// chunks in the pool, 8 MB each with all channels
+	#define TEL_FILE_BUFFER		(1<<20)		// stdio buffer of the writer (bytes)
+	#define TEL_EVENT_ROWS		4096		// contact events per record batch
+	#define TEL_EVENT_POLL		50			// ms between contact queue checks
+
+	class TelemetrySink {
+	public:
+		TelemetrySink ();
+		~TelemetrySink ()		{ Close(); }
+
+		bool		Open ( const char* fname, int every = 1, int stride = 1, int groups = TEL_ALL, bool wait = true );
+		void		Close ();						// writes what is captured and ends the stream
+		bool		isOpen ()			{ return m_fp != 0x0; }
+		static int	ParseGroups ( const char* list );	// "state,forces,..." or "all", -1 if unknown
+
+		// Stepping thread, between steps. Samples on every 'every'-th call.
+		void		Capture ( FlightModel& m );
+		ContactQueue* getContactQueue ()	{ return &m_contacts; }		// for Broadphase::AddQueue
+
+		uint64_t	getRows ()			{ return m_rows; }			// captured
+		uint64_t	getDropped ()		{ return m_dropped; }
+		int			getBatches ()		{ return m_batches.load(); }	// written
+		uint64_t	getBytes ()			{ return m_bytes.load(); }
+		uint64_t	getEvents ()		{ return m_events.load(); }		// contact events written
+
+	private:
+		struct Chunk {
+			int		rows;
+			std::vector<uint8_t> data;			// TEL_CHUNK_ROWS per column, column by column
+		};
+		void		Fill ( Chunk& c, FlightModel& m, int first, int n, double time );
+		bool		NextChunk ();
+		void		Submit ();
+		void		WriterLoop ();
+		void		Encode ( Chunk& c );
+		void*		Column ( Chunk& c, int col )	{ return &c.data[ m_col_offset[col] ]; }
+		void		PollEvents ( bool last );
+		void		WriteEvents ();
+
+		FILE*		m_fp;
+		int			m_every, m_stride, m_groups;
+		bool		m_wait;
+		uint64_t	m_calls;
+		uint64_t	m_rows, m_dropped;
+
+		std::vector<int> m_cols;				// TC_ columns captured, in schema order then orientation
+		int			m_num_out;					// of m_cols, written
+		std::vector<size_t> m_col_offset;		// per TC_, in Chunk data
+		std::vector<void*> m_out;				// writer only, column arrays of a batch
+		ArrowStreamWriter m_arrow;				// writer only after Open
+		bool		m_failed;					// writer, a write failed
+		std::vector<char> m_file_buf;
+
+		ContactQueue m_contacts;				// popped by the writer, or by Open when it is not running
+		std::string	m_events_name;
+		FILE*		m_events_fp;				// writer only
+		ArrowStreamWriter m_events_arrow;
+		std::vector<ContactEvent> m_ev;			// popped, not yet written
+		std::vector<uint8_t> m_ev_cols;			// m_ev by column
+		std::atomic<uint64_t> m_events;
+
+		Chunk*		m_chunks;
+		Chunk*		m_cur;						// being filled, stepping thread
+		std::thread	m_writer;
+		std::mutex	m_mutex;
+		std::condition_variable m_wake, m_done;
+		std::deque<Chunk*> m_queue;				// full, to write
+		std::vector<Chunk*> m_free;
+		std::atomic<int> m_batches;
+		std::atomic<uint64_t> m_bytes;
+		bool		m_quit;
+	};
+
+#endif
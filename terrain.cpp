@@ -0,0 +1,141 @@
+//--------------------------------------------------------
+//
+// Terrain - tiled heightfield streamed from memory-mapped DEM tiles
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "terrain.h"
+#include "common_defs.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+static_assert ( sizeof(DemTileHeader) == 64, "DemTileHeader must be 64 bytes" );
+
+#define TILE_LIMIT		1.0e9f				// tile coordinates beyond this are sea level
+
+Terrain::Terrain ()
+{
+	m_samples = 0;
+	m_spacing = 0;
+	m_tile_size = 0;
+	m_inv_tile = 0;
+	m_tiles = 0x0;
+	m_misses = 0;
+}
+
+bool Terrain::Open ( const char* dir )
+{
+	Close ();
+	m_dir = dir;
+	std::string fname = m_dir + "/terrain.txt";
+	FILE* fp = fopen ( fname.c_str(), "rt" );
+	if ( fp == 0x0 ) return false;			// no terrain, not an error
+	char buf[1024], cmd[64];
+	m_samples = 0;
+	m_spacing = 0;
+	while ( fgets ( buf, 1024, fp ) ) {
+		if ( sscanf ( buf, "%63s", cmd ) != 1 || cmd[0] == '#' ) continue;
+		if      ( strcmp ( cmd, "samples" ) == 0 )		sscanf ( buf, "%*s %d", &m_samples );
+		else if ( strcmp ( cmd, "spacing" ) == 0 )		sscanf ( buf, "%*s %f", &m_spacing );
+	}
+	fclose ( fp );
+	if ( m_samples < 2 || m_spacing <= 0 ) {
+		dbgprintf ( "ERROR: Terrain %s needs samples >= 2 and spacing > 0\n", fname.c_str() );
+		return false;
+	}
+	m_tile_size = (m_samples - 1) * m_spacing;
+	m_inv_tile = 1.0f / m_tile_size;
+
+	m_tiles = new TerrainTile[ TERRAIN_SLOTS ];
+	for (int s = 0; s < TERRAIN_SLOTS; s++) m_tiles[s].heights = 0x0;
+	m_misses = 0;
+	m_cache.Open ( TERRAIN_SLOTS, m_tile_size, LoadTile, ReleaseTile, this );
+	return true;
+}
+
+void Terrain::Close ()
+{
+	if ( m_tiles == 0x0 ) return;
+	m_cache.Close ();
+	delete [] m_tiles;			// unmaps the tiles
+	m_tiles = 0x0;
+}
+
+void Terrain::LoadTile ( void* ctx, int slot, int tx, int tz )
+{
+	Terrain* ter = (Terrain*) ctx;
+	TerrainTile& t = ter->m_tiles[slot];
+	int samples = ter->m_samples;
+	char fname[64];
+	snprintf ( fname, 64, "/tile_%d_%d.dem", tx, tz );
+	std::string path = ter->m_dir + fname;
+
+	t.heights = 0x0;
+	if ( t.file.Open ( path.c_str() ) ) {				// missing tile is sea level, not an error
+		const DemTileHeader* hdr = (const DemTileHeader*) t.file.getData();
+		size_t bytes = sizeof(DemTileHeader) + size_t(samples) * samples * sizeof(int16_t);
+		if ( t.file.getSize() < bytes || memcmp ( hdr->magic, DEMTILE_MAGIC, 4 ) != 0 || hdr->version != DEMTILE_VERSION ||
+			 hdr->header_size != sizeof(DemTileHeader) || hdr->samples != (uint32_t) samples || hdr->tile_x != tx || hdr->tile_z != tz ) {
+			dbgprintf ( "ERROR: %s is not a version %d, %d sample DEM tile\n", path.c_str(), DEMTILE_VERSION, samples );
+			t.file.Close ();
+		} else {
+			t.heights = (const int16_t*) (t.file.getData() + sizeof(DemTileHeader));
+			t.scale = hdr->height_scale;
+			t.offset = hdr->height_offset;
+
+			// Fault the pages in here, so the first height query does not
+			volatile uint8_t sum = 0;
+			for (size_t b = 0; b < bytes; b += 4096) sum += t.file.getData()[b];
+		}
+	}
+}
+
+void Terrain::ReleaseTile ( void* ctx, int slot, int, int )
+{
+	TerrainTile& t = ((Terrain*) ctx)->m_tiles[slot];
+	t.file.Close ();
+	t.heights = 0x0;
+}
+
+bool Terrain::UpdateFocus ( int num, const float* px, const float* pz, float radius )
+{
+	if ( m_tiles == 0x0 ) return false;
+	std::unique_lock<std::mutex> evict ( m_evict, std::try_to_lock );
+	if ( !evict.owns_lock() ) return false;			// a reader is sampling, try again next time
+	m_cache.UpdateFocus ( num, px, pz, radius );
+	return true;
+}
+
+void Terrain::Wait ()
+{
+	m_cache.Wait ();
+}
+
+float Terrain::Height ( float x, float z, int& slot ) const
+{
+	if ( m_tiles == 0x0 ) return 0;
+	float fx = x * m_inv_tile, fz = z * m_inv_tile;
+	if ( !(fabs(fx) < TILE_LIMIT && fabs(fz) < TILE_LIMIT) ) return 0;
+	int tx = (int) floorf ( fx ), tz = (int) floorf ( fz );
+	uint64_t key = CellTable::Key ( tx, tz );
+
+	if ( !m_cache.Ready ( key, slot ) ) { m_misses.fetch_add ( 1, std::memory_order_relaxed ); return 0; }
+	const TerrainTile& t = m_tiles[slot];
+	if ( t.heights == 0x0 ) return 0;
+
+	// Bilinear between the four samples around (x, z)
+	int n = m_samples - 1;
+	float u = (fx - tx) * n, v = (fz - tz) * n;
+	int i = std::min ( (int) u, n-1 ), j = std::min ( (int) v, n-1 );
+	u -= i; v -= j;
+	const int16_t* r0 = t.heights + j * m_samples + i;
+	const int16_t* r1 = r0 + m_samples;
+	float h0 = r0[0] + (r0[1] - r0[0]) * u;
+	float h1 = r1[0] + (r1[1] - r1[0]) * u;
+	return t.offset + t.scale * ( h0 + (h1 - h0) * v );
+}
@@ -0,0 +1,106 @@
+//--------------------------------------------------------
+//
+// Terrain - tiled heightfield streamed from memory-mapped DEM tiles
+//
+// The world is cut into square tiles of TILE samples per side, stored one per
+// file as <dir>/tile_<tx>_<tz>.dem: a 64-byte DemTileHeader then int16
+// heights row by row (z then x). Adjacent tiles share their edge samples.
+// <dir>/terrain.txt gives the samples per side and the spacing, see
+// tools/terrain_tiles.cpp.
+//
+// Only tiles near the points of interest are resident, kept by a TileCache
+// (tile_cache.h). UpdateFocus, called from the main thread between steps,
+// requests tiles within a radius of the aircraft and camera and evicts the
+// least recently needed ones when the cache is full. The cache's worker
+// thread maps requested tiles and touches their pages, so the step never
+// waits on disk. Tiles that do not exist are sea
+// level (height 0), as is any tile not loaded yet, so callers that place
+// aircraft call UpdateFocus and Wait first.
+//
+// Height queries are read-only and safe from the stepping threads. Each
+// caller keeps a slot hint, normally one per aircraft, which makes the
+// common query, same tile as last step, a compare and a bilinear lookup.
+// A thread that queries while another may be in UpdateFocus (the renderer,
+// with physics on its own thread) brackets its queries with BeginRead and
+// EndRead. UpdateFocus then skips a round rather than wait for it.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_TERRAIN
+	#define DEF_TERRAIN
+
+	#include <stdint.h>
+	#include <string>
+	#include <atomic>
+	#include <mutex>
+	#include "mapped_file.h"
+	#include "tile_cache.h"
+
+	#define DEMTILE_MAGIC		"FDEM"
+	#define DEMTILE_VERSION		1
+	#define TERRAIN_SLOTS		64			// resident tiles (8 MB at 257 samples)
+
+	struct DemTileHeader {
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	header_size;
+		uint32_t	samples;					// per side
+		int32_t		tile_x, tile_z;				// tile coordinates
+		float		spacing;					// between samples (m)
+		float		height_scale, height_offset;	// height = offset + scale * sample (m)
+		float		min_height, max_height;		// (m)
+		uint32_t	reserved[5];
+	};
+
+	struct TerrainTile {						// per cache slot
+		const int16_t* heights;					// 0x0 = missing, sea level
+		float		scale, offset;
+		MappedFile	file;
+	};
+
+	class Terrain {
+	public:
+		Terrain ();
+		~Terrain ()			{ Close(); }
+
+		bool		Open ( const char* dir );		// reads dir/terrain.txt and starts the loader, false if none
+		void		Close ();
+		bool		isOpen ()			{ return m_tiles != 0x0; }
+
+		// Stepping thread, between steps: keep tiles within radius of the points
+		// resident. Returns false if skipped, a reader held the lock.
+		bool		UpdateFocus ( int num, const float* px, const float* pz, float radius );
+		void		Wait ();						// until requested tiles are loaded
+
+		// Any thread. slot is the caller's hint, -1 initially.
+		float		Height ( float x, float z, int& slot ) const;
+		float		Height ( float x, float z ) const	{ int slot = -1; return Height ( x, z, slot ); }
+		void		BeginRead ()		{ m_evict.lock(); }		// other threads, around queries
+		void		EndRead ()			{ m_evict.unlock(); }
+
+		float		getTileSize ()		{ return m_tile_size; }
+		float		getSpacing ()		{ return m_spacing; }
+		int			getSamples ()		{ return m_samples; }
+		int			getResident ()		{ return m_cache.getResident(); }	// tiles loaded or loading
+		int			getLoads ()			{ return m_cache.getFilled(); }
+		int			getMisses ()		{ return m_misses.load(); }	// queries on tiles not loaded yet
+
+	private:
+		static void	LoadTile ( void* ctx, int slot, int tx, int tz );		// TileFunc, cache worker
+		static void	ReleaseTile ( void* ctx, int slot, int tx, int tz );	// on eviction
+
+		std::string	m_dir;
+		int			m_samples;
+		float		m_spacing, m_tile_size, m_inv_tile;
+
+		TerrainTile* m_tiles;						// TERRAIN_SLOTS
+		TileCache	m_cache;
+		mutable std::atomic<int> m_misses;
+
+		std::mutex	m_evict;						// held by UpdateFocus and other threads' readers
+	};
+
+#endif
@@ -0,0 +1,105 @@
+//--------------------------------------------------------
+//
+// Terrain mesh - geometry clipmap around the eye
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "terrain_mesh.h"
+#include "terrain.h"
+#include <math.h>
+
+#define CLIPMAP_VERTS	(CLIPMAP_N + 1)
+
+void InitClipmap ( Clipmap& cm, float base_spacing )
+{
+	cm.base_spacing = base_spacing;
+	cm.loads = -1;
+	for (int L = 0; L < CLIPMAP_LEVELS; L++) {
+		ClipmapLevel& l = cm.levels[L];
+		l.spacing = base_spacing * (1 << L);
+		l.ox = l.oz = 0x7FFFFFFF;				// forces the first sample
+		l.hole_x = l.hole_z = -2;
+		l.verts.assign ( CLIPMAP_VERTS * CLIPMAP_VERTS * 3, 0 );
+		l.indices.clear ();
+		l.dirty = false;
+	}
+}
+
+// Level origin in its own cells: eye snapped to two cells, minus half the level
+static inline int LevelOrigin ( float eye, float spacing )
+{
+	return 2 * (int) floorf ( eye / (2 * spacing) ) - CLIPMAP_N/2;
+}
+
+static void BuildIndices ( ClipmapLevel& l )
+{
+	l.indices.clear ();
+	for (int j = 0; j < CLIPMAP_N; j++) {
+		for (int i = 0; i < CLIPMAP_N; i++) {
+			if ( l.hole_x >= 0 && i >= l.hole_x && i < l.hole_x + CLIPMAP_N/2 && j >= l.hole_z && j < l.hole_z + CLIPMAP_N/2 ) continue;
+			uint16_t a = j * CLIPMAP_VERTS + i, b = a + 1, c = a + CLIPMAP_VERTS, d = c + 1;
+			l.indices.push_back ( a );	l.indices.push_back ( c );	l.indices.push_back ( b );
+			l.indices.push_back ( b );	l.indices.push_back ( c );	l.indices.push_back ( d );
+		}
+	}
+}
+
+static void SampleLevel ( ClipmapLevel& l, Terrain& terrain, bool outer )
+{
+	int slot = -1;
+	float* v = l.verts.data();
+	for (int j = 0; j < CLIPMAP_VERTS; j++) {
+		float z = (l.oz + j) * l.spacing;
+		for (int i = 0; i < CLIPMAP_VERTS; i++, v += 3) {
+			v[0] = (l.ox + i) * l.spacing;
+			v[1] = terrain.Height ( v[0], z, slot );
+			v[2] = z;
+		}
+	}
+	if ( outer ) return;
+
+	// Border vertices between two coarse vertices follow the coarse edge
+	float* h = l.verts.data() + 1;
+	const int row = CLIPMAP_VERTS * 3;
+	for (int k = 1; k < CLIPMAP_N; k += 2) {
+		h[ k*3 ] = 0.5f * ( h[ (k-1)*3 ] + h[ (k+1)*3 ] );										// z = 0
+		h[ CLIPMAP_N*row + k*3 ] = 0.5f * ( h[ CLIPMAP_N*row + (k-1)*3 ] + h[ CLIPMAP_N*row + (k+1)*3 ] );	// z = N
+		h[ k*row ] = 0.5f * ( h[ (k-1)*row ] + h[ (k+1)*row ] );								// x = 0
+		h[ k*row + CLIPMAP_N*3 ] = 0.5f * ( h[ (k-1)*row + CLIPMAP_N*3 ] + h[ (k+1)*row + CLIPMAP_N*3 ] );	// x = N
+	}
+}
+
+int UpdateClipmap ( Clipmap& cm, Terrain& terrain, float eye_x, float eye_z )
+{
+	bool arrived = ( terrain.getLoads() != cm.loads );		// new tiles, resample all
+	cm.loads = terrain.getLoads();
+
+	int sampled = 0;
+	for (int L = 0; L < CLIPMAP_LEVELS; L++) {
+		ClipmapLevel& l = cm.levels[L];
+		int ox = LevelOrigin ( eye_x, l.spacing ), oz = LevelOrigin ( eye_z, l.spacing );
+		if ( ox != l.ox || oz != l.oz || arrived ) {
+			l.ox = ox;
+			l.oz = oz;
+			SampleLevel ( l, terrain, L == CLIPMAP_LEVELS-1 );
+			l.dirty = true;
+			sampled++;
+		}
+		// Hole where level L-1 covers, in this level's cells
+		int hx = -1, hz = -1;
+		if ( L > 0 ) {
+			hx = LevelOrigin ( eye_x, cm.levels[L-1].spacing ) / 2 - ox;
+			hz = LevelOrigin ( eye_z, cm.levels[L-1].spacing ) / 2 - oz;
+		}
+		if ( hx != l.hole_x || hz != l.hole_z ) {
+			l.hole_x = hx;
+			l.hole_z = hz;
+			BuildIndices ( l );
+			l.dirty = true;
+		}
+	}
+	return sampled;
+}
@@ -0,0 +1,56 @@
+//--------------------------------------------------------
+//
+// Terrain mesh - geometry clipmap around the eye
+//
+// CLIPMAP_LEVELS nested square grids of CLIPMAP_N cells per side, centered
+// on the eye, each with twice the spacing of the one inside it. Level 0 is a
+// full grid at the terrain's sample spacing; coarser levels are rings with a
+// hole where the finer level covers. Each level's origin snaps to twice its
+// spacing, so it moves in whole coarse cells and the finer level's border
+// always falls on coarse vertices. Border vertices of a finer level that
+// fall between coarse vertices take the average of their neighbours, which
+// closes the T-junction cracks between levels.
+//
+// A level is resampled only when its origin moves or new terrain tiles
+// arrive, so a mostly still camera costs nothing per frame.
+// Geometry only, no GL, so it can be used and timed by headless tools.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_TERRAIN_MESH
+	#define DEF_TERRAIN_MESH
+
+	#include <stdint.h>
+	#include <vector>
+
+	#define CLIPMAP_LEVELS		5
+	#define CLIPMAP_N			64				// cells per side, multiple of 4
+
+	class Terrain;
+
+	struct ClipmapLevel {
+		float		spacing;					// (m)
+		int			ox, oz;						// origin in cells of this level's spacing
+		int			hole_x, hole_z;				// finer level, in cells from the origin, -1 = no hole
+		std::vector<float> verts;				// (N+1)^2 x,y,z, world coordinates
+		std::vector<uint16_t> indices;			// triangles
+		bool		dirty;						// changed since the last upload
+	};
+
+	struct Clipmap {
+		ClipmapLevel levels[CLIPMAP_LEVELS];
+		float		base_spacing;
+		int			loads;						// terrain loads when last sampled
+	};
+
+	// Levels from the terrain's sample spacing, nothing sampled yet
+	void	InitClipmap ( Clipmap& cm, float base_spacing );
+
+	// Move the levels to the eye and resample those that changed. Returns the
+	// number of levels resampled.
+	int		UpdateClipmap ( Clipmap& cm, Terrain& terrain, float eye_x, float eye_z );
+
+#endif
@@ -0,0 +1,97 @@
+//--------------------------------------------------------
+//
+// Text format - fast number formatting for per-frame text
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "text_format.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+static const double g_pow10[10] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+static int PadLeft ( char* buf, const char* s, int n, int width )
+{
+	int pad = (width > n) ? width - n : 0;
+	memset ( buf, ' ', pad );
+	memcpy ( buf + pad, s, n );
+	buf[pad + n] = '\0';
+	return pad + n;
+}
+
+int FormatFloat ( char* buf, float v, int width, int prec )
+{
+	if ( prec < 0 ) prec = 0;
+	if ( prec > 9 ) prec = 9;
+	double d = v;
+	// out of range for the integer path (or inf/nan), let printf handle it
+	if ( !(fabs(d) < 1e9) )
+		return sprintf ( buf, "%*.*f", width, prec, d );
+
+	char tmp[32];
+	char* end = tmp + sizeof(tmp);
+	bool neg = signbit ( d );
+	// scale and round. For prec <= 6 a float times 10^prec is exact in a double,
+	// so exact ties can be seen and rounded to even, as printf does.
+	double x = fabs(d) * g_pow10[prec];
+	double r = floor ( x );
+	uint64_t u = (uint64_t) r;
+	if ( x - r > 0.5 || (x - r == 0.5 && (u & 1)) ) u++;
+	uint64_t ipart = u / (uint64_t) g_pow10[prec];
+	uint64_t fpart = u % (uint64_t) g_pow10[prec];
+
+	char* c = end;
+	for (int k = 0; k < prec; k++) {
+		*--c = '0' + (char) (fpart % 10);
+		fpart /= 10;
+	}
+	if ( prec > 0 ) *--c = '.';
+	do {
+		*--c = '0' + (char) (ipart % 10);
+		ipart /= 10;
+	} while ( ipart > 0 );
+	if ( neg ) *--c = '-';				// as printf, small negatives keep the sign, "-0.00"
+
+	return PadLeft ( buf, c, (int) (end - c), width );
+}
+
+int FormatInt ( char* buf, int v, int width )
+{
+	char tmp[16];
+	char* end = tmp + sizeof(tmp);
+	uint32_t u = (v < 0) ? 0u - (uint32_t) v : (uint32_t) v;
+	char* c = end;
+	do {
+		*--c = '0' + (char) (u % 10);
+		u /= 10;
+	} while ( u > 0 );
+	if ( v < 0 ) *--c = '-';
+	return PadLeft ( buf, c, (int) (end - c), width );
+}
+
+TextBuf& TextBuf::Str ( const char* s )
+{
+	size_t n = strlen ( s );
+	if ( n > (size_t) (TEXTBUF_MAX - 1 - len) ) n = TEXTBUF_MAX - 1 - len;
+	memcpy ( buf + len, s, n );
+	len += (int) n;
+	buf[len] = '\0';
+	return *this;
+}
+
+TextBuf& TextBuf::Float ( float v, int width, int prec )
+{
+	if ( len + 48 + width < TEXTBUF_MAX ) len += FormatFloat ( buf + len, v, width, prec );
+	return *this;
+}
+
+TextBuf& TextBuf::Int ( int v, int width )
+{
+	if ( len + 16 + width < TEXTBUF_MAX ) len += FormatInt ( buf + len, v, width );
+	return *this;
+}
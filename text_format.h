@@ -0,0 +1,37 @@
+//--------------------------------------------------------
+//
+// Text format - fast number formatting for per-frame text
+//
+// FormatFloat gives the same output as printf "%<width>.<prec>f" for the
+// values shown on the HUD, using integer arithmetic and no locale, so a
+// dozen fields can be formatted each frame without sprintf.
+// TextBuf appends strings and numbers into a fixed buffer.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_TEXT_FORMAT
+	#define DEF_TEXT_FORMAT
+
+	#define TEXTBUF_MAX		256
+
+	// Write v into buf as %<width>.<prec>f, prec <= 9. Returns length, buf is terminated.
+	// buf must hold at least max(width, 32) + 1 chars.
+	int		FormatFloat ( char* buf, float v, int width, int prec );
+	int		FormatInt ( char* buf, int v, int width );
+
+	struct TextBuf {
+		TextBuf ()									{ Clear(); }
+		void		Clear ()						{ len = 0; buf[0] = '\0'; }
+		TextBuf&	Str ( const char* s );
+		TextBuf&	Float ( float v, int width, int prec );
+		TextBuf&	Int ( int v, int width = 0 );
+		const char*	c_str () const					{ return buf; }
+
+		char		buf[TEXTBUF_MAX];
+		int			len;
+	};
+
+#endif
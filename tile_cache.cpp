@@ -0,0 +1,189 @@
+//--------------------------------------------------------
+//
+// Tile cache - resident square tiles around points of interest, filled by a worker thread
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "tile_cache.h"
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#define NO_TILE			0xFFFFFFFFFFFFFFFFull
+#define FOCUS_LIMIT		1.0e9f				// points beyond this request no tiles
+
+TileCache::TileCache ()
+{
+	m_slots = 0x0;
+	m_num_slots = 0;
+	m_tile_size = 0;
+	m_inv_tile = 0;
+	m_fill = 0x0;
+	m_release = 0x0;
+	m_ctx = 0x0;
+	m_frame = 0;
+	m_filled = 0;
+	m_pending = 0;
+	m_quit = false;
+}
+
+void TileCache::Open ( int num_slots, float tile_size, TileFunc fill, TileFunc release, void* ctx )
+{
+	Close ();
+	m_num_slots = num_slots;
+	m_tile_size = tile_size;
+	m_inv_tile = 1.0f / tile_size;
+	m_fill = fill;
+	m_release = release;
+	m_ctx = ctx;
+
+	m_slots = new Slot[ num_slots ];
+	for (int s = 0; s < num_slots; s++) {
+		m_slots[s].key = NO_TILE;
+		m_slots[s].state = TILE_EMPTY;
+		m_slots[s].last_used = 0;
+	}
+	m_table.Clear ();
+	m_frame = 0;
+	m_filled = 0;
+	m_pending = 0;
+	m_quit = false;
+	m_worker = std::thread ( &TileCache::WorkerLoop, this );
+}
+
+void TileCache::Close ()
+{
+	if ( m_slots == 0x0 ) return;
+	{
+		std::lock_guard<std::mutex> lock ( m_mutex );
+		m_quit = true;
+		m_queue.clear ();
+	}
+	m_wake.notify_all ();
+	m_worker.join ();
+	delete [] m_slots;
+	m_slots = 0x0;
+	m_num_slots = 0;
+	m_table.Clear ();
+}
+
+void TileCache::WorkerLoop ()
+{
+	std::unique_lock<std::mutex> lock ( m_mutex );
+	for (;;) {
+		m_wake.wait ( lock, [this] { return m_quit || !m_queue.empty(); } );
+		if ( m_quit ) return;
+		int s = m_queue.front ();
+		m_queue.pop_front ();
+		lock.unlock ();
+
+		Slot& t = m_slots[s];
+		m_fill ( m_ctx, s, int32_t(t.key >> 32), int32_t(t.key & 0xFFFFFFFF) );
+		t.state.store ( TILE_READY, std::memory_order_release );
+
+		lock.lock ();
+		m_pending--;
+		m_filled++;
+		m_done.notify_all ();
+	}
+}
+
+int TileCache::AllocSlot ()
+{
+	// free slot, else the least recently needed ready tile not needed this frame
+	int best = -1;
+	for (int s = 0; s < m_num_slots; s++) {
+		int st = m_slots[s].state.load ( std::memory_order_acquire );
+		if ( st == TILE_EMPTY ) return s;
+		if ( st == TILE_READY && m_slots[s].last_used < m_frame && ( best < 0 || m_slots[s].last_used < m_slots[best].last_used ) ) best = s;
+	}
+	if ( best >= 0 ) {
+		Slot& t = m_slots[best];
+		m_table.Insert ( t.key )->count = 0;		// evicted
+		if ( m_release ) m_release ( m_ctx, best, int32_t(t.key >> 32), int32_t(t.key & 0xFFFFFFFF) );
+		t.key = NO_TILE;
+		t.state = TILE_EMPTY;
+	}
+	return best;
+}
+
+void TileCache::UpdateFocus ( int num, const float* px, const float* pz, float radius )
+{
+	if ( m_slots == 0x0 ) return;
+	m_frame++;
+
+	// Tiles overlapping a circle around each point, nearest first
+	std::vector< std::pair<float, uint64_t> > want;
+	for (int i = 0; i < num; i++) {
+		if ( !(fabs(px[i]) < FOCUS_LIMIT && fabs(pz[i]) < FOCUS_LIMIT) ) continue;
+		int tx0 = (int) floorf ( (px[i] - radius) * m_inv_tile ), tx1 = (int) floorf ( (px[i] + radius) * m_inv_tile );
+		int tz0 = (int) floorf ( (pz[i] - radius) * m_inv_tile ), tz1 = (int) floorf ( (pz[i] + radius) * m_inv_tile );
+		for (int tx = tx0; tx <= tx1; tx++) {
+			for (int tz = tz0; tz <= tz1; tz++) {
+				float dx = std::max ( 0.0f, std::max ( tx * m_tile_size - px[i], px[i] - (tx+1) * m_tile_size ) );
+				float dz = std::max ( 0.0f, std::max ( tz * m_tile_size - pz[i], pz[i] - (tz+1) * m_tile_size ) );
+				if ( dx*dx + dz*dz <= radius*radius ) want.push_back ( std::make_pair ( dx*dx + dz*dz, CellTable::Key ( tx, tz ) ) );
+			}
+		}
+	}
+	std::sort ( want.begin(), want.end() );
+
+	// Mark resident tiles first, so none of them is evicted for a new one
+	std::vector<uint64_t> fill;
+	for (size_t k = 0; k < want.size(); k++) {
+		const CellTable::Slot* c = m_table.Find ( want[k].second );
+		if ( c && c->count > 0 )	m_slots[ c->first ].last_used = m_frame;
+		else						fill.push_back ( want[k].second );
+	}
+	for (size_t k = 0; k < fill.size(); k++) {
+		const CellTable::Slot* c = m_table.Find ( fill[k] );
+		if ( c && c->count > 0 ) continue;			// listed twice
+		int s = AllocSlot ();
+		if ( s < 0 ) break;							// all slots needed now
+		Slot& t = m_slots[s];
+		t.key = fill[k];
+		t.last_used = m_frame;
+		t.state = TILE_BUSY;
+		CellTable::Slot* e = m_table.Insert ( fill[k] );
+		e->first = s;
+		e->count = 1;
+		{
+			std::lock_guard<std::mutex> lock ( m_mutex );
+			m_queue.push_back ( s );
+			m_pending++;
+		}
+		m_wake.notify_one ();
+	}
+	if ( m_table.getNumSlots() > 4 * m_num_slots ) m_table.Compact ();		// drop evicted keys
+}
+
+void TileCache::Wait ()
+{
+	if ( m_slots == 0x0 ) return;
+	std::unique_lock<std::mutex> lock ( m_mutex );
+	m_done.wait ( lock, [this] { return m_pending == 0; } );
+}
+
+int TileCache::getResident ()
+{
+	int n = 0;
+	for (int s = 0; m_slots && s < m_num_slots; s++)
+		if ( m_slots[s].state.load() != TILE_EMPTY ) n++;
+	return n;
+}
+
+bool TileCache::Ready ( uint64_t key, int& slot ) const
+{
+	if ( m_slots == 0x0 ) return false;
+
+	// Hint first, the caller is usually still over the same tile
+	if ( slot < 0 || m_slots[slot].key != key ) {
+		const CellTable::Slot* c = m_table.Find ( key );
+		if ( c == 0x0 || c->count == 0 ) return false;
+		slot = c->first;
+	}
+	return m_slots[slot].state.load ( std::memory_order_acquire ) == TILE_READY;
+}
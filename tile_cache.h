@@ -0,0 +1,94 @@
+//--------------------------------------------------------
+//
+// Tile cache - resident square tiles around points of interest, filled by a worker thread
+//
+// Shared by Terrain (DEM tiles mapped from disk) and WindField (generated
+// turbulence). The owner keeps its tile data in arrays indexed by slot; the
+// cache keeps which tile each slot holds and its state, and a CellTable from
+// tile key to slot.
+//
+// UpdateFocus, called from one thread between steps, requests the tiles
+// overlapping a circle of radius around each point, nearest first. Tiles
+// already resident are marked used this frame, then missing ones take a
+// free slot or evict the least recently used tile not needed this frame.
+// The worker thread calls the fill function for each requested slot and
+// marks it ready. The release function is called on eviction, from the
+// UpdateFocus thread, so the owner can drop what the slot held.
+//
+// Lookups are read-only and safe from any thread while no UpdateFocus runs
+// (or, for fill data, once the slot reads ready). Each caller keeps a slot
+// hint, so the common lookup, same tile as last time, is one compare.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_TILE_CACHE
+	#define DEF_TILE_CACHE
+
+	#include <stdint.h>
+	#include <deque>
+	#include <atomic>
+	#include <thread>
+	#include <mutex>
+	#include <condition_variable>
+	#include "spatial_grid.h"
+
+	#define TILE_EMPTY		0
+	#define TILE_BUSY		1			// requested, being filled
+	#define TILE_READY		2
+
+	typedef void (*TileFunc) ( void* ctx, int slot, int tx, int tz );
+
+	class TileCache {
+	public:
+		TileCache ();
+		~TileCache ()		{ Close(); }
+
+		// Starts the worker. release may be 0x0.
+		void		Open ( int num_slots, float tile_size, TileFunc fill, TileFunc release, void* ctx );
+		void		Close ();							// stops the worker, releases nothing
+		bool		isOpen ()			{ return m_slots != 0x0; }
+
+		// One thread, between steps
+		void		UpdateFocus ( int num, const float* px, const float* pz, float radius );
+		void		Wait ();							// until requested tiles are filled
+
+		// Any thread. True if the tile of key is ready, slot is the caller's
+		// hint, -1 initially, and is set to the tile's slot.
+		bool		Ready ( uint64_t key, int& slot ) const;
+
+		float		getTileSize ()		{ return m_tile_size; }
+		int			getNumSlots ()		{ return m_num_slots; }
+		int			getResident ();						// tiles ready or being filled
+		int			getFilled ()		{ return m_filled.load(); }
+
+	private:
+		struct Slot {
+			uint64_t	key;					// CellTable key of tile_x, tile_z
+			std::atomic<int> state;				// TILE_
+			int			last_used;				// UpdateFocus frame
+		};
+		void		WorkerLoop ();
+		int			AllocSlot ();
+
+		Slot*		m_slots;
+		int			m_num_slots;
+		float		m_tile_size, m_inv_tile;
+		TileFunc	m_fill, m_release;
+		void*		m_ctx;
+
+		CellTable	m_table;						// first = slot, count 0 once evicted
+		int			m_frame;
+		std::atomic<int> m_filled;
+
+		std::thread	m_worker;
+		std::mutex	m_mutex;
+		std::condition_variable m_wake, m_done;
+		std::deque<int> m_queue;					// slots to fill
+		int			m_pending;						// queued or being filled
+		bool		m_quit;
+	};
+
+#endif
@@ -0,0 +1,369 @@
+//--------------------------------------------------------
+//
+// Arrow check - reads back an Arrow IPC stream written by arrow_ipc.h
+//
+// Parses the stream with its own flatbuffer reader, independent of the
+// writer: every message, the schema and each record batch, checking the
+// framing, the 8-byte metadata and 64-byte body alignment, and that every
+// buffer lies inside its body. Prints the schema and the batch sizes.
+// Given the CSV that flightsim_batch wrote in the same run, it also matches
+// rows by time and aircraft and compares every column the two share, to
+// the precision the CSV was printed at.
+//
+// Usage:  arrow_check <file.arrows> [results.csv] [-v]
+//   -v   print every batch
+// Returns 0 if the stream is valid and all compared values agree.
+//
+// Example, telemetry every output of every aircraft:
+//   flightsim_batch scenario.txt -o results.csv     (with "telemetry tel.arrows 0.1")
+//   arrow_check tel.arrows results.csv
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "arrow_ipc.h"
+#include "mapped_file.h"
+
+#define FB_METADATA_V5		4			// as arrow_ipc.cpp, from format/Message.fbs
+#define FB_HEADER_SCHEMA	1
+#define FB_HEADER_BATCH		3
+#define FB_TYPE_INT			2
+#define FB_TYPE_FLOAT		3
+#define FB_FLOAT_SINGLE		1
+#define FB_FLOAT_DOUBLE		2
+
+#define ARROW_CONTINUE		0xFFFFFFFF
+#define MISMATCHES_SHOWN	10
+
+// Flatbuffer table, read in place with every offset bounds checked
+struct FlatTable {
+	const uint8_t* b;
+	size_t		size;
+	size_t		pos;					// table start
+	size_t		vt;						// its vtable
+	int			vt_len;
+
+	template<class T> bool Read ( size_t at, T& v ) const	{ if ( at + sizeof(T) > size ) return false; memcpy ( &v, b + at, sizeof(T) ); return true; }
+
+	bool Open ( const uint8_t* buf, size_t len, size_t at )
+	{
+		b = buf; size = len; pos = at;
+		int32_t soff;
+		uint16_t vlen;
+		if ( !Read ( at, soff ) ) return false;
+		vt = at - soff;
+		if ( !Read ( vt, vlen ) || vlen < 4 ) return false;
+		vt_len = vlen;
+		return vt + vt_len <= size;
+	}
+	// Field position, 0 if absent or its vtable entry is out of range
+	size_t Field ( int id ) const
+	{
+		if ( 4 + 2*id + 2 > vt_len ) return 0;
+		uint16_t off;
+		if ( !Read ( vt + 4 + 2*id, off ) ) return 0;
+		return off ? pos + off : 0;
+	}
+	template<class T> T Get ( int id, T def ) const
+	{
+		size_t at = Field ( id );
+		T v = def;
+		if ( at ) Read ( at, v );
+		return v;
+	}
+	// Target of a uoffset field, 0 if absent or out of range
+	size_t Ref ( int id ) const
+	{
+		size_t at = Field ( id );
+		uint32_t off;
+		if ( at == 0 || !Read ( at, off ) || at + off >= size ) return 0;
+		return at + off;
+	}
+	// Vector of n elements of elem_size bytes, first is the first element
+	bool Vector ( int id, int elem_size, uint32_t& n, size_t& first ) const
+	{
+		size_t at = Ref ( id );
+		if ( at == 0 || !Read ( at, n ) ) return false;
+		first = at + 4;
+		return first + (size_t) n * elem_size <= size;
+	}
+	bool String ( int id, std::string& s ) const
+	{
+		uint32_t n;
+		size_t first;
+		if ( !Vector ( id, 1, n, first ) ) return false;
+		s.assign ( (const char*) b + first, n );
+		return true;
+	}
+};
+
+struct Column {
+	std::string	name;
+	int			type;					// ARROW_
+	std::vector<double> values;			// all batches
+};
+
+static bool Fail ( const char* msg, size_t at )
+{
+	fprintf ( stderr, "ERROR: %s at byte %llu\n", msg, (unsigned long long) at );
+	return false;
+}
+
+static bool ReadSchema ( const FlatTable& schema, std::vector<Column>& cols )
+{
+	if ( schema.Get<int16_t> ( 0, 0 ) != 0 ) return Fail ( "Schema is not little-endian", schema.pos );
+	uint32_t n;
+	size_t first;
+	if ( !schema.Vector ( 1, 4, n, first ) ) return Fail ( "Schema has no fields", schema.pos );
+	for (uint32_t k = 0; k < n; k++) {
+		uint32_t off;
+		FlatTable f, t;
+		if ( !schema.Read ( first + 4*k, off ) ) return Fail ( "Field offset outside the file", first + 4*k );
+		if ( !f.Open ( schema.b, schema.size, first + 4*k + off ) ) return Fail ( "Bad field table", first + 4*k );
+		Column c;
+		if ( !f.String ( 0, c.name ) ) return Fail ( "Field without a name", f.pos );
+		int type_type = f.Get<uint8_t> ( 2, 0 );
+		size_t type_at = f.Ref ( 3 );
+		if ( type_at == 0 || !t.Open ( f.b, f.size, type_at ) ) return Fail ( "Field without a type", f.pos );
+		if ( type_type == FB_TYPE_INT && t.Get<int32_t> ( 0, 0 ) == 32 && t.Get<uint8_t> ( 1, 0 ) == 1 ) {
+			c.type = ARROW_I32;
+		} else if ( type_type == FB_TYPE_FLOAT && t.Get<int16_t> ( 0, 0 ) == FB_FLOAT_SINGLE ) {
+			c.type = ARROW_F32;
+		} else if ( type_type == FB_TYPE_FLOAT && t.Get<int16_t> ( 0, 0 ) == FB_FLOAT_DOUBLE ) {
+			c.type = ARROW_F64;
+		} else {
+			fprintf ( stderr, "ERROR: Column %s is not int32, float or double.\n", c.name.c_str() );
+			return false;
+		}
+		uint32_t children;
+		size_t child;
+		if ( f.Vector ( 5, 4, children, child ) && children != 0 )
+			return Fail ( "Nested column", f.pos );
+		cols.push_back ( c );
+	}
+	return true;
+}
+
+static bool ReadBatch ( const FlatTable& batch, const uint8_t* body, int64_t body_len, std::vector<Column>& cols, int64_t& rows )
+{
+	rows = batch.Get<int64_t> ( 0, -1 );
+	uint32_t num_nodes, num_bufs;
+	size_t nodes, bufs;
+	if ( rows < 0 || !batch.Vector ( 1, 16, num_nodes, nodes ) || !batch.Vector ( 2, 16, num_bufs, bufs ) )
+		return Fail ( "Bad record batch", batch.pos );
+	if ( num_nodes != cols.size() || num_bufs != 2 * cols.size() )
+		return Fail ( "Record batch does not match the schema", batch.pos );
+
+	for (size_t c = 0; c < cols.size(); c++) {
+		int64_t node[2], buf[4];
+		if ( !batch.Read ( nodes + 16*c, node ) || !batch.Read ( bufs + 32*c, buf ) )
+			return Fail ( "Record batch outside the file", batch.pos );
+		if ( node[0] != rows || node[1] != 0 ) return Fail ( "Column length or null count is wrong", nodes + 16*c );
+		int64_t len = rows * ArrowStreamWriter::TypeSize ( cols[c].type );
+		if ( buf[1] != 0 ) return Fail ( "Unexpected validity buffer", bufs + 32*c );
+		if ( buf[2] % ARROW_ALIGN != 0 ) return Fail ( "Column buffer is not 64-byte aligned", bufs + 32*c );
+		if ( buf[3] != len || buf[2] < 0 || buf[2] + len > body_len ) return Fail ( "Column buffer outside the body", bufs + 32*c );
+
+		const uint8_t* p = body + buf[2];
+		std::vector<double>& v = cols[c].values;
+		for (int64_t r = 0; r < rows; r++) {
+			if ( cols[c].type == ARROW_I32 )		{ int32_t x; memcpy ( &x, p + 4*r, 4 ); v.push_back ( x ); }
+			else if ( cols[c].type == ARROW_F32 )	{ float x; memcpy ( &x, p + 4*r, 4 ); v.push_back ( x ); }
+			else									{ double x; memcpy ( &x, p + 8*r, 8 ); v.push_back ( x ); }
+		}
+	}
+	return true;
+}
+
+static bool ReadStream ( const uint8_t* b, size_t size, std::vector<Column>& cols, bool verbose )
+{
+	size_t pos = 0;
+	int batches = 0;
+	int64_t total = 0;
+	bool schema = false;
+	for (;;) {
+		uint32_t hdr[2];
+		if ( pos + 8 > size ) return Fail ( "Stream ends without the end-of-stream marker", pos );
+		memcpy ( hdr, b + pos, 8 );
+		if ( hdr[0] != ARROW_CONTINUE ) return Fail ( "Missing continuation marker", pos );
+		if ( hdr[1] == 0 ) break;										// end of stream
+		if ( (8 + hdr[1]) % 8 != 0 ) return Fail ( "Metadata is not padded to 8 bytes", pos );
+		size_t meta = pos + 8;
+		if ( meta + hdr[1] > size ) return Fail ( "Truncated metadata", pos );
+
+		// Message, its flatbuffer root is a uoffset at the start
+		uint32_t root;
+		FlatTable msg, head;
+		memcpy ( &root, b + meta, 4 );
+		if ( !msg.Open ( b + meta, hdr[1], root ) ) return Fail ( "Bad message table", meta );
+		if ( msg.Get<int16_t> ( 0, 0 ) != FB_METADATA_V5 ) return Fail ( "Not metadata version 5", meta );
+		int type = msg.Get<uint8_t> ( 1, 0 );
+		int64_t body_len = msg.Get<int64_t> ( 3, 0 );
+		size_t head_at = msg.Ref ( 2 );
+		size_t body = meta + hdr[1];
+		if ( head_at == 0 || !head.Open ( msg.b, msg.size, head_at ) ) return Fail ( "Message without a header", meta );
+		if ( body_len < 0 || body + body_len > size ) return Fail ( "Truncated message body", body );
+
+		if ( type == FB_HEADER_SCHEMA ) {
+			if ( schema ) return Fail ( "Second schema", pos );
+			if ( !ReadSchema ( head, cols ) ) return false;
+			schema = true;
+			printf ( "Schema, %d columns:", (int) cols.size() );
+			for (size_t c = 0; c < cols.size(); c++)
+				printf ( " %s:%s", cols[c].name.c_str(), cols[c].type == ARROW_I32 ? "int32" : cols[c].type == ARROW_F32 ? "float" : "double" );
+			printf ( "\n" );
+		} else if ( type == FB_HEADER_BATCH ) {
+			if ( !schema ) return Fail ( "Record batch before the schema", pos );
+			int64_t rows;
+			if ( !ReadBatch ( head, b + body, body_len, cols, rows ) ) return false;
+			if ( verbose ) printf ( "Batch %d: %lld rows, %lld bytes\n", batches, (long long) rows, (long long) body_len );
+			batches++;
+			total += rows;
+		} else {
+			return Fail ( "Unexpected message type", meta );
+		}
+		pos = body + body_len;
+	}
+	if ( !schema ) return Fail ( "No schema", 0 );
+	if ( pos + 8 != size ) fprintf ( stderr, "WARNING: %llu bytes after the end of stream.\n", (unsigned long long) (size - pos - 8) );
+	printf ( "%d batches, %lld rows, %llu bytes.\n", batches, (long long) total, (unsigned long long) size );
+	return true;
+}
+
+//----------------------------------------------------------- CSV compare
+
+static void Split ( const char* line, std::vector<std::string>& out )
+{
+	out.clear ();
+	std::string cur;
+	for (const char* c = line; *c && *c != '\n' && *c != '\r'; c++) {
+		if ( *c == ',' ) { out.push_back ( cur ); cur.clear(); }
+		else cur += *c;
+	}
+	out.push_back ( cur );
+}
+
+// Half a unit in the last printed digit, float rounding on top
+static double PrintedTolerance ( const std::string& s, double v )
+{
+	size_t dot = s.find ( '.' );
+	int digits = (dot == std::string::npos) ? 0 : (int) (s.size() - dot - 1);
+	return 0.5 * pow ( 10.0, -digits ) + 1e-6 * fabs ( v ) + 1e-9;
+}
+
+static int CompareCSV ( const char* fname, const std::vector<Column>& cols )
+{
+	FILE* fp = fopen ( fname, "rt" );
+	if ( fp == 0x0 ) {
+		fprintf ( stderr, "ERROR: Unable to open %s\n", fname );
+		return -1;
+	}
+	int tcol = -1, icol = -1;
+	for (size_t c = 0; c < cols.size(); c++) {
+		if ( cols[c].name == "time" ) tcol = (int) c;
+		if ( cols[c].name == "id" ) icol = (int) c;
+	}
+	if ( tcol < 0 || icol < 0 ) {
+		fprintf ( stderr, "ERROR: The stream has no time and id columns to match rows by.\n" );
+		fclose ( fp );
+		return -1;
+	}
+	// Arrow rows by time (ms) and aircraft
+	std::map<std::pair<long long,int>, size_t> rows;
+	for (size_t r = 0; r < cols[tcol].values.size(); r++)
+		rows[ std::make_pair ( llround ( cols[tcol].values[r] * 1000 ), (int) cols[icol].values[r] ) ] = r;
+
+	char line[4096];
+	std::vector<std::string> names, f;
+	if ( fgets ( line, sizeof(line), fp ) == 0x0 ) { fclose ( fp ); return -1; }
+	Split ( line, names );
+	std::vector<int> shared ( names.size(), -1 );				// CSV column to stream column
+	int csv_t = -1, csv_i = -1, num_shared = 0;
+	for (size_t k = 0; k < names.size(); k++) {
+		if ( names[k] == "time" ) csv_t = (int) k;
+		if ( names[k] == "id" ) csv_i = (int) k;
+		for (size_t c = 0; c < cols.size(); c++)
+			if ( cols[c].name == names[k] && (int) c != tcol && (int) c != icol ) { shared[k] = (int) c; num_shared++; }
+	}
+	if ( csv_t < 0 || csv_i < 0 || num_shared == 0 ) {
+		fprintf ( stderr, "ERROR: %s shares no columns with the stream.\n", fname );
+		fclose ( fp );
+		return -1;
+	}
+
+	std::vector<double> max_err ( cols.size(), 0 );
+	long long matched = 0, compared = 0, csv_rows = 0;
+	int bad = 0;
+	while ( fgets ( line, sizeof(line), fp ) ) {
+		Split ( line, f );
+		if ( f.size() != names.size() ) continue;
+		csv_rows++;
+		std::pair<long long,int> key ( llround ( atof ( f[csv_t].c_str() ) * 1000 ), atoi ( f[csv_i].c_str() ) );
+		std::map<std::pair<long long,int>, size_t>::iterator it = rows.find ( key );
+		if ( it == rows.end() ) continue;							// decimated in time or by aircraft
+		matched++;
+		for (size_t k = 0; k < names.size(); k++) {
+			if ( shared[k] < 0 ) continue;
+			double csv = atof ( f[k].c_str() ), arrow = cols[shared[k]].values[it->second];
+			double err = fabs ( csv - arrow );
+			if ( names[k] == "heading" || names[k] == "roll" || names[k] == "pitch" )
+				err = std::min ( err, fabs ( 360.0 - err ) );			// same angle either side of the wrap
+			compared++;
+			if ( err > max_err[shared[k]] ) max_err[shared[k]] = err;
+			if ( err > PrintedTolerance ( f[k], csv ) && ++bad <= MISMATCHES_SHOWN )
+				fprintf ( stderr, "Mismatch: %s at t = %s, aircraft %s: csv %s, arrow %.9g\n",
+					names[k].c_str(), f[csv_t].c_str(), f[csv_i].c_str(), f[k].c_str(), arrow );
+		}
+	}
+	fclose ( fp );
+
+	printf ( "CSV %s: %lld of %lld rows matched, %lld values in %d shared columns compared, %d mismatches.\n",
+		fname, matched, csv_rows, compared, num_shared, bad );
+	printf ( "Largest difference:" );
+	for (size_t c = 0; c < cols.size(); c++) {
+		bool in_csv = false;
+		for (size_t k = 0; k < names.size(); k++) in_csv |= ( shared[k] == (int) c );
+		if ( in_csv ) printf ( " %s %.3g", cols[c].name.c_str(), max_err[c] );
+	}
+	printf ( "\n" );
+	if ( matched == 0 ) {
+		fprintf ( stderr, "ERROR: No rows of %s are in the stream.\n", fname );
+		return -1;
+	}
+	return bad;
+}
+
+int main ( int argc, char** argv )
+{
+	const char* arrow_name = 0x0;
+	const char* csv_name = 0x0;
+	bool verbose = false;
+	for (int a = 1; a < argc; a++) {
+		if      ( strcmp ( argv[a], "-v" ) == 0 )	verbose = true;
+		else if ( arrow_name == 0x0 )				arrow_name = argv[a];
+		else if ( csv_name == 0x0 )					csv_name = argv[a];
+	}
+	if ( arrow_name == 0x0 ) {
+		fprintf ( stderr, "Usage: arrow_check <file.arrows> [results.csv] [-v]\n" );
+		return 1;
+	}
+	MappedFile file;
+	if ( !file.Open ( arrow_name ) ) {
+		fprintf ( stderr, "ERROR: Unable to open %s\n", arrow_name );
+		return 1;
+	}
+	std::vector<Column> cols;
+	if ( !ReadStream ( file.getData(), file.getSize(), cols, verbose ) ) return 1;
+	if ( csv_name && CompareCSV ( csv_name, cols ) != 0 ) return 1;
+	return 0;
+}
@@ -0,0 +1,216 @@
+//--------------------------------------------------------
+//
+// Asset pack - writes the startup asset bundle read by the app
+//
+// Packs into one file, see asset_bundle.h:
+//   arial   font metrics from arial.bin, for HudText
+//   arial   the arial.tga atlas with its mip chain, box filtered, BC4
+//   grid    the ground grid mesh for the default runway, for GridRenderer
+// The app maps the bundle and uses these in place of loading the font and
+// building the grid. Run it again when the font, the default runway or the
+// grid layout changes; the app falls back to the loose files for anything
+// that does not match.
+//
+// Usage:  asset_pack <assets dir> [-o bundle] [-e extent]
+//   -o   output file (default <assets dir>/flightsim.bundle)
+//   -e   grid extent in meters, as the app's m_world_extent (default 27500)
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "asset_bundle.h"
+#include "baked_font.h"
+#include "grid_mesh.h"
+#include "flight_model.h"
+
+// Half-size level, 2x2 box filter, odd edges clamped
+static void Downsample ( const std::vector<uint8_t>& src, int w, int h, std::vector<uint8_t>& dst )
+{
+	int dw = MipSize ( w, 1 ), dh = MipSize ( h, 1 );
+	dst.resize ( dw * dh );
+	for (int y=0; y < dh; y++) {
+		int y0 = 2*y, y1 = (2*y+1 < h) ? 2*y+1 : h-1;
+		for (int x=0; x < dw; x++) {
+			int x0 = 2*x, x1 = (2*x+1 < w) ? 2*x+1 : w-1;
+			int sum = src[y0*w+x0] + src[y0*w+x1] + src[y1*w+x0] + src[y1*w+x1];
+			dst[y*dw+x] = (uint8_t) ((sum + 2) / 4);
+		}
+	}
+}
+
+// Eight values of a block from its two endpoints. r0 > r1 interpolates six,
+// otherwise four and adds 0 and 255.
+static void BC4Palette ( int r0, int r1, int p[8] )
+{
+	p[0] = r0;
+	p[1] = r1;
+	if ( r0 > r1 ) {
+		for (int i=1; i < 7; i++) p[i+1] = ((7-i)*r0 + i*r1) / 7;
+	} else {
+		for (int i=1; i < 5; i++) p[i+1] = ((5-i)*r0 + i*r1) / 5;
+		p[6] = 0;
+		p[7] = 255;
+	}
+}
+
+// Nearest palette index per texel, returns the squared error
+static int BC4Indices ( const uint8_t v[16], const int p[8], int idx[16] )
+{
+	int err = 0;
+	for (int t=0; t < 16; t++) {
+		int best = 0, best_d = 1 << 30;
+		for (int i=0; i < 8; i++) {
+			int d = (v[t] - p[i]) * (v[t] - p[i]);
+			if ( d < best_d ) { best_d = d; best = i; }
+		}
+		idx[t] = best;
+		err += best_d;
+	}
+	return err;
+}
+
+// One 4x4 block, trying both modes. Coverage is mostly 0 and 255 with an
+// edge ramp, which the six value mode keeps exact.
+static void EncodeBC4Block ( const uint8_t v[16], uint8_t out[8] )
+{
+	int lo = 255, hi = 0, lo_in = 255, hi_in = 0;
+	for (int t=0; t < 16; t++) {
+		if ( v[t] < lo ) lo = v[t];
+		if ( v[t] > hi ) hi = v[t];
+		if ( v[t] > 0 && v[t] < 255 ) {
+			if ( v[t] < lo_in ) lo_in = v[t];
+			if ( v[t] > hi_in ) hi_in = v[t];
+		}
+	}
+	int p[8], idx[16], idx6[16];
+	int r0 = hi, r1 = lo;
+	BC4Palette ( r0, r1, p );
+	int err = BC4Indices ( v, p, idx );
+
+	if ( lo_in > hi_in ) { lo_in = 0; hi_in = 0; }		// only 0 and 255
+	int p6[8];
+	BC4Palette ( lo_in, hi_in, p6 );
+	if ( BC4Indices ( v, p6, idx6 ) < err ) {
+		r0 = lo_in; r1 = hi_in;
+		memcpy ( idx, idx6, sizeof(idx) );
+	}
+
+	uint64_t bits = 0;
+	for (int t=0; t < 16; t++) bits |= (uint64_t) idx[t] << (3*t);
+	out[0] = (uint8_t) r0;
+	out[1] = (uint8_t) r1;
+	for (int b=0; b < 6; b++) out[2+b] = (uint8_t) (bits >> (8*b));
+}
+
+static int DecodeBC4Texel ( const uint8_t* block, int t )
+{
+	uint64_t bits = 0;
+	for (int b=0; b < 6; b++) bits |= (uint64_t) block[2+b] << (8*b);
+	int p[8];
+	BC4Palette ( block[0], block[1], p );
+	return p[ (bits >> (3*t)) & 7 ];
+}
+
+// Level in blocks, rows in GL order, texels past the edge replicated.
+// Returns the largest error of a texel after decoding.
+static int EncodeBC4 ( const std::vector<uint8_t>& img, int w, int h, std::vector<uint8_t>& out )
+{
+	int bw = (w + 3) / 4, bh = (h + 3) / 4;
+	size_t at = out.size ();
+	out.resize ( at + bw * bh * 8 );
+	int max_err = 0;
+	for (int by=0; by < bh; by++) {
+		for (int bx=0; bx < bw; bx++) {
+			uint8_t v[16];
+			for (int t=0; t < 16; t++) {
+				int x = bx*4 + t%4, y = by*4 + t/4;
+				v[t] = img[ (y < h ? y : h-1) * w + (x < w ? x : w-1) ];
+			}
+			uint8_t* block = &out[ at + (by*bw + bx) * 8 ];
+			EncodeBC4Block ( v, block );
+			for (int t=0; t < 16; t++) {
+				int e = abs ( DecodeBC4Texel ( block, t ) - v[t] );
+				if ( e > max_err ) max_err = e;
+			}
+		}
+	}
+	return max_err;
+}
+
+int main ( int argc, char** argv )
+{
+	const char* dir = 0x0;
+	std::string out_name;
+	float extent = 27500;
+	for (int a = 1; a < argc; a++) {
+		if      ( strcmp ( argv[a], "-o" ) == 0 && a+1 < argc )	out_name = argv[++a];
+		else if ( strcmp ( argv[a], "-e" ) == 0 && a+1 < argc )	extent = atof ( argv[++a] );
+		else if ( argv[a][0] != '-' )							dir = argv[a];
+	}
+	if ( dir == 0x0 || extent <= 0 ) {
+		fprintf ( stderr, "Usage: asset_pack <assets dir> [-o bundle] [-e extent]\n" );
+		return 1;
+	}
+	std::string base = dir;
+	if ( !base.empty() && base[base.size()-1] != '/' && base[base.size()-1] != '\\' ) base += '/';
+	if ( out_name.empty() ) out_name = base + BUNDLE_NAME;
+
+	AssetBundleWriter bundle;
+
+	// font metrics and the BC4 mip chain of its atlas
+	BakedFont font;
+	if ( !LoadBakedFont ( (base + "arial").c_str(), font ) ) return 1;
+	FontBundleHeader hdr;
+	memset ( &hdr, 0, sizeof(hdr) );
+	hdr.tex_width = font.tex_width;
+	hdr.tex_height = font.tex_height;
+	hdr.ascent = font.ascent;
+	hdr.descent = font.descent;
+	hdr.linegap = font.linegap;
+	std::vector<uint8_t> metrics ( sizeof(hdr) + sizeof(font.glyphs) );
+	memcpy ( &metrics[0], &hdr, sizeof(hdr) );
+	memcpy ( &metrics[sizeof(hdr)], font.glyphs, sizeof(font.glyphs) );
+	bundle.Add ( "arial", BUNDLE_FONT, 0x0, metrics.data(), metrics.size() );
+
+	std::vector<uint8_t> level = font.pixels, next, bc4;
+	int w = font.tex_width, h = font.tex_height, levels = 0, max_err = 0;
+	for (;;) {
+		int e = EncodeBC4 ( level, w, h, bc4 );
+		if ( e > max_err ) max_err = e;
+		levels++;
+		if ( w == 1 && h == 1 ) break;
+		Downsample ( level, w, h, next );
+		level.swap ( next );
+		w = MipSize ( w, 1 );
+		h = MipSize ( h, 1 );
+	}
+	uint32_t tex[3] = { (uint32_t) font.tex_width, (uint32_t) font.tex_height, (uint32_t) levels };
+	bundle.Add ( "arial", BUNDLE_BC4, tex, bc4.data(), bc4.size() );
+
+	// ground grid for the default runway
+	FlightModel model;
+	const Runway& rw = model.getRunway ( 0 );
+	GridMesh mesh;
+	BuildGridMesh ( mesh, rw.half_width, rw.half_length, extent );
+	std::vector<uint8_t> grid;
+	SaveGridMesh ( mesh, grid );
+	uint32_t gp[3] = { BundleFloatBits ( rw.half_width ), BundleFloatBits ( rw.half_length ), BundleFloatBits ( extent ) };
+	bundle.Add ( "grid", BUNDLE_GRID, gp, grid.data(), grid.size() );
+
+	if ( !bundle.Write ( out_name.c_str() ) ) {
+		fprintf ( stderr, "ERROR: Unable to write %s\n", out_name.c_str() );
+		return 1;
+	}
+	fprintf ( stderr, "arial %dx%d atlas, %d BC4 levels, %d bytes (%d uncompressed), max error %d\n",
+		font.tex_width, font.tex_height, levels, (int) bc4.size(), font.tex_width * font.tex_height, max_err );
+	fprintf ( stderr, "grid %d tiles per side, %d vertices\n", mesh.tiles, (int) (mesh.world.size() + mesh.tile.size()) );
+	fprintf ( stderr, "Wrote %s, %d bytes\n", out_name.c_str(), (int) bundle.getSize() );
+	return 0;
+}
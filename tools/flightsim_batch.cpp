@@ -0,0 +1,423 @@
+//--------------------------------------------------------
+//
+// Flightsim batch - headless flight model runner
+//
+// Runs the flight model with no window or GL context, for parameter
+// sweeps on render-less nodes. Reads a scenario with initial conditions
+// and a control schedule, steps the fleet and writes CSV results, and
+// optionally columnar telemetry as an Arrow IPC stream.
+//
+// Usage:  flightsim_batch <scenario.txt> [-o results.csv]
+//
+// Scenario format, one command per line, # starts a comment:
+//   dt <sec>                          step size (default 0.001)
+//   duration <sec>                    simulated time (default 60)
+//   output <sec>                      output interval (default 0.1)
+//   kernel <auto|scalar|avx2|neon>    force kernel (default auto)
+//   integrator <euler|semi|rk4> [tol] airborne integrator (default euler); rk4 with tol (m) steps adaptively
+//   type <default|trainer|glider|jet> aircraft type, before any aircraft (default default)
+//   aero <analytic|table|polar file>   lift curve: analytic, built-in table, or CL polar ("aoa CL" lines)
+//   threads <n>                       worker threads, 0 = all cores (default 1)
+//   wind <x> <y> <z>                  wind (m/s), the mean wind at 10 m with turbulence
+//   turbulence <w20> [shear] [seed]   Dryden turbulence of W20 (m/s, 7.5 light, 15 moderate), power law shear (default 1/7)
+//   runway <x> <z> <heading> <width> <length>   add a runway (m, deg); the first replaces the default at the origin
+//   separation <m>                    count aircraft pairs closer than this at each output
+//   contacts [near] [collide]         near-miss and collision events every step (default 152.4 and 12 m)
+//   terrain <dir>                     ground from DEM tiles (see tools/terrain_tiles.cpp) instead of y=0
+//   aircraft <x> <y> <z> <vx> <vy> <vz> <power>
+//   control <t> <id|*> <roll> <pitch> <power> <flaps>
+//   autopilot <id|*> <alt> <heading> <speed>   hold altitude (m), heading (deg, clockwise from +z) and speed (m/s)
+//   waypoint <id|*> <x> <y> <z> <speed>        add to the aircraft's route, flown in order at altitude y, then held
+//   telemetry <file> <sec> [stride] [groups]   Arrow IPC telemetry every sec, of every stride-th aircraft, of the
+//                                     groups state,attitude,controls,forces,landing (default all). CSV is then
+//                                     only written with -o.
+// Control entries take effect at time t for aircraft id, or for all with *.
+// The autopilot replaces the roll, pitch and power of control entries.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "flight_model.h"
+#include "fleet_sched.h"
+#include "aero_table.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include "autopilot.h"
+#include "telemetry.h"
+#include "broadphase.h"
+
+#define TERRAIN_EVERY	100			// steps between terrain paging updates
+#define TERRAIN_RADIUS	10000		// tiles kept within this of each aircraft (m)
+#define WIND_RADIUS		1500		// wind tiles kept within this of each aircraft (m)
+#define COLLISIONS_SHOWN	10			// collisions listed, the rest are counted
+
+struct ControlEntry {
+	float	time;
+	int		id;				// -1 = all aircraft
+	float	roll, pitch, power, flaps;
+};
+
+struct AutopilotEntry {
+	int		id;				// -1 = all aircraft
+	float	alt, heading, speed;
+};
+
+struct WaypointEntry {
+	int		id;
+	Waypoint wp;
+};
+
+struct Scenario {
+	float	dt, duration, output;
+	int		kernel;
+	int		threads;
+	float	separation;
+	float	contact_near, contact_collide;		// 0 = no contact events
+	std::vector<ControlEntry> controls;
+	std::vector<AutopilotEntry> autopilot;
+	std::vector<WaypointEntry> waypoints;
+	std::string tel_name;
+	float	tel_interval;
+	int		tel_stride, tel_groups;
+};
+
+static bool ControlBefore ( const ControlEntry& a, const ControlEntry& b )		{ return a.time < b.time; }
+
+static AeroTable g_aero;
+static Terrain g_terrain;
+static WindField g_wind;
+static Autopilot g_autopilot;
+static TelemetrySink g_tel;
+static Broadphase g_contacts;
+static ContactQueue g_contact_log;
+
+bool LoadScenario ( const char* fname, Scenario& sc, FlightModel& model )
+{
+	FILE* fp = fopen ( fname, "rt" );
+	if ( fp == 0x0 ) {
+		fprintf ( stderr, "ERROR: Unable to open scenario %s\n", fname );
+		return false;
+	}
+	sc.dt = 0.001;
+	sc.duration = 60;
+	sc.output = 0.1;
+	sc.kernel = KERNEL_AUTO;
+	sc.threads = 1;
+	sc.separation = 0;
+	sc.contact_near = 0;
+	sc.contact_collide = 0;
+	sc.tel_interval = 0;
+	sc.tel_stride = 1;
+	sc.tel_groups = TEL_ALL;
+
+	char buf[1024], cmd[64], arg[64];
+	int line = 0;
+	int runways = 0;
+	bool ok = true;
+
+	while ( fgets ( buf, 1024, fp ) ) {
+		line++;
+		char* c = strchr ( buf, '#' );		// strip comments
+		if ( c ) *c = '\0';
+		if ( sscanf ( buf, "%63s", cmd ) != 1 ) continue;
+
+		Vec3F p, v;
+		ControlEntry e;
+		int n = 0;
+		if ( strcmp ( cmd, "dt" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f", &sc.dt ) - 1;
+		} else if ( strcmp ( cmd, "duration" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f", &sc.duration ) - 1;
+		} else if ( strcmp ( cmd, "output" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f", &sc.output ) - 1;
+		} else if ( strcmp ( cmd, "threads" ) == 0 ) {
+			n = sscanf ( buf, "%*s %d", &sc.threads ) - 1;
+		} else if ( strcmp ( cmd, "wind" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f %f %f", &p.x, &p.y, &p.z ) - 3;
+			model.m_wind = p;
+		} else if ( strcmp ( cmd, "turbulence" ) == 0 ) {
+			float w20, shear = 1.0f / 7.0f;
+			unsigned int seed = 1;
+			n = (sscanf ( buf, "%*s %f %f %u", &w20, &shear, &seed ) >= 1) ? 0 : -1;
+			if ( n == 0 ) {
+				g_wind.Open ( seed );
+				g_wind.setTurbulence ( w20 );
+				g_wind.setShear ( shear );
+				model.setWindField ( &g_wind );
+			}
+		} else if ( strcmp ( cmd, "runway" ) == 0 ) {
+			float heading, w, l;
+			n = sscanf ( buf, "%*s %f %f %f %f %f", &p.x, &p.z, &heading, &w, &l ) - 5;
+			if ( n == 0 ) {
+				if ( runways++ == 0 ) model.ClearRunways ();
+				model.AddRunway ( p.x, p.z, heading, w, l );
+			}
+		} else if ( strcmp ( cmd, "terrain" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s", arg ) - 1;
+			if ( n == 0 ) {
+				if ( g_terrain.Open ( arg ) )	model.setTerrain ( &g_terrain );
+				else { fprintf ( stderr, "ERROR: %s:%d: no terrain in %s\n", fname, line, arg ); ok = false; }
+			}
+		} else if ( strcmp ( cmd, "separation" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f", &sc.separation ) - 1;
+		} else if ( strcmp ( cmd, "kernel" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s", arg ) - 1;
+			if      ( strcmp ( arg, "scalar" ) == 0 )	sc.kernel = KERNEL_SCALAR;
+			else if ( strcmp ( arg, "avx2" ) == 0 )		sc.kernel = KERNEL_AVX2;
+			else if ( strcmp ( arg, "neon" ) == 0 )		sc.kernel = KERNEL_NEON;
+			else if ( strcmp ( arg, "auto" ) == 0 )		sc.kernel = KERNEL_AUTO;
+			else n = -1;
+		} else if ( strcmp ( cmd, "integrator" ) == 0 ) {
+			float tol = 0;
+			n = (sscanf ( buf, "%*s %63s %f", arg, &tol ) >= 1) ? 0 : -1;
+			if      ( strcmp ( arg, "euler" ) == 0 )	model.setIntegrator ( INTEGRATOR_EULER );
+			else if ( strcmp ( arg, "semi" ) == 0 )		model.setIntegrator ( INTEGRATOR_SEMI_IMPLICIT );
+			else if ( strcmp ( arg, "rk4" ) == 0 )		model.setIntegrator ( INTEGRATOR_RK4 );
+			else n = -1;
+			model.setAdaptive ( tol );
+		} else if ( strcmp ( cmd, "aero" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s", arg ) - 1;
+			if      ( strcmp ( arg, "analytic" ) == 0 )	model.setAeroTable ( 0x0 );
+			else if ( strcmp ( arg, "table" ) == 0 )	{ g_aero.BuildDefault (); model.setAeroTable ( &g_aero ); }
+			else if ( g_aero.LoadPolar ( arg ) )		model.setAeroTable ( &g_aero );
+			else n = -1;
+		} else if ( strcmp ( cmd, "type" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s", arg ) - 1;
+			int t;
+			for (t = 0; t < AIRCRAFT_TYPES; t++)
+				if ( strcmp ( arg, FlightModel::getAircraftTypeName(t) ) == 0 ) break;
+			if ( t < AIRCRAFT_TYPES )	model.setAircraftType ( t );
+			else						n = -1;
+		} else if ( strcmp ( cmd, "aircraft" ) == 0 ) {
+			float power;
+			n = sscanf ( buf, "%*s %f %f %f %f %f %f %f", &p.x, &p.y, &p.z, &v.x, &v.y, &v.z, &power ) - 7;
+			if ( n == 0 ) model.AddAircraft ( p, v, power );
+		} else if ( strcmp ( cmd, "control" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f %63s %f %f %f %f", &e.time, arg, &e.roll, &e.pitch, &e.power, &e.flaps ) - 6;
+			e.id = (arg[0] == '*') ? -1 : atoi ( arg );
+			if ( n == 0 ) sc.controls.push_back ( e );
+		} else if ( strcmp ( cmd, "autopilot" ) == 0 ) {
+			AutopilotEntry a;
+			n = sscanf ( buf, "%*s %63s %f %f %f", arg, &a.alt, &a.heading, &a.speed ) - 4;
+			a.id = (arg[0] == '*') ? -1 : atoi ( arg );
+			if ( n == 0 ) sc.autopilot.push_back ( a );
+		} else if ( strcmp ( cmd, "waypoint" ) == 0 ) {
+			WaypointEntry w;
+			n = sscanf ( buf, "%*s %63s %f %f %f %f", arg, &w.wp.x, &w.wp.y, &w.wp.z, &w.wp.speed ) - 5;
+			w.id = (arg[0] == '*') ? -1 : atoi ( arg );
+			if ( n == 0 ) sc.waypoints.push_back ( w );
+		} else if ( strcmp ( cmd, "contacts" ) == 0 ) {
+			sc.contact_near = CONTACT_NEAR_DIST;
+			sc.contact_collide = CONTACT_COLLIDE_DIST;
+			sscanf ( buf, "%*s %f %f", &sc.contact_near, &sc.contact_collide );
+			n = ( sc.contact_near > 0 ) ? 0 : -1;
+		} else if ( strcmp ( cmd, "telemetry" ) == 0 ) {
+			char name[512], groups[256] = "all";
+			n = (sscanf ( buf, "%*s %511s %f %d %255s", name, &sc.tel_interval, &sc.tel_stride, groups ) >= 2) ? 0 : -1;
+			sc.tel_groups = TelemetrySink::ParseGroups ( groups );
+			if ( sc.tel_groups < 0 ) n = -1;
+			if ( n == 0 ) sc.tel_name = name;
+		} else {
+			n = -1;
+		}
+		if ( n != 0 ) {
+			fprintf ( stderr, "ERROR: %s:%d: bad command: %s", fname, line, buf );
+			ok = false;
+		}
+	}
+	fclose ( fp );
+
+	if ( ok && model.getNumAircraft() == 0 ) {
+		fprintf ( stderr, "ERROR: %s: no aircraft\n", fname );
+		ok = false;
+	}
+	for (size_t k = 0; ok && k < sc.controls.size(); k++) {
+		if ( sc.controls[k].id >= model.getNumAircraft() ) {
+			fprintf ( stderr, "ERROR: %s: control for unknown aircraft %d\n", fname, sc.controls[k].id );
+			ok = false;
+		}
+	}
+	for (size_t k = 0; ok && k < sc.autopilot.size(); k++) {
+		if ( sc.autopilot[k].id >= model.getNumAircraft() ) {
+			fprintf ( stderr, "ERROR: %s: autopilot for unknown aircraft %d\n", fname, sc.autopilot[k].id );
+			ok = false;
+		}
+	}
+	for (size_t k = 0; ok && k < sc.waypoints.size(); k++) {
+		if ( sc.waypoints[k].id >= model.getNumAircraft() ) {
+			fprintf ( stderr, "ERROR: %s: waypoint for unknown aircraft %d\n", fname, sc.waypoints[k].id );
+			ok = false;
+		}
+	}
+	std::stable_sort ( sc.controls.begin(), sc.controls.end(), ControlBefore );
+	return ok;
+}
+
+void WriteState ( FILE* fp, float t, FlightModel& m )
+{
+	Vec3F angs;
+	for (int i = 0; i < m.getNumAircraft(); i++) {
+		m.getOrient(i).toEuler ( angs );
+		fprintf ( fp, "%.4f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.4f,%.2f,%.2f,%.2f,%.1f,%.0f,%d,%d,%d\n", t, i,
+			m.m_px[i], m.m_py[i], m.m_pz[i], m.m_vx[i], m.m_vy[i], m.m_vz[i],
+			m.m_speed[i], m.m_aoa[i], angs.x, angs.y, angs.z, m.m_power[i], m.m_flaps[i],
+			m.m_land_count[i], (int) m.m_land_flags[i], m.m_land_runway[i] );
+	}
+}
+
+// Pairs of aircraft closer than r
+int CountPairs ( FlightModel& m, float r, std::vector<int>& near )
+{
+	int pairs = 0;
+	for (int i = 0; i < m.getNumAircraft(); i++) {
+		near.clear ();
+		m.NeighborsWithin ( i, r, near );
+		for (size_t k = 0; k < near.size(); k++)
+			if ( near[k] > i ) pairs++;
+	}
+	return pairs;
+}
+
+int main ( int argc, char** argv )
+{
+	const char* scenario = 0x0;
+	const char* outname = 0x0;
+	for (int a = 1; a < argc; a++) {
+		if ( strcmp ( argv[a], "-o" ) == 0 && a+1 < argc )	outname = argv[++a];
+		else												scenario = argv[a];
+	}
+	if ( scenario == 0x0 ) {
+		fprintf ( stderr, "Usage: flightsim_batch <scenario.txt> [-o results.csv]\n" );
+		return 1;
+	}
+
+	FlightModel model;
+	Scenario sc;
+	if ( !LoadScenario ( scenario, sc, model ) ) return 1;
+	model.setKernel ( sc.kernel );
+	FleetScheduler sched ( sc.threads );
+
+	// Autopilot holds, then one route per aircraft with waypoints
+	if ( !sc.autopilot.empty() || !sc.waypoints.empty() ) {
+		model.setAutopilot ( &g_autopilot );
+		std::vector<Waypoint> route;
+		for (int i = 0; i < model.getNumAircraft(); i++) {
+			for (size_t k = 0; k < sc.autopilot.size(); k++) {
+				AutopilotEntry& a = sc.autopilot[k];
+				if ( a.id < 0 || a.id == i ) g_autopilot.Engage ( model, i, AP_HOLD, a.alt, a.heading, a.speed );
+			}
+			route.clear ();
+			for (size_t k = 0; k < sc.waypoints.size(); k++)
+				if ( sc.waypoints[k].id < 0 || sc.waypoints[k].id == i ) route.push_back ( sc.waypoints[k].wp );
+			if ( !route.empty() ) g_autopilot.setRoute ( model, i, g_autopilot.AddRoute ( route.data(), (int) route.size(), false ) );
+		}
+	}
+
+	if ( !sc.tel_name.empty() ) {
+		int every = std::max ( 1, int( sc.tel_interval / sc.dt + 0.5 ) );
+		if ( !g_tel.Open ( sc.tel_name.c_str(), every, sc.tel_stride, sc.tel_groups, true ) ) return 1;
+	}
+	if ( sc.contact_near > 0 ) {
+		g_contacts.setDistances ( sc.contact_near, sc.contact_collide );
+		g_contacts.AddQueue ( &g_contact_log );
+		if ( g_tel.isOpen() ) g_contacts.AddQueue ( g_tel.getContactQueue() );
+		model.setBroadphase ( &g_contacts );
+	}
+
+	FILE* fp = sc.tel_name.empty() ? stdout : 0x0;
+	if ( outname ) {
+		fp = fopen ( outname, "wt" );
+		if ( fp == 0x0 ) {
+			fprintf ( stderr, "ERROR: Unable to write %s\n", outname );
+			return 1;
+		}
+	}
+	if ( fp ) fprintf ( fp, "time,id,x,y,z,vx,vy,vz,speed,aoa,roll,pitch,heading,power,flaps,landings,land_flags,land_runway\n" );
+
+	int steps = int( sc.duration / sc.dt + 0.5 );
+	int out_every = std::max ( 1, int( sc.output / sc.dt + 0.5 ) );
+	size_t next = 0;
+	int max_pairs = 0;
+	float max_pairs_time = 0;
+	std::vector<int> near;
+	float closest = -1;					// of the near misses that have cleared
+	int collisions = 0;
+	ContactEvent ce;
+
+	for (int s = 0; s <= steps; s++) {
+		float t = s * sc.dt;
+
+		// Apply scheduled controls
+		for ( ; next < sc.controls.size() && sc.controls[next].time <= t; next++ ) {
+			ControlEntry& e = sc.controls[next];
+			int i0 = (e.id < 0) ? 0 : e.id;
+			int i1 = (e.id < 0) ? model.getNumAircraft() : e.id + 1;
+			for (int i = i0; i < i1; i++)
+				model.setControls ( i, e.roll, e.pitch, e.power, e.flaps );
+		}
+
+		// Page terrain around the fleet, waiting for it so runs are repeatable
+		if ( g_terrain.isOpen() && s % TERRAIN_EVERY == 0 ) {
+			g_terrain.UpdateFocus ( model.getNumAircraft(), model.m_px.data(), model.m_pz.data(), TERRAIN_RADIUS );
+			g_terrain.Wait ();
+		}
+		if ( g_wind.isOpen() && s % TERRAIN_EVERY == 0 ) {
+			g_wind.UpdateFocus ( model.getNumAircraft(), model.m_px.data(), model.m_pz.data(), WIND_RADIUS );
+			g_wind.Wait ();
+		}
+		g_tel.Capture ( model );
+		if ( s % out_every == 0 ) {
+			if ( fp ) WriteState ( fp, t, model );
+			if ( sc.separation > 0 ) {
+				int pairs = CountPairs ( model, sc.separation, near );
+				if ( pairs > max_pairs ) { max_pairs = pairs; max_pairs_time = t; }
+			}
+		}
+		if ( s < steps ) model.Advance ( sc.dt, &sched );
+
+		while ( g_contact_log.Pop ( ce ) ) {
+			if ( ce.type == CONTACT_CLEAR && (closest < 0 || ce.dist < closest) ) closest = ce.dist;
+			if ( ce.type == CONTACT_COLLIDE && ++collisions <= COLLISIONS_SHOWN )
+				fprintf ( stderr, "Collision: aircraft %d and %d at t = %.3f s, %.1f m apart at (%.0f, %.0f, %.0f).\n",
+					ce.a, ce.b, ce.time, ce.dist, ce.x, ce.y, ce.z );
+		}
+	}
+	if ( fp && fp != stdout ) fclose ( fp );
+	g_tel.Close ();
+
+	// Touchdown summary
+	int landed = 0, crashed = 0;
+	for (int i = 0; i < model.getNumAircraft(); i++) {
+		if ( model.m_land_count[i] == 0 ) continue;
+		if ( model.m_land_flags[i] & LAND_OK )	landed++;
+		else									crashed++;
+	}
+	fprintf ( stderr, "%d %s aircraft, %d steps of %g s (%s, %d threads). Last touchdown: %d landed, %d crashed.\n",
+		model.getNumAircraft(), FlightModel::getAircraftTypeName ( model.getAircraftType() ), steps, sc.dt,
+		FlightModel::getKernelName ( model.getKernel() ), sched.getNumThreads(), landed, crashed );
+	if ( g_terrain.isOpen() )
+		fprintf ( stderr, "Terrain: %d tile loads, %d resident, %d queries on tiles not loaded.\n",
+			g_terrain.getLoads(), g_terrain.getResident(), g_terrain.getMisses() );
+	if ( g_wind.isOpen() )
+		fprintf ( stderr, "Wind: %d tiles generated, %d resident, %d samples on tiles not made.\n",
+			g_wind.getGenerated(), g_wind.getResident(), g_wind.getMisses() );
+	if ( !sc.tel_name.empty() )
+		fprintf ( stderr, "Telemetry: %llu rows in %d batches, %.1f MB to %s, %llu contact events.\n", (unsigned long long) g_tel.getRows(),
+			g_tel.getBatches(), g_tel.getBytes() / 1048576.0, sc.tel_name.c_str(), (unsigned long long) g_tel.getEvents() );
+	if ( sc.contact_near > 0 ) {
+		fprintf ( stderr, "Contacts: %llu near misses within %g m", (unsigned long long) g_contacts.getNearMisses(), g_contacts.getNearDist() );
+		if ( closest >= 0 ) fprintf ( stderr, " (closest %.1f m)", closest );
+		fprintf ( stderr, ", %llu collisions within %g m, %d pairs still close.\n", (unsigned long long) g_contacts.getCollisions(),
+			g_contacts.getCollideDist(), g_contacts.getActivePairs() );
+	}
+	if ( sc.separation > 0 )
+		fprintf ( stderr, "Separation: at most %d pairs closer than %g m (t = %g s).\n", max_pairs, sc.separation, max_pairs_time );
+	return 0;
+}
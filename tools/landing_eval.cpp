@@ -0,0 +1,510 @@
+//--------------------------------------------------------
+//
+// Landing eval - Monte-Carlo evaluation of approach profiles
+//
+// Flies thousands of approaches from randomized initial conditions, wind
+// and power/flap/flare schedules, and scores the first touchdown of each
+// against the CheckLanding criteria. A simple tracker flies them: pitch
+// holds a glide path to the touchdown zone, then a sink rate in the flare
+// at idle power, and bank steers to the runway centerline. Results are
+// pass rates and histograms per criterion, built from the landing flags
+// and values the model keeps, so nothing is formatted per touchdown.
+//
+// Wind is one vector per FlightModel, so approaches are grouped into cells
+// of the same wind sample. Each cell is a model stepped on its own, and
+// cells run in parallel on the fleet scheduler. Every approach draws its
+// parameters from a generator seeded by its index, so results do not
+// depend on the thread count.
+//
+// Usage:  landing_eval <profile.txt> [-o approaches.csv]
+//
+// Profile format, one command per line, # starts a comment:
+//   approaches <n>                    approaches to fly (default 1024)
+//   cell <n>                          approaches per wind sample (default 64)
+//   seed <n>                          random seed (default 1)
+//   dt <sec>                          step size (default 0.001)
+//   duration <sec>                    longest approach, then it counts as no touchdown (default 180)
+//   threads <n>                       worker threads, 0 = all cores (default 0)
+//   kernel <auto|scalar|avx2|neon>    force kernel (default auto)
+//   integrator <euler|semi|rk4> [tol] airborne integrator (default euler)
+//   type <default|trainer|glider|jet> aircraft type (default default)
+//   aero <analytic|table>             lift curve (default analytic)
+//   runway <x> <z> <heading> <width> <length>   the runway to land on (default at the origin along z)
+//   turbulence <w20> [shear]          Dryden turbulence of W20 (m/s) and power law shear (default none)
+// Uniform ranges, <name> <min> [max]:
+//   wind <m/s>                        horizontal wind at 10 m, random direction
+//   distance <m>                      start, before the runway center along its axis
+//   altitude <m>                      start altitude
+//   offset <m>                        start, right of the runway axis
+//   speed <m/s>                       start speed
+//   heading <deg>                     start heading error, to the right
+//   glide <deg>                       glide path angle
+//   power <0-10>                      approach power
+//   flaps <sec>                       time flaps go down
+//   flare <m>                         height the flare starts
+//   flare_sink <m/s>                  sink rate held in the flare
+//   idle <0-10>                       power in the flare
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "flight_model.h"
+#include "fleet_sched.h"
+#include "aero_table.h"
+#include "wind_field.h"
+
+#define CRITERIA		5					// speed, sink, pitch, roll, runway
+#define HIST_BINS		20
+#define GS_ALT_GAIN		0.02f				// pitch input per m below the glide path
+#define GS_SINK_GAIN	0.2f 				// pitch input per m/s sinking too fast
+#define LOC_OFF_GAIN	0.05f				// closing m/s per m off the centerline
+#define LOC_BANK_GAIN	1.0f				// bank deg per m/s of closing rate error
+#define LOC_MAX_BANK	20.0f				// deg
+#define LOC_ROLL_GAIN	0.05f				// roll input per deg of bank error
+
+struct Range {
+	float	lo, hi;
+};
+
+struct Profile {
+	int		approaches, cell, threads;
+	unsigned int seed;
+	float	dt, duration;
+	int		kernel, integrator, type;
+	float	tol;
+	bool	table;
+	bool	runway;
+	Runway	rw;
+	float	turbulence, shear;
+	Range	wind, distance, altitude, offset, speed, heading;
+	Range	glide, power, flaps, flare, flare_sink, idle;
+};
+
+// One approach: its draw and its first touchdown
+struct Approach {
+	Vec3F	pos, vel;
+	float	glide, power, flaps, flare, flare_sink, idle;
+	bool	down;							// touched down
+	float	time;
+	uint8_t	flags;
+	float	speed, sink, pitch, roll;
+	float	td_x, td_z;						// touchdown point
+};
+
+struct EvalJob {
+	const Profile*	pf;
+	Approach*		ap;
+	Vec3F*			wind;					// per cell
+	const AeroTable* aero;
+	const WindField* field;					// turbulence, 0x0 = none
+};
+
+// Per-index generator, splitmix64
+struct Random {
+	uint64_t	s;
+	Random ( unsigned int seed, uint64_t index )	{ s = ((uint64_t) seed << 32) ^ (index * 0x9E3779B97F4A7C15ull); }
+	float		Next ()		{ uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+							  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull; z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+							  return (float) ((z ^ (z >> 31)) >> 40) * (1.0f / 16777216.0f); }
+	float		In ( const Range& r )	{ return r.lo + (r.hi - r.lo) * Next(); }
+};
+
+static void SetRange ( Range& r, float lo, float hi )	{ r.lo = lo; r.hi = hi; }
+
+bool LoadProfile ( const char* fname, Profile& pf )
+{
+	FILE* fp = fopen ( fname, "rt" );
+	if ( fp == 0x0 ) {
+		fprintf ( stderr, "ERROR: Unable to open profile %s\n", fname );
+		return false;
+	}
+	pf.approaches = 1024;
+	pf.cell = 64;
+	pf.threads = 0;
+	pf.seed = 1;
+	pf.dt = 0.001;
+	pf.duration = 180;
+	pf.kernel = KERNEL_AUTO;
+	pf.integrator = INTEGRATOR_EULER;
+	pf.tol = 0;
+	pf.type = AIRCRAFT_DEFAULT;
+	pf.table = false;
+	pf.turbulence = 0;
+	pf.shear = 1.0f / 7.0f;
+	pf.runway = false;
+	SetRange ( pf.wind, 0, 5 );
+	SetRange ( pf.distance, 6000, 9000 );
+	SetRange ( pf.altitude, 150, 300 );
+	SetRange ( pf.offset, -20, 20 );
+	SetRange ( pf.speed, 100, 130 );
+	SetRange ( pf.heading, -1, 1 );
+	SetRange ( pf.glide, 2.5, 3.5 );
+	SetRange ( pf.power, 1.5, 2.5 );
+	SetRange ( pf.flaps, 10, 30 );
+	SetRange ( pf.flare, 5, 20 );
+	SetRange ( pf.flare_sink, 0.5, 1.5 );
+	SetRange ( pf.idle, 0, 0.5 );
+
+	struct { const char* name; Range* r; } ranges[] = {
+		{ "wind", &pf.wind }, { "distance", &pf.distance }, { "altitude", &pf.altitude }, { "offset", &pf.offset },
+		{ "speed", &pf.speed }, { "heading", &pf.heading }, { "glide", &pf.glide }, { "power", &pf.power }, { "flaps", &pf.flaps },
+		{ "flare", &pf.flare }, { "flare_sink", &pf.flare_sink }, { "idle", &pf.idle } };
+	const int num_ranges = sizeof(ranges) / sizeof(ranges[0]);
+
+	char buf[1024], cmd[64], arg[64];
+	int line = 0;
+	bool ok = true;
+
+	while ( fgets ( buf, 1024, fp ) ) {
+		line++;
+		char* c = strchr ( buf, '#' );		// strip comments
+		if ( c ) *c = '\0';
+		if ( sscanf ( buf, "%63s", cmd ) != 1 ) continue;
+
+		int n = 0, k;
+		for (k = 0; k < num_ranges; k++)
+			if ( strcmp ( cmd, ranges[k].name ) == 0 ) break;
+		if ( k < num_ranges ) {
+			Range& r = *ranges[k].r;
+			int got = sscanf ( buf, "%*s %f %f", &r.lo, &r.hi );
+			if ( got == 1 ) r.hi = r.lo;
+			n = (got >= 1) ? 0 : -1;
+		} else if ( strcmp ( cmd, "approaches" ) == 0 ) {
+			n = sscanf ( buf, "%*s %d", &pf.approaches ) - 1;
+		} else if ( strcmp ( cmd, "cell" ) == 0 ) {
+			n = sscanf ( buf, "%*s %d", &pf.cell ) - 1;
+		} else if ( strcmp ( cmd, "seed" ) == 0 ) {
+			n = sscanf ( buf, "%*s %u", &pf.seed ) - 1;
+		} else if ( strcmp ( cmd, "dt" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f", &pf.dt ) - 1;
+		} else if ( strcmp ( cmd, "duration" ) == 0 ) {
+			n = sscanf ( buf, "%*s %f", &pf.duration ) - 1;
+		} else if ( strcmp ( cmd, "threads" ) == 0 ) {
+			n = sscanf ( buf, "%*s %d", &pf.threads ) - 1;
+		} else if ( strcmp ( cmd, "kernel" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s", arg ) - 1;
+			if      ( strcmp ( arg, "scalar" ) == 0 )	pf.kernel = KERNEL_SCALAR;
+			else if ( strcmp ( arg, "avx2" ) == 0 )		pf.kernel = KERNEL_AVX2;
+			else if ( strcmp ( arg, "neon" ) == 0 )		pf.kernel = KERNEL_NEON;
+			else if ( strcmp ( arg, "auto" ) == 0 )		pf.kernel = KERNEL_AUTO;
+			else n = -1;
+		} else if ( strcmp ( cmd, "integrator" ) == 0 ) {
+			n = (sscanf ( buf, "%*s %63s %f", arg, &pf.tol ) >= 1) ? 0 : -1;
+			if      ( strcmp ( arg, "euler" ) == 0 )	pf.integrator = INTEGRATOR_EULER;
+			else if ( strcmp ( arg, "semi" ) == 0 )		pf.integrator = INTEGRATOR_SEMI_IMPLICIT;
+			else if ( strcmp ( arg, "rk4" ) == 0 )		pf.integrator = INTEGRATOR_RK4;
+			else n = -1;
+		} else if ( strcmp ( cmd, "type" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s", arg ) - 1;
+			int t;
+			for (t = 0; t < AIRCRAFT_TYPES; t++)
+				if ( strcmp ( arg, FlightModel::getAircraftTypeName(t) ) == 0 ) break;
+			if ( t < AIRCRAFT_TYPES )	pf.type = t;
+			else						n = -1;
+		} else if ( strcmp ( cmd, "aero" ) == 0 ) {
+			n = sscanf ( buf, "%*s %63s", arg ) - 1;
+			if      ( strcmp ( arg, "analytic" ) == 0 )	pf.table = false;
+			else if ( strcmp ( arg, "table" ) == 0 )	pf.table = true;
+			else n = -1;
+		} else if ( strcmp ( cmd, "turbulence" ) == 0 ) {
+			n = (sscanf ( buf, "%*s %f %f", &pf.turbulence, &pf.shear ) >= 1) ? 0 : -1;
+		} else if ( strcmp ( cmd, "runway" ) == 0 ) {
+			float w, l;
+			n = sscanf ( buf, "%*s %f %f %f %f %f", &pf.rw.x, &pf.rw.z, &pf.rw.heading, &w, &l ) - 5;
+			pf.rw.half_width = w * 0.5f;
+			pf.rw.half_length = l * 0.5f;
+			pf.runway = ( n == 0 );
+		} else {
+			n = -1;
+		}
+		if ( n != 0 ) {
+			fprintf ( stderr, "ERROR: %s:%d: bad command: %s", fname, line, buf );
+			ok = false;
+		}
+	}
+	fclose ( fp );
+
+	if ( ok && (pf.approaches < 1 || pf.cell < 1 || pf.dt <= 0) ) {
+		fprintf ( stderr, "ERROR: %s: need approaches, cell >= 1 and dt > 0\n", fname );
+		ok = false;
+	}
+	return ok;
+}
+
+// Draw approach i, relative to the runway
+static void DrawApproach ( const Profile& pf, const Runway& rw, int i, Approach& a )
+{
+	Random rnd ( pf.seed, (uint64_t) i + 1 );
+	float h = rw.heading * 3.141592653589f / 180.0f;
+	Vec3F along ( sinf(h), 0, cosf(h) ), right ( cosf(h), 0, -sinf(h) );
+
+	float dist = rnd.In ( pf.distance ), off = rnd.In ( pf.offset );
+	a.pos = Vec3F(rw.x, 0, rw.z) - along * dist + right * off;
+	a.pos.y = rnd.In ( pf.altitude );
+	float e = rnd.In ( pf.heading ) * 3.141592653589f / 180.0f;
+	a.vel = (along * cosf(e) + right * sinf(e)) * rnd.In ( pf.speed );
+	a.glide = rnd.In ( pf.glide );
+	a.power = rnd.In ( pf.power );
+	a.flaps = rnd.In ( pf.flaps );
+	a.flare = rnd.In ( pf.flare );
+	a.flare_sink = rnd.In ( pf.flare_sink );
+	a.idle = rnd.In ( pf.idle );
+	a.down = false;
+	a.time = 0;
+	a.flags = 0;
+	a.speed = a.sink = a.pitch = a.roll = 0;
+	a.td_x = a.td_z = 0;
+}
+
+// Fly one wind cell to its last touchdown or the duration
+static void FlyCell ( void* ctx, int c )
+{
+	EvalJob& job = *(EvalJob*) ctx;
+	const Profile& pf = *job.pf;
+	int first = c * pf.cell;
+	int n = std::min ( pf.cell, pf.approaches - first );
+	Approach* ap = job.ap + first;
+
+	FlightModel m;
+	m.setAircraftType ( pf.type );
+	m.setKernel ( pf.kernel );
+	m.setIntegrator ( pf.integrator );
+	m.setAdaptive ( pf.tol );
+	m.setTrafficIndex ( false );
+	if ( pf.table ) m.setAeroTable ( job.aero );
+	if ( pf.runway ) {
+		m.ClearRunways ();
+		m.AddRunway ( pf.rw.x, pf.rw.z, pf.rw.heading, pf.rw.half_width*2, pf.rw.half_length*2 );
+	}
+	m.m_wind = job.wind[c];
+	m.setWindField ( job.field );
+	for (int j = 0; j < n; j++)
+		m.AddAircraft ( ap[j].pos, ap[j].vel, ap[j].power );
+
+	// Aim point, half way from the near end of the runway to its center
+	const Runway& rw = m.getRunway ( 0 );
+	float rh = rw.heading * 3.141592653589f / 180.0f;
+	Vec3F along ( sinf(rh), 0, cosf(rh) ), right ( cosf(rh), 0, -sinf(rh) );
+	Vec3F aim = Vec3F(rw.x, 0, rw.z) - along * (rw.half_length * 0.5f);
+
+	int steps = int( pf.duration / pf.dt + 0.5f );
+	int left = n;
+	for (int s = 0; s < steps && left > 0; s++) {
+		float t = s * pf.dt;
+		for (int j = 0; j < n; j++) {
+			Approach& a = ap[j];
+			if ( a.down ) continue;
+
+			// Touchdown, scored by CheckLanding during the last step
+			if ( m.m_land_count[j] > 0 ) {
+				a.down = true;
+				a.time = t;
+				a.flags = m.m_land_flags[j];
+				a.speed = m.m_land_speed[j];
+				a.sink = fabsf ( m.m_land_sink[j] );
+				a.pitch = m.m_land_pitch[j];
+				a.roll = m.m_land_roll[j];
+				a.td_x = m.m_px[j];
+				a.td_z = m.m_pz[j];
+				left--;
+				continue;
+			}
+			// Glide slope to the aim point, or the flare. Pitch input is + nose up.
+			float h = m.m_py[j] - m.m_ground[j];
+			float togo = (aim.x - m.m_px[j]) * along.x + (aim.z - m.m_pz[j]) * along.z;
+			float gs = tanf ( a.glide * 3.141592653589f / 180.0f );
+			float ground_speed = sqrtf ( m.m_vx[j]*m.m_vx[j] + m.m_vz[j]*m.m_vz[j] );
+			float pitch, power;
+			if ( h > a.flare ) {
+				pitch = GS_ALT_GAIN * (std::max ( togo, 0.0f ) * gs - h) + GS_SINK_GAIN * (-ground_speed * gs - m.m_vy[j]);
+				power = a.power;
+			} else {
+				pitch = GS_SINK_GAIN * (-a.flare_sink - m.m_vy[j]);
+				power = a.idle;
+			}
+			pitch = std::min ( std::max ( pitch, -1.0f ), 1.0f );
+
+			// Localizer, bank toward the centerline, closing at a rate set by the
+			// offset. Roll input is a roll rate, so it flies the bank angle. Wings
+			// level in the flare.
+			Vec3F angs;
+			m.getOrient ( j ).toEuler ( angs );
+			float off = (m.m_px[j] - aim.x) * right.x + (m.m_pz[j] - aim.z) * right.z;
+			float drift = m.m_vx[j] * right.x + m.m_vz[j] * right.z;
+			float bank = 0;
+			if ( h > a.flare ) {
+				bank = LOC_BANK_GAIN * (LOC_OFF_GAIN * off + drift);
+				bank = std::min ( std::max ( bank, -LOC_MAX_BANK ), LOC_MAX_BANK );
+			}
+			float roll = LOC_ROLL_GAIN * (bank - angs.x);
+			roll = std::min ( std::max ( roll, -1.0f ), 1.0f );
+
+			float flaps = ( t < a.flaps ) ? 0 : 1;
+			m.setControls ( j, roll, pitch, power, flaps );
+		}
+		m.Advance ( pf.dt );
+	}
+}
+
+// Touchdowns per bin of a criterion's measured value, and the fraction of
+// them that landed, so a near miss on one criterion shows what else failed
+struct Histogram {
+	const char*	name;
+	const char*	units;
+	uint8_t		flag;
+	float		limit, max;						// criterion, top of the last bin
+	int			count[HIST_BINS], landed[HIST_BINS];
+};
+
+static void PrintHistogram ( const Histogram& h )
+{
+	int total = 0;
+	for (int b = 0; b < HIST_BINS; b++) total += h.count[b];
+	printf ( "\n%s (%s), limit %g\n", h.name, h.units, h.limit );
+	printf ( "        range   count  landed%%\n" );
+	float w = h.max / HIST_BINS;
+	for (int b = 0; b < HIST_BINS; b++) {
+		if ( h.count[b] == 0 ) continue;
+		int bar = (total > 0) ? (h.count[b] * 50 + total/2) / total : 0;
+		printf ( " %6.1f-%-6.1f %6d  %6.1f  ", b*w, (b+1)*w, h.count[b], 100.0f * h.landed[b] / h.count[b] );
+		for (int k = 0; k < bar; k++) putchar ( '#' );
+		printf ( "%s\n", (b == HIST_BINS-1) ? "  (and over)" : "" );
+	}
+}
+
+int main ( int argc, char** argv )
+{
+	const char* profile = 0x0;
+	const char* outname = 0x0;
+	for (int a = 1; a < argc; a++) {
+		if ( strcmp ( argv[a], "-o" ) == 0 && a+1 < argc )	outname = argv[++a];
+		else												profile = argv[a];
+	}
+	if ( profile == 0x0 ) {
+		fprintf ( stderr, "Usage: landing_eval <profile.txt> [-o approaches.csv]\n" );
+		return 1;
+	}
+	Profile pf;
+	if ( !LoadProfile ( profile, pf ) ) return 1;
+
+	FlightModel ref;								// for the default runway
+	Runway rw = pf.runway ? pf.rw : ref.getRunway ( 0 );
+	AeroTable aero;
+	if ( pf.table ) aero.BuildDefault ();
+
+	int cells = (pf.approaches + pf.cell - 1) / pf.cell;
+	std::vector<Approach> ap ( pf.approaches );
+	std::vector<Vec3F> wind ( cells );
+	for (int i = 0; i < pf.approaches; i++)
+		DrawApproach ( pf, rw, i, ap[i] );
+	for (int c = 0; c < cells; c++) {
+		Random rnd ( pf.seed, ~(uint64_t) c );
+		float speed = rnd.In ( pf.wind ), dir = rnd.Next() * 2 * 3.141592653589f;
+		wind[c].Set ( speed * sinf(dir), 0, speed * cosf(dir) );
+	}
+
+	EvalJob job;
+	job.pf = &pf;
+	job.ap = ap.data();
+	job.wind = wind.data();
+	job.aero = &aero;
+	job.field = 0x0;
+
+	// Turbulence tiles along every approach, made before flying so that cells
+	// only read the field and results do not depend on generator timing
+	WindField field;
+	if ( pf.turbulence > 0 ) {
+		field.Open ( pf.seed );
+		field.setTurbulence ( pf.turbulence );
+		field.setShear ( pf.shear );
+		std::vector<float> px, pz;
+		for (int i = 0; i < pf.approaches; i++) {
+			Vec3F d = Vec3F(rw.x, 0, rw.z) - Vec3F(ap[i].pos.x, 0, ap[i].pos.z);
+			int k = (int) (d.Length() / WIND_SPACING) + 1;
+			for (int s = 0; s <= k; s++) {
+				px.push_back ( ap[i].pos.x + d.x * s / k );
+				pz.push_back ( ap[i].pos.z + d.z * s / k );
+			}
+		}
+		field.UpdateFocus ( (int) px.size(), px.data(), pz.data(), 4 * WIND_SPACING );
+		field.Wait ();
+		job.field = &field;
+	}
+
+	FleetScheduler sched ( pf.threads );
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	sched.ParallelFor ( cells, FlyCell, &job );
+	double secs = std::chrono::duration<double> ( std::chrono::steady_clock::now() - t0 ).count();
+
+	// Aggregate
+	Histogram hist[CRITERIA] = {
+		{ "Speed", "m/s", LAND_SPEED, 80, 160, {0}, {0} },
+		{ "Sink rate", "m/s", LAND_SINK, 2, 10, {0}, {0} },
+		{ "Pitch", "deg", LAND_PITCH, 5, 20, {0}, {0} },
+		{ "Roll", "deg", LAND_ROLL, 5, 20, {0}, {0} },
+		{ "On runway", "distance from center / runway half size", LAND_RUNWAY, 1, 4, {0}, {0} } };
+
+	float h = rw.heading * 3.141592653589f / 180.0f;
+	float sh = sinf(h), ch = cosf(h);
+	int down = 0, landed = 0, passed[CRITERIA] = { 0 };
+	for (int i = 0; i < pf.approaches; i++) {
+		const Approach& a = ap[i];
+		if ( !a.down ) continue;
+		down++;
+		if ( a.flags & LAND_OK ) landed++;
+
+		// On runway is measured as the touchdown point in runway half sizes, 1 at the edge
+		float dx = a.td_x - rw.x, dz = a.td_z - rw.z;
+		float along = fabsf ( dz * ch + dx * sh ) / rw.half_length, across = fabsf ( dx * ch - dz * sh ) / rw.half_width;
+		float value[CRITERIA] = { a.speed, a.sink, a.pitch, a.roll, std::max ( along, across ) };
+		for (int k = 0; k < CRITERIA; k++) {
+			Histogram& hs = hist[k];
+			int b = (int) (value[k] / hs.max * HIST_BINS);
+			if ( b < 0 ) b = 0;
+			if ( b >= HIST_BINS ) b = HIST_BINS-1;
+			hs.count[b]++;
+			if ( a.flags & LAND_OK ) hs.landed[b]++;
+			if ( a.flags & hs.flag ) passed[k]++;
+		}
+	}
+
+	printf ( "%d approaches in %d wind cells, %s, %g s steps: %.2f s on %d threads\n", pf.approaches, cells,
+		FlightModel::getAircraftTypeName ( pf.type ), pf.dt, secs, sched.getNumThreads() );
+	if ( job.field )
+		printf ( "Turbulence W20 %g m/s, shear %g: %d wind tiles, %d samples outside them\n", pf.turbulence, pf.shear,
+			field.getGenerated(), field.getMisses() );
+	printf ( "Touched down %d, no touchdown in %g s %d\n", down, pf.duration, pf.approaches - down );
+	printf ( "Landed (all criteria) %d, %.1f%% of touchdowns\n\n", landed, down ? 100.0f * landed / down : 0.0f );
+	printf ( "Criterion          pass   rate\n" );
+	for (int k = 0; k < CRITERIA; k++)
+		printf ( " %-14s %7d  %5.1f%%\n", hist[k].name, passed[k], down ? 100.0f * passed[k] / down : 0.0f );
+	for (int k = 0; k < CRITERIA; k++)
+		PrintHistogram ( hist[k] );
+
+	if ( outname ) {
+		FILE* fp = fopen ( outname, "wt" );
+		if ( fp == 0x0 ) {
+			fprintf ( stderr, "ERROR: Unable to write %s\n", outname );
+			return 1;
+		}
+		fprintf ( fp, "id,cell,wind_x,wind_z,x,y,z,speed0,glide,power,flaps_t,flare_h,flare_sink,idle,down,time,flags,speed,sink,pitch,roll,td_x,td_z\n" );
+		for (int i = 0; i < pf.approaches; i++) {
+			const Approach& a = ap[i];
+			const Vec3F& w = wind[ i / pf.cell ];
+			fprintf ( fp, "%d,%d,%.2f,%.2f,%.1f,%.1f,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%.3f,%d,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f\n",
+				i, i / pf.cell, w.x, w.z, a.pos.x, a.pos.y, a.pos.z, a.vel.Length(), a.glide, a.power, a.flaps,
+				a.flare, a.flare_sink, a.idle, a.down ? 1 : 0, a.time, (int) a.flags, a.speed, a.sink, a.pitch, a.roll, a.td_x, a.td_z );
+		}
+		fclose ( fp );
+	}
+	return 0;
+}
@@ -0,0 +1,330 @@
+//--------------------------------------------------------
+//
+// Net check - codec error bounds and a lossy loopback for net sync
+//
+// Codec: quantizes random states over the whole encodable range and checks
+// the error of each field against its quantization step: position and
+// velocity per axis, orientation as the rotation angle between the
+// original and the smallest-three result, and the controls. Full and delta
+// states must read back bit exact, against the baseline they were written
+// with. Reports the bytes a state costs in full and as deltas of steady
+// flight at 60 Hz, against the last tick and against older baselines, as
+// a sender uses when acks are lost.
+//
+// Loopback: two stations on 127.0.0.1, each flying one aircraft, talk
+// through a relay that drops a share of the datagrams each way. Station A
+// turns and climbs. B's copy of A is compared with A's own aircraft at
+// every step. Reports the packets, their size, the round trip and the
+// remote position error. A run fails if A is never heard from, if any
+// packet is rejected (other than lost), or if the error at no loss is
+// beyond the bound.
+//
+// Usage:  net_check [-n states] [-t sec] [-l loss%] [-p port]
+//   -n   random states for the codec check (default 200000)
+//   -t   loopback run time, real time (default 5)
+//   -l   datagrams dropped by the relay, each way (default 0, 10 and 30)
+//   -p   first of four UDP ports used (default 47000)
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include "net_codec.h"
+#include "net_sync.h"
+#include "flight_model.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#define CLOSE_SOCKET(s)		closesocket ( (SOCKET) s )
+#else
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#define CLOSE_SOCKET(s)		close ( (int) s )
+#endif
+
+#define LOOP_DT			0.001f		// step (sec)
+#define LOOP_MAX_ERROR	2.0f		// m, remote position error allowed with no loss
+#define DELTA_AGES		4			// baselines 1, 2, 4 and 8 ticks old
+
+static unsigned int g_seed = 1;
+static float Rand ()				{ g_seed = g_seed * 1664525u + 1013904223u; return (g_seed >> 8) * (1.0f / 16777216.0f); }
+static float Rand ( float a, float b )	{ return a + (b - a) * Rand(); }
+
+static bool SameState ( const NetState& a, const NetState& b )
+{
+	return memcmp ( a.f, b.f, sizeof(a.f) ) == 0;
+}
+
+// Rotation angle between two orientations (rad), in double so small angles are exact
+static double QuatAngle ( const Quaternion& a, const Quaternion& b )
+{
+	double dot = (double) a.X*b.X + (double) a.Y*b.Y + (double) a.Z*b.Z + (double) a.W*b.W;
+	double s = (dot < 0) ? -1 : 1, d2 = 0;
+	d2 += pow ( a.X - s*b.X, 2 ) + pow ( a.Y - s*b.Y, 2 ) + pow ( a.Z - s*b.Z, 2 ) + pow ( a.W - s*b.W, 2 );
+	double h = sqrt ( d2 ) * 0.5;
+	return 4 * asin ( h < 1 ? h : 1 );			// the chord between unit quaternions is half the rotation
+}
+
+//----------------------------------------------------------- codec
+
+static bool CheckCodec ( int num )
+{
+	// Bounds, half a step per field plus float rounding of the world position
+	const double pos_step = 0.5 / NET_POS_SCALE, vel_step = 0.5 / NET_VEL_SCALE;
+	const double q_step = 0.5 / ( ((1 << NET_QUAT_BITS) - 1) * 0.70710678 );
+	const double ang_bound = 2 * 2 * sqrt(3.0) * q_step;		// chord of three components and the fourth from them, rotation is twice it
+	double max_pos = 0, max_vel = 0, max_ang = 0, max_ctrl[4] = { 0, 0, 0, 0 }, pos_bound = 0;
+	long long full_bits = 0;
+	int bad = 0;
+
+	uint8_t buf[256];
+	for (int n = 0; n < num; n++) {
+		Vec3F pos ( Rand ( -60000, 60000 ), Rand ( NET_ALT_MIN, 15000 ), Rand ( -60000, 60000 ) );
+		Vec3F vel ( Rand ( -400, 400 ), Rand ( -200, 200 ), Rand ( -400, 400 ) );
+		Quaternion q;
+		q.X = Rand(-1,1); q.Y = Rand(-1,1); q.Z = Rand(-1,1); q.W = Rand(-1,1);
+		q.normalize ();
+		float ctrl[4] = { Rand(-1,1), Rand(-1,1), Rand(0,12), Rand(0,1) };
+
+		NetState s, r;
+		NetQuantize ( s, pos, vel, q, ctrl[0], ctrl[1], ctrl[2], ctrl[3] );
+		Vec3F p2, v2;
+		Quaternion q2;
+		float c2[4];
+		NetDequantize ( s, p2, v2, q2, c2[0], c2[1], c2[2], c2[3] );
+
+		float c = std::max ( fabs(pos.x), fabs(pos.z) );
+		double ulp = nextafterf ( c, 2*c ) - c;						// one rounding of the rebuilt world coordinate
+		pos_bound = std::max ( pos_bound, pos_step + ulp );
+		double ep = std::max ( std::max ( fabs(p2.x - pos.x), fabs(p2.y - pos.y) ), fabs(p2.z - pos.z) );
+		double ev = std::max ( std::max ( fabs(v2.x - vel.x), fabs(v2.y - vel.y) ), fabs(v2.z - vel.z) );
+		double ea = QuatAngle ( q, q2 );
+		max_pos = std::max ( max_pos, ep );
+		max_vel = std::max ( max_vel, ev );
+		max_ang = std::max ( max_ang, ea );
+		const double ctrl_step[4] = { 0.5/127, 0.5/127, 0.5/10, 0.5/15 };
+		for (int k = 0; k < 4; k++) {
+			double e = fabs ( c2[k] - ctrl[k] );
+			max_ctrl[k] = std::max ( max_ctrl[k], e );
+			if ( e > ctrl_step[k] * 1.001 ) bad++;
+		}
+		if ( ep > pos_step + ulp || ev > vel_step * 1.001 || ea > ang_bound ) bad++;
+
+		// Full state round trip
+		{
+			BitWriter w ( buf, sizeof(buf) );
+			NetWriteState ( w, s, 0x0 );
+			w.Flush ();
+			full_bits += w.getBits ();
+			BitReader rd ( buf, w.getBytes() );
+			if ( !NetReadState ( rd, r, 0x0 ) || !SameState ( r, s ) ) bad++;
+		}
+		// Delta against a nearby baseline
+		{
+			NetState base;
+			NetQuantize ( base, pos + Vec3F ( Rand(-50,50), Rand(-5,5), Rand(-50,50) ), vel + Vec3F ( Rand(-5,5), Rand(-1,1), Rand(-5,5) ),
+				q, ctrl[0], ctrl[1], ctrl[2], ctrl[3] );
+			BitWriter w ( buf, sizeof(buf) );
+			NetWriteState ( w, s, &base );
+			w.Flush ();
+			BitReader rd ( buf, w.getBytes() );
+			if ( !NetReadState ( rd, r, &base ) || !SameState ( r, s ) ) bad++;
+		}
+	}
+	printf ( "Codec, %d random states:\n", num );
+	printf ( "  position  max %.2f mm per axis (bound %.2f mm)\n", max_pos * 1000, pos_bound * 1000 );
+	printf ( "  velocity  max %.2f mm/s per axis (bound %.2f mm/s)\n", max_vel * 1000, vel_step * 1000 );
+	printf ( "  rotation  max %.4f deg (bound %.4f deg)\n", max_ang * 180 / 3.14159265, ang_bound * 180 / 3.14159265 );
+	printf ( "  controls  max roll %.4f, pitch %.4f, power %.3f, flaps %.3f\n", max_ctrl[0], max_ctrl[1], max_ctrl[2], max_ctrl[3] );
+	printf ( "  full state %.1f bytes, %d out of bounds or not bit exact\n", full_bits / 8.0 / num, bad );
+
+	// Steady flight at 60 Hz, deltas against baselines of several ages
+	FlightModel m;
+	int i = m.AddAircraft ( Vec3F(0, 1000, 0), Vec3F(0, 0, 120), 3 );
+	m.setControls ( i, 0.2f, 0.05f, 3, 0 );
+	std::vector<NetState> ticks;
+	for (int t = 0; t < 60 * 30; t++) {
+		for (int s = 0; s < 17; s++) m.Advance ( LOOP_DT );
+		NetState s;
+		NetQuantize ( s, m.getPos(i), m.getVel(i), m.getOrient(i), m.m_roll[i], m.m_pitch[i], m.m_power[i], m.m_flaps[i] );
+		ticks.push_back ( s );
+	}
+	printf ( "  steady flight, delta bytes against a baseline" );
+	for (int a = 0; a < DELTA_AGES; a++) {
+		int age = 1 << a;
+		long long bits = 0, count = 0;
+		for (size_t t = age; t < ticks.size(); t++) {
+			BitWriter w ( buf, sizeof(buf) );
+			NetWriteState ( w, ticks[t], &ticks[t - age] );
+			w.Flush ();
+			NetState r;
+			BitReader rd ( buf, w.getBytes() );
+			if ( !NetReadState ( rd, r, &ticks[t - age] ) || !SameState ( r, ticks[t] ) ) bad++;
+			bits += w.getBits ();
+			count++;
+		}
+		printf ( "%s %d old %.1f", a ? "," : "", age, bits / 8.0 / count );
+	}
+	printf ( "\n" );
+	return bad == 0;
+}
+
+//----------------------------------------------------------- loopback
+
+// Forwards datagrams between two stations, dropping some. Station A talks
+// to port a, B to port b, so each sees the relay as its peer.
+struct Relay {
+	intptr_t	sock[2];
+	uint16_t	to[2];					// station port each socket forwards to
+	float		loss;
+	int			forwarded, dropped;
+
+	bool Open ( uint16_t a, uint16_t b, uint16_t sta, uint16_t stb, float lossp )
+	{
+		uint16_t port[2] = { a, b };
+		to[0] = stb;					// from A, on to B
+		to[1] = sta;
+		loss = lossp;
+		forwarded = dropped = 0;
+		for (int k = 0; k < 2; k++) {
+			#ifdef _WIN32
+				SOCKET s = socket ( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+				u_long nonblock = 1;
+				ioctlsocket ( s, FIONBIO, &nonblock );
+			#else
+				int s = socket ( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+				fcntl ( s, F_SETFL, fcntl ( s, F_GETFL, 0 ) | O_NONBLOCK );
+			#endif
+			sockaddr_in addr;
+			memset ( &addr, 0, sizeof(addr) );
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+			addr.sin_port = htons ( port[k] );
+			if ( bind ( s, (sockaddr*) &addr, sizeof(addr) ) != 0 ) {
+				fprintf ( stderr, "ERROR: Unable to bind UDP port %d\n", port[k] );
+				CLOSE_SOCKET ( s );
+				return false;
+			}
+			sock[k] = (intptr_t) s;
+		}
+		return true;
+	}
+	void Close ()
+	{
+		for (int k = 0; k < 2; k++) CLOSE_SOCKET ( sock[k] );
+	}
+	void Pump ()
+	{
+		char buf[NET_MAX_PACKET];
+		for (int k = 0; k < 2; k++) {
+			for (;;) {
+				int n = (int) recv ( sock[k], buf, sizeof(buf), 0 );
+				if ( n <= 0 ) break;
+				if ( Rand() < loss ) { dropped++; continue; }
+				sockaddr_in addr;
+				memset ( &addr, 0, sizeof(addr) );
+				addr.sin_family = AF_INET;
+				addr.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+				addr.sin_port = htons ( to[k] );
+				sendto ( sock[1-k], buf, n, 0, (sockaddr*) &addr, sizeof(addr) );		// from the other side's socket
+				forwarded++;
+			}
+		}
+	}
+};
+
+static bool CheckLoopback ( int port, float sec, float loss )
+{
+	NetSync a, b;
+	Relay relay;
+	if ( !a.Open ( 1, port, 60 ) || !b.Open ( 2, port+1, 60 ) || !relay.Open ( port+2, port+3, port, port+1, loss ) ) return false;
+	a.AddPeer ( "127.0.0.1", port+2 );
+	b.AddPeer ( "127.0.0.1", port+3 );
+
+	FlightModel ma, mb;
+	int ia = ma.AddAircraft ( Vec3F(0, 1000, 0), Vec3F(0, 0, 120), 3 );
+	int ib = mb.AddAircraft ( Vec3F(2000, 1000, 0), Vec3F(0, 0, 120), 3 );
+	a.AddLocal ( ia );
+	b.AddLocal ( ib );
+
+	double sum_err = 0, max_err = 0;
+	long long samples = 0;
+	int steps = (int) (sec / LOOP_DT);
+	auto start = std::chrono::steady_clock::now ();
+	for (int s = 0; s < steps; s++) {
+		// A turns and climbs, then levels off and turns back
+		float t = s * LOOP_DT;
+		ma.setControls ( ia, (fmodf ( t, 4 ) < 2) ? 0.4f : -0.4f, (t < sec/2) ? 0.1f : 0.0f, 3, 0 );
+		ma.Advance ( LOOP_DT );
+		mb.Advance ( LOOP_DT );
+		a.Update ( ma, LOOP_DT );
+		b.Update ( mb, LOOP_DT );
+		relay.Pump ();
+
+		int remote = b.getPeer(0).index[0];
+		if ( remote >= 0 ) {
+			double e = (mb.getPos ( remote ) - ma.getPos ( ia )).Length ();
+			sum_err += e;
+			max_err = std::max ( max_err, e );
+			samples++;
+		}
+		std::this_thread::sleep_until ( start + std::chrono::microseconds ( (long long) ((s+1) * LOOP_DT * 1e6) ) );
+	}
+
+	const NetPeer& pa = a.getPeer ( 0 );
+	bool heard = samples > 0;
+	uint64_t rejected = a.getPacketsDropped () + b.getPacketsDropped ();
+	printf ( "Loopback, %.0f%% loss each way, %g s at 60 Hz:\n", loss * 100, sec );
+	printf ( "  A sent %llu packets of %.1f bytes, B sent %llu, relay dropped %d of %d, %llu rejected\n",
+		(unsigned long long) a.getPacketsSent(), a.getPacketsSent() ? a.getBytesSent() / (double) a.getPacketsSent() : 0.0,
+		(unsigned long long) b.getPacketsSent(), relay.dropped, relay.dropped + relay.forwarded, (unsigned long long) rejected );
+	printf ( "  round trip %.2f ms, remote position error mean %.3f m, max %.3f m\n",
+		pa.rtt * 1000, samples ? sum_err / samples : 0.0, max_err );
+
+	relay.Close ();
+	a.Close ();
+	b.Close ();
+	if ( !heard ) fprintf ( stderr, "ERROR: B never heard from A.\n" );
+	if ( rejected ) fprintf ( stderr, "ERROR: Packets rejected, a baseline was missing or a packet malformed.\n" );
+	if ( loss == 0 && max_err > LOOP_MAX_ERROR ) fprintf ( stderr, "ERROR: Remote error beyond %g m with no loss.\n", LOOP_MAX_ERROR );
+	return heard && rejected == 0 && ( loss > 0 || max_err <= LOOP_MAX_ERROR );
+}
+
+int main ( int argc, char** argv )
+{
+	int num = 200000, port = 47000;
+	float sec = 5, loss = -1;
+	for (int a = 1; a < argc; a++) {
+		if      ( strcmp ( argv[a], "-n" ) == 0 && a+1 < argc )	num = atoi ( argv[++a] );
+		else if ( strcmp ( argv[a], "-t" ) == 0 && a+1 < argc )	sec = (float) atof ( argv[++a] );
+		else if ( strcmp ( argv[a], "-l" ) == 0 && a+1 < argc )	loss = (float) atof ( argv[++a] ) / 100;
+		else if ( strcmp ( argv[a], "-p" ) == 0 && a+1 < argc )	port = atoi ( argv[++a] );
+		else {
+			fprintf ( stderr, "Usage: net_check [-n states] [-t sec] [-l loss%%] [-p port]\n" );
+			return 1;
+		}
+	}
+	bool ok = CheckCodec ( num );
+
+	std::vector<float> losses;
+	if ( loss >= 0 )	losses.push_back ( loss );
+	else				{ losses.push_back ( 0 ); losses.push_back ( 0.1f ); losses.push_back ( 0.3f ); }
+	for (size_t k = 0; k < losses.size(); k++)
+		ok &= CheckLoopback ( port, sec, losses[k] );
+
+	printf ( "%s\n", ok ? "PASS" : "FAIL" );
+	return ok ? 0 : 1;
+}
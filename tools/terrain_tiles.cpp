@@ -0,0 +1,133 @@
+//--------------------------------------------------------
+//
+// Terrain tiles - writes a synthetic DEM tile set for Terrain
+//
+// Generates rolling hills from a few octaves of value noise, flattened to
+// sea level around the runway at the origin, and writes one .dem tile per
+// file with the terrain.txt that Terrain::Open reads. Real DEMs can be cut
+// into the same layout: a DemTileHeader and samples x samples int16 heights
+// per tile, rows along z, edge samples shared with the neighbouring tile.
+//
+// Usage:  terrain_tiles <dir> [-n tiles] [-s samples] [-d spacing] [-h height]
+//   -n   tiles per side, centered on the origin (default 16)
+//   -s   samples per tile side (default 257)
+//   -d   sample spacing in meters (default 30)
+//   -h   peak height in meters (default 1500)
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "terrain.h"
+
+#define FLAT_RADIUS		4000.0f			// sea level within this of the origin (m)
+#define BLEND_RADIUS	8000.0f			// full height beyond this
+
+static float Lattice ( int x, int z, int octave )
+{
+	uint32_t h = uint32_t(x) * 374761393u + uint32_t(z) * 668265263u + uint32_t(octave) * 2246822519u;
+	h = (h ^ (h >> 13)) * 1274126177u;
+	return ((h ^ (h >> 16)) & 0xFFFF) / 65535.0f;
+}
+
+static float ValueNoise ( float x, float z, int octave )
+{
+	int ix = (int) floorf ( x ), iz = (int) floorf ( z );
+	float u = x - ix, v = z - iz;
+	u = u*u*(3 - 2*u);
+	v = v*v*(3 - 2*v);
+	float a = Lattice ( ix, iz, octave ), b = Lattice ( ix+1, iz, octave );
+	float c = Lattice ( ix, iz+1, octave ), d = Lattice ( ix+1, iz+1, octave );
+	return (a + (b-a)*u) + ((c + (d-c)*u) - (a + (b-a)*u)) * v;
+}
+
+static float HillHeight ( float x, float z, float peak )
+{
+	float h = 0, amp = 0.5f, freq = 1.0f / 12000.0f;
+	for (int o = 0; o < 6; o++, amp *= 0.5f, freq *= 2)
+		h += amp * ValueNoise ( x * freq, z * freq, o );
+
+	float r = sqrtf ( x*x + z*z );
+	float t = (r - FLAT_RADIUS) / (BLEND_RADIUS - FLAT_RADIUS);
+	t = (t < 0) ? 0 : (t > 1) ? 1 : t*t*(3 - 2*t);
+	return peak * h * t;
+}
+
+int main ( int argc, char** argv )
+{
+	const char* dir = 0x0;
+	int tiles = 16, samples = 257;
+	float spacing = 30, peak = 1500;
+	for (int a = 1; a < argc; a++) {
+		if      ( strcmp ( argv[a], "-n" ) == 0 && a+1 < argc )	tiles = atoi ( argv[++a] );
+		else if ( strcmp ( argv[a], "-s" ) == 0 && a+1 < argc )	samples = atoi ( argv[++a] );
+		else if ( strcmp ( argv[a], "-d" ) == 0 && a+1 < argc )	spacing = atof ( argv[++a] );
+		else if ( strcmp ( argv[a], "-h" ) == 0 && a+1 < argc )	peak = atof ( argv[++a] );
+		else if ( argv[a][0] != '-' )							dir = argv[a];
+		else { dir = 0x0; break; }
+	}
+	if ( dir == 0x0 || tiles < 1 || samples < 2 || spacing <= 0 ) {
+		fprintf ( stderr, "Usage: terrain_tiles <dir> [-n tiles] [-s samples] [-d spacing] [-h height]\n" );
+		return 1;
+	}
+
+	char fname[1024];
+	snprintf ( fname, 1024, "%s/terrain.txt", dir );
+	FILE* fp = fopen ( fname, "wt" );
+	if ( fp == 0x0 ) {
+		fprintf ( stderr, "ERROR: Unable to write %s\n", fname );
+		return 1;
+	}
+	fprintf ( fp, "# Terrain tiles, see terrain.h\nsamples %d\nspacing %g\n", samples, spacing );
+	fclose ( fp );
+
+	float tile_size = (samples - 1) * spacing;
+	float scale = 0.1f;							// decimeters
+	std::vector<int16_t> h ( size_t(samples) * samples );
+	int t0 = -tiles / 2;
+
+	for (int tz = t0; tz < t0 + tiles; tz++) {
+		for (int tx = t0; tx < t0 + tiles; tx++) {
+			DemTileHeader hdr;
+			memset ( &hdr, 0, sizeof(hdr) );
+			memcpy ( hdr.magic, DEMTILE_MAGIC, 4 );
+			hdr.version = DEMTILE_VERSION;
+			hdr.header_size = sizeof(DemTileHeader);
+			hdr.samples = samples;
+			hdr.tile_x = tx;
+			hdr.tile_z = tz;
+			hdr.spacing = spacing;
+			hdr.height_scale = scale;
+			hdr.height_offset = 0;
+			hdr.min_height = 1e30f;
+			hdr.max_height = -1e30f;
+			for (int j = 0; j < samples; j++) {
+				for (int i = 0; i < samples; i++) {
+					float y = HillHeight ( tx * tile_size + i * spacing, tz * tile_size + j * spacing, peak );
+					int16_t q = (int16_t) fminf ( 32767.0f, floorf ( y / scale + 0.5f ) );
+					h[ j*samples + i ] = q;
+					hdr.min_height = fminf ( hdr.min_height, q * scale );
+					hdr.max_height = fmaxf ( hdr.max_height, q * scale );
+				}
+			}
+			snprintf ( fname, 1024, "%s/tile_%d_%d.dem", dir, tx, tz );
+			fp = fopen ( fname, "wb" );
+			if ( fp == 0x0 ) {
+				fprintf ( stderr, "ERROR: Unable to write %s\n", fname );
+				return 1;
+			}
+			fwrite ( &hdr, sizeof(hdr), 1, fp );
+			fwrite ( h.data(), sizeof(int16_t), h.size(), fp );
+			fclose ( fp );
+		}
+	}
+	fprintf ( stderr, "%d x %d tiles of %d samples, %g m spacing (%g km per side) in %s\n",
+		tiles, tiles, samples, spacing, tiles * tile_size / 1000, dir );
+	return 0;
+}
@@ -0,0 +1,47 @@
+//--------------------------------------------------------
+//
+// Triple buffer - lock-free latest-value handoff from one writer to one reader
+//
+// Three copies of T: the writer fills its back copy and publishes it by
+// swapping it with the middle one; the reader takes the middle one, if it
+// is newer than what it has, by swapping it with its front copy. Both swaps
+// are a single atomic exchange of a slot index, so neither side ever waits.
+// The writer may publish many times between reads, the reader always sees
+// the latest complete value and never a partly written one.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_TRIPLE_BUFFER
+	#define DEF_TRIPLE_BUFFER
+
+	#include <atomic>
+
+	template<class T> class TripleBuffer {
+	public:
+		TripleBuffer () : m_middle ( 1 ), m_back ( 0 ), m_front ( 2 )	{}
+
+		// Writer
+		T&			Back ()				{ return m_slots[m_back]; }
+		void		Publish ()			{ m_back = m_middle.exchange ( m_back | FRESH, std::memory_order_acq_rel ) & INDEX; }
+
+		// Reader. Update returns true if a newer value was taken.
+		bool		Update () {
+			if ( !(m_middle.load ( std::memory_order_relaxed ) & FRESH) ) return false;
+			m_front = m_middle.exchange ( m_front, std::memory_order_acq_rel ) & INDEX;
+			return true;
+		}
+		const T&	Front ()			{ return m_slots[m_front]; }
+
+	private:
+		enum { INDEX = 3, FRESH = 4 };
+
+		alignas(64) T		m_slots[3];
+		alignas(64) std::atomic<int> m_middle;		// slot index, FRESH if published since the last Update
+		alignas(64) int		m_back;					// writer only
+		alignas(64) int		m_front;				// reader only
+	};
+
+#endif
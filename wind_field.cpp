@@ -0,0 +1,239 @@
+//--------------------------------------------------------
+//
+// Wind field - altitude shear and Dryden turbulence from cached 4D tiles
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#include "wind_field.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#define TILE_LIMIT		1.0e9f				// tile coordinates beyond this have no turbulence
+#define WIND_QUANT		4096.0f				// int16 units per standard deviation, +/- 8 sigma
+#define WIND_MIN_WAVE	(4 * WIND_SPACING)	// shortest wavelength, 2 cells a half wave (m)
+#define WIND_MAX_WAVE	2048.0f				// longest wavelength (m)
+#define FT				3.28084f			// ft per m, the Dryden model is given in feet
+
+static const int WIND_POINTS = WIND_CELLS + 1;					// per side, tiles share edges
+static const int WIND_STORED = WIND_FRAMES + 1;				// frame 0 again at the end, so frame pairs are adjacent
+static const int WIND_TILE_VALUES = (WIND_LEVELS+1) * WIND_POINTS * WIND_POINTS * WIND_STORED * 3;
+static const float TWO_PI = 6.283185307f;
+
+// splitmix64
+static inline uint64_t NextRandom ( uint64_t& s )
+{
+	uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+static inline float Uniform ( uint64_t& s )		{ return (float) (NextRandom ( s ) >> 40) * (1.0f / 16777216.0f); }
+
+// MIL-F-8785C low altitude length scales (m) at height h (m), blended to
+// the medium altitude 1750 ft between 1000 and 2000 ft
+static void DrydenScales ( float h, float& Lu, float& Lw )
+{
+	float hf = std::max ( h * FT, 10.0f );
+	float lo = std::min ( hf, 1000.0f );
+	float lu = lo / powf ( 0.177f + 0.000823f * lo, 1.2f ), lw = lo;
+	float t = std::min ( std::max ( (hf - 1000.0f) / 1000.0f, 0.0f ), 1.0f );
+	Lu = (lu + (1750.0f - lu) * t) / FT;
+	Lw = (lw + (1750.0f - lw) * t) / FT;
+}
+
+// Dryden spectra, per unit variance, at wavenumber k (rad/m)
+static inline float SpectrumU ( float L, float k )	{ float x = L*k; return (2.0f * L / 3.14159265f) / (1 + x*x); }
+static inline float SpectrumW ( float L, float k )	{ float x = L*k; return (L / 3.14159265f) * (1 + 3*x*x) / ((1 + x*x) * (1 + x*x)); }
+
+WindField::WindField ()
+{
+	m_shear = 1.0f / 7.0f;
+	m_w20 = 0;
+	m_data = 0x0;
+	m_misses = 0;
+	memset ( m_k, 0, sizeof(m_k) );
+	memset ( m_phase, 0, sizeof(m_phase) );
+	memset ( m_omega, 0, sizeof(m_omega) );
+	MakeProfile ();
+}
+
+void WindField::Open ( uint32_t seed )
+{
+	Close ();
+	MakeWaves ( seed );
+
+	m_data = new int16_t[ WIND_SLOTS * WIND_TILE_VALUES ];
+	m_misses = 0;
+	m_cache.Open ( WIND_SLOTS, WIND_CELLS * WIND_SPACING, Generate, 0x0, this );		// recycled slots are overwritten
+}
+
+void WindField::Close ()
+{
+	if ( m_data == 0x0 ) return;
+	m_cache.Close ();
+	delete [] m_data;
+	m_data = 0x0;
+}
+
+void WindField::MakeWaves ( uint32_t seed )
+{
+	uint64_t rnd = (uint64_t) seed * 0x9E3779B97F4A7C15ull;
+
+	// Wavenumbers log spaced over the band the grid resolves, directions
+	// uniform on the sphere, and 1 or 2 cycles per period in time
+	float kmin = TWO_PI / WIND_MAX_WAVE, kmax = TWO_PI / WIND_MIN_WAVE;
+	float span = logf ( kmax / kmin );
+	float kn[WIND_MODES], dk[WIND_MODES];
+	for (int n = 0; n < WIND_MODES; n++) {
+		kn[n] = kmin * expf ( span * (n + Uniform ( rnd )) / WIND_MODES );
+		dk[n] = kn[n] * span / WIND_MODES;
+		float cz = 2 * Uniform ( rnd ) - 1, a = TWO_PI * Uniform ( rnd );
+		float r = sqrtf ( 1 - cz*cz );
+		m_k[n][0] = kn[n] * r * cosf(a);
+		m_k[n][1] = kn[n] * cz;
+		m_k[n][2] = kn[n] * r * sinf(a);
+		for (int c = 0; c < 3; c++) m_phase[n][c] = TWO_PI * Uniform ( rnd );
+		m_omega[n] = TWO_PI * (1 + (NextRandom ( rnd ) & 1)) / WIND_PERIOD;
+	}
+
+	// Amplitudes per level from the spectra at its height, scaled to unit variance
+	m_amp.resize ( (WIND_LEVELS+1) * WIND_MODES * 3 );
+	for (int l = 0; l <= WIND_LEVELS; l++) {
+		float Lu, Lw;
+		DrydenScales ( l * WIND_LEVEL_SPACING, Lu, Lw );
+		float* amp = &m_amp[ l * WIND_MODES * 3 ];
+		float var[3] = { 0, 0, 0 };
+		for (int n = 0; n < WIND_MODES; n++) {
+			float au = sqrtf ( 2 * SpectrumU ( Lu, kn[n] ) * dk[n] ), aw = sqrtf ( 2 * SpectrumW ( Lw, kn[n] ) * dk[n] );
+			amp[n*3+0] = au;	amp[n*3+1] = aw;	amp[n*3+2] = au;
+			for (int c = 0; c < 3; c++) var[c] += amp[n*3+c] * amp[n*3+c] * 0.5f;
+		}
+		for (int n = 0; n < WIND_MODES; n++)
+			for (int c = 0; c < 3; c++) amp[n*3+c] /= sqrtf ( var[c] );
+	}
+}
+
+void WindField::MakeProfile ()
+{
+	// Vertical intensity is 0.1 W20 at all heights, horizontal is larger near
+	// the ground and equal from 2000 ft
+	for (int e = 0; e <= WIND_PROFILE; e++) {
+		float h = e * WIND_PROFILE_STEP;
+		float hf = std::max ( h * FT, 10.0f );
+		float lo = std::min ( hf, 1000.0f );
+		float ratio = 1.0f / powf ( 0.177f + 0.000823f * lo, 0.4f );
+		float t = std::min ( std::max ( (hf - 1000.0f) / 1000.0f, 0.0f ), 1.0f );
+		m_profile[e][0] = powf ( std::max ( h, 1.0f ) / WIND_REF_HEIGHT, m_shear );
+		m_profile[e][2] = 0.1f * m_w20;
+		m_profile[e][1] = m_profile[e][2] * (ratio + (1 - ratio) * t);
+	}
+}
+
+void WindField::Generate ( void* ctx, int slot, int tx, int tz )
+{
+	const WindField* wf = (const WindField*) ctx;
+	// Time part of every phase, per mode, component and frame. Then a wave at
+	// a point is cos(k.p) cos(th) - sin(k.p) sin(th), one sincos per point and mode.
+	static const float frame_dt = WIND_PERIOD / WIND_FRAMES;
+	float ct[WIND_MODES][3][WIND_STORED], st[WIND_MODES][3][WIND_STORED];
+	for (int n = 0; n < WIND_MODES; n++)
+		for (int c = 0; c < 3; c++)
+			for (int f = 0; f < WIND_STORED; f++) {
+				float th = wf->m_phase[n][c] + wf->m_omega[n] * f * frame_dt;
+				ct[n][c][f] = cosf ( th );
+				st[n][c][f] = sinf ( th );
+			}
+
+	const double x0 = tx * double(WIND_CELLS * WIND_SPACING), z0 = tz * double(WIND_CELLS * WIND_SPACING);
+	int16_t* out = wf->m_data + size_t(slot) * WIND_TILE_VALUES;
+	float acc[WIND_STORED][3];
+
+	for (int l = 0; l <= WIND_LEVELS; l++) {
+		const float* amp = &wf->m_amp[ l * WIND_MODES * 3 ];
+		double y = l * WIND_LEVEL_SPACING;
+		for (int j = 0; j < WIND_POINTS; j++) {
+			double z = z0 + j * WIND_SPACING;
+			for (int i = 0; i < WIND_POINTS; i++) {
+				double x = x0 + i * WIND_SPACING;
+				memset ( acc, 0, sizeof(acc) );
+				for (int n = 0; n < WIND_MODES; n++) {
+					const float* k = wf->m_k[n];
+					double kp = k[0] * x + k[1] * y + k[2] * z;		// double, far tiles have large phases
+					float cp = (float) cos ( kp ), sp = (float) sin ( kp );
+					for (int c = 0; c < 3; c++) {
+						float ac = amp[n*3+c] * cp, as = amp[n*3+c] * sp;
+						for (int f = 0; f < WIND_STORED; f++)
+							acc[f][c] += ac * ct[n][c][f] - as * st[n][c][f];
+					}
+				}
+				for (int f = 0; f < WIND_STORED; f++)
+					for (int c = 0; c < 3; c++) {
+						float q = floorf ( acc[f][c] * WIND_QUANT + 0.5f );
+						*out++ = (int16_t) std::min ( std::max ( q, -32767.0f ), 32767.0f );
+					}
+			}
+		}
+	}
+}
+
+void WindField::UpdateFocus ( int num, const float* px, const float* pz, float radius )
+{
+	m_cache.UpdateFocus ( num, px, pz, radius );
+}
+
+void WindField::Wait ()
+{
+	m_cache.Wait ();
+}
+
+Vec3F WindField::Sample ( Vec3F mean, float x, float h, float z, double t, int& slot ) const
+{
+	// Shear and intensity at h
+	float e = std::min ( std::max ( h / WIND_PROFILE_STEP, 0.0f ), (float) WIND_PROFILE );
+	int k = std::min ( (int) e, WIND_PROFILE-1 );
+	e -= k;
+	const float* p0 = m_profile[k];
+	const float* p1 = m_profile[k+1];
+	Vec3F w = mean * (p0[0] + (p1[0] - p0[0]) * e);
+	float sh = p0[1] + (p1[1] - p0[1]) * e, sv = p0[2] + (p1[2] - p0[2]) * e;
+	if ( m_data == 0x0 || sv == 0 ) return w;
+
+	const float inv_tile = 1.0f / (WIND_CELLS * WIND_SPACING);
+	float fx = x * inv_tile, fz = z * inv_tile;
+	if ( !(fabs(fx) < TILE_LIMIT && fabs(fz) < TILE_LIMIT) ) return w;
+	int tx = (int) floorf ( fx ), tz = (int) floorf ( fz );
+	uint64_t key = CellTable::Key ( tx, tz );
+
+	if ( !m_cache.Ready ( key, slot ) ) { m_misses.fetch_add ( 1, std::memory_order_relaxed ); return w; }
+
+	// Cell and fractions in x, z, level and frame
+	float u = (fx - tx) * WIND_CELLS, v = (fz - tz) * WIND_CELLS;
+	float g = std::min ( std::max ( h / WIND_LEVEL_SPACING, 0.0f ), (float) WIND_LEVELS );
+	double tf = t * (WIND_FRAMES / WIND_PERIOD);
+	float ft = (float) (tf - floor ( tf / WIND_FRAMES ) * WIND_FRAMES);
+	int i = std::min ( (int) u, WIND_CELLS-1 ), j = std::min ( (int) v, WIND_CELLS-1 );
+	int l = std::min ( (int) g, WIND_LEVELS-1 ), f = std::min ( (int) ft, WIND_FRAMES-1 );
+	u -= i; v -= j; g -= l; ft -= f;
+
+	// 16 corners, as 4 runs of two points with two frames each
+	const int XS = WIND_STORED * 3, ZS = WIND_POINTS * XS, LS = WIND_POINTS * ZS;
+	const int16_t* base = m_data + size_t(slot) * WIND_TILE_VALUES + l * LS + j * ZS + i * XS + f * 3;
+	const int off[4] = { 0, ZS, LS, LS + ZS };
+	float wlz[4] = { (1-g)*(1-v), (1-g)*v, g*(1-v), g*v };
+	float acc[3] = { 0, 0, 0 };
+	for (int k = 0; k < 4; k++) {
+		const int16_t* r = base + off[k];
+		float w0 = wlz[k] * (1-u) * (1-ft), w1 = wlz[k] * (1-u) * ft;		// x, frames f and f+1
+		float w2 = wlz[k] * u * (1-ft), w3 = wlz[k] * u * ft;				// x+1
+		for (int c = 0; c < 3; c++)
+			acc[c] += w0 * r[c] + w1 * r[3+c] + w2 * r[XS+c] + w3 * r[XS+3+c];
+	}
+	w.x += acc[0] * (sh / WIND_QUANT);
+	w.y += acc[1] * (sv / WIND_QUANT);
+	w.z += acc[2] * (sh / WIND_QUANT);
+	return w;
+}
@@ -0,0 +1,107 @@
+//--------------------------------------------------------
+//
+// Wind field - altitude shear and Dryden turbulence from cached 4D tiles
+//
+// Wind at a point is the mean wind scaled by a power law shear profile,
+// (h / WIND_REF_HEIGHT)^exponent, plus turbulence. h is height above the
+// ground. The turbulence follows the MIL-F-8785C low altitude Dryden model:
+// length scales and the horizontal to vertical intensity ratio vary with
+// height, and the vertical intensity is 0.1 of the wind at 20 ft (W20),
+// which sets the severity (light 7.5, moderate 15, severe 23 m/s).
+//
+// The turbulence is a sum of WIND_MODES travelling waves, each weighted by
+// the Dryden spectrum at its wavenumber for the height of every grid level.
+// That sum is far too slow to evaluate per aircraft per step, so it is
+// precomputed into tiles on a 4D grid: WIND_CELLS cells of WIND_SPACING on
+// the ground plane, WIND_LEVELS levels of WIND_LEVEL_SPACING up, and
+// WIND_FRAMES frames in time, periodic over WIND_PERIOD. A sample is a
+// quadrilinear lookup. Points are stored with all their frames together,
+// so the 16 corners of a lookup are 4 runs of adjacent memory. Wave phases
+// are global, so tiles match at their shared edges whatever order they
+// are made in.
+//
+// Tiles are generated only near aircraft, kept by a TileCache (tile_cache.h)
+// as Terrain tiles are. UpdateFocus, called from the stepping thread between
+// steps, requests tiles within a radius of the points given and recycles the
+// least recently needed ones. The cache's worker thread fills requested
+// tiles, so a step never waits on one. Where a tile
+// is not ready yet there is no turbulence, only the mean wind and shear.
+//
+// Samples are read-only and safe from the stepping threads. Each caller
+// keeps a slot hint, normally one per aircraft, as with Terrain heights.
+//
+//--------------------------------------------------------------------------------
+// Copyright 2019-2023 (c) Quanta Sciences, Rama Hoetzlein, ramakarl.com
+// MIT License. See app_flightsim.cpp for the full license text.
+//
+
+#ifndef DEF_WIND_FIELD
+	#define DEF_WIND_FIELD
+
+	#include <stdint.h>
+	#include <vector>
+	#include <atomic>
+	#include "vec.h"
+	#include "tile_cache.h"
+
+	#define WIND_CELLS			16			// grid cells per tile side
+	#define WIND_SPACING		64.0f		// horizontal grid spacing (m), tiles are 1024 m
+	#define WIND_LEVELS			12			// vertical grid cells
+	#define WIND_LEVEL_SPACING	64.0f		// (m), turbulence is that of the top level above 768 m
+	#define WIND_FRAMES			8			// time frames per period
+	#define WIND_PERIOD			32.0f		// turbulence repeats after (sec)
+	#define WIND_MODES			48			// waves summed per component
+	#define WIND_SLOTS			32			// resident tiles (200 KB each)
+	#define WIND_REF_HEIGHT		10.0f		// height the mean wind is given at (m)
+	#define WIND_PROFILE		256			// shear and intensity table entries, WIND_PROFILE_STEP apart
+	#define WIND_PROFILE_STEP	4.0f		// (m)
+
+	class WindField {
+	public:
+		WindField ();
+		~WindField ()		{ Close(); }
+
+		void		Open ( uint32_t seed = 1 );		// waves from seed, starts the generator
+		void		Close ();
+		bool		isOpen ()			{ return m_data != 0x0; }
+
+		// Before stepping or between steps. Tiles do not depend on these, so a
+		// change takes effect at once.
+		void		setShear ( float exponent )		{ m_shear = exponent; MakeProfile (); }	// 1/7 open ground, 1/4 town
+		void		setTurbulence ( float w20 )		{ m_w20 = w20; MakeProfile (); }			// m/s, 0 = none
+		float		getShear () const		{ return m_shear; }
+		float		getTurbulence () const	{ return m_w20; }
+
+		// Stepping thread, between steps: keep tiles within radius of the points
+		void		UpdateFocus ( int num, const float* px, const float* pz, float radius );
+		void		Wait ();						// until requested tiles are made
+
+		// Any thread. Wind at (x, z), h above ground, time t, for the mean wind at
+		// WIND_REF_HEIGHT. slot is the caller's hint, -1 initially.
+		Vec3F		Sample ( Vec3F mean, float x, float h, float z, double t, int& slot ) const;
+
+		int			getResident ()		{ return m_cache.getResident(); }	// tiles made or being made
+		int			getGenerated ()		{ return m_cache.getFilled(); }
+		int			getMisses ()		{ return m_misses.load(); }	// samples on tiles not made yet
+
+	private:
+		void		MakeWaves ( uint32_t seed );
+		void		MakeProfile ();
+		static void	Generate ( void* ctx, int slot, int tx, int tz );		// TileFunc, cache worker
+
+		// Waves, shared by all tiles
+		float		m_k[WIND_MODES][3];				// wave vector (rad/m)
+		float		m_phase[WIND_MODES][3];			// per component
+		float		m_omega[WIND_MODES];			// rad/sec, whole cycles per period
+		std::vector<float> m_amp;				// [level][mode][xyz], unit variance per level
+
+		// Shear and intensity by height
+		float		m_shear, m_w20;
+		float		m_profile[WIND_PROFILE+1][3];	// shear factor, horizontal and vertical sigma
+
+		int16_t*	m_data;							// per slot [level][z][x][frame][xyz], unit variance * WIND_QUANT
+		TileCache	m_cache;
+		mutable std::atomic<int> m_misses;
+	};
+
+#endif